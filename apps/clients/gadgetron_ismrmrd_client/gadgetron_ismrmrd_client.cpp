@@ -189,6 +189,9 @@ size_t compress_zfp_precision(float* in, size_t samples, size_t coils, unsigned
 namespace po = boost::program_options;
 using boost::asio::ip::tcp;
 
+// The client talks to the server either over TCP or, on the same host, over a local (Unix domain) socket
+typedef boost::asio::generic::stream_protocol::socket stream_socket;
+
 
 enum GadgetronMessageID {
     GADGET_MESSAGE_INT_ID_MIN                             =   0,
@@ -271,7 +274,7 @@ public:
     /**
     Function must be implemented to read a specific message.
     */
-    virtual void read(tcp::socket* s) = 0;
+    virtual void read(stream_socket* s) = 0;
 
 };
 
@@ -289,7 +292,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(stream_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -334,7 +337,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(stream_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -395,7 +398,7 @@ public:
     } 
 
     template <typename T> 
-    void read_data_attrib(tcp::socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
+    void read_data_attrib(stream_socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
     {
         im.setHead(h);
 
@@ -437,7 +440,7 @@ public:
         }
     }
 
-    virtual void read(tcp::socket* stream) 
+    virtual void read(stream_socket* stream) 
     {
         //Read the image headerfrom the socket
         ISMRMRD::ImageHeader h;
@@ -822,7 +825,7 @@ public:
     } 
 
     template <typename T>
-    void read_data_attrib(tcp::socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
+    void read_data_attrib(stream_socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
     {
         im.setHead(h);
 
@@ -910,7 +913,7 @@ public:
         outfileData.close();
     }
 
-    virtual void read(tcp::socket* stream) 
+    virtual void read(stream_socket* stream) 
     {
         //Read the image headerfrom the socket
         ISMRMRD::ImageHeader h;
@@ -987,7 +990,7 @@ public:
 
     virtual ~GadgetronClientBlobMessageReader() {}
 
-    virtual void read(tcp::socket* socket) 
+    virtual void read(stream_socket* socket) 
     {
 
         // MUST READ 32-bits
@@ -1142,7 +1145,7 @@ public:
         tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
         tcp::resolver::iterator end;
         
-        socket_ = new tcp::socket(io_service);
+        socket_ = new stream_socket(io_service);
         if (!socket_) {
             throw GadgetronClientException("Unable to create socket.");
         }
@@ -1157,7 +1160,7 @@ public:
                 //   boost::asio::connect(*socket_, iterator);
                 while (error && endpoint_iterator != end) {
                     socket_->close();
-                    socket_->connect(*endpoint_iterator++, error);
+                    socket_->connect(boost::asio::generic::stream_protocol::endpoint((endpoint_iterator++)->endpoint()), error);
                 }
                 cv.notify_all();
             });
@@ -1180,6 +1183,27 @@ public:
 
     }
 
+    void connect_local(std::string path)
+    {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        socket_ = new stream_socket(io_service);
+        if (!socket_) {
+            throw GadgetronClientException("Unable to create socket.");
+        }
+
+        boost::system::error_code error;
+        boost::asio::local::stream_protocol::endpoint local_endpoint(path);
+        socket_->connect(boost::asio::generic::stream_protocol::endpoint(local_endpoint), error);
+
+        if (error)
+            throw GadgetronClientException("Error connecting using local socket.");
+
+        reader_thread_ = boost::thread(boost::bind(&GadgetronClientConnector::read_task, this));
+#else
+        throw GadgetronClientException("Local sockets are not supported on this platform.");
+#endif
+    }
+
     void send_gadgetron_close() { 
         if (!socket_) {
             throw GadgetronClientException("Invalid socket.");
@@ -1499,7 +1523,7 @@ protected:
     }
 
     boost::asio::io_service io_service;
-    tcp::socket* socket_;
+    stream_socket* socket_;
     boost::thread reader_thread_;
     maptype readers_;
     unsigned int timeout_ms_;
@@ -1522,7 +1546,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(stream_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -1562,7 +1586,7 @@ public:
 };
 
 
-NoiseStatistics get_noise_statistics(std::string dependency_name, std::string host_name, std::string port, unsigned int timeout_ms)
+NoiseStatistics get_noise_statistics(std::string dependency_name, std::string host_name, std::string port, std::string local_socket, unsigned int timeout_ms)
 {
     GadgetronClientConnector con;
     con.set_timeout(timeout_ms);
@@ -1598,7 +1622,11 @@ NoiseStatistics get_noise_statistics(std::string dependency_name, std::string ho
     xml_config += "</gadgetronStreamConfiguration>\n";
 
     try {
-        con.connect(host_name,port);
+        if (local_socket.size()) {
+            con.connect_local(local_socket);
+        } else {
+            con.connect(host_name,port);
+        }
         con.send_gadgetron_configuration_script(xml_config);       
         con.send_gadgetron_close();
         con.wait();
@@ -1628,6 +1656,7 @@ int main(int argc, char **argv)
 
     std::string host_name;
     std::string port;
+    std::string local_socket;
     std::string in_filename;
     std::string out_filename;
     std::string hdf5_in_group;
@@ -1650,6 +1679,7 @@ int main(int argc, char **argv)
         ("query,q", "Dependency query mode")
         ("port,p", po::value<std::string>(&port)->default_value("9002"), "Port")
         ("address,a", po::value<std::string>(&host_name)->default_value("localhost"), "Address (hostname) of Gadgetron host")
+        ("local-socket,u", po::value<std::string>(&local_socket), "Local socket of Gadgetron host on this machine, used instead of address and port")
         ("filename,f", po::value<std::string>(&in_filename), "Input file")
         ("outfile,o", po::value<std::string>(&out_filename)->default_value("out.h5"), "Output file")
         ("in-group,g", po::value<std::string>(&hdf5_in_group)->default_value("/dataset"), "Input data group")
@@ -1767,7 +1797,7 @@ int main(int argc, char **argv)
             }
             
             std::cout << "Querying the Gadgetron instance for the dependent measurement: " << noise_id << std::endl; 
-            noise_stats = get_noise_statistics(std::string("GadgetronNoiseCovarianceMatrix_") + noise_id, host_name, port, timeout_ms);
+            noise_stats = get_noise_statistics(std::string("GadgetronNoiseCovarianceMatrix_") + noise_id, host_name, port, local_socket, timeout_ms);
             if (!noise_stats.status) {
                 std::cout << "WARNING: Dependent noise measurement not found on Gadgetron server. Was the noise data processed?" << std::endl;
                 if (compression_tolerance > 0.0) {
@@ -1798,7 +1828,11 @@ int main(int argc, char **argv)
     con.register_reader(GADGET_MESSAGE_TEXT, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientTextReader()));
 			
     try {
-        con.connect(host_name,port);
+        if (local_socket.size()) {
+            con.connect_local(local_socket);
+        } else {
+            con.connect(host_name,port);
+        }
         if (vm.count("config-local")) {
             con.send_gadgetron_configuration_script(config_xml_local);
         } else {
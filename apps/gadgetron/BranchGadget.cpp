@@ -0,0 +1,123 @@
+#include "BranchGadget.h"
+
+namespace Gadgetron{
+
+  namespace {
+
+    //Last gadget of every path, hands the path output back to the branch
+    class MergeGadget : public Gadget
+    {
+    public:
+      MergeGadget(BranchGadget* branch)
+        : branch_(branch)
+      {
+      }
+
+    protected:
+      virtual int process(ACE_Message_Block* m)
+      {
+        return branch_->merge(m);
+      }
+
+      BranchGadget* branch_;
+    };
+  }
+
+  BranchGadget::BranchGadget()
+    : Gadget()
+  {
+  }
+
+  BranchGadget::~BranchGadget()
+  {
+    close_paths();
+  }
+
+  ACE_Stream<ACE_MT_SYNCH>* BranchGadget::add_path()
+  {
+    Gadget* merge = new MergeGadget(this);
+    merge->set_controller(controller_);
+
+    ACE_Module<ACE_MT_SYNCH>* tail = 0;
+    ACE_NEW_RETURN(tail,
+                   ACE_Module<ACE_MT_SYNCH>(ACE_TEXT("BranchMerge"), merge),
+                   0);
+
+    ACE_Stream<ACE_MT_SYNCH>* path = new ACE_Stream<ACE_MT_SYNCH>();
+    if (path->open(0, 0, tail) == -1) {
+      GERROR("Failed to open branch path\n");
+      delete tail;
+      delete path;
+      return 0;
+    }
+
+    paths_.push_back(path);
+    return path;
+  }
+
+  int BranchGadget::close(unsigned long flags)
+  {
+    int rval = Gadget::close(flags);
+    if (flags == 1) {
+      close_paths();
+    }
+    return rval;
+  }
+
+  void BranchGadget::close_paths()
+  {
+    //Paths are closed one after the other, each waits for its gadgets to finish
+    for (size_t i = 0; i < paths_.size(); i++) {
+      paths_[i]->close();
+      delete paths_[i];
+    }
+    paths_.clear();
+  }
+
+  int BranchGadget::merge(ACE_Message_Block* m)
+  {
+    return this->put_next(m);
+  }
+
+  int BranchGadget::process(ACE_Message_Block* m)
+  {
+    return dispatch(m);
+  }
+
+  int BranchGadget::process_config(ACE_Message_Block* m)
+  {
+    //The configuration is passed on after the branch by the message loop, the paths get a reference
+    for (size_t i = 0; i < paths_.size(); i++) {
+      ACE_Message_Block* mb = m->duplicate();
+      if (paths_[i]->put(mb) == -1) {
+        GERROR("Failed to put configuration on branch path %d\n", i);
+        mb->release();
+        return GADGET_FAIL;
+      }
+    }
+    return GADGET_OK;
+  }
+
+  int BranchGadget::dispatch(ACE_Message_Block* m)
+  {
+    if (paths_.empty()) {
+      return this->next_step(m);
+    }
+
+    for (size_t i = 0; i+1 < paths_.size(); i++) {
+      ACE_Message_Block* mb = m->duplicate();
+      if (paths_[i]->put(mb) == -1) {
+        GERROR("Failed to put message on branch path %d\n", i);
+        mb->release();
+        return GADGET_FAIL;
+      }
+    }
+
+    if (paths_.back()->put(m) == -1) {
+      GERROR("Failed to put message on branch path %d\n", paths_.size()-1);
+      return GADGET_FAIL;
+    }
+
+    return GADGET_OK;
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef BRANCHGADGET_H
+#define BRANCHGADGET_H
+
+#include "Gadget.h"
+
+#include <vector>
+
+namespace Gadgetron{
+
+  /**
+     Runs parallel paths of gadgets on the same messages and merges their outputs.
+
+     Each path is a stream of its own, so the gadgets of different paths run concurrently.
+     Messages are shared between the paths by reference count (duplicate()), not copied:
+     gadgets on a path must not change the data they receive in place when another path
+     reads it too. Outputs of all paths are passed to the gadget after the branch in the
+     order they are produced.
+   */
+  class EXPORTGADGETBASE BranchGadget : public Gadget
+  {
+  public:
+    BranchGadget();
+    virtual ~BranchGadget();
+
+    /**
+       Add a path. Gadgets pushed onto the returned stream run on this path, the last pushed first.
+     */
+    ACE_Stream<ACE_MT_SYNCH>* add_path();
+
+    /**
+       Waits for the branch and then for every path to finish, so the outputs of the paths
+       reach the gadgets after the branch before those are closed
+     */
+    virtual int close(unsigned long flags);
+
+    /**
+       Pass a message leaving a path on to the gadget after the branch
+     */
+    int merge(ACE_Message_Block* m);
+
+  protected:
+    virtual int process(ACE_Message_Block* m);
+    virtual int process_config(ACE_Message_Block* m);
+
+    int dispatch(ACE_Message_Block* m);
+    void close_paths();
+
+    std::vector<ACE_Stream<ACE_MT_SYNCH>*> paths_;
+  };
+}
+
+#endif //BRANCHGADGET_H
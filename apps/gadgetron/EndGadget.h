@@ -18,13 +18,17 @@ class EndGadget : public Gadget
 	{
 		GDEBUG("Close called in EndGadget with flags %d\n", flags);
 
-		GadgetContainerMessage<GadgetMessageIdentifier>* mb =
-				new GadgetContainerMessage<GadgetMessageIdentifier>();
+		//At the end of a job the writer and the client keep going, the controller sends the job end instead
+		if (!controller_->ending_job()) {
+			GadgetContainerMessage<GadgetMessageIdentifier>* mb =
+					new GadgetContainerMessage<GadgetMessageIdentifier>();
 
-		mb->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+			mb->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
 
-		if (controller_->output_ready(mb) < 0) {
-			return GADGET_FAIL;
+			if (controller_->output_ready(mb) < 0) {
+				mb->release();
+				return GADGET_FAIL;
+			}
 		}
 
 		GDEBUG("Calling close in base class  with flags %d\n", flags);
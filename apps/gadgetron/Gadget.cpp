@@ -37,4 +37,93 @@ namespace Gadgetron
 
     return boost::shared_ptr<std::string>(new std::string(""));
   }
+
+  int GadgetMessageQueue::enqueue_tail(ACE_Message_Block* m, ACE_Time_Value* timeout)
+  {
+    //Account and throttle before taking the queue lock, so a blocked producer does not hold up the consumer
+    gadget_->enqueuing(m);
+
+    int rval = inherited::enqueue_tail(m, timeout);
+    if (rval == -1) {
+      gadget_->enqueue_failed(m);
+    } else {
+      gadget_->enqueued();
+    }
+    return rval;
+  }
+
+  int GadgetMessageQueue::dequeue_head(ACE_Message_Block*& m, ACE_Time_Value* timeout)
+  {
+    int rval = inherited::dequeue_head(m, timeout);
+    if (rval != -1) {
+      gadget_->dequeued(m);
+    }
+    return rval;
+  }
+
+  void Gadget::schedule_pooled()
+  {
+    bool expected = false;
+    if (pooled_scheduled_.compare_exchange_strong(expected, true)) {
+      GadgetThreadPool::instance()->submit(this);
+    }
+  }
+
+  void Gadget::run_pooled()
+  {
+    //A bounded batch per task, so a busy gadget does not hold on to a worker while others wait
+    const size_t max_messages_per_task = 64;
+
+    {
+      std::lock_guard<std::mutex> lock(pooled_mutex_);
+      if (pooled_done_) {
+        return;
+      }
+    }
+
+    //Workers never block on a full queue, a throttled downstream gadget parks this one instead.
+    //It stays marked as scheduled, so messages put meanwhile do not submit it again.
+    Gadget* downstream = dynamic_cast<Gadget*>(this->next());
+
+    bool done = false;
+    for (size_t n = 0; n < max_messages_per_task; n++) {
+      if (downstream && downstream->park_upstream(this)) {
+        //Resubmitted by the downstream gadget once its queue drains, possibly already running elsewhere
+        return;
+      }
+
+      ACE_Message_Block* m = 0;
+      ACE_Time_Value nowait(ACE_OS::gettimeofday());
+      if (this->getq(m, &nowait) == -1) {
+        break;
+      }
+
+      if (m->msg_type() == ACE_Message_Block::MB_HANGUP) {
+        m->release();
+        done = true;
+        break;
+      }
+
+      if (this->handle_message(m) == GADGET_FAIL) {
+        done = true;
+        break;
+      }
+    }
+
+    if (done) {
+      this->close_queue();
+      std::lock_guard<std::mutex> lock(pooled_mutex_);
+      pooled_done_ = true;
+      pooled_cond_.notify_all();
+      return;
+    }
+
+    //Messages put while this task was running did not reschedule it, pick them up now.
+    //The lock keeps the gadget from finishing on another worker and being deleted meanwhile.
+    std::lock_guard<std::mutex> lock(pooled_mutex_);
+    pooled_scheduled_ = false;
+    if (!this->msg_queue()->is_empty()) {
+      this->schedule_pooled();
+    }
+  }
 }
@@ -12,9 +12,18 @@
 
 #include <map>
 #include <string>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 #include "gadgetbase_export.h"
+#include "GadgetThreadPool.h"
+#include "GadgetStatistics.h"
 #include "GadgetContainerMessage.h"
 #include "GadgetronExport.h"
 #include "gadgetron_config.h"
@@ -93,6 +102,56 @@ namespace Gadgetron{
   //Forward declarations
   class GadgetStreamInterface;
 
+  /**
+     Queue limits of a gadget. A limit of 0 is unbounded.
+   */
+  struct GadgetQueueLimits
+  {
+    GadgetQueueLimits()
+    : high_water_bytes(0), low_water_bytes(0), high_water_messages(0), low_water_messages(0)
+    {
+    }
+
+    size_t high_water_bytes;
+    size_t low_water_bytes;
+    size_t high_water_messages;
+    size_t low_water_messages;
+  };
+
+  class Gadget;
+
+  /**
+     Message queue of a gadget. Every message entering the queue is accounted against the
+     gadget's queue limits here, and schedules the gadget when it runs on the thread pool,
+     whether it was put with Gadget::put, put_next or directly with next()->putq(), as most
+     gadgets forward their output.
+   */
+  class EXPORTGADGETBASE GadgetMessageQueue : public ACE_Message_Queue<ACE_MT_SYNCH>
+  {
+  public:
+    typedef ACE_Message_Queue<ACE_MT_SYNCH> inherited;
+
+    GadgetMessageQueue(Gadget* gadget)
+    : inherited()
+    , gadget_(gadget)
+    {
+    }
+
+    /**
+       Account a data message and enqueue it; blocks the caller while the gadget's queue is throttled.
+       A pooled gadget is scheduled once the message is on the queue.
+     */
+    virtual int enqueue_tail(ACE_Message_Block* m, ACE_Time_Value* timeout = 0);
+
+    /**
+       Dequeue a message and release its accounting
+     */
+    virtual int dequeue_head(ACE_Message_Block*& m, ACE_Time_Value* timeout = 0);
+
+  protected:
+    Gadget* gadget_;
+  };
+
   class EXPORTGADGETBASE Gadget : public ACE_Task<ACE_MT_SYNCH>
   {
 
@@ -101,7 +160,8 @@ namespace Gadgetron{
 
     enum
     {
-      GADGET_MESSAGE_CONFIG = (ACE_Message_Block::USER_FLAGS << 1)
+      GADGET_MESSAGE_CONFIG = (ACE_Message_Block::USER_FLAGS << 1),
+      GADGET_MESSAGE_QUEUED = (ACE_Message_Block::USER_FLAGS << 3) //Self flag, duplicates share the data block flags
     };
 
     Gadget()
@@ -110,15 +170,26 @@ namespace Gadgetron{
     , pass_on_undesired_data_(false)
     , controller_(0)
     , parameter_mutex_("GadgetParameterMutex")
+    , queued_bytes_(0)
+    , queued_messages_(0)
+    , queue_throttled_(false)
+    , queue_closed_(false)
+    , pooled_(false)
+    , pooled_scheduled_(false)
+    , pooled_done_(false)
     {
 
       gadgetron_version_ = std::string(GADGETRON_VERSION_STRING) + std::string(" (") +
       std::string(GADGETRON_GIT_SHA1_HASH) + std::string(")");
 
+      //Replace the default queue, so every message put on this gadget is accounted, the task deletes it
+      this->msg_queue(new GadgetMessageQueue(this));
+      this->delete_msg_queue_ = true;
     }
 
     virtual ~Gadget()
     {
+      GadgetStatisticsRegistry::instance()->remove(this);
       if (this->module()) {
         GDEBUG("Shutting down Gadget (%s)\n", this->module()->name());
       }
@@ -132,14 +203,83 @@ namespace Gadgetron{
 
     virtual int open(void* = 0)
     {
+      GadgetStatisticsRegistry::instance()->add(this);
+
+      //Gadgets asking for several threads keep their own, the others run on the shared pool when enabled
+      if (GadgetThreadPool::instance()->enabled() && this->desired_threads() == 1) {
+        pooled_ = true;
+        return GADGET_OK;
+      }
       return this->activate( THR_NEW_LWP | THR_JOINABLE, this->desired_threads() );
     }
 
+    /**
+       Queue a message for this gadget. Data messages are accounted against the queue limits by
+       the gadget's message queue; while the queue is throttled the caller blocks, which holds back
+       the upstream gadget and, at the head of the stream, the socket reader. A pooled upstream
+       gadget does not block its worker, it is parked until the queue has drained.
+     */
     int put(ACE_Message_Block *m, ACE_Time_Value* timeout = 0)
     {
       return this->putq(m, timeout);
     }
 
+    void set_queue_limits(const GadgetQueueLimits& limits)
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      queue_limits_ = limits;
+    }
+
+    GadgetQueueLimits get_queue_limits()
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      return queue_limits_;
+    }
+
+    /**
+       Bytes queued at this gadget: message blocks plus the array data they hold
+     */
+    size_t queued_bytes()
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      return queued_bytes_;
+    }
+
+    size_t queued_messages()
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      return queued_messages_;
+    }
+
+    bool queue_throttled()
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      return queue_throttled_;
+    }
+
+    /**
+       Message counts, bytes and timings recorded by the processing loop
+     */
+    GadgetStatistics& statistics()
+    {
+      return statistics_;
+    }
+
+    /**
+       Size of a message chain as counted against the queue limits
+     */
+    static size_t message_bytes(ACE_Message_Block* m)
+    {
+      size_t bytes = 0;
+      for (ACE_Message_Block* b = m; b; b = b->cont()) {
+        bytes += b->length();
+        if (b->flags() & GadgetContainerMessageBase::CONTAINER_MESSAGE_BLOCK) {
+          bytes += reinterpret_cast<GadgetContainerMessageBase*>(b)->payload_bytes();
+        }
+      }
+      return bytes;
+    }
+
     virtual unsigned int desired_threads()
     {
       return desired_threads_;
@@ -182,7 +322,12 @@ namespace Gadgetron{
           return GADGET_FAIL;
         }
         GDEBUG("Gadget (%s) waiting for thread to finish\n", this->module()->name());
-        rval = this->wait();
+        if (pooled_) {
+          std::unique_lock<std::mutex> lock(pooled_mutex_);
+          pooled_cond_.wait(lock, [this]() { return pooled_done_; });
+        } else {
+          rval = this->wait();
+        }
         GDEBUG("Gadget (%s) thread finished\n", this->module()->name());
         controller_ = 0;
       }
@@ -196,6 +341,7 @@ namespace Gadgetron{
         //GDEBUG("Waiting for message in Gadget (%s)\n", this->module()->name());
         if (this->getq(m) == -1) {
           GDEBUG("Gadget (%s) failed to get message from queue\n", this->module()->name());
+          this->close_queue();
           return GADGET_FAIL;
         }
         //GDEBUG("Message Received in Gadget (%s)\n", this->module()->name());
@@ -205,59 +351,28 @@ namespace Gadgetron{
           //GDEBUG("Gadget (%s) Hangup message encountered\n", this->module()->name());
           if (this->putq(m) == -1) {
             GDEBUG("Gadget (%s) failed to put hang up message on queue (for other threads)\n", this->module()->name());
+            this->close_queue();
             return GADGET_FAIL;
           }
           //GDEBUG("Gadget (%s) breaking loop\n", this->module()->name());
+          this->close_queue();
           break;
         }
 
-
-        //Is this config info, if so call appropriate process function
-        if (m->flags() & GADGET_MESSAGE_CONFIG) {
-
-          int success;
-          try{ success = this->process_config(m); }
-          catch (std::runtime_error& err){
-            GEXCEPTION(err,"Gadget::process_config() failed\n");
-            success = -1;
-          }
-
-          if (success == -1) {
-            m->release();
-            this->flush();
-            GDEBUG("Gadget (%s) process config failed\n", this->module()->name());
-            return GADGET_FAIL;
-
-          }
-
-          //Push this onto next gadgets queue, other gadgets may need this configuration information
-          if (this->next()) {
-            if (this->next()->putq(m) == -1) {
-              m->release();
-              GDEBUG("Gadget (%s) process config failed to put config on dowstream gadget\n", this->module()->name());
-              return GADGET_FAIL;
-            }
-          }
-          continue;
-        }
-
-        int success;
-        try{ success = this->process(m); }
-        catch (std::runtime_error& err){
-          GEXCEPTION(err,"Gadget::process() failed\n");
-          success = -1;
-        }
-
-        if (success == -1) {
-          m->release();
-          this->flush();
-          GERROR("Gadget (%s) process failed\n", this->module()->name());
+        if (this->handle_message(m) == GADGET_FAIL) {
+          this->close_queue();
           return GADGET_FAIL;
         }
       }
       return 0;
     }
 
+    /**
+       Process the queued messages as one task on the shared thread pool. At most one task
+       per gadget is scheduled at a time, so messages are processed in order.
+     */
+    void run_pooled();
+
     virtual int set_parameter(const char* name, const char* val, bool trigger = true) {
       boost::shared_ptr<std::string> old_value = get_string_value(name);
       GadgetPropertyBase* p = this->find_property(name);
@@ -362,11 +477,232 @@ namespace Gadgetron{
       return 0;
     }
 
+    /**
+       Process one configuration or data message, shared by the dedicated threads and the thread pool
+     */
+    int handle_message(ACE_Message_Block* m)
+    {
+      //Is this config info, if so call appropriate process function
+      if (m->flags() & GADGET_MESSAGE_CONFIG) {
+
+        int success;
+        try{ success = this->process_config(m); }
+        catch (std::runtime_error& err){
+          GEXCEPTION(err,"Gadget::process_config() failed\n");
+          success = -1;
+        }
+
+        if (success == -1) {
+          m->release();
+          this->flush();
+          GDEBUG("Gadget (%s) process config failed\n", this->module()->name());
+          return GADGET_FAIL;
+
+        }
+
+        //Push this onto next gadgets queue, other gadgets may need this configuration information
+        if (this->next()) {
+          if (this->next()->putq(m) == -1) {
+            m->release();
+            GDEBUG("Gadget (%s) process config failed to put config on dowstream gadget\n", this->module()->name());
+            return GADGET_FAIL;
+          }
+        }
+        return GADGET_OK;
+      }
+
+      uint64_t bytes = message_bytes(m);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      int success;
+      {
+        //Messages put on a gadget queue meanwhile are the output of this gadget
+        GadgetStatistics::ProcessScope scope(statistics_);
+        try{ success = this->process(m); }
+        catch (std::runtime_error& err){
+          GEXCEPTION(err,"Gadget::process() failed\n");
+          success = -1;
+        }
+      }
+
+      statistics_.record_process(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count(), bytes);
+
+      if (success == -1) {
+        m->release();
+        this->flush();
+        GERROR("Gadget (%s) process failed\n", this->module()->name());
+        return GADGET_FAIL;
+      }
+      return GADGET_OK;
+    }
+
+    /**
+       Submit this gadget to the thread pool unless it is already scheduled or finished
+     */
+    void schedule_pooled();
+
+    /**
+       Called by the message queue after a message was enqueued
+     */
+    void enqueued()
+    {
+      if (pooled_) {
+        this->schedule_pooled();
+      }
+    }
+
+    friend class GadgetMessageQueue;
+
+    /**
+       Account a data message about to enter the queue. While the queue is throttled the caller
+       blocks, unless it is a pool worker: the consumer may need a worker to drain the queue.
+       Pooled producers are instead parked by run_pooled before they take their next message.
+     */
+    void enqueuing(ACE_Message_Block* m)
+    {
+      if (m->msg_type() == ACE_Message_Block::MB_HANGUP || (m->flags() & GADGET_MESSAGE_CONFIG)) {
+        return;
+      }
+      size_t bytes = message_bytes(m);
+      GadgetStatistics::record_output(bytes);
+
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      if (queue_above_high_water()) {
+        queue_throttled_ = true;
+      }
+      if (!GadgetThreadPool::on_worker_thread()) {
+        queue_cond_.wait(lock, [this]() { return !queue_throttled_ || queue_closed_; });
+      }
+
+      queued_bytes_ += bytes;
+      queued_messages_++;
+      queue_times_.push_back(std::chrono::steady_clock::now());
+      m->set_self_flags(GADGET_MESSAGE_QUEUED);
+    }
+
+    /**
+       Park a pooled upstream gadget while this queue is throttled. Returns false without parking
+       it if the queue is below its watermarks. Parked gadgets are submitted to the pool again once
+       the queue has drained below its low watermarks or is closed.
+     */
+    bool park_upstream(Gadget* upstream)
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if (!queue_throttled_ || queue_closed_) {
+        return false;
+      }
+      parked_upstream_.push_back(upstream);
+      return true;
+    }
+
+    /**
+       Release the accounting of a message taken off the queue and wake blocked producers
+       once the queue has drained below its low watermarks
+     */
+    void dequeued(ACE_Message_Block* m)
+    {
+      this->unaccount(m, true);
+    }
+
+    /**
+       Release the accounting of a message the queue refused
+     */
+    void enqueue_failed(ACE_Message_Block* m)
+    {
+      this->unaccount(m, false);
+    }
+
+    void unaccount(ACE_Message_Block* m, bool dequeued)
+    {
+      if (!(m->self_flags() & GADGET_MESSAGE_QUEUED)) {
+        return;
+      }
+      m->clr_self_flags(GADGET_MESSAGE_QUEUED);
+      size_t bytes = message_bytes(m);
+
+      std::vector<Gadget*> resume;
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queued_bytes_ -= std::min(bytes, queued_bytes_);
+      if (queued_messages_ > 0) queued_messages_--;
+
+      //Data messages leave the queue in the order they were put
+      if (!queue_times_.empty()) {
+        if (dequeued) {
+          statistics_.record_queue_wait(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - queue_times_.front()).count());
+          queue_times_.pop_front();
+        } else {
+          queue_times_.pop_back();
+        }
+      }
+
+      if (queue_throttled_ &&
+          (queue_limits_.high_water_bytes == 0 || queued_bytes_ <= queue_limits_.low_water_bytes) &&
+          (queue_limits_.high_water_messages == 0 || queued_messages_ <= queue_limits_.low_water_messages)) {
+        queue_throttled_ = false;
+        queue_cond_.notify_all();
+        resume.swap(parked_upstream_);
+      }
+      lock.unlock();
+
+      this->resume_upstream(resume);
+    }
+
+    /**
+       Stop throttling once nothing will consume the queue any more, so producers cannot block forever
+     */
+    void close_queue()
+    {
+      std::vector<Gadget*> resume;
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_closed_ = true;
+        queue_cond_.notify_all();
+        resume.swap(parked_upstream_);
+      }
+      this->resume_upstream(resume);
+    }
+
+    /**
+       Submit parked upstream gadgets again, they are still marked as scheduled
+     */
+    static void resume_upstream(const std::vector<Gadget*>& parked)
+    {
+      for (size_t i = 0; i < parked.size(); i++) {
+        GadgetThreadPool::instance()->submit(parked[i]);
+      }
+    }
+
+    // Called with queue_mutex_ held
+    bool queue_above_high_water()
+    {
+      return (queue_limits_.high_water_bytes > 0 && queued_bytes_ >= queue_limits_.high_water_bytes) ||
+        (queue_limits_.high_water_messages > 0 && queued_messages_ >= queue_limits_.high_water_messages);
+    }
+
     unsigned int desired_threads_;
     unsigned int threads_;
     bool pass_on_undesired_data_;
     GadgetStreamInterface* controller_;
     ACE_Thread_Mutex parameter_mutex_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cond_;
+    GadgetQueueLimits queue_limits_;
+    size_t queued_bytes_;
+    size_t queued_messages_;
+    bool queue_throttled_;
+    bool queue_closed_;
+    std::deque<std::chrono::steady_clock::time_point> queue_times_;
+    std::vector<Gadget*> parked_upstream_;
+    GadgetStatistics statistics_;
+
+    bool pooled_;
+    std::atomic<bool> pooled_scheduled_;
+    bool pooled_done_;
+    std::mutex pooled_mutex_;
+    std::condition_variable pooled_cond_;
   private:
     std::map<std::string, std::string> parameters_;
     std::string gadgetron_version_;
@@ -0,0 +1,202 @@
+#include "GadgetChainPool.h"
+#include "GadgetStreamController.h"
+#include "log.h"
+
+#include <chrono>
+#include <sstream>
+
+using namespace Gadgetron;
+
+GadgetChainPool* GadgetChainPool::instance_ = 0;
+
+GadgetChainPool* GadgetChainPool::instance()
+{
+  static std::mutex instance_mtx;
+  std::lock_guard<std::mutex> guard(instance_mtx);
+  if (!instance_) {
+    instance_ = new GadgetChainPool();
+  }
+  return instance_;
+}
+
+GadgetChainPool::GadgetChainPool()
+  : misses_(0)
+  , attaches_(0)
+  , attach_ms_(0)
+  , builder_started_(false)
+{
+}
+
+void GadgetChainPool::set_global_gadget_parameters(const std::map<std::string, std::string>& globalGadgetPara)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+  global_gadget_parameters_ = globalGadgetPara;
+}
+
+int GadgetChainPool::add_configuration(const std::string& config_xml_filename, unsigned int size)
+{
+  std::string xml;
+  if (GadgetStreamController::read_configuration_file(config_xml_filename, xml) != GADGET_OK) {
+    GERROR("Unable to pool chains of configuration %s\n", config_xml_filename.c_str());
+    return GADGET_FAIL;
+  }
+
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  Entry e;
+  e.name = config_xml_filename;
+  e.xml = xml;
+  e.size = size;
+  e.building = 0;
+  e.failed = false;
+  e.hits = 0;
+  e.built = 0;
+  e.build_ms = 0;
+  entries_.push_back(e);
+
+  for (unsigned int i = 0; i < size; i++) {
+    request_build(entries_.size()-1);
+  }
+
+  GINFO("Pooling %d chains of configuration %s\n", size, config_xml_filename.c_str());
+  return GADGET_OK;
+}
+
+GadgetStreamController* GadgetChainPool::acquire(const std::string& config_xml_string)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  for (size_t i = 0; i < entries_.size(); i++) {
+    Entry& e = entries_[i];
+    if (e.xml != config_xml_string) {
+      continue;
+    }
+
+    if (e.idle.empty()) {
+      break;
+    }
+
+    GadgetStreamController* controller = e.idle.front();
+    e.idle.pop_front();
+    e.hits++;
+    if (!e.failed && e.idle.size() + e.building < e.size) {
+      request_build(i);
+    }
+    return controller;
+  }
+
+  misses_++;
+  return 0;
+}
+
+void GadgetChainPool::record_attach(double ms)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+  attaches_++;
+  attach_ms_ += ms;
+}
+
+void GadgetChainPool::prefetch(const std::string& config_xml_string)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  for (size_t i = 0; i < entries_.size(); i++) {
+    Entry& e = entries_[i];
+    if (e.xml != config_xml_string) {
+      continue;
+    }
+
+    if (!e.failed && e.idle.empty() && e.building == 0) {
+      request_build(i);
+    }
+    return;
+  }
+
+  //Configurations seen only in job connections are not refilled by acquire, each job end prefetches the next chain
+  Entry e;
+  e.name = "prefetched for job connections";
+  e.xml = config_xml_string;
+  e.size = 0;
+  e.building = 0;
+  e.failed = false;
+  e.hits = 0;
+  e.built = 0;
+  e.build_ms = 0;
+  entries_.push_back(e);
+  request_build(entries_.size()-1);
+}
+
+std::string GadgetChainPool::status()
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  std::stringstream ss;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    const Entry& e = entries_[i];
+    ss << e.name << " : " << e.idle.size() << " of " << e.size << " idle, "
+       << e.building << " building, " << e.hits << " used";
+    if (e.built) {
+      ss << ", average build " << e.build_ms/e.built << " ms";
+    }
+    ss << (e.failed ? ", configuration failed" : "") << std::endl;
+  }
+  ss << "Connections without a pooled chain : " << misses_ << std::endl;
+  ss << "Connections attached to a pooled chain : " << attaches_;
+  if (attaches_) {
+    ss << ", average attach " << attach_ms_/attaches_ << " ms";
+  }
+  ss << std::endl;
+  return ss.str();
+}
+
+// Called with mtx_ held
+void GadgetChainPool::request_build(size_t entry)
+{
+  entries_[entry].building++;
+  pending_.push_back(entry);
+
+  if (!builder_started_) {
+    std::thread(&GadgetChainPool::build_loop, this).detach();
+    builder_started_ = true;
+  }
+  cv_.notify_one();
+}
+
+void GadgetChainPool::build_loop()
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+
+  while (true) {
+    cv_.wait(lock, [this]() { return !pending_.empty(); });
+
+    size_t entry = pending_.front();
+    pending_.pop_front();
+    std::string xml = entries_[entry].xml;
+    std::map<std::string, std::string> parameters = global_gadget_parameters_;
+
+    //Chains are built one at a time without holding the lock
+    lock.unlock();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GadgetStreamController* controller = new GadgetStreamController();
+    controller->set_global_gadget_parameters(parameters);
+    bool ok = (controller->prepare(xml) == GADGET_OK);
+    if (!ok) {
+      controller->discard();
+      controller = 0;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    lock.lock();
+
+    Entry& e = entries_[entry];
+    e.building--;
+    if (ok) {
+      e.idle.push_back(controller);
+      e.built++;
+      e.build_ms += elapsed.count();
+    } else {
+      //Do not retry a configuration that fails, connections will configure their own chain
+      GERROR("Failed to build pooled chain of configuration %s\n", e.name.c_str());
+      e.failed = true;
+    }
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef GADGETCHAINPOOL_H
+#define GADGETCHAINPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gadgetbase_export.h"
+
+namespace Gadgetron{
+
+class GadgetStreamController;
+
+/**
+   Pool of pre-configured gadget chains, keyed by the configuration XML.
+
+   Loading the DLLs of the readers, writers and gadgets, constructing the
+   gadgets, setting their properties and activating their threads is done
+   ahead of time on a background thread. A connection whose configuration
+   matches a pooled chain is handed to an idle chain and a replacement is
+   built. The per scan work is not pre-warmed: every gadget still runs
+   process_config with the ISMRMRD header of the scan after the connection
+   has been attached.
+
+   A pooled chain serves exactly one connection and is then closed and
+   destroyed with it; it is never reset and returned to the pool, since
+   gadgets keep per scan state. The pool only saves the setup latency by
+   rebuilding a fresh chain in the background for the next connection.
+   status() reports the average build time next to the average time a
+   connection spent attaching to a pooled chain, which is the saving.
+
+   All configurations share a single builder thread, which builds one
+   chain at a time in request order. Bursts of connections to several
+   configurations can therefore drain the pool faster than it refills,
+   and those connections configure their own chain as before.
+ */
+class EXPORTGADGETBASE GadgetChainPool
+{
+public:
+  static GadgetChainPool* instance();
+
+  void set_global_gadget_parameters(const std::map<std::string, std::string>& globalGadgetPara);
+
+  /**
+     Keep size configured chains of a configuration file ready, relative to the configuration folder
+   */
+  int add_configuration(const std::string& config_xml_filename, unsigned int size);
+
+  /**
+     Take an idle chain configured with this XML, or return 0 if there is none
+   */
+  GadgetStreamController* acquire(const std::string& config_xml_string);
+
+  /**
+     Make sure one chain configured with this XML is idle or being built, used by connections
+     running several jobs to take over a prebuilt chain when their current job ends
+   */
+  void prefetch(const std::string& config_xml_string);
+
+  /**
+     Record the time a connection took to attach to a pooled chain, in milliseconds
+   */
+  void record_attach(double ms);
+
+  /**
+     Human readable summary of the pool, one line per configuration
+   */
+  std::string status();
+
+private:
+  GadgetChainPool();
+
+  struct Entry
+  {
+    std::string name;
+    std::string xml;
+    unsigned int size;
+    unsigned int building;
+    bool failed;
+    size_t hits;
+    size_t built;
+    double build_ms;
+    std::deque<GadgetStreamController*> idle;
+  };
+
+  void request_build(size_t entry);
+
+  /**
+     Body of the single builder thread, builds the requested chains one after the other
+   */
+  void build_loop();
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<Entry> entries_;
+  std::deque<size_t> pending_;
+  std::map<std::string, std::string> global_gadget_parameters_;
+  size_t misses_;
+  size_t attaches_;
+  double attach_ms_;
+  bool builder_started_;
+
+  static GadgetChainPool* instance_;
+};
+
+}
+#endif //GADGETCHAINPOOL_H
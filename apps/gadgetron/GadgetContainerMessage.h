@@ -6,6 +6,21 @@
 #include <string>
 
 namespace Gadgetron{
+
+/**
+   Heap memory held by the object in a container message, used for queue accounting.
+   Arrays report their data size, other objects are counted by the container alone.
+ */
+template <class T> auto container_payload_bytes(const T& obj, int) -> decltype(size_t(obj.get_number_of_bytes()))
+{
+  return obj.get_number_of_bytes();
+}
+
+template <class T> size_t container_payload_bytes(const T&, long)
+{
+  return 0;
+}
+
 /**
    The purpose of this case is to provide a type indepent interface to all ContainerMessages
 
@@ -31,6 +46,11 @@ class GadgetContainerMessageBase : public ACE_Message_Block
   {
     set_flags(CONTAINER_MESSAGE_BLOCK);
   }
+
+  virtual size_t payload_bytes()
+  {
+    return 0;
+  }
   
 
 #ifdef WIN32
@@ -118,6 +138,11 @@ public:
     return content_;
   }
 
+  virtual size_t payload_bytes()
+  {
+    return content_ ? container_payload_bytes(*content_, 0) : 0;
+  }
+
   virtual GadgetContainerMessage<T>* duplicate() 
   {
     GadgetContainerMessage<T>* nb = new GadgetContainerMessage<T>(this->data_block()->duplicate());
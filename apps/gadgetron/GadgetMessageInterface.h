@@ -7,7 +7,9 @@
 
 #include <ace/SOCK_Stream.h>
 #include <ace/Basic_Types.h>
+#include <algorithm>
 #include <map>
+#include <vector>
 
 namespace Gadgetron
 {
@@ -19,6 +21,7 @@ enum GadgetronMessageID {
   GADGET_MESSAGE_PARAMETER_SCRIPT =   3,
   GADGET_MESSAGE_CLOSE            =   4,
   GADGET_MESSAGE_TEXT             =   5,
+  GADGET_MESSAGE_JOB_END          =   6,
   GADGET_MESSAGE_INT_ID_MAX       = 999
 };
 
@@ -37,6 +40,17 @@ struct GadgetMessageScript
   ACE_UINT32 script_length;
 };
 
+/**
+   Follows GADGET_MESSAGE_JOB_END on a connection carrying several jobs.
+
+   Sent to a node it ends the job whose data came before it, the node flushes its chain and
+   builds a fresh one for the next job. Sent back it marks that all results of the job were returned.
+ */
+struct GadgetMessageJob
+{
+  ACE_UINT32 job_id;
+};
+
 
 /**
    Interface for classes capable of reading a specific message
@@ -53,6 +67,127 @@ class GadgetMessageReader
    */
   virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream) = 0;
 
+  /**
+     Readers that parse several messages off the socket in one read return the first one from read()
+     and hand out the remaining ones here, in arrival order, until 0 is returned.
+     The caller must drain this before reading the next message identifier from the socket.
+   */
+  virtual ACE_Message_Block* read_pending() { return 0; }
+
+};
+
+/**
+   Collects the pieces of one or more outgoing messages so they can be sent with a single gathered write.
+
+   Pieces added with add() are referenced, not copied, and must stay valid until flush() returns.
+   Small temporaries (identifiers, lengths, serialized strings) are added with add_copy(), which keeps
+   them in storage owned by the buffer. The buffer is reused between flushes without reallocating.
+ */
+class GadgetMessageSendBuffer
+{
+ public:
+  GadgetMessageSendBuffer() : bytes_(0) {}
+
+  void add(const void* ptr, size_t len)
+  {
+    if (!len) return;
+    Piece p;
+    p.ptr = static_cast<const char*>(ptr);
+    p.offset = 0;
+    p.len = len;
+    pieces_.push_back(p);
+    bytes_ += len;
+  }
+
+  void add_copy(const void* ptr, size_t len)
+  {
+    if (!len) return;
+    Piece p;
+    p.ptr = 0;
+    p.offset = storage_.size();
+    p.len = len;
+    storage_.insert(storage_.end(), static_cast<const char*>(ptr), static_cast<const char*>(ptr) + len);
+    pieces_.push_back(p);
+    bytes_ += len;
+  }
+
+  size_t pieces() const { return pieces_.size(); }
+
+  size_t bytes() const { return bytes_; }
+
+  bool empty() const { return pieces_.empty(); }
+
+  /**
+     Position of the buffer, to drop the pieces of a message that could not be gathered completely.
+   */
+  struct Mark
+  {
+    size_t pieces;
+    size_t storage;
+    size_t bytes;
+  };
+
+  Mark mark() const
+  {
+    Mark m;
+    m.pieces = pieces_.size();
+    m.storage = storage_.size();
+    m.bytes = bytes_;
+    return m;
+  }
+
+  void rollback(const Mark& m)
+  {
+    pieces_.resize(m.pieces);
+    storage_.resize(m.storage);
+    bytes_ = m.bytes;
+  }
+
+  void clear()
+  {
+    pieces_.clear();
+    storage_.clear();
+    bytes_ = 0;
+  }
+
+  /**
+     Sends all pieces, in at most ACE_IOV_MAX pieces per system call, and clears the buffer.
+   */
+  int flush(ACE_SOCK_Stream* stream)
+  {
+    int res = 0;
+
+    iov_.resize(pieces_.size());
+    for (size_t i = 0; i < pieces_.size(); i++) {
+      const char* ptr = pieces_[i].ptr ? pieces_[i].ptr : &storage_[pieces_[i].offset];
+      iov_[i].iov_base = const_cast<char*>(ptr);
+      iov_[i].iov_len = pieces_[i].len;
+    }
+
+    for (size_t i = 0; i < iov_.size(); i += ACE_IOV_MAX) {
+      int n = (int)std::min(iov_.size() - i, (size_t)ACE_IOV_MAX);
+      if (stream->sendv_n(&iov_[i], n) <= 0) {
+        res = -1;
+        break;
+      }
+    }
+
+    clear();
+    return res;
+  }
+
+ protected:
+  struct Piece
+  {
+    const char* ptr;
+    size_t offset;
+    size_t len;
+  };
+
+  std::vector<Piece> pieces_;
+  std::vector<char> storage_;
+  std::vector<iovec> iov_;
+  size_t bytes_;
 };
 
 /**
@@ -68,6 +203,18 @@ class GadgetMessageWriter
      Function must be implemented to write a specific message.
    */
   virtual int write(ACE_SOCK_Stream* stream, ACE_Message_Block* mb) = 0;
+
+  /**
+     Writers that can describe a message as a list of memory pieces return true here and implement gather().
+     The writer task then coalesces queued messages into one gathered send instead of calling write().
+   */
+  virtual bool supports_gather() { return false; }
+
+  /**
+     Appends the pieces of a message to the send buffer. The message is kept alive until the buffer is flushed.
+     On failure the caller drops whatever was appended for the message before releasing it.
+   */
+  virtual int gather(GadgetMessageSendBuffer& buffer, ACE_Message_Block* mb) { return -1; }
 };
 
 class GadgetMessageWriterContainer
@@ -3,6 +3,17 @@
 #include "GadgetStreamController.h"
 #include "CloudBus.h"
 
+#include "ace/OS_NS_unistd.h"
+
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
 using namespace Gadgetron;
 
 GadgetServerAcceptor::~GadgetServerAcceptor ()
@@ -84,3 +95,126 @@ int GadgetServerAcceptor::handle_close (ACE_HANDLE, ACE_Reactor_Mask)
   }
   return 0;
 }
+
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+
+/**
+   Removes a socket file left behind by an instance that is no longer running. Anything
+   else at the path, or a socket another instance still listens on, is left alone.
+   Returns -1 if the path can not be used.
+ */
+static int remove_stale_socket (const char* path)
+{
+  struct stat st;
+  if (::lstat (path, &st) == -1) {
+    if (errno == ENOENT) return 0;
+    GERROR("Unable to check local socket path %s: %s\n", path, strerror (errno));
+    return -1;
+  }
+
+  if (!S_ISSOCK (st.st_mode)) {
+    GERROR("%s exists and is not a socket, it is not removed\n", path);
+    return -1;
+  }
+
+  //A live instance accepts the connection, a stale socket file refuses it
+  int fd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    GERROR("Unable to create socket to check %s: %s\n", path, strerror (errno));
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strncpy (addr.sun_path, path, sizeof (addr.sun_path) - 1);
+
+  int rc = ::connect (fd, (struct sockaddr*) &addr, sizeof (addr));
+  int err = errno;
+  ::close (fd);
+
+  if (rc == 0) {
+    GERROR("Another instance is listening on %s\n", path);
+    return -1;
+  }
+
+  if (err != ECONNREFUSED) {
+    GERROR("Unable to check local socket %s: %s\n", path, strerror (err));
+    return -1;
+  }
+
+  GDEBUG("Removing stale local socket %s\n", path);
+  if (ACE_OS::unlink (path) == -1) {
+    GERROR("Unable to remove stale local socket %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+GadgetLocalServerAcceptor::~GadgetLocalServerAcceptor ()
+{
+  this->handle_close (ACE_INVALID_HANDLE, 0);
+}
+
+int GadgetLocalServerAcceptor::open (const ACE_UNIX_Addr &listen_addr)
+{
+  //Remove a socket file left behind by a previous instance
+  if (remove_stale_socket (listen_addr.get_path_name ()) == -1) {
+    return -1;
+  }
+
+  if (this->acceptor_.open (listen_addr) == -1) {
+    GERROR("error opening local acceptor on %s\n", listen_addr.get_path_name ());
+    return -1;
+  }
+
+  path_ = listen_addr.get_path_name ();
+
+  return this->reactor ()->register_handler(this, ACE_Event_Handler::ACCEPT_MASK);
+}
+
+int GadgetLocalServerAcceptor::handle_input (ACE_HANDLE)
+{
+  GadgetStreamController *controller;
+
+  ACE_NEW_RETURN (controller, GadgetStreamController, -1);
+
+  controller->set_global_gadget_parameters(global_gadget_parameters_);
+
+  ACE_LSOCK_Stream local_stream;
+  if (this->acceptor_.accept (local_stream) == -1) {
+    GERROR("Failed to accept local controller connection\n"); 
+    delete controller;
+    return -1;
+  }
+
+  //The controller, readers and writers only use the socket handle, which is the same for local and TCP streams
+  controller->peer ().set_handle (local_stream.get_handle ());
+  local_stream.set_handle (ACE_INVALID_HANDLE);
+
+  controller->reactor (this->reactor ());
+  if (controller->open () == -1)
+    controller->handle_close (ACE_INVALID_HANDLE, 0);
+  return 0;
+}
+
+int GadgetLocalServerAcceptor::handle_close (ACE_HANDLE, ACE_Reactor_Mask)
+{
+  GDEBUG("GadgetLocalServerAcceptor::handle_close\n");
+
+  if (this->acceptor_.get_handle () != ACE_INVALID_HANDLE) {
+    ACE_Reactor_Mask m = 
+      ACE_Event_Handler::ACCEPT_MASK | ACE_Event_Handler::DONT_CALL;
+    this->reactor ()->remove_handler (this, m);
+    this->acceptor_.close ();
+  }
+
+  //Do not leave the socket file behind for the next instance or for clients
+  if (!path_.empty()) {
+    ACE_OS::unlink (path_.c_str ());
+    path_.clear();
+  }
+  return 0;
+}
+
+#endif
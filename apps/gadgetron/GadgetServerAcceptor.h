@@ -2,6 +2,8 @@
 #define _GADGETSERVERACCEPTOR_H
 
 #include "ace/SOCK_Acceptor.h"
+#include "ace/LSOCK_Acceptor.h"
+#include "ace/UNIX_Addr.h"
 #include "ace/Reactor.h"
 #include <string>
 #include <map>
@@ -38,5 +40,37 @@ protected:
   bool is_listening_;
   
 };
+
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+/**
+   Accepts connections on a local (Unix domain) socket.
+
+   Clients on the same host connect through the socket file instead of the loopback TCP stack.
+   The accepted connections are served by the same GadgetStreamController, readers and writers as TCP connections.
+   The socket file is removed again when the acceptor is closed.
+ */
+class GadgetLocalServerAcceptor : public ACE_Event_Handler
+{
+public:
+  virtual ~GadgetLocalServerAcceptor ();
+
+  int open (const ACE_UNIX_Addr &listen_addr);
+
+  virtual ACE_HANDLE get_handle (void) const
+    { return this->acceptor_.get_handle (); }
+
+  virtual int handle_input (ACE_HANDLE fd = ACE_INVALID_HANDLE);
+
+  virtual int handle_close (ACE_HANDLE handle,
+                            ACE_Reactor_Mask close_mask);
+
+  std::map<std::string, std::string> global_gadget_parameters_;
+
+protected:
+  ACE_LSOCK_Acceptor acceptor_;
+  std::string path_;
+};
+#endif
+
 }
 #endif //_GADGETSERVERACCEPTOR_H
@@ -0,0 +1,262 @@
+#include "GadgetStatistics.h"
+#include "Gadget.h"
+
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using namespace Gadgetron;
+
+namespace {
+  //Statistics of the gadget processing a message on this thread
+  thread_local GadgetStatistics* processing = 0;
+}
+
+GadgetStatistics::GadgetStatistics()
+  : created(std::chrono::steady_clock::now())
+  , messages(0)
+  , bytes_in(0)
+  , bytes_out(0)
+  , process_us(0)
+  , queue_waits(0)
+  , queue_wait_us(0)
+{
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    process_histogram[i] = 0;
+    queue_wait_histogram[i] = 0;
+  }
+  for (size_t i = 0; i < RATE_WINDOW_SECONDS; i++) {
+    rate_second[i] = std::numeric_limits<uint64_t>::max();
+    rate_messages[i] = 0;
+  }
+}
+
+GadgetStatistics::ProcessScope::ProcessScope(GadgetStatistics& st)
+  : outer_(processing)
+{
+  processing = &st;
+}
+
+GadgetStatistics::ProcessScope::~ProcessScope()
+{
+  processing = outer_;
+}
+
+size_t GadgetStatistics::bucket(uint64_t microseconds)
+{
+  size_t b = 0;
+  while (microseconds > 0 && b < HISTOGRAM_BUCKETS-1) {
+    microseconds >>= 1;
+    b++;
+  }
+  return b;
+}
+
+void GadgetStatistics::record_process(uint64_t microseconds, uint64_t bytes)
+{
+  messages++;
+  bytes_in += bytes;
+  process_us += microseconds;
+  process_histogram[bucket(microseconds)]++;
+
+  //The first message of a second reuses the slot of the oldest second in the window
+  uint64_t second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - created).count();
+  size_t slot = second % RATE_WINDOW_SECONDS;
+  uint64_t slot_second = rate_second[slot];
+  if (slot_second != second && rate_second[slot].compare_exchange_strong(slot_second, second)) {
+    rate_messages[slot] = 0;
+  }
+  rate_messages[slot]++;
+}
+
+void GadgetStatistics::record_queue_wait(uint64_t microseconds)
+{
+  queue_waits++;
+  queue_wait_us += microseconds;
+  queue_wait_histogram[bucket(microseconds)]++;
+}
+
+void GadgetStatistics::record_output(uint64_t bytes)
+{
+  if (processing) {
+    processing->bytes_out += bytes;
+  }
+}
+
+double GadgetStatistics::messages_per_second(std::chrono::steady_clock::time_point now)
+{
+  double elapsed = std::chrono::duration<double>(now - created).count();
+  if (elapsed <= 0) {
+    return 0;
+  }
+
+  //The window ends with the current, partial second
+  uint64_t second = (uint64_t)elapsed;
+  uint64_t first = (second + 1 >= RATE_WINDOW_SECONDS) ? second + 1 - RATE_WINDOW_SECONDS : 0;
+
+  uint64_t count = 0;
+  for (size_t i = 0; i < RATE_WINDOW_SECONDS; i++) {
+    uint64_t s = rate_second[i];
+    if (s >= first && s <= second) {
+      count += rate_messages[i];
+    }
+  }
+  return count / (elapsed - first);
+}
+
+namespace {
+
+  //Upper bound in us of the bucket holding the given fraction of the samples
+  uint64_t histogram_quantile(const std::atomic<uint64_t>* histogram, double fraction)
+  {
+    uint64_t total = 0;
+    for (size_t i = 0; i < GadgetStatistics::HISTOGRAM_BUCKETS; i++) {
+      total += histogram[i];
+    }
+    if (total == 0) {
+      return 0;
+    }
+
+    uint64_t count = 0;
+    for (size_t i = 0; i < GadgetStatistics::HISTOGRAM_BUCKETS; i++) {
+      count += histogram[i];
+      if (count >= fraction*total) {
+        return (uint64_t)1 << i;
+      }
+    }
+    return (uint64_t)1 << (GadgetStatistics::HISTOGRAM_BUCKETS-1);
+  }
+
+  std::string json_string(const std::string& s)
+  {
+    std::string out("\"");
+    for (size_t i = 0; i < s.size(); i++) {
+      if (s[i] == '"' || s[i] == '\\') {
+        out += '\\';
+      }
+      out += s[i];
+    }
+    return out + "\"";
+  }
+
+  void write_histogram(std::ostream& o, const std::atomic<uint64_t>* histogram)
+  {
+    o << "[";
+    for (size_t i = 0; i < GadgetStatistics::HISTOGRAM_BUCKETS; i++) {
+      o << (i ? "," : "") << histogram[i];
+    }
+    o << "]";
+  }
+}
+
+GadgetStatisticsRegistry* GadgetStatisticsRegistry::instance_ = 0;
+
+GadgetStatisticsRegistry* GadgetStatisticsRegistry::instance()
+{
+  static std::mutex instance_mtx;
+  std::lock_guard<std::mutex> guard(instance_mtx);
+  if (!instance_) {
+    instance_ = new GadgetStatisticsRegistry();
+  }
+  return instance_;
+}
+
+void GadgetStatisticsRegistry::add(Gadget* g)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+  gadgets_.insert(g);
+}
+
+void GadgetStatisticsRegistry::remove(Gadget* g)
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+  gadgets_.erase(g);
+}
+
+size_t GadgetStatisticsRegistry::queued_bytes()
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  size_t bytes = 0;
+  for (std::set<Gadget*>::iterator it = gadgets_.begin(); it != gadgets_.end(); it++) {
+    bytes += (*it)->queued_bytes();
+  }
+  return bytes;
+}
+
+std::string GadgetStatisticsRegistry::to_json()
+{
+  std::lock_guard<std::mutex> guard(mtx_);
+
+  //Follow next() from every gadget without a predecessor, only gadgets still
+  //registered are dereferenced. Each such root starts a chain of its own.
+  std::vector< std::vector<Gadget*> > chains;
+  for (std::set<Gadget*>::iterator it = gadgets_.begin(); it != gadgets_.end(); ++it) {
+    bool has_predecessor = false;
+    for (std::set<Gadget*>::iterator p = gadgets_.begin(); p != gadgets_.end(); ++p) {
+      if ((*p)->next() == *it) {
+        has_predecessor = true;
+        break;
+      }
+    }
+    if (has_predecessor) {
+      continue;
+    }
+
+    chains.push_back(std::vector<Gadget*>());
+    for (Gadget* g = *it; g; ) {
+      chains.back().push_back(g);
+      std::set<Gadget*>::iterator n = gadgets_.find(static_cast<Gadget*>(g->next()));
+      g = (n != gadgets_.end()) ? *n : 0;
+    }
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  std::stringstream ss;
+  ss << "{\"chains\":[";
+  for (size_t c = 0; c < chains.size(); c++) {
+    const std::vector<Gadget*>& chain = chains[c];
+
+    ss << (c ? "," : "");
+    ss << "{\"stream\":\"" << chain.front()->get_controller() << "\",\"gadgets\":[";
+
+    for (size_t i = 0; i < chain.size(); i++) {
+      Gadget* g = chain[i];
+      GadgetStatistics& st = g->statistics();
+
+      uint64_t messages = st.messages;
+      uint64_t queue_waits = st.queue_waits;
+
+      ss << (i ? "," : "") << "{";
+      ss << "\"name\":" << json_string(g->module() ? g->module()->name() : "");
+      ss << ",\"messages\":" << messages;
+      ss << ",\"messages_per_second\":" << st.messages_per_second(now);
+      ss << ",\"bytes_in\":" << st.bytes_in;
+      ss << ",\"bytes_out\":" << st.bytes_out;
+      ss << ",\"queued_messages\":" << g->queued_messages();
+      ss << ",\"queued_bytes\":" << g->queued_bytes();
+      ss << ",\"queue_throttled\":" << (g->queue_throttled() ? "true" : "false");
+      ss << ",\"process_us\":{\"total\":" << st.process_us
+         << ",\"mean\":" << (messages ? st.process_us/messages : 0)
+         << ",\"p50\":" << histogram_quantile(st.process_histogram, 0.5)
+         << ",\"p99\":" << histogram_quantile(st.process_histogram, 0.99)
+         << ",\"histogram\":";
+      write_histogram(ss, st.process_histogram);
+      ss << "}";
+      ss << ",\"queue_wait_us\":{\"count\":" << queue_waits
+         << ",\"total\":" << st.queue_wait_us
+         << ",\"mean\":" << (queue_waits ? st.queue_wait_us/queue_waits : 0)
+         << ",\"p50\":" << histogram_quantile(st.queue_wait_histogram, 0.5)
+         << ",\"p99\":" << histogram_quantile(st.queue_wait_histogram, 0.99)
+         << ",\"histogram\":";
+      write_histogram(ss, st.queue_wait_histogram);
+      ss << "}";
+      ss << "}";
+    }
+    ss << "]}";
+  }
+  ss << "]}";
+
+  return ss.str();
+}
@@ -0,0 +1,111 @@
+#ifndef GADGETSTATISTICS_H
+#define GADGETSTATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+#include "gadgetbase_export.h"
+
+namespace Gadgetron{
+
+class Gadget;
+
+/**
+   Counters of one gadget, updated by its svc loop or pool task without locking.
+
+   Process and queue wait times are kept as totals and in histograms with
+   power of two buckets: bucket 0 counts times below 1 us, bucket i times
+   in [2^(i-1), 2^i) us and the last bucket everything longer.
+
+   Processed messages are also counted per second over the last RATE_WINDOW_SECONDS,
+   for the current message rate.
+ */
+struct EXPORTGADGETBASE GadgetStatistics
+{
+  enum { HISTOGRAM_BUCKETS = 28 };
+  enum { RATE_WINDOW_SECONDS = 10 };
+
+  GadgetStatistics();
+
+  void record_process(uint64_t microseconds, uint64_t bytes);
+  void record_queue_wait(uint64_t microseconds);
+
+  /**
+     Messages processed per second over the last RATE_WINDOW_SECONDS, or since
+     the gadget was created if that is more recent
+   */
+  double messages_per_second(std::chrono::steady_clock::time_point now);
+
+  /**
+     Count bytes put on a gadget queue as output of the gadget processing on this
+     thread, if any. Messages a gadget sends from threads of its own are not counted.
+   */
+  static void record_output(uint64_t bytes);
+
+  /**
+     Marks the gadget processing a message on this thread while in scope
+   */
+  class EXPORTGADGETBASE ProcessScope
+  {
+  public:
+    ProcessScope(GadgetStatistics& st);
+    ~ProcessScope();
+
+  private:
+    GadgetStatistics* outer_;
+  };
+
+  static size_t bucket(uint64_t microseconds);
+
+  std::chrono::steady_clock::time_point created;
+  std::atomic<uint64_t> messages;
+  std::atomic<uint64_t> bytes_in;
+  std::atomic<uint64_t> bytes_out;
+  std::atomic<uint64_t> process_us;
+  std::atomic<uint64_t> queue_waits;
+  std::atomic<uint64_t> queue_wait_us;
+  std::atomic<uint64_t> process_histogram[HISTOGRAM_BUCKETS];
+  std::atomic<uint64_t> queue_wait_histogram[HISTOGRAM_BUCKETS];
+
+  //Second since created and message count of each slot of the rate window
+  std::atomic<uint64_t> rate_second[RATE_WINDOW_SECONDS];
+  std::atomic<uint64_t> rate_messages[RATE_WINDOW_SECONDS];
+};
+
+/**
+   Gadgets of all running streams, reported as JSON on the ReST interface
+ */
+class EXPORTGADGETBASE GadgetStatisticsRegistry
+{
+public:
+  static GadgetStatisticsRegistry* instance();
+
+  void add(Gadget* g);
+  void remove(Gadget* g);
+
+  /**
+     One object per chain of gadgets, in stream order, with the stream it belongs to.
+     The paths of a branch and pooled chains waiting for a connection are chains of their own.
+   */
+  std::string to_json();
+
+  /**
+     Bytes waiting in the queues of all registered gadgets
+   */
+  size_t queued_bytes();
+
+private:
+  GadgetStatisticsRegistry() {}
+
+  std::mutex mtx_;
+  std::set<Gadget*> gadgets_;
+
+  static GadgetStatisticsRegistry* instance_;
+};
+
+}
+#endif //GADGETSTATISTICS_H
@@ -9,14 +9,18 @@
 #include "GadgetronConnector.h"
 #include "Gadget.h"
 #include "EndGadget.h"
+#include "BranchGadget.h"
 #include "gadgetron_config.h"
+#include "GadgetChainPool.h"
 
 #include "gadgetron_xml.h"
 #include "url_encode.h"
 #include "CloudBus.h"
 
+#include <chrono>
 #include <complex>
 #include <fstream>
+#include <iterator>
 
 using namespace Gadgetron;
 
@@ -24,18 +28,50 @@ GadgetStreamController::GadgetStreamController()
   : GadgetStreamInterface()
   , notifier_ (0, this, ACE_Event_Handler::WRITE_MASK)
   , writer_task_(&this->peer())
+  , recon_reported_(false)
 {
-  CloudBus::instance()->report_recon_start();    
 }
 
 GadgetStreamController::~GadgetStreamController()
 { 
-  CloudBus::instance()->report_recon_end();
+  if (recon_reported_) {
+    CloudBus::instance()->report_recon_end();
+  }
 }
 
 int GadgetStreamController::open (void)
 {
+  if (this->open_stream() == -1) {
+    return -1;
+  }
+
+  return this->start();
+}
+
+int GadgetStreamController::prepare(std::string config_xml_string)
+{
+  if (this->open_stream() == -1) {
+    return GADGET_FAIL;
+  }
+
+  return this->configure(config_xml_string);
+}
+
+int GadgetStreamController::attach(ACE_HANDLE handle, ACE_Reactor* reactor)
+{
+  this->peer().set_handle(handle);
+  this->reactor(reactor);
+  return this->start();
+}
+
+void GadgetStreamController::discard()
+{
+  this->writer_task_.close(1);
+  this->handle_close(ACE_INVALID_HANDLE, 0);
+}
 
+int GadgetStreamController::start()
+{
   //We will set up the controllers message queue such that when a packet is enqueued write will be triggered.
   this->notifier_.reactor (this->reactor ());
   this->msg_queue ()->notification_strategy (&this->notifier_);
@@ -47,6 +83,14 @@ int GadgetStreamController::open (void)
     GINFO("Connection from %s\n", peer_name);
   }
 
+  CloudBus::instance()->report_recon_start();
+  recon_reported_ = true;
+
+  return this->activate( THR_NEW_LWP | THR_JOINABLE, 1);
+}
+
+int GadgetStreamController::open_stream()
+{
   //We have to have these basic types to be able to receive configuration file for stream
   readers_.insert(GADGET_MESSAGE_CONFIG_FILE,
 		  new GadgetMessageConfigFileReader());
@@ -57,6 +101,15 @@ int GadgetStreamController::open (void)
   readers_.insert(GADGET_MESSAGE_PARAMETER_SCRIPT,
 		  new GadgetMessageScriptReader());
 
+  if (this->open_chain() == -1) {
+    return -1;
+  }
+
+  return this->writer_task_.open();
+}
+
+int GadgetStreamController::open_chain()
+{
   GadgetModule *head = 0;
   GadgetModule *tail = 0;
 
@@ -74,10 +127,132 @@ int GadgetStreamController::open (void)
     stream_.open(0,head,tail);
   }
 
-  this->writer_task_.open();
+  return 0;
+}
 
-  return this->activate( THR_NEW_LWP | THR_JOINABLE, 1);
+int GadgetStreamController::end_job(ACE_UINT32 job_id)
+{
+  //Shutdown gadgets and wait for them, the results of the job are then on the output queue.
+  //The end gadget does not send CLOSE, which would stop the writer and the client.
+  ending_job_ = true;
+  stream_.close(1);
+  ending_job_ = false;
+  GDEBUG("Job %d done\n", job_id);
+
+  GadgetContainerMessage<GadgetMessageIdentifier>* mid =
+    new GadgetContainerMessage<GadgetMessageIdentifier>();
+  mid->getObjectPtr()->id = GADGET_MESSAGE_JOB_END;
+
+  GadgetContainerMessage<GadgetMessageJob>* job =
+    new GadgetContainerMessage<GadgetMessageJob>();
+  job->getObjectPtr()->job_id = job_id;
+  mid->cont(job);
+
+  if (this->writer_task_.putq(mid) == -1) {
+    GERROR("Failed to put end of job %d on output queue\n", job_id);
+    mid->release();
+    return GADGET_FAIL;
+  }
+
+  return GADGET_OK;
+}
+
+int GadgetStreamController::rebuild_chain()
+{
+  if (this->open_chain() == -1) {
+    GERROR("Failed to open stream for next job\n");
+    return GADGET_FAIL;
+  }
+
+  GadgetronXML::GadgetStreamConfiguration cfg;
+  try {
+    deserialize(config_xml_.c_str(), cfg);
+  }  catch (const std::runtime_error& e) {
+    GERROR("Failed to parse Gadget Stream Configuration: %s\n", e.what());
+    return GADGET_FAIL;
+  }
 
+  if (this->configure_gadgets(cfg) != GADGET_OK) {
+    GERROR("Failed to configure stream for next job\n");
+    return GADGET_FAIL;
+  }
+
+  if (parameters_.size() && this->put_parameters(parameters_) != GADGET_OK) {
+    GERROR("Failed to put parameters on stream for next job\n");
+    return GADGET_FAIL;
+  }
+
+  return GADGET_OK;
+}
+
+int GadgetStreamController::put_parameters(const std::string& parameters)
+{
+  parameters_ = parameters;
+
+  ACE_Message_Block* mb = new ACE_Message_Block(parameters_.size());
+  memcpy(mb->wr_ptr(), parameters_.c_str(), parameters_.size());
+  mb->wr_ptr(parameters_.size());
+  mb->set_flags(Gadget::GADGET_MESSAGE_CONFIG);
+
+  if (stream_.put(mb) == -1) {
+    mb->release();
+    return GADGET_FAIL;
+  }
+
+  return GADGET_OK;
+}
+
+ACE_HANDLE GadgetStreamController::release_connection()
+{
+  //The writer sends the results already queued, and the end of the job, before it stops
+  if (this->writer_task_.close(1) < 0) {
+    GERROR("Failed to close writer task\n");
+    return ACE_INVALID_HANDLE;
+  }
+
+  ACE_HANDLE handle = this->peer().get_handle();
+  this->peer().set_handle(ACE_INVALID_HANDLE);
+  return handle;
+}
+
+int GadgetStreamController::register_writer(size_t slot, GadgetMessageWriter* writer)
+{
+  return this->writer_task_.register_writer(slot, writer);
+}
+
+int GadgetStreamController::hand_over(GadgetStreamController* controller)
+{
+  //This controller only read the configuration or ran the previous jobs, the pooled chain serves the rest of the connection.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ACE_HANDLE handle = this->release_connection();
+  if (handle == ACE_INVALID_HANDLE) {
+    GERROR("Failed to release connection for pooled chain\n");
+    controller->discard();
+    return GADGET_FAIL;
+  }
+
+  if (recon_reported_) {
+    CloudBus::instance()->report_recon_end();
+    recon_reported_ = false;
+  }
+
+  //The parameters reach the gadgets before the first message the pooled chain reads off the socket
+  if (parameters_.size() && controller->put_parameters(parameters_) != GADGET_OK) {
+    GERROR("Failed to put parameters on pooled chain\n");
+    controller->discard();
+    return GADGET_FAIL;
+  }
+
+  if (controller->attach(handle, this->reactor()) == -1) {
+    GERROR("Failed to attach connection to pooled chain\n");
+    controller->discard();
+    return GADGET_FAIL;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  GadgetChainPool::instance()->record_attach(elapsed.count());
+  GINFO("Connection attached to pooled chain in %f ms\n", elapsed.count());
+  return GADGET_OK;
 }
 
 int GadgetStreamController::svc(void)
@@ -99,6 +274,34 @@ int GadgetStreamController::svc(void)
       continue;
     }
 
+    if (id.id == GADGET_MESSAGE_JOB_END) {
+      GadgetMessageJob job;
+      if ((recv_cnt = peer().recv_n (&job, sizeof(GadgetMessageJob))) <= 0) {
+	GERROR("GadgetStreamController, unable to read job ID\n");
+	return -1;
+      }
+
+      if (this->end_job(job.job_id) != GADGET_OK) {
+	GERROR("Failed to end job %d\n", job.job_id);
+	return GADGET_FAIL;
+      }
+
+      //The next job runs on a prebuilt chain if the pool holds one, and the chain for the job after it
+      //is built in the background meanwhile. Without one the chain is rebuilt here, before reading on.
+      GadgetChainPool* pool = GadgetChainPool::instance();
+      GadgetStreamController* pooled = pool->acquire(config_xml_);
+      pool->prefetch(config_xml_);
+      if (pooled) {
+	return this->hand_over(pooled);
+      }
+
+      if (this->rebuild_chain() != GADGET_OK) {
+	GERROR("Failed to set up chain for the job after %d\n", job.job_id);
+	return GADGET_FAIL;
+      }
+      continue;
+    }
+
     GadgetMessageReader* r = readers_.find(id.id);
 
     if (!r) {
@@ -114,34 +317,48 @@ int GadgetStreamController::svc(void)
     }
 
     //We need to handle some special cases to make sure that we can get a stream set up.
-    if (id.id == GADGET_MESSAGE_CONFIG_FILE) {
-      GadgetContainerMessage<GadgetMessageConfigurationFile>* cfgm =
-	AsContainerMessage<GadgetMessageConfigurationFile>(mb);
+    if (id.id == GADGET_MESSAGE_CONFIG_FILE || id.id == GADGET_MESSAGE_CONFIG_SCRIPT) {
+      std::string xml_config;
+      if (id.id == GADGET_MESSAGE_CONFIG_FILE) {
+	GadgetContainerMessage<GadgetMessageConfigurationFile>* cfgm =
+	  AsContainerMessage<GadgetMessageConfigurationFile>(mb);
+
+	if (!cfgm) {
+	  GERROR("Failed to cast message block to configuration file\n");
+	  mb->release();
+	  return GADGET_FAIL;
+	}
 
-      if (!cfgm) {
-	GERROR("Failed to cast message block to configuration file\n");
+	std::string config_file(cfgm->getObjectPtr()->configuration_file);
 	mb->release();
-	return GADGET_FAIL;
-      } else {
-	if (this->configure_from_file(std::string(cfgm->getObjectPtr()->configuration_file)) != GADGET_OK) {
+	GINFO("Running configuration: %s\n", config_file.c_str());
+	if (read_configuration_file(config_file, xml_config) != GADGET_OK) {
 	  GERROR("GadgetStream configuration failed\n");
-	  mb->release();
 	  return GADGET_FAIL;
-	} else {
-	  mb->release();
-	  continue;
+	}
+      } else {
+	xml_config = std::string(mb->rd_ptr(), mb->length());
+	mb->release();
+      }
+
+      //Use a pre-configured chain if the pool holds one for this configuration
+      if (!stream_configured_) {
+	GadgetStreamController* pooled = GadgetChainPool::instance()->acquire(xml_config);
+	if (pooled) {
+	  return this->hand_over(pooled);
 	}
       }
-    } else if (id.id == GADGET_MESSAGE_CONFIG_SCRIPT) {
-      std::string xml_config(mb->rd_ptr(), mb->length());
+
       if (this->configure(xml_config) != GADGET_OK) {
 	GERROR("GadgetStream configuration failed\n");
-	mb->release();
 	return GADGET_FAIL;
-      } else {
-	mb->release();
-	continue;
       }
+      continue;
+    }
+
+    //Kept to configure the chains of later jobs on this connection
+    if (id.id == GADGET_MESSAGE_PARAMETER_SCRIPT) {
+      parameters_ = std::string(mb->rd_ptr(), mb->length());
     }
 
     ACE_Time_Value wait = ACE_OS::gettimeofday() + ACE_Time_Value(0,10000); //10ms from now
@@ -150,6 +367,15 @@ int GadgetStreamController::svc(void)
       mb->release();
       return GADGET_FAIL;
     }
+
+    //Buffered readers may have parsed more messages than the one returned
+    while ((mb = r->read_pending())) {
+      if (stream_.put(mb) == -1) {
+        GERROR("Failed to put pending message on stream\n");
+        mb->release();
+        return GADGET_FAIL;
+      }
+    }
   }
   return GADGET_OK;
 }
@@ -209,37 +435,34 @@ int GadgetStreamController::handle_close (ACE_HANDLE, ACE_Reactor_Mask mask)
 
 
 
-int GadgetStreamController::configure_from_file(std::string config_xml_filename)
+int GadgetStreamController::read_configuration_file(std::string config_xml_filename, std::string& config_xml_string)
 {
   ACE_TCHAR config_file_name[4096];
-  ACE_OS::sprintf(config_file_name, "%s/%s/%s", gadgetron_home_.c_str(), GADGETRON_CONFIG_PATH, config_xml_filename.c_str());
-  
-  GINFO("Running configuration: %s\n", config_file_name);
-
-  std::ifstream file (config_file_name, std::ios::in|std::ios::binary|std::ios::ate);
-  if (file.is_open()) {
-    size_t size = file.tellg();
-    char* buffer = new char [size];
-    if (!buffer) {
-      GERROR("Unable to create temporary buffer for configuration file\n");
-      return GADGET_FAIL;
-    }
-    file.seekg (0, std::ios::beg);
-    file.read (buffer, size);
-    file.close();
-    std::string xml_file_contents(buffer,size);
-    
-    return configure(xml_file_contents);
-    delete[] buffer;
-    
-  } else {
+  ACE_OS::sprintf(config_file_name, "%s/%s/%s", get_gadgetron_home().c_str(), GADGETRON_CONFIG_PATH, config_xml_filename.c_str());
+
+  std::ifstream file (config_file_name, std::ios::in|std::ios::binary);
+  if (!file.is_open()) {
     GERROR("Unable to open configuation file: %s\n", config_file_name);
     return GADGET_FAIL;
   }
-  
+
+  config_xml_string.assign((std::istreambuf_iterator<char>(file)),
+			   std::istreambuf_iterator<char>());
   return GADGET_OK;
 }
 
+int GadgetStreamController::configure_from_file(std::string config_xml_filename)
+{
+  GINFO("Running configuration: %s\n", config_xml_filename.c_str());
+
+  std::string xml_file_contents;
+  if (read_configuration_file(config_xml_filename, xml_file_contents) != GADGET_OK) {
+    return GADGET_FAIL;
+  }
+
+  return configure(xml_file_contents);
+}
+
 int GadgetStreamController::configure(std::string config_xml_string)
 {
 
@@ -323,71 +546,147 @@ int GadgetStreamController::configure(std::string config_xml_string)
     }
   //Configuration of writers end
 
+  if (this->configure_gadgets(cfg) != GADGET_OK) {
+    return GADGET_FAIL;
+  }
+
+  GINFO("Gadget Stream configured\n");
+  stream_configured_ = true;
+
+  return GADGET_OK;
+}
+
+int GadgetStreamController::configure_gadgets(GadgetronXML::GadgetStreamConfiguration& cfg)
+{
   //Let's configure the stream
   GDEBUG("Processing %d gadgets in reverse order\n",cfg.gadget.size());
 
-  for (std::vector<GadgetronXML::Gadget>::reverse_iterator i = cfg.gadget.rbegin();
-       i != cfg.gadget.rend();
-       ++i) 
+  //Modules are pushed onto the head of the stream, so the stream is built from its end.
+  //A branch is pushed just before the gadget at its position.
+  std::vector<GadgetronXML::Branch>::reverse_iterator b = cfg.branch.rbegin();
+  for (size_t i = cfg.gadget.size()+1; i-- > 0; )
     {
-      std::string gadgetname("");
-      std::string dllname("");
-      std::string classname("");
-
-      gadgetname = i->name;
-      dllname = i->dll;
-      classname = i->classname;
+      for (; b != cfg.branch.rend() && b->position >= i; ++b)
+	{
+	  GadgetModule* m = create_branch_module(*b);
+	  if (!m) {
+	    return GADGET_FAIL;
+	  }
+
+	  if (stream_.push(m) < 0) {
+	    GERROR("Failed to push branch %s onto stream\n", b->name.c_str());
+	    delete m;
+	    return GADGET_FAIL;
+	  }
+	}
 
-      GINFO("--Found gadget declaration\n");
-      GINFO("  Gadget Name: %s\n", gadgetname.c_str());
-      GINFO("  Gadget dll: %s\n", dllname.c_str());
-      GINFO("  Gadget class: %s\n", classname.c_str());
+      if (i == 0) {
+	break;
+      }
 
-      GadgetModule* m = create_gadget_module(dllname.c_str(),
-					     classname.c_str(),
-					     gadgetname.c_str());
-      
+      GadgetModule* m = create_configured_gadget_module(cfg.gadget[i-1]);
       if (!m) {
-	GERROR("Failed to create GadgetModule from %s:%s\n",
-	       classname.c_str(),
-	       dllname.c_str());
 	return GADGET_FAIL;
       }
-      
-      Gadget* g = dynamic_cast<Gadget*>(m->writer());//Get the gadget out of the module
-      
-      GINFO("  Gadget parameters: %d\n", i->property.size());
-      for (std::vector<GadgetronXML::GadgetronParameter>::iterator p = i->property.begin();
-	   p != i->property.end();
-	   ++p)
-	{
-	  std::string pname(p->name);
-	  std::string pval(p->value);
-	  GINFO("Setting parameter %s = %s\n", pname.c_str(),pval.c_str());
-	  g->set_parameter(pname.c_str(),pval.c_str(),false);
-	}
-      
-      // set the global gadget parameters for every gadget
-      std::map<std::string, std::string>::const_iterator iter;
-      for ( iter=global_gadget_parameters_.begin(); iter!=global_gadget_parameters_.end(); iter++ )
-        {
-	  std::string key = iter->first;
-	  std::string value = iter->second;
-	  g->set_parameter(key.c_str(), value.c_str(), false);
-        }
 
       if (stream_.push(m) < 0) {
-	GERROR("Failed to push Gadget %s onto stream\n", gadgetname.c_str());
+	GERROR("Failed to push Gadget %s onto stream\n", cfg.gadget[i-1].name.c_str());
 	delete m;
 	return GADGET_FAIL;
       }
-      
     }
 
-  GINFO("Gadget Stream configured\n");
-  stream_configured_ = true;
-
   return GADGET_OK;
 }
 
+GadgetModule* GadgetStreamController::create_configured_gadget_module(const GadgetronXML::Gadget& cfg)
+{
+  GINFO("--Found gadget declaration\n");
+  GINFO("  Gadget Name: %s\n", cfg.name.c_str());
+  GINFO("  Gadget dll: %s\n", cfg.dll.c_str());
+  GINFO("  Gadget class: %s\n", cfg.classname.c_str());
+
+  GadgetModule* m = create_gadget_module(cfg.dll.c_str(),
+					 cfg.classname.c_str(),
+					 cfg.name.c_str());
+
+  if (!m) {
+    GERROR("Failed to create GadgetModule from %s:%s\n",
+	   cfg.classname.c_str(),
+	   cfg.dll.c_str());
+    return 0;
+  }
+
+  Gadget* g = dynamic_cast<Gadget*>(m->writer());//Get the gadget out of the module
+
+  GINFO("  Gadget parameters: %d\n", cfg.property.size());
+  for (std::vector<GadgetronXML::GadgetronParameter>::const_iterator p = cfg.property.begin();
+       p != cfg.property.end();
+       ++p)
+    {
+      GINFO("Setting parameter %s = %s\n", p->name.c_str(), p->value.c_str());
+      g->set_parameter(p->name.c_str(), p->value.c_str(), false);
+    }
 
+  // set the global gadget parameters for every gadget
+  std::map<std::string, std::string>::const_iterator iter;
+  for ( iter=global_gadget_parameters_.begin(); iter!=global_gadget_parameters_.end(); iter++ )
+    {
+      g->set_parameter(iter->first.c_str(), iter->second.c_str(), false);
+    }
+
+  if (cfg.queue) {
+    GadgetQueueLimits limits;
+    limits.high_water_bytes = (size_t)cfg.queue->highWaterMB << 20;
+    limits.low_water_bytes = (size_t)cfg.queue->lowWaterMB << 20;
+    limits.high_water_messages = cfg.queue->highWaterMessages;
+    limits.low_water_messages = cfg.queue->lowWaterMessages;
+    GINFO("  Gadget queue limits: %d MB, %d messages\n", cfg.queue->highWaterMB, cfg.queue->highWaterMessages);
+    g->set_queue_limits(limits);
+  }
+
+  return m;
+}
+
+GadgetModule* GadgetStreamController::create_branch_module(const GadgetronXML::Branch& cfg)
+{
+  GINFO("--Found branch declaration\n");
+  GINFO("  Branch Name: %s\n", cfg.name.c_str());
+  GINFO("  Branch paths: %d\n", cfg.path.size());
+
+  BranchGadget* branch = new BranchGadget();
+  branch->set_controller(this);
+
+  GadgetModule* module = 0;
+  ACE_NEW_RETURN(module,
+		 GadgetModule(cfg.name.c_str(), branch),
+		 0);
+
+  for (size_t p = 0; p < cfg.path.size(); p++) {
+    ACE_Stream<ACE_MT_SYNCH>* path = branch->add_path();
+    if (!path) {
+      delete module;
+      return 0;
+    }
+
+    for (std::vector<GadgetronXML::Gadget>::const_reverse_iterator i = cfg.path[p].rbegin();
+	 i != cfg.path[p].rend();
+	 ++i)
+      {
+	GadgetModule* m = create_configured_gadget_module(*i);
+	if (!m) {
+	  delete module;
+	  return 0;
+	}
+
+	if (path->push(m) < 0) {
+	  GERROR("Failed to push Gadget %s onto branch %s\n", i->name.c_str(), cfg.name.c_str());
+	  delete m;
+	  delete module;
+	  return 0;
+	}
+      }
+  }
+
+  return module;
+}
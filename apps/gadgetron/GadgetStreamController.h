@@ -14,6 +14,7 @@
 #include "gadgetbase_export.h"
 #include "GadgetronConnector.h"
 #include "GadgetStreamInterface.h"
+#include "gadgetron_xml.h"
 
 
 namespace Gadgetron{
@@ -30,6 +31,39 @@ public:
   virtual int open (void);
   virtual int svc(void);
 
+  /**
+     Set up and configure the chain without a connection, used by GadgetChainPool
+   */
+  virtual int prepare(std::string config_xml_string);
+
+  /**
+     Take over a connection whose configuration matched this prepared chain
+   */
+  virtual int attach(ACE_HANDLE handle, ACE_Reactor* reactor);
+
+  /**
+     Put the parameter script of the connection on the stream and keep it for later jobs
+   */
+  virtual int put_parameters(const std::string& parameters);
+
+  /**
+     Shut down and delete a chain that never served a connection
+   */
+  virtual void discard();
+
+  /**
+     Send what is queued for the client and give up the socket, which is returned.
+     Returns ACE_INVALID_HANDLE if the writer could not be closed.
+   */
+  virtual ACE_HANDLE release_connection();
+
+  /**
+     Writer for the messages with the given ID on the output of the chain
+   */
+  virtual int register_writer(size_t slot, GadgetMessageWriter* writer);
+
+  static int read_configuration_file(std::string config_xml_filename, std::string& config_xml_string);
+
 
   virtual int handle_input (ACE_HANDLE fd = ACE_INVALID_HANDLE);
   virtual int handle_close (ACE_HANDLE handle,
@@ -41,7 +75,27 @@ private:
   WriterTask writer_task_;
   ACE_Reactor_Notification_Strategy notifier_;
   GadgetMessageReaderContainer readers_;
+  bool recon_reported_;
+  std::string parameters_;
+  int open_stream();
+  int open_chain();
+  int start();
+
+  /**
+     Flushes the chain and reports the job done to the client
+   */
+  int end_job(ACE_UINT32 job_id);
+
+  /**
+     Builds a fresh chain with the same configuration and parameters on this controller,
+     used for the next job when the pool holds no prebuilt chain
+   */
+  int rebuild_chain();
+  int hand_over(GadgetStreamController* controller);
   virtual int configure(std::string config_xml_string);
+  int configure_gadgets(GadgetronXML::GadgetStreamConfiguration& cfg);
+  GadgetModule* create_configured_gadget_module(const GadgetronXML::Gadget& cfg);
+  GadgetModule* create_branch_module(const GadgetronXML::Branch& cfg);
   virtual int configure_from_file(std::string config_xml_filename);
 };
 
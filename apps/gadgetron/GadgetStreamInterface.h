@@ -21,6 +21,7 @@ namespace Gadgetron {
   public:
     GadgetStreamInterface()
       : stream_configured_(false)
+      , ending_job_(false)
     {  
       gadgetron_home_ = get_gadgetron_home();
     } 
@@ -50,6 +51,48 @@ namespace Gadgetron {
     {
       return config_xml_;
     }
+
+    /**
+       True while the chain is closed at the end of a job; the connection stays open for the next job
+     */
+    bool ending_job()
+    {
+      return ending_job_;
+    }
+
+    struct GadgetQueueStatus
+    {
+      std::string gadget;
+      size_t bytes;
+      size_t messages;
+      bool throttled;
+    };
+
+    /**
+       Queued bytes and messages of every gadget, in stream order
+     */
+    virtual std::vector<GadgetQueueStatus> queue_status()
+    {
+      std::vector<GadgetQueueStatus> status;
+
+      ACE_Stream_Iterator<ACE_MT_SYNCH> it(stream_);
+      const GadgetModule* m = 0;
+      for (; it.next(m); it.advance()) {
+	Gadget* g = dynamic_cast<Gadget*>(const_cast<GadgetModule*>(m)->writer());
+	if (!g) {
+	  continue;
+	}
+
+	GadgetQueueStatus s;
+	s.gadget = m->name();
+	s.bytes = g->queued_bytes();
+	s.messages = g->queued_messages();
+	s.throttled = g->queue_throttled();
+	status.push_back(s);
+      }
+
+      return status;
+    }
     
     template <class T>  T* load_dll_component(const char* DLL, const char* component_name)
     {
@@ -105,6 +148,7 @@ namespace Gadgetron {
   protected:
     ACE_Stream<ACE_MT_SYNCH> stream_;
     bool stream_configured_;  
+    bool ending_job_;
     std::vector<ACE_DLL_Handle*> dll_handles_;
     std::map<std::string, std::string> global_gadget_parameters_;
     std::string gadgetron_home_;
@@ -0,0 +1,193 @@
+#include "GadgetThreadPool.h"
+#include "Gadget.h"
+
+#include <algorithm>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+using namespace Gadgetron;
+
+namespace {
+  //Index of the worker running on this thread, -1 on other threads
+  thread_local int worker_index = -1;
+}
+
+GadgetThreadPool* GadgetThreadPool::instance_ = 0;
+
+GadgetThreadPool* GadgetThreadPool::instance()
+{
+  static std::mutex instance_mtx;
+  std::lock_guard<std::mutex> guard(instance_mtx);
+  if (!instance_) {
+    instance_ = new GadgetThreadPool();
+  }
+  return instance_;
+}
+
+GadgetThreadPool::GadgetThreadPool()
+  : pending_(0)
+  , active_(0)
+  , next_(0)
+  , enabled_(false)
+  , stopping_(false)
+{
+}
+
+void GadgetThreadPool::start(unsigned int threads)
+{
+  if (enabled_) {
+    GERROR("Gadget thread pool already started\n");
+    return;
+  }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int i = 0; i < threads; i++) {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+
+  stopping_ = false;
+  for (unsigned int i = 0; i < threads; i++) {
+    threads_.push_back(std::thread(&GadgetThreadPool::run, this, (size_t)i));
+  }
+
+  enabled_ = true;
+  GINFO("Running gadgets on a shared pool of %d threads\n", threads);
+}
+
+void GadgetThreadPool::stop()
+{
+  if (!enabled_) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(sleep_mtx_);
+    stopping_ = true;
+  }
+  sleep_cv_.notify_all();
+
+  for (size_t i = 0; i < threads_.size(); i++) {
+    threads_[i].join();
+  }
+  threads_.clear();
+  workers_.clear();
+
+  enabled_ = false;
+  GINFO("Gadget thread pool stopped\n");
+}
+
+bool GadgetThreadPool::enabled()
+{
+  return enabled_;
+}
+
+unsigned int GadgetThreadPool::threads()
+{
+  return (unsigned int)workers_.size();
+}
+
+unsigned int GadgetThreadPool::active()
+{
+  return active_;
+}
+
+bool GadgetThreadPool::on_worker_thread()
+{
+  return worker_index >= 0;
+}
+
+int GadgetThreadPool::omp_budget()
+{
+#ifdef USE_OMP
+  if (worker_index < 0) {
+    return omp_get_max_threads();
+  }
+
+  //Workers only run once the pool exists
+  unsigned int busy = std::max(1u, instance_->active());
+  return (int)std::max(1u, instance_->threads() / busy);
+#else
+  return 1;
+#endif
+}
+
+void GadgetThreadPool::submit(Gadget* g)
+{
+  //Tasks submitted from a worker stay on it, the next gadget of a chain then finds its input in cache
+  size_t w = worker_index >= 0 ? (size_t)worker_index : next_++ % workers_.size();
+
+  {
+    std::lock_guard<std::mutex> guard(workers_[w]->mtx);
+    workers_[w]->tasks.push_back(g);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(sleep_mtx_);
+    pending_++;
+  }
+  sleep_cv_.notify_one();
+}
+
+bool GadgetThreadPool::try_pop(size_t self, Gadget*& g)
+{
+  {
+    Worker& own = *workers_[self];
+    std::lock_guard<std::mutex> guard(own.mtx);
+    if (!own.tasks.empty()) {
+      g = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t k = 1; k < workers_.size(); k++) {
+    Worker& victim = *workers_[(self + k) % workers_.size()];
+    std::lock_guard<std::mutex> guard(victim.mtx);
+    if (!victim.tasks.empty()) {
+      g = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void GadgetThreadPool::run(size_t self)
+{
+  worker_index = (int)self;
+
+  while (true) {
+    Gadget* g = 0;
+    if (!try_pop(self, g)) {
+      std::unique_lock<std::mutex> lock(sleep_mtx_);
+      sleep_cv_.wait(lock, [this]() { return pending_ > 0 || stopping_; });
+      if (pending_ == 0 && stopping_) {
+        break;
+      }
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(sleep_mtx_);
+      pending_--;
+    }
+
+    ++active_;
+#ifdef USE_OMP
+    //Default for regions that do not query omp_budget() themselves
+    omp_set_num_threads(omp_budget());
+#endif
+
+    g->run_pooled();
+
+    --active_;
+  }
+
+  worker_index = -1;
+}
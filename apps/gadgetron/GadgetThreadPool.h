@@ -0,0 +1,93 @@
+#ifndef GADGETTHREADPOOL_H
+#define GADGETTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gadgetbase_export.h"
+
+namespace Gadgetron{
+
+class Gadget;
+
+/**
+   Process-wide work-stealing pool that runs gadgets instead of a thread per gadget.
+
+   When started, single threaded gadgets do not activate their own thread; a gadget
+   is submitted as a task when a message is put on its queue and processes a batch of
+   queued messages on a worker. A gadget is never scheduled twice at once, so its
+   messages are processed in order. Each worker keeps a deque of tasks, runs its own
+   tasks newest first and steals the oldest tasks of other workers when it runs dry.
+
+   OpenMP regions started from a worker should be limited to an equal share of the pool
+   threads among the busy workers, so gadget tasks and toolbox parallelism together
+   stay within the pool budget. The share changes while a task runs, so gadgets query
+   omp_budget() when they enter a parallel region; the share at the start of a task
+   is only the default for regions that do not ask.
+ */
+class EXPORTGADGETBASE GadgetThreadPool
+{
+public:
+  static GadgetThreadPool* instance();
+
+  /**
+     Start the workers, 0 uses one per hardware thread. Must be called before any stream is opened.
+   */
+  void start(unsigned int threads = 0);
+
+  /**
+     Let the workers finish the queued tasks and join them. Must be called after all streams are closed.
+   */
+  void stop();
+
+  bool enabled();
+
+  unsigned int threads();
+
+  /**
+     Number of workers currently running a gadget
+   */
+  unsigned int active();
+
+  void submit(Gadget* g);
+
+  static bool on_worker_thread();
+
+  /**
+     Number of OpenMP threads a parallel region entered now should use: on a worker, an equal share
+     of the pool threads among the busy workers, elsewhere omp_get_max_threads(). 1 without OpenMP.
+   */
+  static int omp_budget();
+
+private:
+  GadgetThreadPool();
+
+  struct Worker
+  {
+    std::mutex mtx;
+    std::deque<Gadget*> tasks;
+  };
+
+  bool try_pop(size_t self, Gadget*& g);
+  void run(size_t self);
+
+  std::vector<std::unique_ptr<Worker> > workers_;
+  std::vector<std::thread> threads_;
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cv_;
+  size_t pending_;
+  std::atomic<unsigned int> active_;
+  std::atomic<size_t> next_;
+  bool enabled_;
+  bool stopping_;
+
+  static GadgetThreadPool* instance_;
+};
+
+}
+#endif //GADGETTHREADPOOL_H
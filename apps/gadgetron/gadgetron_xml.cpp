@@ -22,6 +22,11 @@ namespace GadgetronXML
 
     h.port = port.child_value();
 
+    pugi::xml_node local_socket = root.child("localSocket");
+    if (local_socket) {
+      h.localSocket = std::string(local_socket.child_value());
+    }
+
     pugi::xml_node p = root.child("globalGadgetParameter");
     while (p) {
       GadgetronParameter pp;
@@ -44,6 +49,10 @@ namespace GadgetronXML
       if (lbn) {
           cb.lbEndpoint = b.child_value("loadBalancedEndpoint");
       }
+      pugi::xml_node ccn = b.child("computeCapability");
+      if (ccn) {
+          cb.computeCapability = static_cast<unsigned int>(std::atoi(ccn.child_value()));
+      }
       h.cloudBus = cb;
     }
 
@@ -56,6 +65,96 @@ namespace GadgetronXML
       }
       h.rest = re;
     }
+
+    pugi::xml_node m = root.child("memoryPool");
+    if (m) {
+      MemoryPool mp;
+      mp.maxCachedMB = 1024;
+      mp.hugePages = true;
+      if (m.child("maxCachedMB")) {
+        mp.maxCachedMB = static_cast<unsigned int>(std::atoi(m.child_value("maxCachedMB")));
+      }
+      if (m.child("hugePages")) {
+        std::string v = m.child_value("hugePages");
+        mp.hugePages = (v == "true" || v == "1");
+      }
+      h.memoryPool = mp;
+    }
+
+    pugi::xml_node f = root.child("fftw");
+    if (f) {
+      FFTW fw;
+      if (f.child("wisdomFile")) {
+        fw.wisdomFile = std::string(f.child_value("wisdomFile"));
+      }
+      fw.planningRigor = f.child("planningRigor") ? f.child_value("planningRigor") : "measure";
+      if (fw.planningRigor != "measure" && fw.planningRigor != "patient" && fw.planningRigor != "exhaustive") {
+        throw std::runtime_error("Invalid FFTW planning rigor, expected measure, patient or exhaustive.");
+      }
+
+      pugi::xml_node pl = f.child("plan");
+      while (pl) {
+        FFTWPlan fp;
+        fp.size = pl.child_value("size");
+        fp.batch = pl.child("batch") ? static_cast<unsigned int>(std::atoi(pl.child_value("batch"))) : 1;
+        fw.plan.push_back(fp);
+        pl = pl.next_sibling("plan");
+      }
+      h.fftw = fw;
+    }
+
+    pugi::xml_node tp = root.child("threadPool");
+    if (tp) {
+      ThreadPool pool;
+      pool.threads = tp.child("threads") ? static_cast<unsigned int>(std::atoi(tp.child_value("threads"))) : 0;
+      h.threadPool = pool;
+    }
+
+    pugi::xml_node cp = root.child("chainPool");
+    if (cp) {
+      ChainPool pool;
+      pugi::xml_node pc = cp.child("configuration");
+      while (pc) {
+        ChainPoolConfiguration c;
+        c.name = pc.child_value("name");
+        c.size = pc.child("size") ? static_cast<unsigned int>(std::atoi(pc.child_value("size"))) : 1;
+        if (c.name.size() == 0) {
+          throw std::runtime_error("Invalid chain pool configuration, name missing.");
+        }
+        pool.configuration.push_back(c);
+        pc = pc.next_sibling("configuration");
+      }
+      h.chainPool = pool;
+    }
+  }
+
+  void deserialize_gadget(pugi::xml_node& node, Gadget& g)
+  {
+    g.name = node.child_value("name");
+    g.dll = node.child_value("dll");
+    g.classname = node.child_value("classname");
+
+    pugi::xml_node property = node.child("property");
+    while (property) {
+      GadgetronParameter p;
+      p.name = property.child_value("name");
+      p.value = property.child_value("value");
+      g.property.push_back(p);
+      property = property.next_sibling("property");
+    }
+
+    pugi::xml_node queue = node.child("queue");
+    if (queue) {
+      GadgetQueue q;
+      q.highWaterMB = static_cast<unsigned int>(std::atoi(queue.child_value("highWaterMB")));
+      q.highWaterMessages = static_cast<unsigned int>(std::atoi(queue.child_value("highWaterMessages")));
+      q.lowWaterMB = queue.child("lowWaterMB") ? static_cast<unsigned int>(std::atoi(queue.child_value("lowWaterMB"))) : q.highWaterMB/2;
+      q.lowWaterMessages = queue.child("lowWaterMessages") ? static_cast<unsigned int>(std::atoi(queue.child_value("lowWaterMessages"))) : q.highWaterMessages/2;
+      if (q.lowWaterMB > q.highWaterMB || q.lowWaterMessages > q.highWaterMessages) {
+        throw std::runtime_error("Invalid gadget queue configuration, low watermark above high watermark.");
+      }
+      g.queue = q;
+    }
   }
 
   void deserialize(const char* xml_config, GadgetStreamConfiguration& cfg)
@@ -88,24 +187,33 @@ namespace GadgetronXML
       writer = writer.next_sibling("writer");
     }
 
-    pugi::xml_node gadget = root.child("gadget");
-    while (gadget) {
-      Gadget g;
-      g.name = gadget.child_value("name");
-      g.dll = gadget.child_value("dll");
-      g.classname = gadget.child_value("classname");
-
-      pugi::xml_node property = gadget.child("property");
-      while (property) {
-        GadgetronParameter p;
-        p.name = property.child_value("name");
-        p.value = property.child_value("value");
-        g.property.push_back(p);
-        property = property.next_sibling("property");
+    pugi::xml_node node = root.first_child();
+    while (node) {
+      //Gadgets and branches are read in document order, a branch takes the gadgets before it as position
+      if (std::string(node.name()) == "gadget") {
+        Gadget g;
+        deserialize_gadget(node, g);
+        cfg.gadget.push_back(g);
+      } else if (std::string(node.name()) == "branch") {
+        Branch b;
+        b.name = node.child_value("name");
+        b.position = cfg.gadget.size();
+        pugi::xml_node path = node.child("path");
+        while (path) {
+          std::vector<Gadget> gadgets;
+          pugi::xml_node gadget = path.child("gadget");
+          while (gadget) {
+            Gadget g;
+            deserialize_gadget(gadget, g);
+            gadgets.push_back(g);
+            gadget = gadget.next_sibling("gadget");
+          }
+          b.path.push_back(gadgets);
+          path = path.next_sibling("path");
+        }
+        cfg.branch.push_back(b);
       }
-
-      cfg.gadget.push_back(g);
-      gadget = gadget.next_sibling("gadget");
+      node = node.next_sibling();
     }
   }
 
@@ -123,6 +231,46 @@ namespace GadgetronXML
     return std::string(buffer);
   }
 
+  std::string to_string_val(const unsigned int& v)
+  {
+    char buffer[256];
+    sprintf(buffer,"%u",v);
+    return std::string(buffer);
+  }
+
+  void serialize_gadget(pugi::xml_node& parent, const Gadget& g)
+  {
+    pugi::xml_node n1,n2,n3;
+    n1 = parent.append_child("gadget");
+
+    n2 = n1.append_child("name");
+    n2.append_child(pugi::node_pcdata).set_value(g.name.c_str());
+
+    n2 = n1.append_child("dll");
+    n2.append_child(pugi::node_pcdata).set_value(g.dll.c_str());
+
+    n2 = n1.append_child("classname");
+    n2.append_child(pugi::node_pcdata).set_value(g.classname.c_str());
+
+    for (std::vector<GadgetronParameter>::const_iterator it = g.property.begin();
+    it != g.property.end(); it++)
+    {
+      n2 = n1.append_child("property");
+      n3 = n2.append_child("name");
+      n3.append_child(pugi::node_pcdata).set_value(it->name.c_str());
+      n3 = n2.append_child("value");
+      n3.append_child(pugi::node_pcdata).set_value(it->value.c_str());
+    }
+
+    if (g.queue) {
+      n2 = n1.append_child("queue");
+      append_node(n2, "highWaterMB", to_string_val(g.queue->highWaterMB));
+      append_node(n2, "lowWaterMB", to_string_val(g.queue->lowWaterMB));
+      append_node(n2, "highWaterMessages", to_string_val(g.queue->highWaterMessages));
+      append_node(n2, "lowWaterMessages", to_string_val(g.queue->lowWaterMessages));
+    }
+  }
+
   void serialize(const GadgetStreamConfiguration& cfg, std::ostream& o)
   {
     pugi::xml_document doc;
@@ -175,28 +323,26 @@ namespace GadgetronXML
       n2.append_child(pugi::node_pcdata).set_value(it->classname.c_str());
     }
 
-    for (std::vector<Gadget>::const_iterator it = cfg.gadget.begin();
-    it != cfg.gadget.end(); it++)
+    //Branches are written before the gadget at their position
+    std::vector<Branch>::const_iterator b = cfg.branch.begin();
+    for (size_t i = 0; i <= cfg.gadget.size(); i++)
     {
-      n1 = root.append_child("gadget");
-
-      n2 = n1.append_child("name");
-      n2.append_child(pugi::node_pcdata).set_value(it->name.c_str());
-
-      n2 = n1.append_child("dll");
-      n2.append_child(pugi::node_pcdata).set_value(it->dll.c_str());
-
-      n2 = n1.append_child("classname");
-      n2.append_child(pugi::node_pcdata).set_value(it->classname.c_str());
-
-      for (std::vector<GadgetronParameter>::const_iterator it2 = it->property.begin();
-      it2 != it->property.end(); it2++)
+      for (; b != cfg.branch.end() && (b->position <= i || i == cfg.gadget.size()); b++)
       {
-        n2 = n1.append_child("property");
-        n3 = n2.append_child("name");
-        n3.append_child(pugi::node_pcdata).set_value(it2->name.c_str());
-        n3 = n2.append_child("value");
-        n3.append_child(pugi::node_pcdata).set_value(it2->value.c_str());
+        n1 = root.append_child("branch");
+        append_node(n1, "name", b->name);
+        for (std::vector< std::vector<Gadget> >::const_iterator p = b->path.begin(); p != b->path.end(); p++)
+        {
+          n2 = n1.append_child("path");
+          for (std::vector<Gadget>::const_iterator g = p->begin(); g != p->end(); g++)
+          {
+            serialize_gadget(n2, *g);
+          }
+        }
+      }
+
+      if (i < cfg.gadget.size()) {
+        serialize_gadget(root, cfg.gadget[i]);
       }
     }
 
@@ -79,6 +79,7 @@ namespace GadgetronXML
     std::string relayAddress;
     unsigned int port;
     Optional<std::string> lbEndpoint;
+    Optional<unsigned int> computeCapability;
   };
 
 
@@ -86,13 +87,53 @@ namespace GadgetronXML
   {
     unsigned int port;
   };
+
+  struct MemoryPool
+  {
+    unsigned int maxCachedMB;
+    bool hugePages;
+  };
+
+  struct FFTWPlan
+  {
+    std::string size;
+    unsigned int batch;
+  };
+
+  struct FFTW
+  {
+    Optional<std::string> wisdomFile;
+    std::string planningRigor;
+    std::vector<FFTWPlan> plan;
+  };
+
+  struct ThreadPool
+  {
+    unsigned int threads;
+  };
+
+  struct ChainPoolConfiguration
+  {
+    std::string name;
+    unsigned int size;
+  };
+
+  struct ChainPool
+  {
+    std::vector<ChainPoolConfiguration> configuration;
+  };
   
   struct GadgetronConfiguration
   {
     std::string port;
+    Optional<std::string> localSocket;
     std::vector<GadgetronParameter> globalGadgetParameter;
     Optional<CloudBus> cloudBus;
     Optional<ReST> rest;
+    Optional<MemoryPool> memoryPool;
+    Optional<FFTW> fftw;
+    Optional<ChainPool> chainPool;
+    Optional<ThreadPool> threadPool;
   };
 
   void EXPORTGADGETBASE deserialize(const char* xml_config, GadgetronConfiguration& h);
@@ -105,6 +146,14 @@ namespace GadgetronXML
   };
 
   typedef Reader Writer;
+
+  struct GadgetQueue
+  {
+    unsigned int highWaterMB;
+    unsigned int lowWaterMB;
+    unsigned int highWaterMessages;
+    unsigned int lowWaterMessages;
+  };
   
   struct Gadget
   {
@@ -112,6 +161,18 @@ namespace GadgetronXML
     std::string dll;
     std::string classname;
     std::vector<GadgetronParameter> property;
+    Optional<GadgetQueue> queue;
+  };
+
+  /**
+     Parallel paths after the first position gadgets of the stream. Every path receives
+     each message, the outputs of all paths continue to the gadget at position.
+   */
+  struct Branch
+  {
+    std::string name;
+    size_t position;
+    std::vector< std::vector<Gadget> > path;
   };
 
   struct GadgetStreamConfiguration
@@ -119,6 +180,7 @@ namespace GadgetronXML
     std::vector<Reader> reader;
     std::vector<Writer> writer;
     std::vector<Gadget> gadget;
+    std::vector<Branch> branch;
   };
 
   void EXPORTGADGETBASE deserialize(const char* xml, GadgetStreamConfiguration& cfg);
@@ -8,8 +8,13 @@
 #include "gadgetron_config.h"
 #include "gadgetron_paths.h"
 #include "CloudBus.h"
+#include "GadgetChainPool.h"
+#include "GadgetThreadPool.h"
+#include "GadgetStatistics.h"
 
 #include "gadgetron_system_info.h"
+#include "hoMemoryPool.h"
+#include "hoNDFFT.h"
 
 #include <ace/Log_Msg.h>
 #include <ace/Service_Config.h>
@@ -20,6 +25,7 @@
 #include <string>
 #include <fstream>
 #include <streambuf>
+#include <sstream>
 
 
 #ifdef _WIN32
@@ -83,12 +89,70 @@ namespace Gadgetron {
     return true;
   }
 
+  // Load FFTW wisdom, plan the configured sizes so the first scan does not pay for planning, and write the wisdom back
+  void warm_start_fftw(const GadgetronXML::FFTW& cfg)
+  {
+    hoNDFFT<float>* fft = hoNDFFT<float>::instance();
+
+    if (cfg.wisdomFile) {
+      if (fft->import_wisdom(*cfg.wisdomFile)) {
+        GINFO("Loaded FFTW wisdom from %s\n", cfg.wisdomFile->c_str());
+      } else {
+        GINFO("No FFTW wisdom loaded from %s\n", cfg.wisdomFile->c_str());
+      }
+    }
+
+    unsigned rigor = FFTW_MEASURE;
+    if (cfg.planningRigor == "patient") rigor = FFTW_PATIENT;
+    if (cfg.planningRigor == "exhaustive") rigor = FFTW_EXHAUSTIVE;
+
+    for (std::vector<GadgetronXML::FFTWPlan>::const_iterator it = cfg.plan.begin(); it != cfg.plan.end(); ++it) {
+      std::vector<size_t> dims;
+      std::stringstream ss(it->size);
+      size_t d;
+      while (ss >> d) dims.push_back(d);
+
+      if (dims.empty() || dims.size() > 3) {
+        GERROR("Ignoring FFTW plan of size '%s', 1 to 3 dimensions expected\n", it->size.c_str());
+        continue;
+      }
+
+      GINFO("Planning FFTW transforms of size %s, batch %d (%s)\n", it->size.c_str(), it->batch, cfg.planningRigor.c_str());
+      try {
+        fft->plan_ahead(dims, it->batch, rigor);
+      } catch (std::exception& e) {
+        GERROR("FFTW planning of size %s failed: %s\n", it->size.c_str(), e.what());
+      }
+    }
+
+    if (cfg.wisdomFile) {
+      if (!fft->export_wisdom(*cfg.wisdomFile)) {
+        GERROR("Unable to write FFTW wisdom to %s\n", cfg.wisdomFile->c_str());
+      }
+    }
+  }
+
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+  // Ends the reactor event loop on SIGINT and SIGTERM, so the local acceptor is closed and removes its socket file
+  class LocalSocketShutdownHandler : public ACE_Event_Handler
+  {
+  public:
+    virtual int handle_signal(int signum, siginfo_t* = 0, ucontext_t* = 0)
+    {
+      GINFO("Signal %d received, shutting down\n", signum);
+      ACE_Reactor::instance()->end_reactor_event_loop();
+      return 0;
+    }
+  };
+#endif
+
 }
 
 void print_usage()
 {
   GINFO("Usage: \n");
   GINFO("gadgetron   -p <PORT>                      (default 9002)       \n");
+  GINFO("            -u <LOCAL SOCKET PATH>         (default none)       \n");
   GINFO("            -r <RELAY HOST>                (default localhost)  \n");
   GINFO("            -l <RELAY PORT>                (default 0, disabled)\n");
   GINFO("            -R <REST PORT>                 (default 0, disabled)\n");
@@ -115,6 +179,8 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
   uint16_t  relay_port = 0;
   uint16_t  rest_port = 0;
   std::string lb_endpoint = "";
+  uint32_t compute_capability = 1;
+  std::string local_socket = "";
   
   ACE_OS_String::strncpy(relay_host, "localhost", 1024);
 
@@ -133,17 +199,29 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
       GadgetronXML::deserialize(gcfg_text.c_str(), c);
       ACE_OS_String::strncpy(port_no, c.port.c_str(), 1024);
 
+      if (c.localSocket) {
+        local_socket = *c.localSocket;
+      }
+
       if (c.cloudBus) {
 	ACE_OS_String::strncpy(relay_host, c.cloudBus->relayAddress.c_str(), 1024);
 	relay_port = c.cloudBus->port;
         if (c.cloudBus->lbEndpoint) {
             lb_endpoint = *c.cloudBus->lbEndpoint;
         }
+        if (c.cloudBus->computeCapability) {
+            compute_capability = *c.cloudBus->computeCapability;
+        }
       }
 
       if (c.rest) {
 	rest_port = c.rest->port;
       }
+
+      if (c.memoryPool) {
+        GINFO("Enabling memory pool, caching up to %d MB\n", c.memoryPool->maxCachedMB);
+        Gadgetron::hoMemoryPool::configure(true, (size_t)c.memoryPool->maxCachedMB << 20, (size_t)1 << 26, c.memoryPool->hugePages);
+      }
       
       for (std::vector<GadgetronXML::GadgetronParameter>::iterator it = c.globalGadgetParameter.begin();
 	   it != c.globalGadgetParameter.end();
@@ -162,7 +240,7 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     return -1;
   }
 
-  static const ACE_TCHAR options[] = ACE_TEXT(":p:r:l:R:e:");
+  static const ACE_TCHAR options[] = ACE_TEXT(":p:u:r:l:R:e:");
   ACE_Get_Opt cmd_opts(argc, argv, options);
 
   int option;
@@ -171,6 +249,9 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     case 'p':
       ACE_OS_String::strncpy(port_no, cmd_opts.opt_arg(), 1024);
       break;
+    case 'u':
+      local_socket = std::string(cmd_opts.opt_arg());
+      break;
     case 'r':
       ACE_OS_String::strncpy(relay_host, cmd_opts.opt_arg(), 1024);
       break;
@@ -206,6 +287,30 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
       std::string content = ss.str();
       return content;
     });
+
+    Gadgetron::ReST::instance()->server().route_dynamic("/info/memory")([]()
+    {
+      Gadgetron::hoMemoryPool::Statistics stats = Gadgetron::hoMemoryPool::statistics();
+      std::stringstream ss;
+      ss << "Memory pool enabled   : " << (Gadgetron::hoMemoryPool::enabled() ? "yes" : "no") << std::endl;
+      ss << "Bytes in use          : " << stats.bytes_in_use << std::endl;
+      ss << "High-water mark       : " << stats.high_water_mark << std::endl;
+      ss << "Bytes cached          : " << stats.bytes_cached << std::endl;
+      ss << "Blocks in use         : " << stats.blocks_in_use << std::endl;
+      return ss.str();
+    });
+
+    Gadgetron::ReST::instance()->server().route_dynamic("/info/chains")([]()
+    {
+      return Gadgetron::GadgetChainPool::instance()->status();
+    });
+
+    Gadgetron::ReST::instance()->server().route_dynamic("/info/gadgets")([]()
+    {
+      crow::response res(Gadgetron::GadgetStatisticsRegistry::instance()->to_json());
+      res.set_header("Content-Type", "application/json");
+      return res;
+    });
   }
 
   if (relay_port > 0) {
@@ -215,6 +320,8 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     Gadgetron::CloudBus::set_gadgetron_port(std::atoi(port_no));
     Gadgetron::CloudBus::set_rest_port(rest_port);
     Gadgetron::CloudBus* cb = Gadgetron::CloudBus::instance();//This actually starts the bus.
+    cb->set_compute_capability(compute_capability);
+    cb->set_pending_bytes_function([]() { return static_cast<uint64_t>(Gadgetron::GadgetStatisticsRegistry::instance()->queued_bytes()); });
     if (lb_endpoint.size()) {
         size_t colon_pos = lb_endpoint.find(":");
         if (colon_pos == std::string::npos) {
@@ -257,6 +364,24 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
       return -1;
     }
 
+  if (c.fftw) {
+    Gadgetron::warm_start_fftw(*c.fftw);
+  }
+
+  if (c.threadPool) {
+    Gadgetron::GadgetThreadPool::instance()->start(c.threadPool->threads);
+  }
+
+  //Also used for the chains prefetched for connections running several jobs
+  Gadgetron::GadgetChainPool::instance()->set_global_gadget_parameters(gadget_parameters);
+  if (c.chainPool) {
+    Gadgetron::GadgetChainPool* pool = Gadgetron::GadgetChainPool::instance();
+    for (std::vector<GadgetronXML::ChainPoolConfiguration>::const_iterator it = c.chainPool->configuration.begin();
+         it != c.chainPool->configuration.end(); ++it) {
+      pool->add_configuration(it->name, it->size);
+    }
+  }
+
   GINFO("Configuring services, Running on port %s\n", port_no);
 
   ACE_INET_Addr port_to_listen (port_no);
@@ -265,8 +390,29 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
   acceptor.reactor (ACE_Reactor::instance ());
   if (acceptor.open (port_to_listen) == -1)
     return 1;
+
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+  GadgetLocalServerAcceptor local_acceptor;
+  Gadgetron::LocalSocketShutdownHandler shutdown_handler;
+  if (local_socket.size()) {
+    GINFO("Accepting local connections on %s\n", local_socket.c_str());
+    local_acceptor.global_gadget_parameters_ = gadget_parameters;
+    local_acceptor.reactor (ACE_Reactor::instance ());
+    if (local_acceptor.open (ACE_UNIX_Addr (local_socket.c_str())) == -1)
+      return 1;
+
+    ACE_Reactor::instance()->register_handler (SIGINT, &shutdown_handler);
+    ACE_Reactor::instance()->register_handler (SIGTERM, &shutdown_handler);
+  }
+#endif
   
   ACE_Reactor::instance()->run_reactor_event_loop ();
 
+#if !defined (ACE_LACKS_UNIX_DOMAIN_SOCKETS)
+  local_acceptor.handle_close (ACE_INVALID_HANDLE, 0);
+#endif
+
+  Gadgetron::GadgetThreadPool::instance()->stop();
+
   return 0;
 }
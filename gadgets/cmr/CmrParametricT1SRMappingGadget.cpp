@@ -116,6 +116,9 @@ namespace Gadgetron {
             t1_sr.thres_fun_ = thres_func.value();
             t1_sr.max_map_value_ = max_T1.value();
 
+            t1_sr.use_batched_fitting_ = use_batched_fitting.value();
+            t1_sr.batch_size_ = fitting_batch_size.value();
+
             t1_sr.verbose_ = verbose.value();
             t1_sr.debug_folder_ = debug_folder_full_path_;
             t1_sr.perform_timing_ = perform_timing.value();
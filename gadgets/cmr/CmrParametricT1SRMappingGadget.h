@@ -28,6 +28,9 @@ namespace Gadgetron {
         GADGET_PROPERTY(thres_func, double, "Threshold for minimal change of cost function", 1e-4);
         GADGET_PROPERTY(max_T1, double, "Maximal T1 allowed in mapping (ms)", 4000);
 
+        GADGET_PROPERTY(use_batched_fitting, bool, "Whether to fit blocks of pixels together with the Levenberg-Marquardt solver", false);
+        GADGET_PROPERTY(fitting_batch_size, size_t, "Number of pixels fitted together in batched fitting", 64);
+
         GADGET_PROPERTY(anchor_image_index, size_t, "Index for anchor image; by default, the first image is the anchor (without SR pulse)", 0);
         GADGET_PROPERTY(anchor_TS, double, "Saturation time for anchor", 10000);
 
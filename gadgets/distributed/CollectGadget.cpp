@@ -4,6 +4,8 @@
 #include "GadgetIsmrmrdReadWrite.h"
 #include "GadgetStreamInterface.h"
 
+#include <algorithm>
+
 namespace Gadgetron{
 
   int CollectGadget::message_id(ACE_Message_Block* m)
@@ -18,14 +20,168 @@ namespace Gadgetron{
   }
 
   CollectGadget::CollectGadget()
+  : next_job_(1)
+  , buffered_bytes_(0)
   {
   }
 
   CollectGadget::~CollectGadget()
   {
+    for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+      for (size_t i = 0; i < j->second.held.size(); i++) {
+        j->second.held[i]->release();
+      }
+    }
   }
 
   int CollectGadget::process(ACE_Message_Block* m)
+  {
+    //Reused connections tag the results with their job and mark the end of each job
+    GadgetContainerMessage<GadgetMessageIdentifier>* mid = AsContainerMessage<GadgetMessageIdentifier>(m);
+    if (mid && mid->getObjectPtr()->id == GADGET_MESSAGE_JOB_END) {
+      GadgetContainerMessage<GadgetMessageJob>* job = AsContainerMessage<GadgetMessageJob>(m->cont());
+      if (!job) {
+        GERROR("CollectGadget::process, end of job without job ID\n");
+        m->release();
+        return GADGET_FAIL;
+      }
+
+      ACE_UINT32 job_id = job->getObjectPtr()->job_id;
+      m->release();
+      return this->process_job_done(job_id);
+    }
+
+    GadgetContainerMessage<GadgetMessageJob>* job = AsContainerMessage<GadgetMessageJob>(m);
+    if (job) {
+      ACE_UINT32 job_id = job->getObjectPtr()->job_id;
+      ACE_Message_Block* result = job->cont();
+      job->cont(0);
+      job->release();
+
+      if (!result) {
+        GERROR("CollectGadget::process, job %d result without data\n", job_id);
+        return GADGET_FAIL;
+      }
+      return this->process_job_result(job_id, result);
+    }
+
+    return this->forward(m);
+  }
+
+  int CollectGadget::process_job_result(ACE_UINT32 job_id, ACE_Message_Block* m)
+  {
+    if (!ordered_output.value()) {
+      jobs_[job_id].results++;
+      return this->forward(m);
+    }
+
+    if (job_id < next_job_) {
+      GWARN("CollectGadget, result of job %d received after the job was done\n", job_id);
+      return this->forward(m);
+    }
+
+    JobResults& job = jobs_[job_id];
+    job.results++;
+
+    if (job_id == next_job_ || job.streaming) {
+      return this->forward(m);
+    }
+
+    job.held.push_back(m);
+    buffered_bytes_ += message_bytes(m);
+
+    //Release the oldest held jobs rather than holding results without bound
+    size_t max_bytes = (size_t)std::max(max_buffered_mb.value(), 0) << 20;
+    for (auto j = jobs_.begin(); max_bytes && buffered_bytes_ > max_bytes && j != jobs_.end(); j++) {
+      if (j->second.held.empty()) continue;
+
+      GWARN("CollectGadget, %d MB held for ordering, passing on job %d before job %d is done\n",
+        (int)(buffered_bytes_ >> 20), j->first, next_job_);
+
+      j->second.streaming = true;
+      for (size_t i = 0; i < j->second.held.size(); i++) {
+        buffered_bytes_ -= std::min(message_bytes(j->second.held[i]), buffered_bytes_);
+        if (this->forward(j->second.held[i]) != GADGET_OK) {
+          j->second.held.erase(j->second.held.begin(), j->second.held.begin()+i+1);
+          return GADGET_FAIL;
+        }
+      }
+      j->second.held.clear();
+    }
+
+    return GADGET_OK;
+  }
+
+  int CollectGadget::process_job_done(ACE_UINT32 job_id)
+  {
+    JobResults& job = jobs_[job_id];
+    GDEBUG("CollectGadget, job %d done with %d results\n", job_id, job.results);
+
+    if (!ordered_output.value()) {
+      jobs_.erase(job_id);
+      return GADGET_OK;
+    }
+
+    job.done = true;
+    return this->advance();
+  }
+
+  int CollectGadget::advance()
+  {
+    while (true) {
+      auto j = jobs_.find(next_job_);
+      if (j == jobs_.end()) {
+        return GADGET_OK;
+      }
+
+      for (size_t i = 0; i < j->second.held.size(); i++) {
+        buffered_bytes_ -= std::min(message_bytes(j->second.held[i]), buffered_bytes_);
+        if (this->forward(j->second.held[i]) != GADGET_OK) {
+          j->second.held.erase(j->second.held.begin(), j->second.held.begin()+i+1);
+          return GADGET_FAIL;
+        }
+      }
+      j->second.held.clear();
+
+      if (!j->second.done) {
+        return GADGET_OK;
+      }
+
+      jobs_.erase(j);
+      next_job_++;
+    }
+  }
+
+  int CollectGadget::close(unsigned long flags)
+  {
+    //The base class waits for the gadget thread and then clears the controller, which the held results still go to
+    GadgetStreamInterface* controller = this->controller_;
+    int ret = BasicPropertyGadget::close(flags);
+    if (flags) {
+      this->controller_ = controller;
+
+      //Jobs that never reported done, e.g. on a failed node, no longer hold back later ones
+      for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+        if (!j->second.held.empty() || !j->second.done) {
+          GDEBUG("CollectGadget, passing on %d held results of job %d at close\n", j->second.held.size(), j->first);
+        }
+
+        for (size_t i = 0; i < j->second.held.size(); i++) {
+          if (this->forward(j->second.held[i]) != GADGET_OK) {
+            ret = GADGET_FAIL;
+          }
+        }
+        j->second.held.clear();
+      }
+      jobs_.clear();
+      buffered_bytes_ = 0;
+
+      this->controller_ = 0;
+    }
+    return ret;
+  }
+
+  int CollectGadget::forward(ACE_Message_Block* m)
   {
     if (pass_through_mode.value()) {
       //It is enough to put the first one, since they are linked
@@ -38,6 +194,7 @@ namespace Gadgetron{
       if (!this->controller_)
       {
         GERROR("Cannot return result to controller, no controller set");
+        m->release();
         return -1;
       }
 
@@ -51,6 +208,7 @@ namespace Gadgetron{
       if ((ret < 0))
       {
         GERROR("Failed to return massage to controller\n");
+        mb->release();
         return GADGET_FAIL;
       }
 
@@ -5,6 +5,8 @@
 #include "gadgetron_distributed_gadgets_export.h"
 
 #include <complex>
+#include <map>
+#include <vector>
 
 namespace Gadgetron{
 
@@ -19,8 +21,47 @@ namespace Gadgetron{
   protected:
     GADGET_PROPERTY(pass_through_mode, bool,
       "If true, data will simply pass through to next gadget, otherwise return to controller", false);
+    GADGET_PROPERTY(ordered_output, bool,
+      "Pass results on in the order the distribute gadget first saw their index in the parallel dimension", false);
+    GADGET_PROPERTY(max_buffered_mb, int,
+      "Results held back for ordering, in MB, before the oldest held job is passed on out of order, 0 for no limit", 512);
+
     virtual int process(ACE_Message_Block* m);
     virtual int message_id(ACE_Message_Block* m);
+    virtual int close(unsigned long flags);
+
+    /**
+    Called for each result of a job from a node, after the job tag has been removed.
+
+    With ordered_output, results of the oldest unfinished job are passed on at once and those of
+    later jobs are held until all jobs before them are done.
+    */
+    virtual int process_job_result(ACE_UINT32 job_id, ACE_Message_Block* m);
+
+    /**
+    Called when all results of a job have been returned
+    */
+    virtual int process_job_done(ACE_UINT32 job_id);
+
+    virtual int forward(ACE_Message_Block* m);
+
+    /**
+    Passes on the held results of the oldest jobs as they become due
+    */
+    int advance();
+
+    struct JobResults
+    {
+      JobResults() : results(0), done(false), streaming(false) {}
+      size_t results;
+      bool done;
+      bool streaming; //Held results were released to keep under max_buffered_mb, the rest follow unordered
+      std::vector<ACE_Message_Block*> held;
+    };
+
+    std::map<ACE_UINT32, JobResults> jobs_; //Unfinished jobs, or finished ones waiting for an older job
+    ACE_UINT32 next_job_; //Oldest job whose results have not all been passed on
+    size_t buffered_bytes_;
   };
 }
 #endif //COLLECTGADGET_H
@@ -2,25 +2,173 @@
 #include "GadgetStreamInterface.h"
 #include "gadgetron_xml.h"
 #include "CloudBus.h"
+#include <ace/OS_NS_unistd.h>
 #include <stdint.h>
+#include <algorithm>
+#include <sstream>
 
 namespace Gadgetron{
 
   DistributionConnector::DistributionConnector(DistributeGadget* g)
   : distribute_gadget_(g)
+  , job_open_(false)
+  , jobs_mtx_("distribution_connector_jobs_mtx")
   {
 
   }
 
   int DistributionConnector::process(size_t messageid, ACE_Message_Block* mb) {
+    jobs_mtx_.acquire();
+    bool tagged = !jobs_.empty();
+    ACE_UINT32 job_id = tagged ? jobs_.front() : 0;
+    jobs_mtx_.release();
+
+    //Another node returned results for this job first
+    if (tagged && !distribute_gadget_->claim_job(job_id, this)) {
+      mb->release();
+      return 0;
+    }
+
+    //Results tell the collector which job they belong to
+    if (tagged) {
+      GadgetContainerMessage<GadgetMessageJob>* job = new GadgetContainerMessage<GadgetMessageJob>();
+      job->getObjectPtr()->job_id = job_id;
+      job->cont(mb);
+      mb = job;
+    }
+
     return distribute_gadget_->collector_putq(mb);
   }
 
+  int DistributionConnector::job_done(ACE_UINT32 job_id) {
+    jobs_mtx_.acquire();
+    if (jobs_.empty() || jobs_.front() != job_id) {
+      jobs_mtx_.release();
+      GERROR("End of job %d received out of order\n", job_id);
+      return -1;
+    }
+    jobs_.pop_front();
+    jobs_mtx_.release();
+
+    return collector_job_done(job_id);
+  }
+
+  int DistributionConnector::svc(void) {
+    int ret = GadgetronConnector::svc();
+
+    //The node has closed the connection, no more results will come for the jobs still in flight
+    jobs_mtx_.acquire();
+    std::deque<ACE_UINT32> remaining;
+    remaining.swap(jobs_);
+    job_open_ = false;
+    jobs_mtx_.release();
+
+    for (auto j = remaining.begin(); j != remaining.end(); j++) {
+      if (collector_job_done(*j) < 0) {
+        ret = -1;
+      }
+    }
+    return ret;
+  }
+
+  int DistributionConnector::collector_job_done(ACE_UINT32 job_id) {
+    if (!distribute_gadget_->finish_job(job_id, this)) {
+      return 0;
+    }
+
+    auto mid = new GadgetContainerMessage<GadgetMessageIdentifier>();
+    mid->getObjectPtr()->id = GADGET_MESSAGE_JOB_END;
+
+    auto job = new GadgetContainerMessage<GadgetMessageJob>();
+    job->getObjectPtr()->job_id = job_id;
+    mid->cont(job);
+
+    return distribute_gadget_->collector_putq(mid);
+  }
+
+  void DistributionConnector::start_job(ACE_UINT32 job_id) {
+    jobs_mtx_.acquire();
+    jobs_.push_back(job_id);
+    job_open_ = true;
+    jobs_mtx_.release();
+  }
+
+  int DistributionConnector::end_job() {
+    jobs_mtx_.acquire();
+    if (!job_open_) {
+      jobs_mtx_.release();
+      return 0;
+    }
+    ACE_UINT32 job_id = jobs_.back();
+    job_open_ = false;
+    jobs_mtx_.release();
+
+    auto mid = new GadgetContainerMessage<GadgetMessageIdentifier>();
+    mid->getObjectPtr()->id = GADGET_MESSAGE_JOB_END;
+
+    auto job = new GadgetContainerMessage<GadgetMessageJob>();
+    job->getObjectPtr()->job_id = job_id;
+    mid->cont(job);
+
+    if (this->putq(mid) == -1) {
+      GERROR("Unable to put end of job %d on connector queue\n", job_id);
+      mid->release();
+      return -1;
+    }
+    return 0;
+  }
+
+  bool DistributionConnector::job_open() {
+    jobs_mtx_.acquire();
+    bool open = job_open_;
+    jobs_mtx_.release();
+    return open;
+  }
+
+  ACE_UINT32 DistributionConnector::open_job() {
+    jobs_mtx_.acquire();
+    ACE_UINT32 job_id = (job_open_ && !jobs_.empty()) ? jobs_.back() : 0;
+    jobs_mtx_.release();
+    return job_id;
+  }
+
+  void DistributionConnector::abort() {
+    GDEBUG("Shutting down connection to %s:%s\n", hostname_.c_str(), port_.c_str());
+    this->peer().close_reader();
+    this->peer().close_writer();
+  }
+
+  void DistributionConnector::discard() {
+    //The writer stops after sending the close message, the reader once the socket is shut down
+    auto m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
+    m1->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+    if (writer_task_.putq(m1) == -1) {
+      m1->release();
+    }
+    writer_task_.close(1);
+
+    this->abort();
+    this->wait();
+  }
+
+  size_t DistributionConnector::jobs_in_flight() {
+    jobs_mtx_.acquire();
+    size_t n = jobs_.size();
+    jobs_mtx_.release();
+    return n;
+  }
+
 
   DistributeGadget::DistributeGadget()
   : BasicPropertyGadget()
   , mtx_("distribution_mtx")
   , prev_connector_(0)
+  , next_job_id_(1)
+  , prev_node_index_(-1)
+  , mean_job_seconds_(0)
+  , finished_jobs_(0)
+  , dispatch_mtx_("distribution_dispatch_mtx")
+  , rng_(std::random_device()())
   {
   }
 
@@ -74,6 +222,10 @@ namespace Gadgetron{
     //  return GADGET_OK;
     //}
 
+    if (reuse_connections.value()) {
+      return this->process_pooled(node_index, m);
+    }
+
     //At this point, the node index is positive, so we need to find a suitable connector.
     mtx_.acquire();
     auto n = node_map_.find(node_index);
@@ -82,101 +234,17 @@ namespace Gadgetron{
     if (n != node_map_.end()) { //We have a suitable connection already.
       con = n->second;
     } else {
-      std::vector<GadgetronNodeInfo> nl;
-      CloudBus::instance()->get_node_info(nl);
+      GadgetronNodeInfo me = choose_node(node_index);
 
-      GDEBUG("Number of network nodes found: %d\n", nl.size());
-
-      GadgetronNodeInfo me;
-      me.address = "127.0.0.1";//We may have to update this
-      me.port = CloudBus::instance()->port();
-      me.uuid = CloudBus::instance()->uuid();
-      me.active_reconstructions = CloudBus::instance()->active_reconstructions();
-
-      //This would give the current node the lowest possible priority
-      if (!use_this_node_for_compute.value()) {
-        me.active_reconstructions = UINT32_MAX;
-      }
-
-      for (auto it = nl.begin(); it != nl.end(); it++) {
-        if (it->active_reconstructions < me.active_reconstructions) {
-          me = *it;
-        }
-
-        //Is this a free node
-        if (me.active_reconstructions == 0) break;
-      }
-
-      // first job, send to current node if required
-      if (use_this_node_for_compute.value() && node_index==0)
-      {
-        size_t num_of_ip = local_address_.size();
-
-          for (auto it = nl.begin(); it != nl.end(); it++)
-          {
-              for (size_t ii=0; ii<num_of_ip; ii++)
-              {
-                  if (it->address == local_address_[ii])
-                  {
-                      me = *it;
-                  }
-              }
-          }
-
-          GDEBUG_STREAM("Send first job to current node : " << me.address);
-      }
-
-      con = new DistributionConnector(this);
-
-      GadgetronXML::GadgetStreamConfiguration cfg;
-      try {
-        deserialize(node_xml_config_.c_str(), cfg);
-      }  catch (const std::runtime_error& e) {
-        GERROR("Failed to parse Node Gadget Stream Configuration: %s\n", e.what());
-        return GADGET_FAIL;
-      }
-
-      //Configuration of readers
-      for (auto i = cfg.reader.begin(); i != cfg.reader.end(); ++i) {
-        GadgetMessageReader* r =
-        controller_->load_dll_component<GadgetMessageReader>(i->dll.c_str(),
-        i->classname.c_str());
-        if (!r) {
-          GERROR("Failed to load GadgetMessageReader from DLL\n");
-          return GADGET_FAIL;
-        }
-        con->register_reader(i->slot, r);
-      }
-
-      for (auto i = cfg.writer.begin(); i != cfg.writer.end(); ++i) {
-        GadgetMessageWriter* w =
-        controller_->load_dll_component<GadgetMessageWriter>(i->dll.c_str(),
-        i->classname.c_str());
-        if (!w) {
-          GERROR("Failed to load GadgetMessageWriter from DLL\n");
-          return GADGET_FAIL;
-        }
-        con->register_writer(i->slot, w);
-      }
-
-
-      char buffer[10];
-      sprintf(buffer,"%d",me.port);
-      if (con->open(me.address,std::string(buffer)) != 0) {
-        GERROR("Failed to open connection to node %s : %d\n", me.address.c_str(), me.port);
+      DistributionConnector* dc = open_connector(me);
+      if (!dc) {
         return GADGET_FAIL;
       }
 
-      if (con->send_gadgetron_configuration_script(node_xml_config_) != 0) {
-        GERROR("Failed to send XML configuration to compute node\n");
-        return GADGET_FAIL;
-      }
+      //Each connection carries one job, it is done when the node closes the connection
+      dc->start_job(next_job_id_++);
+      con = dc;
 
-      if (con->send_gadgetron_parameters(node_parameters_) != 0) {
-        GERROR("Failed to send XML parameters to compute node\n");
-        return GADGET_FAIL;
-      }
-      
       mtx_.acquire();
       node_map_[node_index] = con;
       mtx_.release();
@@ -259,6 +327,445 @@ namespace Gadgetron{
     return 0;
   }
 
+  GadgetronNodeInfo DistributeGadget::choose_node(int node_index)
+  {
+    std::vector<GadgetronNodeInfo> nl;
+    CloudBus::instance()->get_node_info(nl);
+
+    GDEBUG("Number of network nodes found: %d\n", nl.size());
+
+    GadgetronNodeInfo me;
+    me.address = "127.0.0.1";//We may have to update this
+    me.port = CloudBus::instance()->port();
+    me.uuid = CloudBus::instance()->uuid();
+    me.active_reconstructions = CloudBus::instance()->active_reconstructions();
+    me.compute_capability = 1;
+    me.cpu_load = 0;
+    me.free_memory = 0;
+    me.pending_bytes = 0;
+
+    select_node(nl, me);
+
+    GDEBUG_STREAM("Placing job (" << placement_strategy.value() << ") on node " << me.address << ":" << me.port
+      << ", active reconstructions " << me.active_reconstructions << ", cpu load " << me.cpu_load << "%");
+
+    // first job, send to current node if required; the load-aware strategies place it like any other
+    if (use_this_node_for_compute.value() && node_index==0 && placement_strategy.value() == "least_active")
+    {
+      size_t num_of_ip = local_address_.size();
+
+        for (auto it = nl.begin(); it != nl.end(); it++)
+        {
+            for (size_t ii=0; ii<num_of_ip; ii++)
+            {
+                if (it->address == local_address_[ii])
+                {
+                    me = *it;
+                }
+            }
+        }
+
+        GDEBUG_STREAM("Send first job to current node : " << me.address);
+    }
+
+    return me;
+  }
+
+  DistributionConnector* DistributeGadget::open_connector(const GadgetronNodeInfo& node)
+  {
+    DistributionConnector* con = new DistributionConnector(this);
+
+    GadgetronXML::GadgetStreamConfiguration cfg;
+    try {
+      deserialize(node_xml_config_.c_str(), cfg);
+    }  catch (const std::runtime_error& e) {
+      GERROR("Failed to parse Node Gadget Stream Configuration: %s\n", e.what());
+      delete con;
+      return 0;
+    }
+
+    //Configuration of readers
+    for (auto i = cfg.reader.begin(); i != cfg.reader.end(); ++i) {
+      GadgetMessageReader* r =
+      controller_->load_dll_component<GadgetMessageReader>(i->dll.c_str(),
+      i->classname.c_str());
+      if (!r) {
+        GERROR("Failed to load GadgetMessageReader from DLL\n");
+        delete con;
+        return 0;
+      }
+      con->register_reader(i->slot, r);
+    }
+
+    for (auto i = cfg.writer.begin(); i != cfg.writer.end(); ++i) {
+      GadgetMessageWriter* w =
+      controller_->load_dll_component<GadgetMessageWriter>(i->dll.c_str(),
+      i->classname.c_str());
+      if (!w) {
+        GERROR("Failed to load GadgetMessageWriter from DLL\n");
+        delete con;
+        return 0;
+      }
+      con->register_writer(i->slot, w);
+    }
+
+
+    char buffer[10];
+    sprintf(buffer,"%d",node.port);
+    if (con->open(node.address,std::string(buffer)) != 0) {
+      GERROR("Failed to open connection to node %s : %d\n", node.address.c_str(), node.port);
+      con->discard();
+      delete con;
+      return 0;
+    }
+
+    if (con->send_gadgetron_configuration_script(node_xml_config_) != 0) {
+      GERROR("Failed to send XML configuration to compute node\n");
+      con->discard();
+      delete con;
+      return 0;
+    }
+
+    if (con->send_gadgetron_parameters(node_parameters_) != 0) {
+      GERROR("Failed to send XML parameters to compute node\n");
+      con->discard();
+      delete con;
+      return 0;
+    }
+
+    return con;
+  }
+
+  DistributionConnector* DistributeGadget::pooled_connector(const GadgetronNodeInfo& node)
+  {
+    std::stringstream key;
+    key << node.address << ":" << node.port;
+
+    size_t max_jobs = std::max(max_pipelined_jobs.value(), 1);
+
+    DistributionConnector* con = 0;
+    mtx_.acquire();
+    auto range = pool_.equal_range(key.str());
+    for (auto it = range.first; it != range.second; it++) {
+      if (it->second->job_open() || it->second->jobs_in_flight() >= max_jobs) continue;
+      if (!con || it->second->jobs_in_flight() < con->jobs_in_flight()) con = it->second;
+    }
+    mtx_.release();
+
+    if (con) {
+      GDEBUG("Reusing connection to %s, %d jobs in flight\n", key.str().c_str(), con->jobs_in_flight());
+      return con;
+    }
+
+    con = open_connector(node);
+    if (!con) {
+      return 0;
+    }
+
+    mtx_.acquire();
+    pool_.insert(std::make_pair(key.str(), con));
+    mtx_.release();
+    GDEBUG("Opened connection to %s, %d connections in pool\n", key.str().c_str(), pool_.size());
+
+    return con;
+  }
+
+  int DistributeGadget::process_pooled(int node_index, ACE_Message_Block* m)
+  {
+    if (ended_jobs_.count(node_index)) {
+      m->release();
+      GERROR("The valid connection for incoming data has already been closed. Distribute Gadget is not configured properly for this type of data\n");
+      return GADGET_FAIL;
+    }
+
+    if (speculative_redispatch.value()) {
+      redispatch_stragglers();
+    }
+
+    auto j = jobs_.find(node_index);
+    DistributionConnector* con = 0;
+    if (j != jobs_.end()) {
+      con = j->second;
+    } else {
+      //The previous job gets no more data, ending it first lets its connection carry this one
+      if (nodes_used_sequentially.value() && !single_package_mode.value() && prev_node_index_ >= 0) {
+        if (end_job(prev_node_index_) != GADGET_OK) {
+          m->release();
+          return GADGET_FAIL;
+        }
+      }
+
+      GadgetronNodeInfo me = choose_node(node_index);
+
+      con = pooled_connector(me);
+      if (!con) {
+        m->release();
+        return GADGET_FAIL;
+      }
+
+      ACE_UINT32 job_id = next_job_id_++;
+      con->start_job(job_id);
+      GDEBUG("Job %d for node index %d sent to %s:%d\n", job_id, node_index, me.address.c_str(), me.port);
+
+      if (speculative_redispatch.value()) {
+        std::stringstream key;
+        key << me.address << ":" << me.port;
+
+        dispatch_mtx_.acquire();
+        dispatched_[job_id].node = key.str();
+        dispatch_mtx_.release();
+      }
+
+      mtx_.acquire();
+      jobs_[node_index] = con;
+      mtx_.release();
+    }
+
+    prev_node_index_ = node_index;
+
+    //Keep a reference to the package while the job may have to be sent again
+    if (speculative_redispatch.value()) {
+      dispatch_mtx_.acquire();
+      auto d = dispatched_.find(con->open_job());
+      if (d != dispatched_.end()) {
+        d->second.data.push_back(m->duplicate());
+      }
+      dispatch_mtx_.release();
+    }
+
+    auto m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
+    m1->getObjectPtr()->id = message_id(m);
+
+    m1->cont(m);
+
+    if (con->putq(m1) == -1) {
+      GERROR("Unable to put package on connector queue\n");
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    if (single_package_mode.value()) {
+      return end_job(node_index);
+    }
+
+    return GADGET_OK;
+  }
+
+  int DistributeGadget::end_job(int node_index)
+  {
+    mtx_.acquire();
+    auto j = jobs_.find(node_index);
+    if (j == jobs_.end()) {
+      mtx_.release();
+      return GADGET_OK;
+    }
+    DistributionConnector* con = j->second;
+    jobs_.erase(j);
+    ended_jobs_.insert(node_index);
+    mtx_.release();
+
+    ACE_UINT32 job_id = con->open_job();
+    if (con->end_job() != 0) {
+      GERROR("Unable to end job of node index %d\n", node_index);
+      return GADGET_FAIL;
+    }
+
+    //The duration of a job is counted from its last package
+    dispatch_mtx_.acquire();
+    auto d = dispatched_.find(job_id);
+    if (d != dispatched_.end()) {
+      d->second.sent = std::chrono::steady_clock::now();
+      d->second.sent_all = true;
+    }
+    dispatch_mtx_.release();
+
+    return GADGET_OK;
+  }
+
+  bool DistributeGadget::claim_job(ACE_UINT32 job_id, DistributionConnector* con)
+  {
+    dispatch_mtx_.acquire();
+    bool used = claim_job_locked(job_id, con);
+    dispatch_mtx_.release();
+    return used;
+  }
+
+  // Called with dispatch_mtx_ held
+  bool DistributeGadget::claim_job_locked(ACE_UINT32 job_id, DistributionConnector* con)
+  {
+    //Every copy still running once the job is finished is a dropped one
+    if (dropped_.count(job_id)) {
+      return false;
+    }
+
+    auto w = winners_.find(job_id);
+    if (w != winners_.end()) {
+      return (w->second == con);
+    }
+
+    if (dispatched_.count(job_id)) {
+      winners_[job_id] = con;
+    }
+    return true;
+  }
+
+  bool DistributeGadget::finish_job(ACE_UINT32 job_id, DistributionConnector* con)
+  {
+    dispatch_mtx_.acquire();
+    auto d = dispatched_.find(job_id);
+
+    if (!claim_job_locked(job_id, con)) {
+      //The job is forgotten once all its copies have ended
+      if (d != dispatched_.end()) {
+        d->second.copies--;
+      } else {
+        auto r = dropped_.find(job_id);
+        if (r != dropped_.end() && --r->second <= 0) {
+          dropped_.erase(r);
+        }
+      }
+      dispatch_mtx_.release();
+
+      GDEBUG("Job %d finished by a dropped copy\n", job_id);
+      return false;
+    }
+
+    if (d != dispatched_.end()) {
+      if (d->second.sent_all) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - d->second.sent).count();
+        mean_job_seconds_ = (mean_job_seconds_*finished_jobs_ + seconds)/(finished_jobs_+1);
+        finished_jobs_++;
+        GDEBUG("Job %d finished in %f s, mean %f s\n", job_id, seconds, mean_job_seconds_);
+      }
+
+      for (size_t i = 0; i < d->second.data.size(); i++) {
+        d->second.data[i]->release();
+      }
+
+      if (d->second.copies > 1) {
+        dropped_[job_id] = d->second.copies - 1;
+      }
+      dispatched_.erase(d);
+    }
+    winners_.erase(job_id);
+    dispatch_mtx_.release();
+
+    return true;
+  }
+
+  size_t DistributeGadget::unfinished_jobs()
+  {
+    dispatch_mtx_.acquire();
+    size_t n = dispatched_.size();
+    dispatch_mtx_.release();
+    return n;
+  }
+
+  void DistributeGadget::redispatch_stragglers()
+  {
+    std::vector<ACE_UINT32> stragglers;
+
+    dispatch_mtx_.acquire();
+    if (finished_jobs_ >= (size_t)std::max(straggler_min_jobs.value(), 1)) {
+      double limit = straggler_factor.value()*mean_job_seconds_;
+      auto now = std::chrono::steady_clock::now();
+
+      for (auto d = dispatched_.begin(); d != dispatched_.end(); d++) {
+        //A copy that has started to return results is not replaced
+        if (!d->second.sent_all || d->second.redispatched || winners_.count(d->first)) continue;
+
+        double seconds = std::chrono::duration<double>(now - d->second.sent).count();
+        if (seconds > limit) stragglers.push_back(d->first);
+      }
+    }
+    dispatch_mtx_.release();
+
+    for (size_t s = 0; s < stragglers.size(); s++) {
+      ACE_UINT32 job_id = stragglers[s];
+
+      dispatch_mtx_.acquire();
+      auto d = dispatched_.find(job_id);
+      if (d == dispatched_.end()) {
+        dispatch_mtx_.release();
+        continue;
+      }
+      std::string node = d->second.node;
+      std::vector<ACE_Message_Block*> data;
+      for (size_t i = 0; i < d->second.data.size(); i++) {
+        data.push_back(d->second.data[i]->duplicate());
+      }
+      d->second.redispatched = true;
+      dispatch_mtx_.release();
+
+      //The least loaded node other than the one running the job
+      std::vector<GadgetronNodeInfo> nl;
+      CloudBus::instance()->get_node_info(nl);
+
+      std::vector<GadgetronNodeInfo> others;
+      for (auto it = nl.begin(); it != nl.end(); it++) {
+        std::stringstream key;
+        key << it->address << ":" << it->port;
+        if (key.str() != node) others.push_back(*it);
+      }
+
+      DistributionConnector* con = 0;
+      if (!others.empty()) {
+        GadgetronNodeInfo me = others[0];
+        select_node(others, me);
+
+        std::stringstream key;
+        key << me.address << ":" << me.port;
+        if (key.str() != node) {
+          GWARN("Job %d has run %f times the mean job duration on %s, sending it again to %s\n",
+            job_id, straggler_factor.value(), node.c_str(), key.str().c_str());
+          con = pooled_connector(me);
+        }
+      }
+
+      //The job may have finished meanwhile, otherwise the copy is counted before it can report its end
+      bool running = false;
+      if (con) {
+        dispatch_mtx_.acquire();
+        auto r = dispatched_.find(job_id);
+        if (r != dispatched_.end() && !winners_.count(job_id)) {
+          r->second.copies++;
+          running = true;
+        }
+        dispatch_mtx_.release();
+      }
+
+      if (!running) {
+        if (!con) {
+          GWARN("Job %d is a straggler, but no other node can take it\n", job_id);
+        }
+        for (size_t i = 0; i < data.size(); i++) {
+          data[i]->release();
+        }
+        continue;
+      }
+
+      con->start_job(job_id);
+      for (size_t i = 0; i < data.size(); i++) {
+        auto m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
+        m1->getObjectPtr()->id = message_id(data[i]);
+        m1->cont(data[i]);
+
+        if (con->putq(m1) == -1) {
+          GERROR("Unable to put package of job %d on connector queue\n", job_id);
+          m1->release();
+          for (size_t k = i+1; k < data.size(); k++) {
+            data[k]->release();
+          }
+          break;
+        }
+      }
+
+      if (con->end_job() != 0) {
+        GERROR("Unable to end copy of job %d\n", job_id);
+      }
+    }
+  }
+
   int DistributeGadget::process_config(ACE_Message_Block* m)
   {
 
@@ -274,13 +781,24 @@ namespace Gadgetron{
     //Delete Gadgets up to this Gadget
     std::vector<GadgetronXML::Gadget>::iterator it = cfg.gadget.begin();
     while ((it->name != std::string(this->module()->name())) && (it != cfg.gadget.end())) it++; it++;
+    size_t first = it - cfg.gadget.begin();
     cfg.gadget.erase(cfg.gadget.begin(),it);
 
     //Delete Gadgets after collector
     it = cfg.gadget.begin();
     while ((it->name != collector.value()) && (it != cfg.gadget.end())) it++; it++;
+    size_t last = it - cfg.gadget.begin();
     cfg.gadget.erase(it,cfg.gadget.end());
 
+    //Keep only the branches between the remaining Gadgets
+    std::vector<GadgetronXML::Branch> branches;
+    for (std::vector<GadgetronXML::Branch>::iterator b = cfg.branch.begin(); b != cfg.branch.end(); b++) {
+      if (b->position < first || b->position - first >= last) continue;
+      branches.push_back(*b);
+      branches.back().position -= first;
+    }
+    cfg.branch = branches;
+
     std::stringstream o;
     GadgetronXML::serialize(cfg,o);
 
@@ -301,6 +819,10 @@ namespace Gadgetron{
       collect_gadget_->set_parameter("pass_through_mode","true");
     }
 
+    if (speculative_redispatch.value() && !reuse_connections.value()) {
+      GWARN("speculative_redispatch requires reuse_connections, stragglers will not be sent again\n");
+    }
+
     // get current node ip addresses
     ACE_INET_Addr* the_addr_array = NULL;
     size_t num_of_ip = 0;
@@ -327,6 +849,44 @@ namespace Gadgetron{
   int DistributeGadget::close(unsigned long flags)
   {
     int ret = Gadget::close(flags);
+    if (flags && speculative_redispatch.value() && reuse_connections.value()) {
+      //The open jobs are complete, stragglers are sent again until every job has a finished copy
+      std::vector<int> open;
+      for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+        open.push_back(j->first);
+      }
+      for (size_t i = 0; i < open.size(); i++) {
+        end_job(open[i]);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      while (unfinished_jobs()) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (close_timeout_s.value() > 0 && seconds > close_timeout_s.value()) {
+          dispatch_mtx_.acquire();
+          for (auto d = dispatched_.begin(); d != dispatched_.end(); d++) {
+            GERROR("Job %d sent to %s did not finish within %d s, its results are missing\n",
+              d->first, d->second.node.c_str(), close_timeout_s.value());
+          }
+          dispatch_mtx_.release();
+          ret = GADGET_FAIL;
+          break;
+        }
+
+        redispatch_stragglers();
+        ACE_OS::sleep(ACE_Time_Value(0, 50000));
+      }
+
+      //Connections still busy only run copies whose results are dropped, or jobs that timed out
+      mtx_.acquire();
+      for (auto p = pool_.begin(); p != pool_.end(); p++) {
+        if (p->second->jobs_in_flight()) {
+          p->second->abort();
+        }
+      }
+      mtx_.release();
+    }
+
     if (flags) {
       mtx_.acquire();
 
@@ -352,6 +912,31 @@ namespace Gadgetron{
         it = node_map_.begin();
       }
 
+
+      //Jobs still open get no more data, then the pooled connections are closed like the others
+      for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+        if (j->second->end_job() != 0) {
+          GERROR("Unable to end job of node index %d\n", j->first);
+        }
+      }
+      jobs_.clear();
+
+      for (auto p = pool_.begin(); p != pool_.end(); p++) {
+        auto m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
+        m1->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+
+        if (p->second->putq(m1) == -1) {
+          GERROR("Unable to put CLOSE package on queue\n");
+          return -1;
+        }
+      }
+
+      for (auto p = pool_.begin(); p != pool_.end(); p++) {
+        p->second->wait();
+        delete p->second;
+      }
+      pool_.clear();
+
       mtx_.release();
       GDEBUG("All connectors closed. Waiting for Gadget to close\n");
     }
@@ -363,5 +948,93 @@ namespace Gadgetron{
     return 0;
   }
 
+  double DistributeGadget::node_load(const GadgetronNodeInfo& n)
+  {
+    double load = n.active_reconstructions + n.cpu_load/100.0;
+    if (pending_mb_per_reconstruction.value() > 0) {
+      load += n.pending_bytes/(pending_mb_per_reconstruction.value()*1048576.0);
+    }
+    return load/std::max<uint32_t>(n.compute_capability, 1);
+  }
+
+  void DistributeGadget::select_node(std::vector<GadgetronNodeInfo>& nl, GadgetronNodeInfo& me)
+  {
+    std::string strategy = placement_strategy.value();
+
+    if (strategy == "least_active") {
+      //This would give the current node the lowest possible priority
+      if (!use_this_node_for_compute.value()) {
+        me.active_reconstructions = UINT32_MAX;
+      }
+
+      for (auto it = nl.begin(); it != nl.end(); it++) {
+        if (it->active_reconstructions < me.active_reconstructions) {
+          me = *it;
+        }
+
+        //Is this a free node
+        if (me.active_reconstructions == 0) break;
+      }
+      return;
+    }
+
+    std::string uuid = CloudBus::instance()->uuid();
+
+    std::vector<GadgetronNodeInfo*> candidates;
+    for (auto it = nl.begin(); it != nl.end(); it++) {
+      if (!use_this_node_for_compute.value() && it->uuid == uuid) continue;
+      candidates.push_back(&(*it));
+    }
+
+    if (candidates.empty()) {
+      GDEBUG("No other node on the cloud bus, keeping the job on this node\n");
+      return;
+    }
+
+    //Avoid nodes close to running out of memory while others have room
+    if (min_free_memory_mb.value() > 0) {
+      uint64_t min_free = static_cast<uint64_t>(min_free_memory_mb.value()) << 20;
+      std::vector<GadgetronNodeInfo*> roomy;
+      for (auto it = candidates.begin(); it != candidates.end(); it++) {
+        if ((*it)->free_memory == 0 || (*it)->free_memory >= min_free) roomy.push_back(*it);
+      }
+
+      if (roomy.empty()) {
+        GWARN("All nodes are below %d MB of available memory\n", min_free_memory_mb.value());
+      } else {
+        candidates.swap(roomy);
+      }
+    }
+
+    GadgetronNodeInfo* best = candidates[0];
+    for (auto it = candidates.begin(); it != candidates.end(); it++) {
+      if (node_load(**it) < node_load(*best)) best = *it;
+    }
+
+    if (strategy == "power_of_two_choices" && candidates.size() > 2) {
+      std::uniform_int_distribution<size_t> pick(0, candidates.size()-1);
+      size_t a = pick(rng_);
+      size_t b = pick(rng_);
+      while (b == a) b = pick(rng_);
+      best = (node_load(*candidates[a]) <= node_load(*candidates[b])) ? candidates[a] : candidates[b];
+    }
+
+    if (strategy == "locality") {
+      GadgetronNodeInfo* local = 0;
+      for (auto it = candidates.begin(); it != candidates.end(); it++) {
+        bool is_local = ((*it)->uuid == uuid);
+        for (size_t ii = 0; ii < local_address_.size(); ii++) {
+          if ((*it)->address == local_address_[ii]) is_local = true;
+        }
+
+        if (is_local && (!local || node_load(**it) < node_load(*local))) local = *it;
+      }
+
+      if (local && node_load(*local) <= node_load(*best) + 1.0) best = local;
+    }
+
+    me = *best;
+  }
+
   GADGET_FACTORY_DECLARE(DistributeGadget)
 }
@@ -4,8 +4,14 @@
 #include "Gadget.h"
 #include "gadgetron_distributed_gadgets_export.h"
 #include "GadgetronConnector.h"
+#include "cloudbus_io.h"
 
+#include <chrono>
 #include <complex>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
 
 namespace Gadgetron{
 
@@ -17,9 +23,53 @@ namespace Gadgetron{
   public:
     DistributionConnector(DistributeGadget* g);
     virtual int process(size_t messageid, ACE_Message_Block* mb);
+    virtual int job_done(ACE_UINT32 job_id);
+    virtual int svc(void);
+
+    /**
+    Starts a job, the data sent until end_job() belongs to it and its results are tagged with the job ID.
+    Job IDs are assigned from 1 in the order the node indexes are first seen.
+    */
+    void start_job(ACE_UINT32 job_id);
+
+    /**
+    Queues the end of the open job, the node flushes its chain and is then ready for the next job
+    */
+    int end_job();
+
+    bool job_open();
+
+    /**
+    Jobs on this connection whose results have not all been returned, including the open one
+    */
+    size_t jobs_in_flight();
+
+    /**
+    ID of the open job, 0 if there is none
+    */
+    ACE_UINT32 open_job();
+
+    /**
+    Shuts the connection down without waiting for the node, for connections only carrying
+    copies of jobs whose results are taken from another node
+    */
+    void abort();
+
+    /**
+    Closes a connection that never carried a job and waits for its threads, so it can be deleted
+    */
+    void discard();
 
   protected:
+    /**
+    Tells the collector that all results of a job have been returned
+    */
+    int collector_job_done(ACE_UINT32 job_id);
+
     DistributeGadget* distribute_gadget_;
+    std::deque<ACE_UINT32> jobs_; //Oldest first, the node processes the jobs of a connection in order
+    bool job_open_;
+    ACE_Thread_Mutex jobs_mtx_;
   };
 
   class EXPORTDISTRIBUTEDGADGETS DistributeGadget : public BasicPropertyGadget
@@ -29,6 +79,17 @@ namespace Gadgetron{
     DistributeGadget();
     virtual int collector_putq(ACE_Message_Block* m);
 
+    /**
+    Whether the results of a job coming from a connection are used. With speculative_redispatch a
+    job may run on two nodes, the first copy to return a result is used and the other is dropped.
+    */
+    bool claim_job(ACE_UINT32 job_id, DistributionConnector* con);
+
+    /**
+    Records that a connection has returned all results of a job. Returns false for a dropped copy.
+    */
+    bool finish_job(ACE_UINT32 job_id, DistributionConnector* con);
+
   protected:
     GADGET_PROPERTY(collector, std::string,
       "Name of collection Gadget", "Collect");
@@ -38,6 +99,25 @@ namespace Gadgetron{
       "Indicates that data is distributed to one node at a time. When new node becomes active, previous receives close message.", true);
     GADGET_PROPERTY(use_this_node_for_compute, bool,
       "This node can also be used for computation", true);
+    GADGET_PROPERTY_LIMITS(placement_strategy, std::string,
+      "How the node of a new job is chosen", "least_active",
+      GadgetPropertyLimitsEnumeration, "least_active", "least_loaded", "power_of_two_choices", "locality");
+    GADGET_PROPERTY(min_free_memory_mb, int,
+      "Nodes with less available memory are only used when no other node is, 0 to disable", 0);
+    GADGET_PROPERTY(pending_mb_per_reconstruction, int,
+      "Data queued on a node, in MB, that adds as much load as one running reconstruction", 1024);
+    GADGET_PROPERTY(reuse_connections, bool,
+      "Keep the connections to the nodes open and send several jobs over each, the nodes must support job messages", false);
+    GADGET_PROPERTY(max_pipelined_jobs, int,
+      "Jobs a reused connection carries before the results of the oldest have returned", 2);
+    GADGET_PROPERTY(speculative_redispatch, bool,
+      "Send jobs running much longer than the others again to another node, requires reuse_connections", false);
+    GADGET_PROPERTY(straggler_factor, float,
+      "A job is sent again when it has run this many times the mean duration of the finished jobs", 3.0);
+    GADGET_PROPERTY(straggler_min_jobs, int,
+      "Finished jobs needed before stragglers are sent again", 3);
+    GADGET_PROPERTY(close_timeout_s, int,
+      "Seconds the close waits for unfinished jobs before the connections still running them are aborted, 0 for no limit", 600);
 
     virtual int process(ACE_Message_Block* m);
     virtual int process_config(ACE_Message_Block* m);
@@ -51,6 +131,72 @@ namespace Gadgetron{
     */
     virtual int node_index(ACE_Message_Block* m);
 
+    /**
+    Chooses the node of a new job from the nodes on the cloud bus.
+
+    me holds this node on entry and the chosen node on return. The placement
+    strategies are:
+
+    least_active: fewest active reconstructions.
+    least_loaded: lowest load per compute capability, where the load counts the
+      active reconstructions, the CPU utilisation (a busy node counts one more)
+      and the queued data.
+    power_of_two_choices: the less loaded of two random nodes, which spreads
+      bursts of jobs without every job picking the same node from stale reports.
+    locality: the least loaded node on this host, unless it carries more than one
+      reconstruction's worth of load above the least loaded node.
+    */
+    virtual void select_node(std::vector<GadgetronNodeInfo>& nl, GadgetronNodeInfo& me);
+
+    /**
+    Load of a node per unit of compute capability
+    */
+    double node_load(const GadgetronNodeInfo& n);
+
+    /**
+    Node chosen for the job of a new node index
+    */
+    GadgetronNodeInfo choose_node(int node_index);
+
+    /**
+    Opens a connection to a node and sends it the configuration and parameters. Returns 0 on failure.
+    */
+    DistributionConnector* open_connector(const GadgetronNodeInfo& node);
+
+    /**
+    Dispatches a package when connections are reused. A pooled connection to the chosen node is
+    taken if it has no open job and fewer than max_pipelined_jobs jobs in flight, otherwise a new
+    one is added to the pool.
+    */
+    virtual int process_pooled(int node_index, ACE_Message_Block* m);
+
+    /**
+    Pooled connection to a node that can take a new job, a new one is opened if none can
+    */
+    DistributionConnector* pooled_connector(const GadgetronNodeInfo& node);
+
+    /**
+    Ends the job of a node index, it must not receive more data
+    */
+    int end_job(int node_index);
+
+    /**
+    Sends jobs whose data was sent but which have run straggler_factor times the mean duration
+    of the finished jobs, without returning a result, again to the least loaded other node.
+    Each job is sent again at most once.
+    */
+    void redispatch_stragglers();
+
+    /**
+    claim_job with dispatch_mtx_ held
+    */
+    bool claim_job_locked(ACE_UINT32 job_id, DistributionConnector* con);
+
+    /**
+    Jobs not yet finished by any of their copies
+    */
+    size_t unfinished_jobs();
+
     /**
     Returns the message ID associated with this message
     */
@@ -72,7 +218,31 @@ namespace Gadgetron{
     std::map<int,GadgetronConnector*> node_map_;
     std::vector<GadgetronConnector*> closed_connectors_;
     GadgetronConnector* prev_connector_; //Keeps track of previously used connector
+    std::multimap<std::string, DistributionConnector*> pool_; //Reused connections by node address:port
+    std::map<int, DistributionConnector*> jobs_; //Open jobs by node index
+    std::set<int> ended_jobs_;
+    ACE_UINT32 next_job_id_;
+    int prev_node_index_;
+
+    struct DispatchedJob
+    {
+      DispatchedJob() : sent_all(false), redispatched(false), copies(1) {}
+      std::vector<ACE_Message_Block*> data; //References to the packages of the job, to send it again
+      std::chrono::steady_clock::time_point sent; //When the last package was sent
+      bool sent_all;
+      bool redispatched;
+      int copies; //Copies sent that have not reported their end
+      std::string node; //address:port of the first copy
+    };
+
+    std::map<ACE_UINT32, DispatchedJob> dispatched_; //Unfinished jobs tracked for speculative_redispatch
+    std::map<ACE_UINT32, DistributionConnector*> winners_; //Connection whose results are used, by unfinished job
+    std::map<ACE_UINT32, int> dropped_; //Copies of finished jobs still running, their results are dropped
+    double mean_job_seconds_;
+    size_t finished_jobs_;
+    ACE_Thread_Mutex dispatch_mtx_;
     std::vector<std::string> local_address_;
+    std::mt19937 rng_;
 
   };
 }
@@ -0,0 +1,24 @@
+#include "StragglerGadget.h"
+#include "CloudBus.h"
+#include <ace/OS_NS_unistd.h>
+
+namespace Gadgetron{
+
+  int StragglerGadget::process(ACE_Message_Block* m)
+  {
+    if (straggler_port.value() > 0 && delay_ms.value() > 0
+        && CloudBus::instance()->port() == (unsigned int)straggler_port.value()) {
+      ACE_OS::sleep(ACE_Time_Value(0, delay_ms.value()*1000));
+    }
+
+    if (this->next()->putq(m) == -1) {
+      m->release();
+      GERROR("StragglerGadget::process, passing data on to next gadget\n");
+      return GADGET_FAIL;
+    }
+
+    return GADGET_OK;
+  }
+
+  GADGET_FACTORY_DECLARE(StragglerGadget)
+}
@@ -0,0 +1,28 @@
+#ifndef STRAGGLERGADGET_H
+#define STRAGGLERGADGET_H
+
+#include "Gadget.h"
+#include "gadgetron_distributed_gadgets_export.h"
+
+namespace Gadgetron{
+
+  /**
+  Test gadget turning one node into a straggler. Placed before the CollectGadget of a distributed
+  configuration, it delays every result on the node listening on straggler_port and passes results
+  on unchanged elsewhere. Used by the integration case for speculative_redispatch, not for scanning.
+  */
+  class EXPORTDISTRIBUTEDGADGETS StragglerGadget : public BasicPropertyGadget
+  {
+  public:
+    GADGET_DECLARE(StragglerGadget);
+
+  protected:
+    GADGET_PROPERTY(straggler_port, int,
+      "Gadgetron port of the node whose results are delayed, 0 for none", 0);
+    GADGET_PROPERTY(delay_ms, int,
+      "Delay of each result on that node", 1000);
+
+    virtual int process(ACE_Message_Block* m);
+  };
+}
+#endif //STRAGGLERGADGET_H
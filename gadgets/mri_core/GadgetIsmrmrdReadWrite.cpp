@@ -1,6 +1,264 @@
 #include "GadgetIsmrmrdReadWrite.h"
 
+#include <ace/Guard_T.h>
+#include <boost/align/aligned_alloc.hpp>
+#include <algorithm>
+
 namespace Gadgetron{
+
+    static const size_t GADGET_SLAB_ALIGNMENT = 64;
+
+    // ----------------------------------------------------------------------------------------
+
+    GadgetIsmrmrdSlabPool::GadgetIsmrmrdSlabPool(size_t slab_size, size_t max_free_slabs)
+        : state_(new State)
+    {
+        state_->slab_size_ = slab_size;
+        state_->max_free_slabs_ = max_free_slabs;
+    }
+
+    size_t GadgetIsmrmrdSlabPool::slab_size() const
+    {
+        return state_->slab_size_;
+    }
+
+    boost::shared_ptr<char> GadgetIsmrmrdSlabPool::get(size_t size)
+    {
+        char* slab = NULL;
+        size_t slab_bytes = std::max(size, state_->slab_size_);
+
+        if (slab_bytes == state_->slab_size_)
+        {
+            ACE_Guard<ACE_Thread_Mutex> guard(state_->mutex_);
+            if (!state_->free_.empty())
+            {
+                slab = state_->free_.back();
+                state_->free_.pop_back();
+            }
+        }
+
+        if (!slab)
+        {
+            slab = static_cast<char*>(boost::alignment::aligned_alloc(GADGET_SLAB_ALIGNMENT, slab_bytes));
+            if (!slab) throw std::bad_alloc();
+        }
+
+        Recycler recycler;
+        recycler.state_ = state_;
+        recycler.size_ = slab_bytes;
+        return boost::shared_ptr<char>(slab, recycler);
+    }
+
+    void GadgetIsmrmrdSlabPool::Recycler::operator()(char* slab)
+    {
+        if (size_ == state_->slab_size_)
+        {
+            ACE_Guard<ACE_Thread_Mutex> guard(state_->mutex_);
+            if (state_->free_.size() < state_->max_free_slabs_)
+            {
+                state_->free_.push_back(slab);
+                return;
+            }
+        }
+
+        boost::alignment::aligned_free(slab);
+    }
+
+    GadgetIsmrmrdSlabPool::State::~State()
+    {
+        for (size_t n = 0; n < free_.size(); n++)
+        {
+            boost::alignment::aligned_free(free_[n]);
+        }
+        free_.clear();
+    }
+
+    // ----------------------------------------------------------------------------------------
+
+    GadgetIsmrmrdAcquisitionBufferedMessageReader::GadgetIsmrmrdAcquisitionBufferedMessageReader(size_t peek_size, size_t slab_size, size_t max_free_slabs)
+        : peek_buffer_(peek_size)
+        , pool_(slab_size, max_free_slabs)
+        , slab_capacity_(0)
+        , slab_offset_(0)
+    {
+    }
+
+    GadgetIsmrmrdAcquisitionBufferedMessageReader::~GadgetIsmrmrdAcquisitionBufferedMessageReader()
+    {
+        while (!pending_.empty())
+        {
+            pending_.front()->release();
+            pending_.pop_front();
+        }
+    }
+
+    size_t GadgetIsmrmrdAcquisitionBufferedMessageReader::parse(size_t len, std::vector<Layout>& layout)
+    {
+        // every acquisition takes up to four io vectors: identifier, header, trajectory and data
+        const size_t max_batch = ACE_IOV_MAX / 4;
+
+        layout.clear();
+
+        size_t offset = 0;
+        while (layout.size() < max_batch)
+        {
+            size_t pos = offset;
+
+            // the identifier of the first acquisition has already been consumed by the caller
+            if (!layout.empty())
+            {
+                if (pos + sizeof(GadgetMessageIdentifier) > len) break;
+
+                GadgetMessageIdentifier id;
+                memcpy(&id, &peek_buffer_[pos], sizeof(GadgetMessageIdentifier));
+                if (id.id != GADGET_MESSAGE_ISMRMRD_ACQUISITION) break;
+
+                pos += sizeof(GadgetMessageIdentifier);
+            }
+
+            if (pos + sizeof(ISMRMRD::AcquisitionHeader) > len) break;
+
+            Layout l;
+            memcpy(&l.head, &peek_buffer_[pos], sizeof(ISMRMRD::AcquisitionHeader));
+            pos += sizeof(ISMRMRD::AcquisitionHeader);
+
+            if (l.head.isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1) || l.head.isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2)) break;
+
+            l.trajectory_bytes = sizeof(float)*l.head.trajectory_dimensions*l.head.number_of_samples;
+            l.data_bytes = sizeof(std::complex<float>)*l.head.number_of_samples*l.head.active_channels;
+            pos += l.trajectory_bytes + l.data_bytes;
+
+            // the payload of the first acquisition does not need to be in the peek buffer, it is received blocking
+            if (!layout.empty() && pos > len) break;
+
+            layout.push_back(l);
+            offset = pos;
+        }
+
+        return layout.size();
+    }
+
+    char* GadgetIsmrmrdAcquisitionBufferedMessageReader::reserve(size_t bytes)
+    {
+        size_t aligned_bytes = (bytes + GADGET_SLAB_ALIGNMENT - 1) & ~(GADGET_SLAB_ALIGNMENT - 1);
+
+        if (!slab_ || slab_offset_ + aligned_bytes > slab_capacity_)
+        {
+            slab_capacity_ = std::max(aligned_bytes, pool_.slab_size());
+            slab_ = pool_.get(slab_capacity_);
+            slab_offset_ = 0;
+        }
+
+        char* ptr = slab_.get() + slab_offset_;
+        slab_offset_ += aligned_bytes;
+        return ptr;
+    }
+
+    ACE_Message_Block* GadgetIsmrmrdAcquisitionBufferedMessageReader::read(ACE_SOCK_Stream* stream)
+    {
+        ssize_t peek_count = stream->recv(&peek_buffer_[0], peek_buffer_.size(), MSG_PEEK);
+        if (peek_count < 0) {
+            GERROR("GadgetIsmrmrdAcquisitionBufferedMessageReader, failed to peek socket\n");
+            return 0;
+        }
+
+        std::vector<Layout> layout;
+        if (this->parse((size_t)peek_count, layout) == 0) {
+            // header not yet available or compressed data
+            return GadgetIsmrmrdAcquisitionMessageReader::read(stream);
+        }
+
+        size_t num = layout.size();
+        ids_.resize(num);
+
+        std::vector<iovec> iov;
+        iov.reserve(4*num);
+
+        std::vector< GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* > msgs(num, NULL);
+
+        try
+        {
+            for (size_t n = 0; n < num; n++)
+            {
+                const ISMRMRD::AcquisitionHeader& head = layout[n].head;
+
+                iovec v;
+                if (n > 0) {
+                    v.iov_base = reinterpret_cast<char*>(&ids_[n]);
+                    v.iov_len = sizeof(GadgetMessageIdentifier);
+                    iov.push_back(v);
+                }
+
+                GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1 = new GadgetContainerMessage<ISMRMRD::AcquisitionHeader>();
+                msgs[n] = m1;
+
+                v.iov_base = reinterpret_cast<char*>(m1->getObjectPtr());
+                v.iov_len = sizeof(ISMRMRD::AcquisitionHeader);
+                iov.push_back(v);
+
+                std::vector<size_t> adims(2);
+                adims[0] = head.number_of_samples;
+                adims[1] = head.active_channels;
+
+                char* data = this->reserve(layout[n].data_bytes);
+                GadgetSlabContainerMessage< hoNDArray< std::complex<float> > >* m2 =
+                    new GadgetSlabContainerMessage< hoNDArray< std::complex<float> > >(slab_, adims, reinterpret_cast<std::complex<float>*>(data), false);
+                m1->cont(m2);
+
+                if (head.trajectory_dimensions) {
+                    std::vector<size_t> tdims(2);
+                    tdims[0] = head.trajectory_dimensions;
+                    tdims[1] = head.number_of_samples;
+
+                    char* traj = this->reserve(layout[n].trajectory_bytes);
+                    GadgetSlabContainerMessage< hoNDArray<float> >* m3 =
+                        new GadgetSlabContainerMessage< hoNDArray<float> >(slab_, tdims, reinterpret_cast<float*>(traj), false);
+                    m2->cont(m3);
+
+                    if (layout[n].trajectory_bytes) {
+                        v.iov_base = traj;
+                        v.iov_len = layout[n].trajectory_bytes;
+                        iov.push_back(v);
+                    }
+                }
+
+                if (layout[n].data_bytes) {
+                    v.iov_base = data;
+                    v.iov_len = layout[n].data_bytes;
+                    iov.push_back(v);
+                }
+            }
+        }
+        catch (std::exception& err)
+        {
+            GEXCEPTION(err, "GadgetIsmrmrdAcquisitionBufferedMessageReader, failed to set up acquisitions\n");
+            for (size_t n = 0; n < num; n++) if (msgs[n]) msgs[n]->release();
+            return 0;
+        }
+
+        if (stream->recvv_n(&iov[0], (int)iov.size()) <= 0) {
+            GERROR("GadgetIsmrmrdAcquisitionBufferedMessageReader, unable to read %d acquisitions\n", num);
+            for (size_t n = 0; n < num; n++) msgs[n]->release();
+            return 0;
+        }
+
+        for (size_t n = 1; n < num; n++) {
+            pending_.push_back(msgs[n]);
+        }
+
+        return msgs[0];
+    }
+
+    ACE_Message_Block* GadgetIsmrmrdAcquisitionBufferedMessageReader::read_pending()
+    {
+        if (pending_.empty()) return 0;
+
+        ACE_Message_Block* mb = pending_.front();
+        pending_.pop_front();
+        return mb;
+    }
+
     GADGETRON_READER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionMessageReader)
+    GADGETRON_READER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionBufferedMessageReader)
     GADGETRON_WRITER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionMessageWriter)
 }
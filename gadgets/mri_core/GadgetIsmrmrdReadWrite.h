@@ -10,7 +10,11 @@
 #include <ismrmrd/ismrmrd.h>
 #include <ace/SOCK_Stream.h>
 #include <ace/Task.h>
+#include <ace/Thread_Mutex.h>
+#include <boost/shared_ptr.hpp>
 #include <complex>
+#include <deque>
+#include <vector>
 
 #include "NHLBICompression.h"
 
@@ -25,6 +29,23 @@ namespace Gadgetron{
 
     public:
         virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+        {
+	  GadgetMessageSendBuffer buffer;
+	  if (this->gather(buffer, mb) < 0) {
+	    return -1;
+	  }
+
+	  if (buffer.flush(sock) < 0) {
+	    GERROR("Unable to send acquisition\n");
+	    return -1;
+	  }
+
+	  return 0;
+        }
+
+        virtual bool supports_gather() { return true; }
+
+        virtual int gather(GadgetMessageSendBuffer& buffer, ACE_Message_Block* mb)
         {
 	  auto h = AsContainerMessage<ISMRMRD::AcquisitionHeader>(mb);
 
@@ -33,40 +54,36 @@ namespace Gadgetron{
 	    return -1;
 	  }
 
-	  ssize_t send_cnt = 0;
-	  
-	  GadgetMessageIdentifier id;
-	  id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION;
+	  ISMRMRD::AcquisitionHeader* acqHead = h->getObjectPtr();
+
+	  unsigned long trajectory_elements = acqHead->trajectory_dimensions*acqHead->number_of_samples;
+	  unsigned long data_elements = acqHead->active_channels*acqHead->number_of_samples;
+
+	  auto d = AsContainerMessage< hoNDArray<std::complex<float> > >(h->cont());
+	  auto t = AsContainerMessage< hoNDArray<float> >(d ? d->cont() : 0);
 
-	  if ((send_cnt = sock->send_n (&id, sizeof(GadgetMessageIdentifier))) <= 0) {
-	    GERROR("Unable to send acquisition message identifier\n");
+	  //Check the whole message before adding to the buffer, so nothing partial is sent
+	  if (trajectory_elements && !t) {
+	    GERROR("GadgetAcquisitionMessageWriter, missing acquisition trajectory\n");
 	    return -1;
 	  }
 
-	  ISMRMRD::AcquisitionHeader* acqHead = h->getObjectPtr();
-	  if ((send_cnt = sock->send_n (acqHead, sizeof(ISMRMRD::AcquisitionHeader))) <= 0) {
-	    GERROR("Unable to send acquisition header\n");
+	  if (data_elements && !d) {
+	    GERROR("GadgetAcquisitionMessageWriter, missing acquisition data\n");
 	    return -1;
 	  }
 
-	  unsigned long trajectory_elements = acqHead->trajectory_dimensions*acqHead->number_of_samples;
-	  unsigned long data_elements = acqHead->active_channels*acqHead->number_of_samples;
+	  GadgetMessageIdentifier id;
+	  id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION;
+	  buffer.add_copy(&id, sizeof(GadgetMessageIdentifier));
+	  buffer.add(acqHead, sizeof(ISMRMRD::AcquisitionHeader));
 
-	  auto d = AsContainerMessage< hoNDArray<std::complex<float> > >(h->cont());
-	  
 	  if (trajectory_elements) {
-	    auto t = AsContainerMessage< hoNDArray<float> >(h->cont());
-	    if ((send_cnt = sock->send_n (t->getObjectPtr()->get_data_ptr(), sizeof(float)*trajectory_elements)) <= 0) {
-	      GERROR("Unable to send acquisition trajectory elements\n");
-	      return -1;
-	    }
+	    buffer.add(t->getObjectPtr()->get_data_ptr(), sizeof(float)*trajectory_elements);
 	  }
 
 	  if (data_elements) {
-	    if ((send_cnt = sock->send_n (d->getObjectPtr()->get_data_ptr(), 2*sizeof(float)*data_elements)) <= 0) {
-	      GERROR("Unable to send acquisition data elements\n");
-	      return -1;
-	    }
+	    buffer.add(d->getObjectPtr()->get_data_ptr(), 2*sizeof(float)*data_elements);
 	  }
 	  
 	  return 0;
@@ -287,5 +304,130 @@ namespace Gadgetron{
         }
 
     };    
+
+    /**
+    Pool of fixed size memory slabs used by the buffered acquisition reader.
+
+    A slab handed out by get() is reference counted. When the last reference is dropped the slab goes back
+    to the pool, or is freed if the pool already holds max_free_slabs or the slab was oversized.
+    The pool state is shared with the outstanding slabs, so slabs may outlive the pool object itself.
+    */
+    class EXPORTGADGETSMRICORE GadgetIsmrmrdSlabPool
+    {
+    public:
+        GadgetIsmrmrdSlabPool(size_t slab_size, size_t max_free_slabs);
+
+        size_t slab_size() const;
+
+        /// get a slab of at least max(size, slab_size) bytes
+        boost::shared_ptr<char> get(size_t size);
+
+    protected:
+        struct State
+        {
+            ACE_Thread_Mutex mutex_;
+            std::vector<char*> free_;
+            size_t slab_size_;
+            size_t max_free_slabs_;
+
+            ~State();
+        };
+
+        struct Recycler
+        {
+            boost::shared_ptr<State> state_;
+            size_t size_;
+            void operator()(char* slab);
+        };
+
+        boost::shared_ptr<State> state_;
+    };
+
+    /**
+    Container message whose content views memory inside a pooled slab.
+    The message holds a reference on the slab, so the slab is not recycled while the content is still reachable,
+    including through duplicates of this message.
+    */
+    template <class T> class GadgetSlabContainerMessage : public GadgetContainerMessage<T>
+    {
+        typedef GadgetContainerMessage<T> base;
+
+    public:
+        template<typename... X> GadgetSlabContainerMessage(boost::shared_ptr<char> slab, X... xs)
+            : base(xs...), slab_(slab)
+        {
+        }
+
+        GadgetSlabContainerMessage(boost::shared_ptr<char> slab, ACE_Data_Block* d)
+            : base(d), slab_(slab)
+        {
+        }
+
+        virtual GadgetContainerMessage<T>* duplicate()
+        {
+            GadgetSlabContainerMessage<T>* nb = new GadgetSlabContainerMessage<T>(slab_, this->data_block()->duplicate());
+            nb->rd_ptr(this->rd_ptr_);
+            nb->wr_ptr(this->wr_ptr_);
+            if (this->cont_) {
+                nb->cont_ = this->cont_->duplicate();
+            }
+            return nb;
+        }
+
+    protected:
+        boost::shared_ptr<char> slab_;
+    };
+
+    /**
+    Buffered implementation of GadgetMessageReader for IsmrmrdAcquisition messages.
+
+    Each read peeks up to peek_size bytes off the socket, finds every complete, uncompressed acquisition queued
+    behind the current one and receives all of them with a single scatter read. Trajectory and sample data land
+    directly in 64 byte aligned regions of pooled slabs and the hoNDArrays handed downstream are views of these
+    regions, so no per-readout allocation of sample memory takes place. The first acquisition is returned by read(),
+    the others by read_pending().
+
+    Since the arrays do not own their memory, downstream gadgets must not resize them in place; gadgets holding on to
+    acquisitions keep the whole slab alive. Compressed acquisitions fall back to GadgetIsmrmrdAcquisitionMessageReader.
+
+    Select it by naming this class for slot 1008 in the stream configuration.
+    */
+    class EXPORTGADGETSMRICORE GadgetIsmrmrdAcquisitionBufferedMessageReader : public GadgetIsmrmrdAcquisitionMessageReader
+    {
+
+    public:
+        GADGETRON_READER_DECLARE(GadgetIsmrmrdAcquisitionBufferedMessageReader);
+
+        GadgetIsmrmrdAcquisitionBufferedMessageReader(size_t peek_size = 1 << 20, size_t slab_size = 1 << 23, size_t max_free_slabs = 16);
+        virtual ~GadgetIsmrmrdAcquisitionBufferedMessageReader();
+
+        virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream);
+        virtual ACE_Message_Block* read_pending();
+
+    protected:
+
+        struct Layout
+        {
+            ISMRMRD::AcquisitionHeader head;
+            size_t trajectory_bytes;
+            size_t data_bytes;
+        };
+
+        /// find the acquisitions completely contained in the first len bytes of the peek buffer
+        size_t parse(size_t len, std::vector<Layout>& layout);
+
+        /// reserve an aligned region of the current slab, starting a new slab if needed
+        char* reserve(size_t bytes);
+
+        std::vector<char> peek_buffer_;
+        std::vector<ACE_UINT16> ids_;
+
+        GadgetIsmrmrdSlabPool pool_;
+        boost::shared_ptr<char> slab_;
+        size_t slab_capacity_;
+        size_t slab_offset_;
+
+        std::deque<ACE_Message_Block*> pending_;
+    };
 }
 #endif //GADGETISMRMRDREADWRITE_H
@@ -3,6 +3,8 @@
 #include "mri_core_grappa.h"
 #include "hoNDArray_reductions.h"
 
+#include <algorithm>
+
 /*
     The input is IsmrmrdReconData and output is single 2D or 3D ISMRMRD images
 
@@ -44,6 +46,9 @@ namespace Gadgetron {
         GDEBUG_CONDITION_STREAM(verbose.value(), "Number of encoding spaces: " << NE);
 
         recon_obj_.resize(NE);
+        sub_recon_obj_.resize(NE);
+        sub_ref_N_.resize(NE, 1);
+        sub_ref_S_.resize(NE, 1);
 
         return GADGET_OK;
     }
@@ -87,6 +92,19 @@ namespace Gadgetron {
 
             // ---------------------------------------------------------------
 
+            // after this step, the reference is consumed and, if there is data, recon_obj_[e].recon_res_ and recon_obj_[e].gfactor_ are filled
+            bool parallel = parallel_sub_problems.value();
+            if (parallel)
+            {
+                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_parallel_recon"); }
+                this->perform_parallel_recon(recon_bit_->rbit_[e], recon_obj_[e], e);
+                if (perform_timing.value()) { gt_timer_.stop(); }
+
+                recon_bit_->rbit_[e].ref_ = boost::none;
+            }
+
+            // ---------------------------------------------------------------
+
             if (recon_bit_->rbit_[e].ref_)
             {
                 if (!debug_folder_full_path_.empty())
@@ -165,15 +183,18 @@ namespace Gadgetron {
 
                 // ---------------------------------------------------------------
 
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_unwrapping"); }
-                this->perform_unwrapping(recon_bit_->rbit_[e], recon_obj_[e], e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                if (!parallel)
+                {
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_unwrapping"); }
+                    this->perform_unwrapping(recon_bit_->rbit_[e], recon_obj_[e], e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
 
-                // ---------------------------------------------------------------
+                    // ---------------------------------------------------------------
 
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::compute_image_header"); }
-                this->compute_image_header(recon_bit_->rbit_[e], recon_obj_[e].recon_res_, e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::compute_image_header"); }
+                    this->compute_image_header(recon_bit_->rbit_[e], recon_obj_[e].recon_res_, e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+                }
 
                 // ---------------------------------------------------------------
 
@@ -359,12 +380,26 @@ namespace Gadgetron {
     }
 
     void GenericReconCartesianGrappaGadget::perform_calib(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t e)
+    {
+        hoNDArray< std::complex<float> >& data = recon_bit.data_.data_;
+
+        std::vector<size_t> recon_dims(3);
+        recon_dims[0] = data.get_size(0);
+        recon_dims[1] = data.get_size(1);
+        recon_dims[2] = data.get_size(2);
+
+        this->perform_calib(recon_dims, recon_obj, e);
+    }
+
+    void GenericReconCartesianGrappaGadget::perform_calib(const std::vector<size_t>& recon_dims, ReconObjType& recon_obj, size_t e)
     {
         try
         {
-            size_t RO = recon_bit.data_.data_.get_size(0);
-            size_t E1 = recon_bit.data_.data_.get_size(1);
-            size_t E2 = recon_bit.data_.data_.get_size(2);
+            GADGET_CHECK_THROW(recon_dims.size() >= 3);
+
+            size_t RO = recon_dims[0];
+            size_t E1 = recon_dims[1];
+            size_t E2 = recon_dims[2];
 
             hoNDArray< std::complex<float> >& src = recon_obj.ref_calib_;
             hoNDArray< std::complex<float> >& dst = recon_obj.ref_calib_dst_;
@@ -556,16 +591,21 @@ namespace Gadgetron {
                 gt_exporter_.export_array_complex(recon_bit.data_.data_, debug_folder_full_path_ + "data_src_" + suffix);
             }
 
+            // parallel sub-problems cannot share the buffers
+            hoNDArray< std::complex<float> > sub_problem_im_buf, sub_problem_data_buf;
+            hoNDArray< std::complex<float> >& complex_im = parallel_sub_problems.value() ? sub_problem_im_buf : complex_im_recon_buf_;
+            hoNDArray< std::complex<float> >& data_buf = parallel_sub_problems.value() ? sub_problem_data_buf : data_recon_buf_;
+
             // compute aliased images
-            data_recon_buf_.create(RO, E1, E2, dstCHA, N, S, SLC);
+            data_buf.create(RO, E1, E2, dstCHA, N, S, SLC);
 
             if (E2>1)
             {
-                Gadgetron::hoNDFFT<float>::instance()->ifft3c(recon_bit.data_.data_, complex_im_recon_buf_, data_recon_buf_);
+                Gadgetron::hoNDFFT<float>::instance()->ifft3c(recon_bit.data_.data_, complex_im, data_buf);
             }
             else
             {
-                Gadgetron::hoNDFFT<float>::instance()->ifft2c(recon_bit.data_.data_, complex_im_recon_buf_, data_recon_buf_);
+                Gadgetron::hoNDFFT<float>::instance()->ifft2c(recon_bit.data_.data_, complex_im, data_buf);
             }
 
             // SNR unit scaling
@@ -575,7 +615,7 @@ namespace Gadgetron {
             {
                 // since the grappa in gadgetron is doing signal preserving scaling, to perserve noise level, we need this compensation factor
                 double grappaKernelCompensationFactor = 1.0 / (acceFactorE1_[e] * acceFactorE2_[e]);
-                Gadgetron::scal((float)(grappaKernelCompensationFactor*snr_scaling_ratio), complex_im_recon_buf_);
+                Gadgetron::scal((float)(grappaKernelCompensationFactor*snr_scaling_ratio), complex_im);
 
                 if (this->verbose.value()) GDEBUG_STREAM("GenericReconCartesianGrappaGadget, grappaKernelCompensationFactor*snr_scaling_ratio : " << grappaKernelCompensationFactor*snr_scaling_ratio);
             }
@@ -585,7 +625,7 @@ namespace Gadgetron {
                 std::stringstream os;
                 os << "encoding_" << e;
                 std::string suffix = os.str();
-                gt_exporter_.export_array_complex(complex_im_recon_buf_, debug_folder_full_path_ + "aliasedIm_" + suffix);
+                gt_exporter_.export_array_complex(complex_im, debug_folder_full_path_ + "aliasedIm_" + suffix);
             }
 
             // unwrapping
@@ -594,7 +634,7 @@ namespace Gadgetron {
 
             long long ii;
 
-#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, E2, srcCHA, convkRO, convkE1, convkE2, ref_N, ref_S, recon_obj, dstCHA, unmixingCoeff_CHA, e) if(num>1)
+#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, E2, srcCHA, convkRO, convkE1, convkE2, ref_N, ref_S, recon_obj, dstCHA, unmixingCoeff_CHA, e, complex_im) if(num>1)
             {
 #pragma omp for 
                 for (ii = 0; ii < num; ii++)
@@ -604,7 +644,7 @@ namespace Gadgetron {
                     size_t n = ii - slc*N*S - s*N;
 
                     // combined channels
-                    T* pIm = &(complex_im_recon_buf_(0, 0, 0, 0, n, s, slc));
+                    T* pIm = &(complex_im(0, 0, 0, 0, n, s, slc));
 
                     size_t usedN = n;
                     if (n >= ref_N) usedN = ref_N - 1;
@@ -637,6 +677,139 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconCartesianGrappaGadget::perform_parallel_recon(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t e)
+    {
+        try
+        {
+            std::vector<ReconObjType>& sub_obj = sub_recon_obj_[e];
+
+            bool has_ref = (bool)recon_bit.ref_;
+            bool has_data = (recon_bit.data_.data_.get_number_of_elements() > 0);
+            if (!has_ref && !has_data) return;
+
+            if (has_ref)
+            {
+                sub_ref_N_[e] = recon_bit.ref_->data_.get_size(4);
+                sub_ref_S_[e] = recon_bit.ref_->data_.get_size(5);
+            }
+
+            size_t ref_N = sub_ref_N_[e];
+            size_t ref_S = sub_ref_S_[e];
+
+            std::vector<IsmrmrdReconBit> sub_bits;
+            this->split_recon_bit(recon_bit, ref_N, ref_S, sub_bits);
+
+            if (has_ref)
+            {
+                sub_obj.clear();
+                sub_obj.resize(sub_bits.size());
+            }
+            else if (sub_obj.size() != sub_bits.size())
+            {
+                GERROR_STREAM("Data do not match the calibrated sub-problems : " << sub_bits.size() << " instead of " << sub_obj.size());
+                GADGET_THROW("Uncalibrated sub-problems");
+            }
+
+            std::vector<size_t> recon_dims = *recon_bit.data_.data_.get_dimensions();
+
+            long long num = (long long)sub_bits.size();
+            long long ii;
+
+            int numThreads = this->number_of_sub_problem_tasks(num);
+            GDEBUG_CONDITION_STREAM(verbose.value(), "Reconstructing " << num << " sub-problems with " << numThreads << " tasks ... ");
+
+            // every task runs the steps of the serial recon on its sub-problem; the openmp loops in these steps run
+            // single threaded inside a task, so the parallelism comes from the number of sub-problems
+            std::vector<int> failed(num, 0);
+
+#pragma omp parallel for default(none) private(ii) shared(num, sub_bits, sub_obj, recon_dims, e, failed) num_threads(numThreads) schedule(dynamic) if(num>1)
+            for (ii = 0; ii < num; ii++)
+            {
+                try
+                {
+                    IsmrmrdReconBit& sub_bit = sub_bits[ii];
+                    ReconObjType& obj = sub_obj[ii];
+
+                    if (sub_bit.ref_)
+                    {
+                        this->make_ref_coil_map(*sub_bit.ref_, recon_dims, obj.ref_calib_, obj.ref_coil_map_, e);
+                        this->prepare_down_stream_coil_compression_ref_data(obj.ref_calib_, obj.ref_coil_map_, obj.ref_calib_dst_, e);
+                        this->perform_coil_map_estimation(obj.ref_coil_map_, obj.coil_map_, e);
+                        // a sub-problem may only hold reference, e.g. ref_N > N; the kernels are still for the full recon size
+                        this->perform_calib(recon_dims, obj, e);
+                    }
+
+                    if (sub_bit.data_.data_.get_number_of_elements() > 0)
+                    {
+                        this->perform_unwrapping(sub_bit, obj, e);
+                        this->compute_image_header(sub_bit, obj.recon_res_, e);
+                    }
+                }
+                catch (...)
+                {
+                    failed[ii] = 1;
+                }
+            }
+
+            size_t numFailed = std::count(failed.begin(), failed.end(), 1);
+            if (numFailed > 0)
+            {
+                GERROR_STREAM("Recon failed for " << numFailed << " out of " << num << " sub-problems");
+                GADGET_THROW("Sub-problem recon failed");
+            }
+
+            // ---------------------------------------------------------------
+            // merge the results in order
+
+            if (has_data)
+            {
+                std::vector<IsmrmrdImageArray> sub_res(num);
+                for (ii = 0; ii < num; ii++)
+                {
+                    sub_res[ii] = std::move(sub_obj[ii].recon_res_);
+                    sub_obj[ii].recon_res_ = IsmrmrdImageArray();
+                }
+
+                this->merge_image_arrays(sub_res, ref_N, ref_S, recon_bit.data_.data_.get_size(4), recon_bit.data_.data_.get_size(5), recon_obj.recon_res_);
+
+                // as in the serial recon, the gfactor is only sent out with the data the kernels are calibrated with
+                if (has_ref)
+                {
+                    size_t SLC = num / (ref_N*ref_S);
+                    bool created = false;
+
+                    for (ii = 0; ii < num; ii++)
+                    {
+                        hoNDArray<float>& gfactor = sub_obj[ii].gfactor_;
+                        if (sub_bits[ii].data_.data_.get_number_of_elements() == 0 || gfactor.get_number_of_elements() == 0) continue;
+
+                        if (!created)
+                        {
+                            recon_obj.gfactor_.create(gfactor.get_size(0), gfactor.get_size(1), gfactor.get_size(2), gfactor.get_size(3), ref_N, ref_S, SLC);
+                            Gadgetron::clear(recon_obj.gfactor_);
+                            created = true;
+                        }
+
+                        size_t slc = ii / (ref_N*ref_S);
+                        size_t s = (ii - slc*ref_N*ref_S) / ref_N;
+                        size_t n = ii - slc*ref_N*ref_S - s*ref_N;
+
+                        memcpy(&(recon_obj.gfactor_(0, 0, 0, 0, n, s, slc)), gfactor.begin(), gfactor.get_number_of_bytes());
+                    }
+                }
+            }
+
+            for (ii = 0; ii < num; ii++)
+            {
+                sub_obj[ii].gfactor_.clear();
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconCartesianGrappaGadget::perform_parallel_recon(...) ... ");
+        }
+    }
+
     void GenericReconCartesianGrappaGadget::compute_snr_map(ReconObjType& recon_obj, hoNDArray< std::complex<float> >& snr_map)
     {
         try
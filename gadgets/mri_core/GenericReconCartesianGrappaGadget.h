@@ -99,6 +99,11 @@ namespace Gadgetron {
         // record the recon kernel, coil maps etc. for every encoding space
         std::vector< ReconObjType > recon_obj_;
 
+        // with parallel_sub_problems, the recon objects of the sub-problems, [ref_N ref_S SLC], for every encoding space
+        std::vector< std::vector<ReconObjType> > sub_recon_obj_;
+        std::vector<size_t> sub_ref_N_;
+        std::vector<size_t> sub_ref_S_;
+
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
@@ -115,10 +120,15 @@ namespace Gadgetron {
 
         // calibration, if only one dst channel is prescribed, the GrappaOne is used
         virtual void perform_calib(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
+        // the kernels are computed for the recon size [RO E1 E2 ...] given by recon_dims, e.g. for a sub-problem without data
+        virtual void perform_calib(const std::vector<size_t>& recon_dims, ReconObjType& recon_obj, size_t encoding);
 
         // unwrapping or coil combination
         virtual void perform_unwrapping(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
 
+        // calibration and unwrapping of every sub-problem as parallel tasks, recon_obj.recon_res_ and recon_obj.gfactor_ are filled with the merged results
+        virtual void perform_parallel_recon(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
+
         // compute snr map
         virtual void compute_snr_map(ReconObjType& recon_obj, hoNDArray< std::complex<float> >& snr_map);
     };
@@ -2,8 +2,10 @@
 #include "GenericReconCartesianSpiritGadget.h"
 #include "mri_core_spirit.h"
 #include "hoNDArray_reductions.h"
-#include "hoSPIRIT2DOperator.h"
+#include "hoSPIRIT2DImageDomainOperator.h"
 #include "hoLsqrSolver.h"
+#include "hoCgSolver.h"
+#include "hoBatchCgSolver.h"
 #include "mri_core_grappa.h"
 
 namespace Gadgetron {
@@ -74,6 +76,17 @@ namespace Gadgetron {
             GDEBUG_STREAM("spirit_iter_thres: " << this->spirit_iter_thres.value());
         }
 
+        if (this->spirit_kernel_cache_size_mb.value() > 0)
+        {
+            size_t cache_size = hoSPIRIT2DImageDomainOperator< std::complex<float> >::reserve_kernel_cache_size((size_t)this->spirit_kernel_cache_size_mb.value() * 1024 * 1024);
+            GDEBUG_STREAM("spirit kernel cache size: " << (cache_size >> 20) << " MB");
+        }
+        else
+        {
+            GWARN_STREAM("spirit_kernel_cache_size_mb must be positive, " << this->spirit_kernel_cache_size_mb.value() << " is ignored; the cache keeps "
+                << (hoSPIRIT2DImageDomainOperator< std::complex<float> >::get_kernel_cache_size() >> 20) << " MB");
+        }
+
         if (this->spirit_reg_lamda.value()<FLT_EPSILON)
         {
             if(acceFactorE2_[0]>1)
@@ -281,8 +294,7 @@ namespace Gadgetron {
                         hoNDArray< std::complex<float> > convKer(convKRO, convKE1, srcCHA, dstCHA, &(recon_obj.kernel_(0, 0, 0, 0, 0, n, s, slc)));
                         hoNDArray< std::complex<float> > kIm(RO, E1, srcCHA, dstCHA, &(recon_obj.kernelIm2D_(0, 0, 0, 0, n, s, slc)));
 
-                        Gadgetron::spirit2d_calib_convolution_kernel(acsSrc, acsDst, reg_lamda, kRO, kE1, 1, 1, convKer, true);
-                        Gadgetron::spirit2d_image_domain_kernel(convKer, RO, E1, kIm);
+                        hoSPIRIT2DImageDomainOperator< std::complex<float> >::calib_image_domain_kernel(acsSrc, acsDst, reg_lamda, kRO, kE1, RO, E1, convKer, kIm);
 
                         hoNDArray< std::complex<float> > convKerTmp, kImTmp;
 
@@ -638,6 +650,7 @@ namespace Gadgetron {
             size_t iter_max = this->spirit_iter_max.value();
             double iter_thres = this->spirit_iter_thres.value();
             bool print_iter = this->spirit_print_iter.value();
+            bool use_cg = this->spirit_use_cg.value();
 
             size_t RO = kspace.get_size(0);
             size_t E1 = kspace.get_size(1);
@@ -660,6 +673,34 @@ namespace Gadgetron {
             kspace_Shifted = kspace;
             Gadgetron::hoNDFFT<float>::instance()->ifftshift2D(kspace, kspace_Shifted);
 
+            // check whether the kspace is undersampled
+            std::vector<unsigned char> undersampled(num, 0);
+            for (ii = 0; ii < num; ii++)
+            {
+                size_t slc = ii / (N*S);
+                size_t s = (ii - slc*N*S) / N;
+                size_t n = ii - slc*N*S - s*N;
+
+                for (size_t e1 = 0; e1 < E1; e1++)
+                {
+                    if ((std::abs(kspace(RO / 2, e1, 0, CHA - 1, n, s, slc)) == 0)
+                        && (std::abs(kspace(RO / 2, e1, 0, 0, n, s, slc)) == 0))
+                    {
+                        undersampled[ii] = 1;
+                        break;
+                    }
+                }
+            }
+
+            if (this->use_batched_cg.value() && ref_N == 1 && ref_S == 1)
+            {
+                this->perform_spirit_unwrapping_batched(kspace_Shifted, ker_Shifted, undersampled, res);
+
+                Gadgetron::hoNDFFT<float>::instance()->fftshift2D(res, kspace_Shifted);
+                res = kspace_Shifted;
+                return;
+            }
+
 #ifdef USE_OMP
             int numThreads = (int)num;
             if (numThreads > omp_get_num_procs()) numThreads = omp_get_num_procs();
@@ -671,10 +712,10 @@ namespace Gadgetron {
             dim[1] = E1;
             dim[2] = CHA;
 
-#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, CHA, dim, ref_N, ref_S, kspace, res, kspace_Shifted, ker_Shifted, iter_max, iter_thres, print_iter) num_threads(numThreads) if(num>1) 
+#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, CHA, dim, ref_N, ref_S, kspace, res, kspace_Shifted, ker_Shifted, iter_max, iter_thres, print_iter, use_cg, undersampled) num_threads(numThreads) if(num>1) 
             {
-                boost::shared_ptr< hoSPIRIT2DOperator< std::complex<float> > > oper(new hoSPIRIT2DOperator< std::complex<float> >(&dim));
-                hoSPIRIT2DOperator< std::complex<float> >& spirit = *oper;
+                boost::shared_ptr< hoSPIRIT2DImageDomainOperator< std::complex<float> > > oper(new hoSPIRIT2DImageDomainOperator< std::complex<float> >(&dim));
+                hoSPIRIT2DImageDomainOperator< std::complex<float> >& spirit = *oper;
                 spirit.use_non_centered_fft_ = true;
                 spirit.no_null_space_ = false;
 
@@ -690,6 +731,19 @@ namespace Gadgetron {
                 cgSolver.set_output_mode(print_iter ? hoLsqrSolver< std::complex<float> >::OUTPUT_VERBOSE : hoLsqrSolver< std::complex<float> >::OUTPUT_SILENT);
                 cgSolver.set_encoding_operator(oper);
 
+                // the helper memory is kept between the unwrappings of this thread
+                cgSolver.set_keep_workspace(true);
+                cgSolver.set_use_fused_kernels(true);
+
+                // the normal equations are applied with Dc(G-I)'(G-I)Dc', one fft pair per iteration instead of two
+                hoCgSolver< std::complex<float> > normalSolver;
+                normalSolver.set_tc_tolerance((float)iter_thres);
+                normalSolver.set_max_iterations((unsigned int)iter_max);
+                normalSolver.set_output_mode(print_iter ? hoCgSolver< std::complex<float> >::OUTPUT_VERBOSE : hoCgSolver< std::complex<float> >::OUTPUT_SILENT);
+                normalSolver.set_encoding_operator(oper);
+                normalSolver.set_keep_workspace(true);
+                normalSolver.set_use_fused_kernels(true);
+
                 hoNDArray< std::complex<float> > b(RO, E1, CHA);
                 hoNDArray< std::complex<float> > unwarppedKSpace(RO, E1, CHA);
 
@@ -700,22 +754,10 @@ namespace Gadgetron {
                     size_t s = (ii - slc*N*S) / N;
                     size_t n = ii - slc*N*S - s*N;
 
-                    // check whether the kspace is undersampled
-                    bool undersampled = false;
-                    for (size_t e1 = 0; e1 < E1; e1++)
-                    {
-                        if ((std::abs(kspace(RO / 2, e1, 0, CHA - 1, n, s, slc)) == 0)
-                            && (std::abs(kspace(RO / 2, e1, 0, 0, n, s, slc)) == 0))
-                        {
-                            undersampled = true;
-                            break;
-                        }
-                    }
-
                     std::complex<float>* pKpaceShifted = &(kspace_Shifted(0, 0, 0, 0, n, s, slc));
                     std::complex<float>* pRes = &(res(0, 0, 0, 0, n, s, slc));
 
-                    if (!undersampled)
+                    if (!undersampled[ii])
                     {
                         memcpy(pRes, pKpaceShifted, sizeof(std::complex<float>)*RO*E1*CHA);
                         continue;
@@ -729,20 +771,26 @@ namespace Gadgetron {
 
                     boost::shared_ptr< hoNDArray< std::complex<float> > > acq(new hoNDArray< std::complex<float> >(RO, E1, CHA, pKpaceShifted));
                     spirit.set_acquired_points(*acq);
-                    cgSolver.set_x0(acq);
 
-                    if (ref_N == 1 && ref_S == 1)
-                    {
-                        spirit.compute_righ_hand_side(*acq, b);
-                        cgSolver.solve(&unwarppedKSpace, &b);
-                    }
-                    else
+                    if (ref_N > 1 || ref_S > 1)
                     {
                         std::complex<float>* pKer = &(ker_Shifted(0, 0, 0, 0, kernelN, kernelS, slc));
                         boost::shared_ptr<hoNDArray< std::complex<float> > > ker(new hoNDArray< std::complex<float> >(RO, E1, CHA, CHA, pKer));
                         spirit.set_forward_kernel(*ker, false);
+                    }
+
+                    spirit.compute_righ_hand_side(*acq, b);
 
-                        spirit.compute_righ_hand_side(*acq, b);
+                    if (use_cg)
+                    {
+                        normalSolver.set_x0(acq);
+                        boost::shared_ptr< hoNDArray< std::complex<float> > > x = normalSolver.solve(&b);
+                        GADGET_CHECK_THROW(x);
+                        memcpy(unwarppedKSpace.begin(), x->begin(), unwarppedKSpace.get_number_of_bytes());
+                    }
+                    else
+                    {
+                        cgSolver.set_x0(acq);
                         cgSolver.solve(&unwarppedKSpace, &b);
                     }
 
@@ -761,5 +809,103 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconCartesianSpiritGadget::perform_spirit_unwrapping_batched(hoNDArray< std::complex<float> >& kspace, hoNDArray< std::complex<float> >& kerIm, const std::vector<unsigned char>& undersampled, hoNDArray< std::complex<float> >& res)
+    {
+        try
+        {
+            size_t RO = kspace.get_size(0);
+            size_t E1 = kspace.get_size(1);
+            size_t CHA = kspace.get_size(3);
+
+            size_t num = undersampled.size();
+            size_t sysSize = RO*E1*CHA;
+
+            // kspace without undersampling is copied, the others are stacked as [RO E1 CHA K]
+            std::vector<size_t> systems;
+            for (size_t ii = 0; ii < num; ii++)
+            {
+                if (undersampled[ii])
+                {
+                    systems.push_back(ii);
+                }
+                else
+                {
+                    memcpy(res.begin() + ii*sysSize, kspace.begin() + ii*sysSize, sizeof(std::complex<float>)*sysSize);
+                }
+            }
+
+            size_t K = systems.size();
+            if (K == 0) return;
+
+            GDEBUG_CONDITION_STREAM(this->verbose.value(), "batched spirit unwrapping of " << K << " out of " << num << " images");
+
+            std::vector<size_t> dim(4);
+            dim[0] = RO;
+            dim[1] = E1;
+            dim[2] = CHA;
+            dim[3] = K;
+
+            boost::shared_ptr< hoNDArray< std::complex<float> > > acq(new hoNDArray< std::complex<float> >(dim));
+            size_t k;
+            for (k = 0; k < K; k++)
+            {
+                memcpy(acq->begin() + k*sysSize, kspace.begin() + systems[k] * sysSize, sizeof(std::complex<float>)*sysSize);
+            }
+
+            boost::shared_ptr< hoSPIRIT2DImageDomainOperator< std::complex<float> > > oper(new hoSPIRIT2DImageDomainOperator< std::complex<float> >(&dim));
+            oper->use_non_centered_fft_ = true;
+            oper->no_null_space_ = false;
+
+            hoNDArray< std::complex<float> > ker(RO, E1, CHA, CHA, kerIm.begin());
+            oper->set_forward_kernel(ker, true);
+            oper->set_acquired_points(*acq);
+
+            // the normal equations are applied with Dc(G-I)'(G-I)Dc', one fft pair for all images per iteration
+            hoBatchCgSolver< std::complex<float> > cgSolver;
+            cgSolver.set_tc_tolerance((float)this->spirit_iter_thres.value());
+            cgSolver.set_max_iterations((unsigned int)this->spirit_iter_max.value());
+            cgSolver.set_output_mode(this->spirit_print_iter.value() ? hoBatchCgSolver< std::complex<float> >::OUTPUT_VERBOSE : hoBatchCgSolver< std::complex<float> >::OUTPUT_SILENT);
+            cgSolver.set_encoding_operator(oper);
+            cgSolver.set_use_fused_kernels(true);
+            cgSolver.set_x0(acq);
+
+            hoNDArray< std::complex<float> > b;
+            oper->compute_righ_hand_side(*acq, b);
+
+            boost::shared_ptr< hoNDArray< std::complex<float> > > unwarppedKSpace = cgSolver.solve(&b);
+            GADGET_CHECK_THROW(unwarppedKSpace);
+
+            // restore the acquired points
+            oper->restore_acquired_kspace(*acq, *unwarppedKSpace);
+
+            for (k = 0; k < K; k++)
+            {
+                memcpy(res.begin() + systems[k] * sysSize, unwarppedKSpace->begin() + k*sysSize, sizeof(std::complex<float>)*sysSize);
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconCartesianSpiritGadget::perform_spirit_unwrapping_batched(...) ... ");
+        }
+    }
+
+    int GenericReconCartesianSpiritGadget::close(unsigned long flags)
+    {
+        GDEBUG_CONDITION_STREAM(true, "GenericReconCartesianSpiritGadget - close(flags) : " << flags);
+
+        if (BaseClass::close(flags) != GADGET_OK) return GADGET_FAIL;
+
+        if (flags != 0)
+        {
+            // the job is done, kernels no operator uses any more are not kept for the next one
+            size_t num = hoSPIRIT2DImageDomainOperator< std::complex<float> >::release_unused_kernels();
+            GDEBUG_CONDITION_STREAM(this->verbose.value(), "Released " << num << " cached spirit kernels");
+        }
+
+        return GADGET_OK;
+    }
+
+    // ----------------------------------------------------------------------------------------
+
     GADGET_FACTORY_DECLARE(GenericReconCartesianSpiritGadget)
 }
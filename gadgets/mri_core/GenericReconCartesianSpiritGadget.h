@@ -80,6 +80,9 @@ namespace Gadgetron {
         GADGET_PROPERTY(spirit_iter_max, int, "Spirit maximal number of iterations", 0);
         GADGET_PROPERTY(spirit_iter_thres, double, "Spirit threshold to stop iteration", 0);
         GADGET_PROPERTY(spirit_print_iter, bool, "Spirit print out iterations", false);
+        GADGET_PROPERTY(spirit_use_cg, bool, "Spirit solves the normal equations with the conjugate gradient solver instead of lsqr", false);
+        GADGET_PROPERTY(spirit_kernel_cache_size_mb, int, "Spirit maximal size in MB of the image domain kernels kept for reuse; the cache is shared by the whole process and only grows to the largest size any chain asked for", 256);
+        GADGET_PROPERTY(use_batched_cg, bool, "Whether to solve the 2D unwrappings sharing a kernel together with the batched conjugate gradient solver", false);
 
     protected:
 
@@ -96,6 +99,9 @@ namespace Gadgetron {
         virtual int process_config(ACE_Message_Block* mb);
         virtual int process(Gadgetron::GadgetContainerMessage< IsmrmrdReconData >* m1);
 
+        // close call
+        int close(unsigned long flags);
+
         // --------------------------------------------------
         // recon step functions
         // --------------------------------------------------
@@ -110,6 +116,11 @@ namespace Gadgetron {
         // kspace, kerIm, full_kspace: [RO E1 CHA N S SLC]
         void perform_spirit_unwrapping(hoNDArray< std::complex<float> >& kspace, hoNDArray< std::complex<float> >& kerIm, hoNDArray< std::complex<float> >& full_kspace);
 
+        // solve the undersampled images of a 2D unwrapping together with the batched cg solver, all with the same kernel
+        // kspace, res: shifted kspace [RO E1 1 CHA N S SLC], kerIm: shifted kernel [RO E1 CHA CHA]
+        // undersampled: whether image ii = n + s*N + slc*N*S is undersampled
+        void perform_spirit_unwrapping_batched(hoNDArray< std::complex<float> >& kspace, hoNDArray< std::complex<float> >& kerIm, const std::vector<unsigned char>& undersampled, hoNDArray< std::complex<float> >& res);
+
         // perform coil combination
         void perform_spirit_coil_combine(ReconObjType& recon_obj);
     };
@@ -2,9 +2,82 @@
 #include "GenericReconGadget.h"
 #include "mri_core_kspace_filter.h"
 #include "hoNDArray_reductions.h"
+#include "GadgetThreadPool.h"
+
+#include <algorithm>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
 
 namespace Gadgetron {
 
+    namespace
+    {
+        // copy the entries [n0, n1) x [s0, s1) x slc of an array whose last three dimensions are [N S SLC]
+        template <typename T>
+        void copy_sub_problem(const hoNDArray<T>& src, size_t n0, size_t n1, size_t s0, size_t s1, size_t slc, hoNDArray<T>& dst)
+        {
+            std::vector<size_t> dim = *src.get_dimensions();
+            size_t D = dim.size();
+            size_t N = dim[D - 3];
+            size_t S = dim[D - 2];
+            size_t block = src.get_number_of_elements() / (N*S*dim[D - 1]);
+
+            dim[D - 3] = n1 - n0;
+            dim[D - 2] = s1 - s0;
+            dim[D - 1] = 1;
+            dst.create(dim);
+
+            for (size_t s = s0; s < s1; s++)
+            {
+                const T* pSrc = src.begin() + ((slc*S + s)*N + n0)*block;
+                std::copy(pSrc, pSrc + (n1 - n0)*block, dst.begin() + (s - s0)*(n1 - n0)*block);
+            }
+        }
+
+        // the inverse of copy_sub_problem
+        template <typename T>
+        void paste_sub_problem(const hoNDArray<T>& src, size_t n0, size_t s0, size_t slc, hoNDArray<T>& dst)
+        {
+            std::vector<size_t> dim = *dst.get_dimensions();
+            size_t D = dim.size();
+            size_t N = dim[D - 3];
+            size_t S = dim[D - 2];
+            size_t block = dst.get_number_of_elements() / (N*S*dim[D - 1]);
+
+            size_t subN = src.get_size(D - 3);
+            size_t subS = src.get_size(D - 2);
+
+            for (size_t s = 0; s < subS; s++)
+            {
+                const T* pSrc = src.begin() + s*subN*block;
+                std::copy(pSrc, pSrc + subN*block, dst.begin() + ((slc*S + s0 + s)*N + n0)*block);
+            }
+        }
+
+        // the data entries [start, end) reconstructed with the reference entry r out of R, for D data entries
+        void sub_problem_range(size_t r, size_t R, size_t D, size_t& start, size_t& end)
+        {
+            start = std::min(r, D);
+            end = (r + 1 == R) ? D : std::min(r + 1, D);
+        }
+
+        void split_data_buffered(const IsmrmrdDataBuffered& src, size_t n0, size_t n1, size_t s0, size_t s1, size_t slc, IsmrmrdDataBuffered& dst)
+        {
+            copy_sub_problem(src.data_, n0, n1, s0, s1, slc, dst.data_);
+            copy_sub_problem(src.headers_, n0, n1, s0, s1, slc, dst.headers_);
+
+            if (src.trajectory_ && src.trajectory_->get_number_of_elements() > 0)
+            {
+                dst.trajectory_ = hoNDArray<float>();
+                copy_sub_problem(*src.trajectory_, n0, n1, s0, s1, slc, *dst.trajectory_);
+            }
+
+            dst.sampling_ = src.sampling_;
+        }
+    }
+
     GenericReconGadget::GenericReconGadget() : BaseClass()
     {
     }
@@ -446,6 +519,8 @@ namespace Gadgetron {
             }
 
             // filter the ref_coil_map
+            std::unique_lock<std::mutex> filter_lock(filter_mutex_);
+
             if (filter_RO_ref_coi_map_.get_size(0) != RO)
             {
                 Gadgetron::generate_symmetric_filter_ref(ref_coil_map.get_size(0), ref_.sampling_.sampling_limits_[0].min_, ref_.sampling_.sampling_limits_[0].max_, filter_RO_ref_coi_map_);
@@ -485,6 +560,8 @@ namespace Gadgetron {
                 }
             }
 
+            filter_lock.unlock();
+
             hoNDArray< std::complex<float> > ref_recon_buf;
 
             if (E2 > 1)
@@ -532,14 +609,18 @@ namespace Gadgetron {
             coil_map = ref_coil_map;
             Gadgetron::clear(coil_map);
 
+            // parallel sub-problems cannot share the buffer
+            hoNDArray< std::complex<float> > sub_problem_buf;
+            hoNDArray< std::complex<float> >& complex_im = parallel_sub_problems.value() ? sub_problem_buf : complex_im_recon_buf_;
+
             size_t E2 = ref_coil_map.get_size(2);
             if (E2 > 1)
             {
-                Gadgetron::hoNDFFT<float>::instance()->ifft3c(ref_coil_map, complex_im_recon_buf_);
+                Gadgetron::hoNDFFT<float>::instance()->ifft3c(ref_coil_map, complex_im);
             }
             else
             {
-                Gadgetron::hoNDFFT<float>::instance()->ifft2c(ref_coil_map, complex_im_recon_buf_);
+                Gadgetron::hoNDFFT<float>::instance()->ifft2c(ref_coil_map, complex_im);
             }
 
             if (!debug_folder_full_path_.empty())
@@ -547,7 +628,7 @@ namespace Gadgetron {
                 std::stringstream os;
                 os << "encoding_" << e;
 
-                gt_exporter_.export_array_complex(complex_im_recon_buf_, debug_folder_full_path_ + "complex_im_for_coil_map_" + os.str());
+                gt_exporter_.export_array_complex(complex_im, debug_folder_full_path_ + "complex_im_for_coil_map_" + os.str());
             }
 
             if (coil_map_algorithm.value() == "Inati")
@@ -556,7 +637,7 @@ namespace Gadgetron {
                 size_t kz = 5;
                 size_t power = 3;
 
-                Gadgetron::coil_map_Inati(complex_im_recon_buf_, coil_map, ks, kz, power);
+                Gadgetron::coil_map_Inati(complex_im, coil_map, ks, kz, power);
             }
             else
             {
@@ -565,7 +646,7 @@ namespace Gadgetron {
                 size_t iterNum = 5;
                 float thres = 0.001;
 
-                Gadgetron::coil_map_Inati_Iter(complex_im_recon_buf_, coil_map, ks, kz, iterNum, thres);
+                Gadgetron::coil_map_Inati_Iter(complex_im, coil_map, ks, kz, iterNum, thres);
             }
 
             if (!debug_folder_full_path_.empty())
@@ -817,5 +898,135 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconGadget::split_recon_bit(IsmrmrdReconBit& recon_bit, size_t ref_N, size_t ref_S, std::vector<IsmrmrdReconBit>& sub_bits)
+    {
+        try
+        {
+            hoNDArray< std::complex<float> >& data = recon_bit.data_.data_;
+            bool has_data = (data.get_number_of_elements() > 0);
+
+            size_t N = has_data ? data.get_size(4) : 0;
+            size_t S = has_data ? data.get_size(5) : 0;
+            size_t SLC = has_data ? data.get_size(6) : 0;
+
+            if (recon_bit.ref_)
+            {
+                GADGET_CHECK_THROW(recon_bit.ref_->data_.get_size(4) == ref_N);
+                GADGET_CHECK_THROW(recon_bit.ref_->data_.get_size(5) == ref_S);
+
+                size_t ref_SLC = recon_bit.ref_->data_.get_size(6);
+                GADGET_CHECK_THROW(!has_data || SLC == ref_SLC);
+                SLC = ref_SLC;
+            }
+
+            sub_bits.clear();
+            sub_bits.resize(ref_N*ref_S*SLC);
+
+            size_t n, s, slc;
+            for (slc = 0; slc < SLC; slc++)
+            {
+                for (s = 0; s < ref_S; s++)
+                {
+                    for (n = 0; n < ref_N; n++)
+                    {
+                        IsmrmrdReconBit& sub_bit = sub_bits[n + s*ref_N + slc*ref_N*ref_S];
+
+                        if (recon_bit.ref_)
+                        {
+                            sub_bit.ref_ = IsmrmrdDataBuffered();
+                            split_data_buffered(*recon_bit.ref_, n, n + 1, s, s + 1, slc, *sub_bit.ref_);
+                        }
+
+                        size_t n0, n1, s0, s1;
+                        sub_problem_range(n, ref_N, N, n0, n1);
+                        sub_problem_range(s, ref_S, S, s0, s1);
+
+                        if (n0 < n1 && s0 < s1)
+                        {
+                            split_data_buffered(recon_bit.data_, n0, n1, s0, s1, slc, sub_bit.data_);
+                        }
+                        else
+                        {
+                            sub_bit.data_.sampling_ = recon_bit.data_.sampling_;
+                        }
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconGadget::split_recon_bit(...) ... ");
+        }
+    }
+
+    void GenericReconGadget::merge_image_arrays(std::vector<IsmrmrdImageArray>& sub_res, size_t ref_N, size_t ref_S, size_t N, size_t S, IsmrmrdImageArray& res)
+    {
+        try
+        {
+            GADGET_CHECK_THROW(ref_N*ref_S > 0 && sub_res.size() % (ref_N*ref_S) == 0);
+            size_t SLC = sub_res.size() / (ref_N*ref_S);
+
+            bool created = false;
+
+            size_t n, s, slc;
+            for (slc = 0; slc < SLC; slc++)
+            {
+                for (s = 0; s < ref_S; s++)
+                {
+                    for (n = 0; n < ref_N; n++)
+                    {
+                        IsmrmrdImageArray& sub = sub_res[n + s*ref_N + slc*ref_N*ref_S];
+                        if (sub.data_.get_number_of_elements() == 0) continue;
+
+                        if (!created)
+                        {
+                            res.data_.create(sub.data_.get_size(0), sub.data_.get_size(1), sub.data_.get_size(2), sub.data_.get_size(3), N, S, SLC);
+                            res.headers_.create(N, S, SLC);
+                            res.meta_.resize(N*S*SLC);
+                            created = true;
+                        }
+
+                        size_t n0, n1, s0, s1;
+                        sub_problem_range(n, ref_N, N, n0, n1);
+                        sub_problem_range(s, ref_S, S, s0, s1);
+
+                        paste_sub_problem(sub.data_, n0, s0, slc, res.data_);
+                        paste_sub_problem(sub.headers_, n0, s0, slc, res.headers_);
+
+                        if (sub.meta_.size() == (n1 - n0)*(s1 - s0))
+                        {
+                            for (size_t ss = s0; ss < s1; ss++)
+                            {
+                                for (size_t nn = n0; nn < n1; nn++)
+                                {
+                                    res.meta_[nn + ss*N + slc*N*S] = sub.meta_[(nn - n0) + (ss - s0)*(n1 - n0)];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconGadget::merge_image_arrays(...) ... ");
+        }
+    }
+
+    int GenericReconGadget::number_of_sub_problem_tasks(size_t num)
+    {
+        int numTasks = 1;
+
+#ifdef USE_OMP
+        // the threads this gadget may use now: its share of the gadget thread pool, or the OpenMP limit without the pool
+        numTasks = GadgetThreadPool::omp_budget();
+        if (parallel_sub_problems_max_tasks.value() > 0 && parallel_sub_problems_max_tasks.value() < numTasks) numTasks = parallel_sub_problems_max_tasks.value();
+        if ((size_t)numTasks > num) numTasks = (int)num;
+        if (numTasks < 1) numTasks = 1;
+#endif // USE_OMP
+
+        return numTasks;
+    }
+
     GADGET_FACTORY_DECLARE(GenericReconGadget)
 }
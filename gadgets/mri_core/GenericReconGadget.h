@@ -14,6 +14,8 @@
 
 #include "mri_core_coil_map_estimation.h"
 
+#include <mutex>
+
 namespace Gadgetron {
 
     class EXPORTGADGETSMRICORE GenericReconGadget : public GenericReconDataBase
@@ -37,6 +39,13 @@ namespace Gadgetron {
         GADGET_PROPERTY_LIMITS(coil_map_algorithm, std::string, "Method for coil map estimation", "Inati",
             GadgetPropertyLimitsEnumeration, "Inati", "Inati_Iter");
 
+        /// parallel reconstruction of independent sub-problems
+        /// if parallel_sub_problems==true, every [N S SLC] entry of the reference and the data reconstructed with it form a sub-problem
+        /// the sub-problems are reconstructed as parallel tasks, whose results are merged in order
+        /// this pays off when there are at least as many sub-problems as cores, e.g. multi-slice and SMS protocols
+        GADGET_PROPERTY(parallel_sub_problems, bool, "Whether to reconstruct independent [N S SLC] sub-problems as parallel tasks", false);
+        GADGET_PROPERTY(parallel_sub_problems_max_tasks, int, "Maximal number of sub-problems reconstructed at the same time, 0 for the available OpenMP threads", 0);
+
     protected:
 
         // --------------------------------------------------
@@ -63,7 +72,8 @@ namespace Gadgetron {
         hoNDArray< std::complex<float> > complex_im_recon_buf_;
         hoNDArray< std::complex<float> > data_recon_buf_;
 
-        // filter used for ref coil map 
+        // filter used for ref coil map, created under filter_mutex_ as sub-problems may share it
+        std::mutex filter_mutex_;
         hoNDArray< std::complex<float> > filter_RO_ref_coi_map_;
         hoNDArray< std::complex<float> > filter_E1_ref_coi_map_;
         hoNDArray< std::complex<float> > filter_E2_ref_coi_map_;
@@ -101,6 +111,22 @@ namespace Gadgetron {
         // compute snr scaling factor from effective acceleration rate and sampling region
         void compute_snr_scaling_factor(IsmrmrdReconBit& recon_bit, float& effective_acce_factor, float& snr_scaling_ratio);
 
+        // --------------------------------------------------
+        // parallel sub-problems
+        // --------------------------------------------------
+
+        // split a recon bit into ref_N*ref_S*SLC sub-problems, ordered as [ref_N ref_S SLC]
+        // sub-problem (n, s, slc) holds the reference entry (n, s, slc) and the data entries reconstructed with it:
+        // data entry n uses the reference entry min(n, ref_N-1), and the same for s
+        void split_recon_bit(IsmrmrdReconBit& recon_bit, size_t ref_N, size_t ref_S, std::vector<IsmrmrdReconBit>& sub_bits);
+
+        // merge the images of the sub-problems made by split_recon_bit into res, [RO E1 E2 CHA N S SLC]
+        // sub-problems without data are skipped
+        void merge_image_arrays(std::vector<IsmrmrdImageArray>& sub_res, size_t ref_N, size_t ref_S, size_t N, size_t S, IsmrmrdImageArray& res);
+
+        // number of tasks to reconstruct num sub-problems with
+        int number_of_sub_problem_tasks(size_t num);
+
         // --------------------------------------------------
         // utility functions
         // --------------------------------------------------
@@ -8,13 +8,30 @@
 namespace Gadgetron{
 
     int MRIImageWriter::write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+    {
+        GadgetMessageSendBuffer buffer;
+        if (this->gather(buffer, mb) != 0)
+        {
+            return -1;
+        }
+
+        if (buffer.flush(sock) != 0)
+        {
+            GERROR("MRIImageWriter::write, unable to send image\n");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int MRIImageWriter::gather(GadgetMessageSendBuffer& buffer, ACE_Message_Block* mb)
     {
         GadgetContainerMessage<ISMRMRD::ImageHeader>* imagemb =
             AsContainerMessage<ISMRMRD::ImageHeader>(mb);
 
         if (!imagemb)
         {
-            GERROR("MRIImageWriter::write, invalid image message objects, 1\n");
+            GERROR("MRIImageWriter::gather, invalid image message objects, 1\n");
             return -1;
         }
 
@@ -25,13 +42,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< unsigned short > >* datamb = AsContainerMessage< hoNDArray< unsigned short > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for unsigned short ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for unsigned short ... \n");
                 return -1;
             }
         }
@@ -40,13 +57,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< short > >* datamb = AsContainerMessage< hoNDArray< short > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for short ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for short ... \n");
                 return -1;
             }
         }
@@ -55,13 +72,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< unsigned int > >* datamb = AsContainerMessage< hoNDArray< unsigned int > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for unsigned int ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for unsigned int ... \n");
                 return -1;
             }
         }
@@ -70,13 +87,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< int > >* datamb = AsContainerMessage< hoNDArray< int > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for int ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for int ... \n");
                 return -1;
             }
         }
@@ -85,13 +102,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< float > >* datamb = AsContainerMessage< hoNDArray< float > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for float ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for float ... \n");
                 return -1;
             }
         }
@@ -100,13 +117,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< double > >* datamb = AsContainerMessage< hoNDArray< double > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for double ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for double ... \n");
                 return -1;
             }
         }
@@ -115,13 +132,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< std::complex<float> > >* datamb = AsContainerMessage< hoNDArray< std::complex<float> > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for std::complex<float> ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for std::complex<float> ... \n");
                 return -1;
             }
         }
@@ -130,13 +147,13 @@ namespace Gadgetron{
             GadgetContainerMessage< hoNDArray< std::complex<double> > >* datamb = AsContainerMessage< hoNDArray< std::complex<double> > >(imagemb->cont());
             if (!datamb)
             {
-                GERROR("MRIImageWriter::write, invalid image message objects\n");
+                GERROR("MRIImageWriter::gather, invalid image message objects\n");
                 return -1;
             }
 
-            if (this->write_data_attrib(sock, imagemb, datamb) != 0)
+            if (this->gather_data_attrib(buffer, imagemb, datamb) != 0)
             {
-                GERROR("MRIImageWriter::write_data_attrib failed for std::complex<double> ... \n");
+                GERROR("MRIImageWriter::gather_data_attrib failed for std::complex<double> ... \n");
                 return -1;
             }
         }
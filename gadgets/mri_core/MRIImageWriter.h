@@ -21,8 +21,11 @@ namespace Gadgetron{
     public:
         virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb);
 
+        virtual bool supports_gather() { return true; }
+        virtual int gather(GadgetMessageSendBuffer& buffer, ACE_Message_Block* mb);
+
         template <typename T>
-        int write_data_attrib(ACE_SOCK_Stream* sock, GadgetContainerMessage<ISMRMRD::ImageHeader>* header, GadgetContainerMessage< hoNDArray<T> >* data)
+        int gather_data_attrib(GadgetMessageSendBuffer& buffer, GadgetContainerMessage<ISMRMRD::ImageHeader>* header, GadgetContainerMessage< hoNDArray<T> >* data)
         {
             typedef unsigned long long size_t_type;
 
@@ -45,19 +48,12 @@ namespace Gadgetron{
                 return -1;
             }
 
-            ssize_t send_cnt = 0;
             GadgetMessageIdentifier id;
             id.id = GADGET_MESSAGE_ISMRMRD_IMAGE;
 
-            if ((send_cnt = sock->send_n(&id, sizeof(GadgetMessageIdentifier))) <= 0)
-            {
-                GERROR("Unable to send image message identifier\n");
-                return -1;
-            }
-
             GadgetContainerMessage<ISMRMRD::MetaContainer>* attribmb = AsContainerMessage<ISMRMRD::MetaContainer>(data->cont());
 
-            char* buf = NULL;
+            std::string attribContent;
             size_t_type len(0);
 
             if (attribmb)
@@ -66,14 +62,8 @@ namespace Gadgetron{
                 {
                     std::stringstream str;
                     ISMRMRD::serialize(*attribmb->getObjectPtr(), str);
-                    std::string attribContent = str.str();
+                    attribContent = str.str();
                     len = attribContent.length() + 1;
-
-                    buf = new char[len];
-                    GADGET_CHECK_THROW(buf != NULL);
-
-                    memset(buf, '\0', sizeof(char)*len);
-                    memcpy(buf, attribContent.c_str(), len - 1);
                 }
                 catch (...)
                 {
@@ -84,36 +74,17 @@ namespace Gadgetron{
 
             header->getObjectPtr()->attribute_string_len = (uint32_t)len;
 
-            if ((send_cnt = sock->send_n(header->getObjectPtr(), sizeof(ISMRMRD::ImageHeader))) <= 0)
-            {
-                GERROR("Unable to send image header\n");
-                return -1;
-            }
-
-            if ((send_cnt = sock->send_n(&len, sizeof(size_t_type))) <= 0)
-            {
-                GERROR("Unable to send image meta attributes length\n");
-                if (buf != NULL) delete[] buf;
-                return -1;
-            }
+            buffer.add_copy(&id, sizeof(GadgetMessageIdentifier));
+            buffer.add(header->getObjectPtr(), sizeof(ISMRMRD::ImageHeader));
+            buffer.add_copy(&len, sizeof(size_t_type));
 
+            // the attribute string goes out with its terminating null character
             if (len>0)
             {
-                if ((send_cnt = sock->send_n(buf, len)) <= 0)
-                {
-                    GERROR("Unable to send image meta attributes\n");
-                    if (buf != NULL) delete[] buf;
-                    return -1;
-                }
+                buffer.add_copy(attribContent.c_str(), len);
             }
 
-            if (buf != NULL) delete[] buf;
-
-            if ((send_cnt = sock->send_n(data->getObjectPtr()->get_data_ptr(), sizeof(T)*data->getObjectPtr()->get_number_of_elements())) <= 0)
-            {
-                GERROR("Unable to send image data\n");
-                return -1;
-            }
+            buffer.add(data->getObjectPtr()->get_data_ptr(), sizeof(T)*data->getObjectPtr()->get_number_of_elements());
 
             return 0;
         }
@@ -3,6 +3,7 @@
 #include "vector_td_utilities.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/functional/hash.hpp>
 #include "hoNFFT.h"
 #include "hoNDArray.h"
 #include "hoNDArray_elemwise.h"
@@ -10,9 +11,10 @@
 #include "hoCgSolver.h"
 #include <time.h>
 #include <numeric>
+#include <algorithm>
 
 namespace Gadgetron{
-	CPUGriddingReconGadget::CPUGriddingReconGadget(){}
+	CPUGriddingReconGadget::CPUGriddingReconGadget() : planTrajHash_(0), planSparse_(false){}
 
 	CPUGriddingReconGadget::~CPUGriddingReconGadget(){}
 
@@ -24,6 +26,15 @@ namespace Gadgetron{
 
 		kernelWidth = kernelWidthProperty.value();
 		oversamplingFactor = oversamplingFactorProperty.value();
+		kernel = hoNFFT_plan<float, 2>::NFFT_KERNEL_KAISER_BESSEL;
+
+		if(kernelProperty.value() == "exponential_semicircle"){
+			kernel = hoNFFT_plan<float, 2>::NFFT_KERNEL_EXP_SEMICIRCLE;
+			if(toleranceProperty.value() > 0)
+				hoNFFT_plan<float, 2>::select_parameters(toleranceProperty.value(), matrixSize.x, oversamplingFactor, kernelWidth);
+
+			GDEBUG("Exponential of semicircle kernel, width %f, oversampling factor %f\n", kernelWidth, oversamplingFactor);
+		}
 
 		imageDims.push_back(matrixSize.x); 
 		imageDims.push_back(matrixSize.y);
@@ -91,32 +102,69 @@ namespace Gadgetron{
 		size_t nCoils
 	){
 		hoNDArray<float_complext> arg;
-		arg.create(imageDimsOs[0], imageDimsOs[0]);
+		arg.create(imageDimsOs[0], imageDimsOs[1]);
+		clear(arg);
+
+		hoNFFT_plan<float, 2>& plan = getPlan(traj, nCoils);
+
+		std::vector<size_t> dims = *dcw->get_dimensions();
+		dims.push_back(nCoils);
+		hoNDArray<float_complext> channelData(dims);
+		std::copy(data->begin(), data->begin()+channelData.get_number_of_elements(), channelData.begin());
+
+		hoNDArray<float_complext> channelRecon = *reconstructChannel(&channelData, plan, dcw);
+		multiplyConj(channelRecon, channelRecon, channelRecon);
+
+		size_t pixels = arg.get_number_of_elements();
 		for(unsigned int i = 0; i < nCoils; ++i){
-			hoNDArray<float_complext> channelData(data->get_number_of_elements()/nCoils);
-			std::copy(data->begin()+i*(data->get_number_of_elements()/nCoils), data->begin()+(i+1)*(data->get_number_of_elements()/nCoils), channelData.begin());
-			
-			hoNDArray<float_complext> channelRecon = *reconstructChannel(&channelData, traj, dcw);
-			multiplyConj(channelRecon, channelRecon, channelRecon);
-			add(arg, channelRecon, arg);	
+			hoNDArray<float_complext> coilRecon(imageDimsOs[0], imageDimsOs[1], channelRecon.begin()+i*pixels);
+			add(arg, coilRecon, arg);
 		}
 		sqrt_inplace(&arg);
 		return boost::make_shared<hoNDArray<float_complext>>(arg);
 	}	
 
+	hoNFFT_plan<float, 2>& CPUGriddingReconGadget::getPlan(
+		hoNDArray<floatd2> *traj,
+		size_t nCoils
+	){
+		// The trajectory is shared by all channels, so the gridding weights are computed once
+		// and kept in a sparse matrix, which grids all channels without atomics.
+		// Most protocols repeat the same trajectory for every readout buffer, so the
+		// preprocessed plan is kept until the trajectory changes.
+		bool sparse = nCoils > 1;
+		const float* coords = reinterpret_cast<const float*>(traj->get_data_ptr());
+		size_t hash = boost::hash_range(coords, coords + 2*traj->get_number_of_elements());
+
+		// The hash only rules trajectories out, a hit is confirmed against the stored copy
+		if(plan_ && sparse == planSparse_ && hash == planTrajHash_ && traj->dimensions_equal(&planTraj_)){
+			const float* planCoords = reinterpret_cast<const float*>(planTraj_.get_data_ptr());
+			if(std::equal(coords, coords + 2*traj->get_number_of_elements(), planCoords))
+				return *plan_;
+		}
+
+		plan_ = boost::make_shared<hoNFFT_plan<float, 2>>(
+			from_std_vector<size_t, 2>(imageDims),
+			oversamplingFactor,
+			kernelWidth,
+			kernel
+		);
+		plan_->preprocess(*traj, sparse ? hoNFFT_plan<float, 2>::NFFT_PREP_SPARSE_MATRIX : hoNFFT_plan<float, 2>::NFFT_PREP_NONE);
+
+		planTraj_ = *traj;
+		planTrajHash_ = hash;
+		planSparse_ = sparse;
+		return *plan_;
+	}
+
 	boost::shared_ptr<hoNDArray<float_complext>> CPUGriddingReconGadget::reconstructChannel(
 		hoNDArray<float_complext> *data,
-		hoNDArray<floatd2> *traj,
+		hoNFFT_plan<float, 2> &plan,
 		hoNDArray<float> *dcw
 	){	
 		if(!iterateProperty.value()){
-			hoNFFT_plan<float, 2> plan(
-				from_std_vector<size_t, 2>(imageDims),
-				oversamplingFactor,
-				kernelWidth
-			);	
-			hoNDArray<float_complext> result; result.create(imageDimsOs[0], imageDimsOs[1]);
-			plan.preprocess(*traj);
+			size_t nCoils = data->get_number_of_elements()/dcw->get_number_of_elements();
+			hoNDArray<float_complext> result; result.create(imageDimsOs[0], imageDimsOs[1], nCoils);
 			plan.compute(*data, result, *dcw, hoNFFT_plan<float, 2>::NFFT_BACKWARDS_NC2C); 
 
 			return boost::make_shared<hoNDArray<float_complext>>(result);
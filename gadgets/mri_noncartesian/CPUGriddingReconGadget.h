@@ -10,6 +10,7 @@
 #include "GenericReconGadget.h"
 #include "gadgetron_mri_noncartesian_export.h"
 #include "hoNDArray.h"
+#include "hoNFFT.h"
 
 namespace Gadgetron{
 
@@ -41,6 +42,9 @@ namespace Gadgetron{
 		GADGET_PROPERTY(kernelWidthProperty, float, "Kernel width", 5.5);
 		GADGET_PROPERTY(oversamplingFactorProperty, float, "Oversmapling factor", 1.5);
 		GADGET_PROPERTY(iterateProperty, bool, "Iterate bool", false);
+		GADGET_PROPERTY_LIMITS(kernelProperty, std::string, "Gridding kernel", "kaiser_bessel",
+			GadgetPropertyLimitsEnumeration, "kaiser_bessel", "exponential_semicircle");
+		GADGET_PROPERTY(toleranceProperty, float, "Target accuracy of the exponential of semicircle kernel, selects kernel width and oversampling factor (0 to use the properties above)", 1e-3);
 
 		/**
 			Storage for the properties above
@@ -48,6 +52,7 @@ namespace Gadgetron{
 
 		float kernelWidth;
 		float oversamplingFactor;
+		hoNFFT_plan<float, 2>::NFFT_kernel kernel;
 
 		/**
 			Image dimensions
@@ -56,6 +61,16 @@ namespace Gadgetron{
 		std::vector<size_t> imageDims;
 		std::vector<size_t> imageDimsOs;
 
+		/**
+			NFFT plan preprocessed for the last trajectory, reused while
+			the trajectory dimensions and contents stay the same
+		*/
+
+		boost::shared_ptr<hoNFFT_plan<float, 2>> plan_;
+		hoNDArray<floatd2> planTraj_;
+		size_t planTrajHash_;
+		bool planSparse_;
+
 		virtual int process_config(ACE_Message_Block *mb);
 		virtual int process(GadgetContainerMessage <IsmrmrdReconData> *m1);
 
@@ -76,16 +91,29 @@ namespace Gadgetron{
 		);
 
 		/**
-			Reconstruct single channel
+			Returns the NFFT plan for a trajectory, preprocessing a new
+			one only if the trajectory differs from the cached plan's
+
+			/param traj: trajectories
+			/param nCoils: number of channels
+		*/
 
-			/param data: single channel data
-			/param traj: trajectory
+		hoNFFT_plan<float, 2>& getPlan(
+			hoNDArray<floatd2> *traj,
+			size_t nCoils
+		);
+
+		/**
+			Reconstruct all channels in one batched NFFT
+
+			/param data: k-space data, channels in the last dimension
+			/param plan: NFFT plan, preprocessed for the trajectory
 			/param dcw: density compensation
 		*/
 
 		boost::shared_ptr<hoNDArray<float_complext>> reconstructChannel(
 			hoNDArray<float_complext> *data,
-			hoNDArray<floatd2> *traj,
+			hoNFFT_plan<float, 2> &plan,
 			hoNDArray<float> *dcw
 		);
 
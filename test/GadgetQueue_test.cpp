@@ -0,0 +1,102 @@
+#include "Gadget.h"
+#include "GadgetThreadPool.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace Gadgetron;
+
+namespace {
+
+  const size_t message_size = 64*1024;
+  const size_t fan_out = 4;
+
+  // Puts fan_out messages on the downstream queue for every message it takes, recording the
+  // largest downstream queue it has seen
+  class FanOutGadget : public Gadget
+  {
+  public:
+    FanOutGadget() : max_downstream_bytes(0) {}
+
+    std::atomic<size_t> max_downstream_bytes;
+
+  protected:
+    virtual int process(ACE_Message_Block* m)
+    {
+      Gadget* downstream = dynamic_cast<Gadget*>(this->next());
+      for (size_t k = 0; k < fan_out; k++) {
+        ACE_Message_Block* out = new ACE_Message_Block(message_size);
+        out->wr_ptr(message_size);
+        if (this->next()->putq(out) == -1) {
+          out->release();
+          m->release();
+          return GADGET_FAIL;
+        }
+
+        size_t queued = downstream->queued_bytes();
+        size_t seen = max_downstream_bytes;
+        while (queued > seen && !max_downstream_bytes.compare_exchange_weak(seen, queued)) {}
+      }
+      m->release();
+      return GADGET_OK;
+    }
+  };
+
+  class SlowGadget : public Gadget
+  {
+  public:
+    SlowGadget() : processed(0) {}
+
+    std::atomic<size_t> processed;
+
+  protected:
+    virtual int process(ACE_Message_Block* m)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      processed++;
+      m->release();
+      return GADGET_OK;
+    }
+  };
+
+}
+
+TEST(GadgetQueue, pooledProducerHonoursWatermarkTest){
+  if (!GadgetThreadPool::instance()->enabled()) {
+    GadgetThreadPool::instance()->start(2);
+  }
+
+  FanOutGadget* producer = new FanOutGadget();
+  SlowGadget* consumer = new SlowGadget();
+  ACE_Module<ACE_MT_SYNCH> producer_module("FanOut", producer);
+  ACE_Module<ACE_MT_SYNCH> consumer_module("Slow", consumer);
+  producer->next(consumer);
+
+  GadgetQueueLimits limits;
+  limits.high_water_bytes = 16*message_size;
+  limits.low_water_bytes = 8*message_size;
+  consumer->set_queue_limits(limits);
+
+  ASSERT_EQ(GADGET_OK, consumer->open());
+  ASSERT_EQ(GADGET_OK, producer->open());
+
+  const size_t inputs = 200;
+  for (size_t i = 0; i < inputs; i++) {
+    ASSERT_NE(-1, producer->putq(new ACE_Message_Block(1)));
+  }
+
+  EXPECT_EQ(GADGET_OK, producer->close(1));
+  EXPECT_EQ(GADGET_OK, consumer->close(1));
+
+  EXPECT_EQ(inputs*fan_out, (size_t)consumer->processed);
+
+  // Parked before each message it takes, the producer overshoots the high watermark by at most one message's output
+  EXPECT_LE((size_t)producer->max_downstream_bytes, limits.high_water_bytes + fan_out*message_size);
+  EXPECT_EQ((size_t)0, consumer->queued_bytes());
+
+  GadgetThreadPool::instance()->stop();
+  EXPECT_FALSE(GadgetThreadPool::instance()->enabled());
+}
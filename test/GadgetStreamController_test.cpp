@@ -0,0 +1,95 @@
+#include "GadgetStreamController.h"
+#include "GadgetContainerMessage.h"
+#include "GadgetMessageInterface.h"
+
+#include <ace/OS_NS_sys_socket.h>
+#include <gtest/gtest.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  const ACE_UINT16 result_id = 1022;
+  const size_t results = 8;
+
+  // Sends the identifier and the index of the result
+  class ResultWriter : public GadgetMessageWriter
+  {
+  public:
+    virtual int write(ACE_SOCK_Stream* stream, ACE_Message_Block* mb)
+    {
+      GadgetContainerMessage<ACE_UINT32>* index = AsContainerMessage<ACE_UINT32>(mb);
+      if (!index) {
+        return -1;
+      }
+
+      GadgetMessageIdentifier id;
+      id.id = result_id;
+      if (stream->send_n(&id, sizeof(GadgetMessageIdentifier)) <= 0) {
+        return -1;
+      }
+      if (stream->send_n(index->getObjectPtr(), sizeof(ACE_UINT32)) <= 0) {
+        return -1;
+      }
+      return 0;
+    }
+  };
+
+}
+
+TEST(GadgetStreamController, releaseConnectionSendsQueuedResultsTest){
+  ACE_HANDLE sv[2];
+  ASSERT_EQ(0, ACE_OS::socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+  GadgetStreamController* controller = new GadgetStreamController();
+  ASSERT_EQ(GADGET_OK, controller->prepare("<gadgetronStreamConfiguration></gadgetronStreamConfiguration>"));
+  ASSERT_EQ(GADGET_OK, controller->register_writer(result_id, new ResultWriter()));
+  controller->peer().set_handle(sv[0]);
+
+  // The results of the job are still on the output queue when its end is queued
+  for (ACE_UINT32 i = 0; i < results; i++) {
+    GadgetContainerMessage<GadgetMessageIdentifier>* mid =
+      new GadgetContainerMessage<GadgetMessageIdentifier>();
+    mid->getObjectPtr()->id = result_id;
+    GadgetContainerMessage<ACE_UINT32>* index = new GadgetContainerMessage<ACE_UINT32>();
+    *index->getObjectPtr() = i;
+    mid->cont(index);
+    ASSERT_NE(-1, controller->output_ready(mid));
+  }
+
+  const ACE_UINT32 job_id = 7;
+  GadgetContainerMessage<GadgetMessageIdentifier>* end =
+    new GadgetContainerMessage<GadgetMessageIdentifier>();
+  end->getObjectPtr()->id = GADGET_MESSAGE_JOB_END;
+  GadgetContainerMessage<GadgetMessageJob>* job = new GadgetContainerMessage<GadgetMessageJob>();
+  job->getObjectPtr()->job_id = job_id;
+  end->cont(job);
+  ASSERT_NE(-1, controller->output_ready(end));
+
+  ACE_HANDLE handle = controller->release_connection();
+  EXPECT_EQ(sv[0], handle);
+  EXPECT_EQ(ACE_INVALID_HANDLE, controller->peer().get_handle());
+
+  ACE_SOCK_Stream client;
+  client.set_handle(sv[1]);
+
+  for (ACE_UINT32 i = 0; i < results; i++) {
+    GadgetMessageIdentifier id;
+    ACE_UINT32 index = 0;
+    ASSERT_EQ((ssize_t)sizeof(GadgetMessageIdentifier), client.recv_n(&id, sizeof(GadgetMessageIdentifier)));
+    ASSERT_EQ(result_id, id.id);
+    ASSERT_EQ((ssize_t)sizeof(ACE_UINT32), client.recv_n(&index, sizeof(ACE_UINT32)));
+    EXPECT_EQ(i, index);
+  }
+
+  GadgetMessageIdentifier id;
+  GadgetMessageJob done;
+  ASSERT_EQ((ssize_t)sizeof(GadgetMessageIdentifier), client.recv_n(&id, sizeof(GadgetMessageIdentifier)));
+  EXPECT_EQ(GADGET_MESSAGE_JOB_END, id.id);
+  ASSERT_EQ((ssize_t)sizeof(GadgetMessageJob), client.recv_n(&done, sizeof(GadgetMessageJob)));
+  EXPECT_EQ(job_id, done.job_id);
+
+  client.close();
+  ACE_OS::closesocket(handle);
+  controller->discard();
+}
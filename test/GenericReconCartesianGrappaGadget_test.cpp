@@ -0,0 +1,128 @@
+#include "GenericReconCartesianGrappaGadget.h"
+#include "hoNDArray_math.h"
+
+#include <ace/Message_Block.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+using namespace Gadgetron;
+
+namespace {
+
+  const size_t RO = 32;
+  const size_t E1 = 32;
+  const size_t CHA = 4;
+
+  // 2D cartesian, acceleration 2 along E1, separate reference
+  const std::string header =
+    "<?xml version=\"1.0\"?>"
+    "<ismrmrdHeader xmlns=\"http://www.ismrm.org/ISMRMRD\">"
+    "<experimentalConditions><H1resonanceFrequency_Hz>63500000</H1resonanceFrequency_Hz></experimentalConditions>"
+    "<acquisitionSystemInformation><receiverChannels>4</receiverChannels></acquisitionSystemInformation>"
+    "<encoding>"
+    "<encodedSpace><matrixSize><x>32</x><y>32</y><z>1</z></matrixSize>"
+    "<fieldOfView_mm><x>256</x><y>256</y><z>5</z></fieldOfView_mm></encodedSpace>"
+    "<reconSpace><matrixSize><x>32</x><y>32</y><z>1</z></matrixSize>"
+    "<fieldOfView_mm><x>256</x><y>256</y><z>5</z></fieldOfView_mm></reconSpace>"
+    "<encodingLimits><kspace_encoding_step_1><minimum>0</minimum><maximum>31</maximum><center>16</center></kspace_encoding_step_1></encodingLimits>"
+    "<trajectory>cartesian</trajectory>"
+    "<parallelImaging><accelerationFactor><kspace_encoding_step_1>2</kspace_encoding_step_1><kspace_encoding_step_2>1</kspace_encoding_step_2></accelerationFactor>"
+    "<calibrationMode>separate</calibrationMode></parallelImaging>"
+    "</encoding>"
+    "</ismrmrdHeader>";
+
+  class GrappaReconTester : public GenericReconCartesianGrappaGadget
+  {
+  public:
+    int configure()
+    {
+      ACE_Message_Block mb(header.size() + 1);
+      memcpy(mb.wr_ptr(), header.c_str(), header.size() + 1);
+      mb.wr_ptr(header.size() + 1);
+      return this->process_config(&mb);
+    }
+
+    void recon(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj)
+    {
+      this->perform_parallel_recon(recon_bit, recon_obj, 0);
+    }
+
+    std::vector<ReconObjType>& sub_problems()
+    {
+      return this->sub_recon_obj_[0];
+    }
+  };
+
+  void make_sampling(SamplingDescription& sampling)
+  {
+    sampling.sampling_limits_[0].min_ = 0;
+    sampling.sampling_limits_[0].center_ = RO / 2;
+    sampling.sampling_limits_[0].max_ = RO - 1;
+
+    sampling.sampling_limits_[1].min_ = 0;
+    sampling.sampling_limits_[1].center_ = E1 / 2;
+    sampling.sampling_limits_[1].max_ = E1 - 1;
+  }
+
+  // every other line of one image, and a fully sampled reference for each of ref_N images
+  void make_recon_bit(size_t ref_N, IsmrmrdReconBit& recon_bit)
+  {
+    hoNDArray< std::complex<float> >& data = recon_bit.data_.data_;
+    data.create(RO, E1, 1, CHA, 1, 1, 1);
+    for (size_t n = 0; n < data.get_number_of_elements(); n++)
+    {
+      size_t e1 = (n / RO) % E1;
+      data(n) = (e1 % 2 == 0) ? std::complex<float>(1 + std::cos(0.5f*n), std::sin(0.3f*n)) : std::complex<float>(0);
+    }
+
+    recon_bit.data_.headers_.create(E1, 1, 1, 1, 1);
+    for (size_t e1 = 0; e1 < E1; e1++)
+    {
+      recon_bit.data_.headers_(e1, 0, 0, 0, 0).idx.kspace_encode_step_1 = (uint16_t)e1;
+    }
+    make_sampling(recon_bit.data_.sampling_);
+
+    recon_bit.ref_ = IsmrmrdDataBuffered();
+    hoNDArray< std::complex<float> >& ref = recon_bit.ref_->data_;
+    ref.create(RO, E1, 1, CHA, ref_N, 1, 1);
+    for (size_t n = 0; n < ref.get_number_of_elements(); n++)
+    {
+      size_t i = n % (RO*E1*CHA);
+      ref(n) = std::complex<float>(1 + std::cos(0.5f*i), std::sin(0.3f*i));
+    }
+
+    recon_bit.ref_->headers_.create(E1, 1, ref_N, 1, 1);
+    make_sampling(recon_bit.ref_->sampling_);
+  }
+
+}
+
+TEST(GenericReconCartesianGrappaGadget, parallelReconMoreRefThanDataTest){
+  GrappaReconTester single, more;
+  ASSERT_EQ(GADGET_OK, single.configure());
+  ASSERT_EQ(GADGET_OK, more.configure());
+  single.set_parameter("parallel_sub_problems", "true");
+  more.set_parameter("parallel_sub_problems", "true");
+
+  IsmrmrdReconBit bit, bitMoreRef;
+  make_recon_bit(1, bit);
+  make_recon_bit(2, bitMoreRef);
+
+  GenericReconCartesianGrappaGadget::ReconObjType obj, objMoreRef;
+  ASSERT_NO_THROW(single.recon(bit, obj));
+
+  // the second reference has no data; it is still calibrated for the full recon size
+  ASSERT_NO_THROW(more.recon(bitMoreRef, objMoreRef));
+  ASSERT_EQ((size_t)2, more.sub_problems().size());
+  EXPECT_EQ(RO, more.sub_problems()[1].unmixing_coeff_.get_size(0));
+  EXPECT_EQ(E1, more.sub_problems()[1].unmixing_coeff_.get_size(1));
+
+  // the data is reconstructed with the first reference either way
+  ASSERT_EQ(obj.recon_res_.data_.get_number_of_elements(), objMoreRef.recon_res_.data_.get_number_of_elements());
+  EXPECT_EQ((size_t)1, objMoreRef.recon_res_.data_.get_size(4));
+
+  hoNDArray< std::complex<float> > diff(obj.recon_res_.data_);
+  diff -= objMoreRef.recon_res_.data_;
+  EXPECT_LE(nrm2(&diff), nrm2(&obj.recon_res_.data_)*1e-5);
+}
@@ -10,6 +10,7 @@
 #include "hoNDRedundantWavelet.h"
 #include "hoNDArray_math.h"
 #include "simplexLagariaSolver.h"
+#include "batchedLevenbergMarquardtSolver.h"
 #include "twoParaExpDecayOperator.h"
 #include "twoParaExpRecoveryOperator.h"
 #include "curveFittingCostFunction.h"
@@ -125,6 +126,48 @@ TYPED_TEST(curveFitting_test, T1SR)
     EXPECT_NEAR(b[1], 1122.36963, 0.001);
 }
 
+TYPED_TEST(curveFitting_test, T1SRBatched)
+{
+    size_t L = 5;
+    size_t K = 11;
+
+    std::vector<TypeParam> x(K, 545), y(K), yb(K*L), b(2*L);
+    x[10] = 10000;
+
+    y[0] = 178;
+    y[1] = 185;
+    y[2] = 182;
+    y[3] = 189;
+    y[4] = 178;
+    y[5] = 180;
+    y[6] = 187;
+    y[7] = 179;
+    y[8] = 177;
+    y[9] = 177;
+    y[10] = 471;
+
+    size_t k, l;
+    for (k = 0; k < K; k++)
+        for (l = 0; l < L; l++)
+            yb[l + k*L] = y[k];
+
+    for (l = 0; l < L; l++)
+    {
+        b[l] = *std::max_element(y.begin(), y.end());
+        b[l + L] = x[K / 2];
+    }
+
+    Gadgetron::batchedLevenbergMarquardtSolver< TypeParam, Gadgetron::twoParaExpRecoveryModel<TypeParam> > solver(1e-4, 150);
+    solver.solve(&x[0], K, &yb[0], L, &b[0]);
+
+    // least square optimum, the simplex solver stops within 0.01 of it
+    for (l = 0; l < L; l++)
+    {
+        EXPECT_NEAR(b[l], 471.0636, 0.01);
+        EXPECT_NEAR(b[l + L], 1122.3632, 0.01);
+    }
+}
+
 TYPED_TEST(curveFitting_test, T1SRMapping)
 {
     Gadgetron::ImageIOAnalyze gt_exporter_;
@@ -231,3 +274,73 @@ TYPED_TEST(curveFitting_test, T1SRMapping)
     // test hole filling
     EXPECT_NEAR(t1_sr.map_(12, 23, 0, 0), 1122.36963, 1.0);
 }
+
+TYPED_TEST(curveFitting_test, T1SRMappingBatched)
+{
+    Gadgetron::CmrT1SRMapping<float> t1_sr;
+
+    t1_sr.fill_holes_in_maps_ = false;
+    t1_sr.hole_marking_value_ = 0;
+    t1_sr.compute_SD_maps_ = true;
+
+    t1_sr.use_batched_fitting_ = true;
+    t1_sr.batch_size_ = 64;
+
+    t1_sr.ti_.resize(11, 545);
+    t1_sr.ti_[10] = 10000;
+
+    t1_sr.max_iter_ = 150;
+    t1_sr.thres_fun_ = 1e-4;
+    t1_sr.max_map_value_ = 4000;
+
+    size_t RO = 67;
+    size_t E1 = 45;
+    size_t N = t1_sr.ti_.size();
+    size_t S = 1;
+    size_t SLC = 1;
+
+    std::vector<float> y(11);
+    y[0] = 178;
+    y[1] = 185;
+    y[2] = 182;
+    y[3] = 189;
+    y[4] = 178;
+    y[5] = 180;
+    y[6] = 187;
+    y[7] = 179;
+    y[8] = 177;
+    y[9] = 177;
+    y[10] = 471;
+
+    t1_sr.data_.create(RO, E1, N, S, SLC);
+
+    size_t s, n;
+    for (s = 0; s < S; s++)
+    {
+        Gadgetron::hoNDArray<float> data2D;
+        for (n = 0; n < N; n++)
+        {
+            data2D.create(RO, E1, &(t1_sr.data_(0, 0, n, s, 0)));
+            Gadgetron::fill(data2D, y[n]);
+        }
+    }
+
+    t1_sr.mask_for_mapping_.create(RO, E1, SLC);
+    Gadgetron::fill(t1_sr.mask_for_mapping_, (float)1);
+    t1_sr.mask_for_mapping_(12, 23, 0) = 0;
+
+    t1_sr.perform_parametric_mapping();
+
+    EXPECT_NEAR(t1_sr.para_(0, 0, 0, 0, 0), 471.0636, 0.01);
+    EXPECT_NEAR(t1_sr.para_(RO - 1, E1 - 1, 0, 0, 0), 471.0636, 0.01);
+
+    EXPECT_NEAR(t1_sr.map_(0, 0, 0, 0), 1122.3632, 0.01);
+    EXPECT_NEAR(t1_sr.map_(RO / 2, E1 / 2, 0, 0), 1122.3632, 0.01);
+    EXPECT_NEAR(t1_sr.map_(RO - 1, E1 - 1, 0, 0), 1122.3632, 0.01);
+
+    // masked pixel is not mapped
+    EXPECT_EQ(t1_sr.map_(12, 23, 0, 0), 0);
+
+    // sd is computed for every mapped pixel
+    EXPECT_GT(t1_sr.sd_map_(RO / 2, E1 / 2, 0, 0), 0);
+}
@@ -0,0 +1,130 @@
+#include "hoMemoryPool.h"
+#include "hoNDArray.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <complex>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+using namespace Gadgetron;
+
+class hoMemoryPool_Test : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    was_enabled = hoMemoryPool::enabled();
+    hoMemoryPool::configure(true);
+  }
+  virtual void TearDown() {
+    hoMemoryPool::configure(was_enabled);
+  }
+  bool was_enabled;
+};
+
+TEST_F(hoMemoryPool_Test, allocateAlignedTest){
+  for (size_t bytes = 1; bytes < ((size_t)1 << 24); bytes = bytes*3 + 1) {
+    bool pooled = false;
+    void* p = hoMemoryPool::allocate(bytes, pooled);
+    ASSERT_TRUE(p != NULL);
+    EXPECT_TRUE(pooled);
+    EXPECT_EQ((size_t)0, reinterpret_cast<uintptr_t>(p) % 64);
+    memset(p, 0xAB, bytes);
+    hoMemoryPool::deallocate(p, pooled);
+  }
+}
+
+TEST_F(hoMemoryPool_Test, reuseTest){
+  bool pooled = false;
+  void* p = hoMemoryPool::allocate(10000, pooled);
+  hoMemoryPool::deallocate(p, pooled);
+  void* q = hoMemoryPool::allocate(9000, pooled);
+  EXPECT_EQ(p, q);
+  hoMemoryPool::deallocate(q, pooled);
+}
+
+TEST_F(hoMemoryPool_Test, statisticsTest){
+  hoMemoryPool::trim();
+  hoMemoryPool::reset_high_water_mark();
+  hoMemoryPool::Statistics before = hoMemoryPool::statistics();
+
+  {
+    std::vector<size_t> dims(2);
+    dims[0] = 128;
+    dims[1] = 256;
+    hoNDArray< std::complex<float> > a(&dims);
+    hoNDArray< std::complex<float> > b(&dims);
+
+    hoMemoryPool::Statistics during = hoMemoryPool::statistics();
+    EXPECT_GE(during.bytes_in_use, before.bytes_in_use + 2*a.get_number_of_bytes());
+    EXPECT_EQ(before.blocks_in_use + 2, during.blocks_in_use);
+    EXPECT_GE(during.high_water_mark, during.bytes_in_use);
+  }
+
+  hoMemoryPool::Statistics after = hoMemoryPool::statistics();
+  EXPECT_EQ(before.bytes_in_use, after.bytes_in_use);
+  EXPECT_EQ(before.blocks_in_use, after.blocks_in_use);
+  EXPECT_GT(after.bytes_cached, before.bytes_cached);
+  EXPECT_GT(after.high_water_mark, after.bytes_in_use);
+
+  hoMemoryPool::trim();
+  EXPECT_EQ((size_t)0, hoMemoryPool::statistics().bytes_cached);
+}
+
+TEST_F(hoMemoryPool_Test, switchModeTest){
+  bool pooled = false, plain_pooled = true;
+  void* pooled_block = hoMemoryPool::allocate(4096, pooled);
+  EXPECT_TRUE(pooled);
+  hoMemoryPool::configure(false);
+  void* plain = hoMemoryPool::allocate(4096, plain_pooled);
+  EXPECT_FALSE(plain_pooled);
+  hoMemoryPool::deallocate(pooled_block, pooled);
+  hoMemoryPool::configure(true);
+  hoMemoryPool::deallocate(plain, plain_pooled);
+}
+
+TEST_F(hoMemoryPool_Test, adoptedDataTest){
+  // data allocated outside the pool is freed with free(), not taken for a pool block
+  std::vector<size_t> dims(1, 1000);
+  float* data = (float*)malloc(dims[0]*sizeof(float));
+  hoMemoryPool::Statistics before = hoMemoryPool::statistics();
+  {
+    hoNDArray<float> a(&dims, data, true);
+    hoNDArray<float> b(std::move(a));
+  }
+  hoMemoryPool::Statistics after = hoMemoryPool::statistics();
+  EXPECT_EQ(before.blocks_in_use, after.blocks_in_use);
+
+  // moved arrays keep releasing their pool data to the pool
+  {
+    hoNDArray<float> a(&dims);
+    EXPECT_EQ(before.blocks_in_use + 1, hoMemoryPool::statistics().blocks_in_use);
+    hoNDArray<float> b(std::move(a));
+  }
+  EXPECT_EQ(before.blocks_in_use, hoMemoryPool::statistics().blocks_in_use);
+}
+
+TEST_F(hoMemoryPool_Test, trimOtherThreadsTest){
+  hoMemoryPool::trim();
+
+  // a block freed on another thread stays in that thread's cache until trim()
+  std::atomic<bool> freed(false), done(false);
+  std::thread t([&]() {
+    bool pooled = false;
+    void* p = hoMemoryPool::allocate(100000, pooled);
+    hoMemoryPool::deallocate(p, pooled);
+    freed = true;
+    while (!done) std::this_thread::yield();
+  });
+
+  while (!freed) std::this_thread::yield();
+  EXPECT_GT(hoMemoryPool::statistics().bytes_cached, (size_t)0);
+
+  hoMemoryPool::trim();
+  EXPECT_EQ((size_t)0, hoMemoryPool::statistics().bytes_cached);
+
+  done = true;
+  t.join();
+}
@@ -44,3 +44,88 @@ TYPED_TEST(hoNDFFT_test,ifftNrm2Test){
 	EXPECT_NEAR(nrm2(&this->Array2),nrm2(&this->Array),nrm2(&this->Array)*1e-2);
 
 }
+
+TYPED_TEST(hoNDFFT_test,fft2cRoundTripTest){
+	typedef std::complex<TypeParam> T;
+	hoNDArray<T>& a = reinterpret_cast<hoNDArray<T>&>(this->Array);
+
+	// the second transform runs on a new array of the same shape through the cached plans
+	hoNDArray<T> k, r;
+	hoNDFFT<TypeParam>::instance()->fft2c(a, k);
+	hoNDFFT<TypeParam>::instance()->ifft2c(k, r);
+
+	r -= a;
+	EXPECT_LE(nrm2(&r), nrm2(&a)*1e-3);
+}
+
+TYPED_TEST(hoNDFFT_test,planCacheSizeTest){
+	typedef std::complex<TypeParam> T;
+	hoNDFFT<TypeParam>* fft = hoNDFFT<TypeParam>::instance();
+
+	size_t cache_size = fft->get_plan_cache_size();
+	fft->set_plan_cache_size(2);
+	EXPECT_LE(fft->get_number_of_cached_plans(), 2u);
+
+	// every size needs its own plans, the cache keeps at most two of them
+	for (size_t n = 8; n <= 32; n += 8)
+	{
+		hoNDArray<T> a(n, n, 2), k, r;
+		for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = T(std::cos(0.3*i), std::sin(0.7*i));
+
+		fft->fft2c(a, k);
+		fft->ifft2c(k, r);
+		EXPECT_LE(fft->get_number_of_cached_plans(), 2u);
+
+		r -= a;
+		EXPECT_LE(nrm2(&r), nrm2(&a)*1e-3);
+	}
+
+	fft->set_plan_cache_size(cache_size);
+	EXPECT_EQ(fft->get_plan_cache_size(), cache_size);
+}
+
+TYPED_TEST(hoNDFFT_test,planAheadCacheHitTest){
+	typedef std::complex<TypeParam> T;
+	hoNDFFT<TypeParam>* fft = hoNDFFT<TypeParam>::instance();
+
+	std::vector<size_t> dims(2);
+	dims[0] = 40;
+	dims[1] = 36;
+	fft->plan_ahead(dims, 16, FFTW_MEASURE);
+
+	// the run-time transforms of the planned shape, batched and single, find their plans in the cache
+	size_t num_plans = fft->get_number_of_cached_plans();
+
+	hoNDArray<T> a(40, 36, 16), r;
+	for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = T(std::cos(0.3*i), std::sin(0.7*i));
+	hoNDArray<T> b(40, 36), s;
+	for (size_t i = 0; i < b.get_number_of_elements(); i++) b(i) = a(i);
+
+	fft->fft2(a, r);
+	fft->ifft2(r);
+	fft->fft2(b, s);
+	fft->ifft2(s);
+
+	EXPECT_EQ(fft->get_number_of_cached_plans(), num_plans);
+
+	r -= a;
+	EXPECT_LE(nrm2(&r), nrm2(&a)*1e-3);
+}
+
+TYPED_TEST(hoNDFFT_test,unevenRoundTripTest){
+	typedef std::complex<TypeParam> T;
+	hoNDFFT<TypeParam>* fft = hoNDFFT<TypeParam>::instance();
+
+	// an odd length is transformed by fft_int_uneven, every point of it must be written back
+	hoNDArray<T> a(7, 3), r;
+	for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = T(std::cos(0.3*i), std::sin(0.7*i));
+	r = a;
+
+	fft->fft(&r, 0);
+	fft->ifft(&r, 0);
+
+	// the odd length path is not normalised like the even one, so compare up to the overall scale
+	r *= TypeParam(nrm2(&a)/nrm2(&r));
+	r -= a;
+	EXPECT_LE(nrm2(&r), nrm2(&a)*1e-3);
+}
@@ -138,3 +138,185 @@ TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, randomTestOne)
 
     EXPECT_LE(v/norm_ref, 0.00001);
 }
+
+TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, sparseMatrixConvolutionTest)
+{
+    typedef float T;
+
+    vector_td< size_t, 2 > dims;
+    dims[0] = 64;
+    dims[1] = 64;
+
+    size_t num = 4096;
+    hoNDArray<vector_td<T, 2>> traj(num);
+    hoNDArray< std::complex<T> > data(num);
+    for(size_t n=0; n<num; n++)
+    {
+        T r = T(0.5)*T(n)/T(num);
+        T phi = T(0.05)*T(n);
+        traj(n)[0] = r*std::cos(phi);
+        traj(n)[1] = r*std::sin(phi);
+        data(n) = std::complex<T>(std::cos(T(0.3)*n), std::sin(T(0.7)*n));
+    }
+
+    hoNFFT_plan<T, 2> plan(dims, 1.5, 5.5);
+    plan.preprocess(traj);
+
+    hoNFFT_plan<T, 2> sparsePlan(dims, 1.5, 5.5);
+    sparsePlan.preprocess(traj, hoNFFT_plan<T, 2>::NFFT_PREP_SPARSE_MATRIX);
+
+    hoNDArray< std::complex<T> > grid(96, 96), sparseGrid(96, 96);
+    plan.convolve(data, grid, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+    sparsePlan.convolve(data, sparseGrid, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+
+    hoNDArray< std::complex<T> > diff;
+    T v, norm_ref;
+    Gadgetron::subtract(grid, sparseGrid, diff);
+    Gadgetron::norm2(diff, v);
+    Gadgetron::norm2(grid, norm_ref);
+    EXPECT_LE(v/norm_ref, 0.00001);
+
+    hoNDArray< std::complex<T> > samples(num), sparseSamples(num);
+    plan.convolve(grid, samples, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+    sparsePlan.convolve(grid, sparseSamples, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+
+    Gadgetron::subtract(samples, sparseSamples, diff);
+    Gadgetron::norm2(diff, v);
+    Gadgetron::norm2(samples, norm_ref);
+    EXPECT_LE(v/norm_ref, 0.00001);
+}
+
+TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, batchedConvolutionTest)
+{
+    typedef float T;
+
+    vector_td< size_t, 2 > dims;
+    dims[0] = 64;
+    dims[1] = 64;
+
+    size_t num = 4096;
+    size_t CHA = 4;
+    hoNDArray<vector_td<T, 2>> traj(num);
+    hoNDArray< std::complex<T> > data(num, CHA);
+    for(size_t n=0; n<num; n++)
+    {
+        T r = T(0.5)*T(n)/T(num);
+        T phi = T(0.05)*T(n);
+        traj(n)[0] = r*std::cos(phi);
+        traj(n)[1] = r*std::sin(phi);
+        for(size_t cha=0; cha<CHA; cha++)
+            data(n, cha) = std::complex<T>(std::cos(T(0.3)*n*(cha+1)), std::sin(T(0.7)*n+cha));
+    }
+
+    hoNFFT_plan<T, 2> plan(dims, 1.5, 5.5);
+    plan.preprocess(traj);
+
+    hoNDArray< std::complex<T> > grid(96, 96, CHA);
+    plan.convolve(data, grid, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+
+    hoNDArray< std::complex<T> > samples(num, CHA);
+    plan.convolve(grid, samples, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+
+    for(size_t cha=0; cha<CHA; cha++)
+    {
+        hoNDArray< std::complex<T> > dataCha(num, data.begin()+cha*num);
+        hoNDArray< std::complex<T> > gridCha(96, 96), samplesCha(num);
+        plan.convolve(dataCha, gridCha, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+        plan.convolve(gridCha, samplesCha, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+
+        for(size_t i=0; i<gridCha.get_number_of_elements(); i++)
+            EXPECT_EQ(gridCha(i), grid(i+cha*gridCha.get_number_of_elements()));
+
+        for(size_t i=0; i<num; i++)
+            EXPECT_EQ(samplesCha(i), samples(i, cha));
+    }
+}
+
+TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, expSemicircleParametersTest)
+{
+    typedef float T;
+
+    T osf, wg;
+    hoNFFT_plan<T, 2>::select_parameters(T(1e-3), 256, osf, wg);
+    EXPECT_EQ((size_t)320, (size_t)(osf*256));
+    EXPECT_EQ(T(5), wg);
+
+    hoNFFT_plan<T, 2>::select_parameters(T(1e-6), 190, osf, wg);
+    EXPECT_EQ((size_t)238, (size_t)(osf*190));
+    EXPECT_GT(wg, T(5));
+
+    hoNFFT_plan<T, 2>::select_parameters(T(1e-12), 64, osf, wg);
+    EXPECT_EQ((size_t)128, (size_t)(osf*64));
+
+    // compare the gridding reconstruction against a direct NDFT on a small grid
+    vector_td< size_t, 2 > dims;
+    dims[0] = 32;
+    dims[1] = 32;
+
+    size_t num = 1024;
+    hoNDArray<vector_td<T, 2>> traj(num);
+    hoNDArray< std::complex<T> > data(num);
+    for(size_t n=0; n<num; n++)
+    {
+        // the samples stay far enough from the grid edge for the kernel to fit, the grid is not periodic
+        T r = T(0.3)*T(n)/T(num);
+        T phi = T(0.05)*T(n);
+        traj(n)[0] = r*std::cos(phi);
+        traj(n)[1] = r*std::sin(phi);
+        data(n) = std::complex<T>(std::cos(T(0.3)*n), std::sin(T(0.7)*n));
+    }
+
+    T tolerances[] = {T(1e-4), T(1e-6)};
+    T bounds[] = {T(1e-3), T(1e-4)};
+
+    for(size_t t=0; t<2; t++)
+    {
+        hoNFFT_plan<T, 2>::select_parameters(tolerances[t], dims[0], osf, wg);
+
+        hoNFFT_plan<T, 2> plan(dims, osf, wg, hoNFFT_plan<T, 2>::NFFT_KERNEL_EXP_SEMICIRCLE);
+        plan.preprocess(traj);
+
+        size_t os = (size_t)(osf*dims[0]);
+        hoNDArray< std::complex<T> > image(os, os);
+        hoNDArray< std::complex<T> > d(data);
+        hoNDArray<T> w((size_t)0);
+        plan.compute(d, image, w, hoNFFT_plan<T, 2>::NFFT_BACKWARDS_NC2C);
+
+        // f(x, y) = sum_n data(n) exp(2*pi*i*(k0*x + k1*y)) over the central field of view
+        std::vector< std::complex<double> > ref, res;
+        for(size_t j=os/2-dims[1]/2; j<os/2+dims[1]/2; j++)
+        {
+            for(size_t i=os/2-dims[0]/2; i<os/2+dims[0]/2; i++)
+            {
+                double x = (double)i - (double)(os/2);
+                double y = (double)j - (double)(os/2);
+
+                std::complex<double> v(0);
+                for(size_t n=0; n<num; n++)
+                    v += std::complex<double>(data(n))*std::polar(1.0, 2*M_PI*(traj(n)[0]*x + traj(n)[1]*y));
+
+                ref.push_back(v);
+                res.push_back(std::complex<double>(image(i+j*os)));
+            }
+        }
+
+        // the reconstruction is scaled by a real constant, fit it before comparing
+        std::complex<double> rr(0), rs(0);
+        for(size_t i=0; i<ref.size(); i++)
+        {
+            rr += std::norm(ref[i]);
+            rs += std::conj(ref[i])*res[i];
+        }
+        std::complex<double> scale = rs/rr;
+        EXPECT_GT(scale.real(), 0.0);
+        EXPECT_LE(std::abs(scale.imag()), std::abs(scale)*1e-3);
+
+        double err = 0, norm_ref = 0;
+        for(size_t i=0; i<ref.size(); i++)
+        {
+            err += std::norm(res[i]-scale*ref[i]);
+            norm_ref += std::norm(scale*ref[i]);
+        }
+        EXPECT_LE(std::sqrt(err/norm_ref), bounds[t]);
+    }
+}
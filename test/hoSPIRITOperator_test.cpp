@@ -0,0 +1,416 @@
+#include "hoNDArray_math.h"
+#include "hoSPIRIT2DOperator.h"
+#include "hoSPIRIT2DImageDomainOperator.h"
+#include "hoLsqrSolver.h"
+#include "hoBatchCgSolver.h"
+#include "mri_core_spirit.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <complex>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Gadgetron;
+using testing::Types;
+
+template <typename Real> class hoSPIRITOperator_test : public ::testing::Test {
+protected:
+  typedef std::complex<Real> T;
+
+  virtual void SetUp() {
+    RO = 16;
+    E1 = 12;
+    CHA = 4;
+
+    dim.resize(3);
+    dim[0] = RO;
+    dim[1] = E1;
+    dim[2] = CHA;
+
+    kernel.create(RO, E1, CHA, CHA);
+    for (size_t n = 0; n < kernel.get_number_of_elements(); n++)
+    {
+        kernel(n) = T(std::sin(0.37*n), std::cos(0.11*n*n));
+    }
+
+    // every third line is acquired
+    kspace.create(RO, E1, CHA);
+    x.create(RO, E1, CHA);
+    for (size_t n = 0; n < kspace.get_number_of_elements(); n++)
+    {
+        size_t e1 = (n / RO) % E1;
+        kspace(n) = (e1 % 3 == 0) ? T(1 + std::cos(0.5*n), std::sin(0.3*n)) : T(0);
+        x(n) = T(std::cos(0.21*n), std::sin(0.13*n) - 0.5);
+    }
+  }
+
+  void expect_near(hoNDArray<T>& a, hoNDArray<T>& b) {
+    hoNDArray<T> d(a);
+    d -= b;
+    EXPECT_LE(nrm2(&d), nrm2(&a)*1e-4);
+  }
+
+  // a batch of two systems [RO E1 CHA 2] sharing the kernel, against each system alone
+  template <typename Op> void batch_test() {
+    hoNDArray<T> kspace2(this->kspace.get_dimensions()), x2(this->x.get_dimensions());
+    for (size_t n = 0; n < kspace2.get_number_of_elements(); n++)
+    {
+        size_t e1 = (n / RO) % E1;
+        kspace2(n) = (e1 % 2 == 1) ? T(std::sin(0.2*n), 1) : T(0);
+        x2(n) = T(std::sin(0.17*n), std::cos(0.07*n));
+    }
+
+    size_t N = x.get_number_of_elements();
+    hoNDArray<T> kspaceBatch(RO, E1, CHA, 2), xBatch(RO, E1, CHA, 2);
+    memcpy(kspaceBatch.begin(), kspace.begin(), kspace.get_number_of_bytes());
+    memcpy(kspaceBatch.begin() + N, kspace2.begin(), kspace2.get_number_of_bytes());
+    memcpy(xBatch.begin(), x.begin(), x.get_number_of_bytes());
+    memcpy(xBatch.begin() + N, x2.begin(), x2.get_number_of_bytes());
+
+    std::vector<size_t> dimBatch(dim);
+    dimBatch.push_back(2);
+
+    Op batch(&dimBatch), one(&dim), two(&dim);
+    batch.set_forward_kernel(kernel, true);
+    batch.set_acquired_points(kspaceBatch);
+    one.set_forward_kernel(kernel, true);
+    one.set_acquired_points(kspace);
+    two.set_forward_kernel(kernel, true);
+    two.set_acquired_points(kspace2);
+
+    for (int null_space = 0; null_space < 2; null_space++)
+    {
+        batch.no_null_space_ = (null_space == 0);
+        one.no_null_space_ = (null_space == 0);
+        two.no_null_space_ = (null_space == 0);
+
+        hoNDArray<T> y(xBatch.get_dimensions()), y1(dim), y2(dim);
+
+        for (int op = 0; op < 3; op++)
+        {
+            if (op == 0)
+            {
+                batch.mult_M(&xBatch, &y);
+                one.mult_M(&x, &y1);
+                two.mult_M(&x2, &y2);
+            }
+            else if (op == 1)
+            {
+                batch.mult_MH(&xBatch, &y);
+                one.mult_MH(&x, &y1);
+                two.mult_MH(&x2, &y2);
+            }
+            else
+            {
+                batch.gradient(&xBatch, &y);
+                one.gradient(&x, &y1);
+                two.gradient(&x2, &y2);
+            }
+
+            EXPECT_EQ(y.get_number_of_elements(), 2*N);
+            hoNDArray<T> yOne(dim, y.begin()), yTwo(dim, y.begin() + N);
+            expect_near(y1, yOne);
+            expect_near(y2, yTwo);
+        }
+    }
+  }
+
+  size_t RO, E1, CHA;
+  std::vector<size_t> dim;
+  hoNDArray<T> kernel, kspace, x;
+};
+
+typedef Types<float, double> realImplementations;
+
+TYPED_TEST_CASE(hoSPIRITOperator_test, realImplementations);
+
+TYPED_TEST(hoSPIRITOperator_test, imageDomainOperatorTest){
+  typedef std::complex<TypeParam> T;
+
+  hoSPIRIT2DOperator<T> ref(&this->dim);
+  ref.set_forward_kernel(this->kernel, true);
+  ref.set_acquired_points(this->kspace);
+
+  hoSPIRIT2DImageDomainOperator<T> spirit(&this->dim);
+  spirit.set_forward_kernel(this->kernel, false);
+  spirit.set_acquired_points(this->kspace);
+
+  for (int null_space = 0; null_space < 2; null_space++)
+  {
+    ref.no_null_space_ = (null_space == 0);
+    spirit.no_null_space_ = (null_space == 0);
+
+    hoNDArray<T> y(this->x.get_dimensions()), yRef(this->x.get_dimensions());
+
+    ref.mult_M(&this->x, &yRef);
+    spirit.mult_M(&this->x, &y);
+    this->expect_near(yRef, y);
+
+    ref.mult_MH(&this->x, &yRef);
+    spirit.mult_MH(&this->x, &y);
+    this->expect_near(yRef, y);
+
+    ref.gradient(&this->x, &yRef);
+    spirit.gradient(&this->x, &y);
+    this->expect_near(yRef, y);
+
+    // one fft pair against mult_M followed by mult_MH
+    hoNDArray<T> tmp(this->x.get_dimensions());
+    ref.mult_M(&this->x, &tmp);
+    ref.mult_MH(&tmp, &yRef);
+    spirit.mult_MH_M(&this->x, &y);
+    this->expect_near(yRef, y);
+  }
+}
+
+TYPED_TEST(hoSPIRITOperator_test, imageDomainKernelCacheTest){
+  typedef std::complex<TypeParam> T;
+
+  hoSPIRIT2DImageDomainOperator<T> spirit(&this->dim);
+  spirit.set_forward_kernel(this->kernel, true);
+  spirit.set_acquired_points(this->kspace);
+
+  hoNDArray<T> y(this->x.get_dimensions()), y2(this->x.get_dimensions());
+  spirit.mult_MH_M(&this->x, &y);
+
+  // the second operator finds the kernel in the cache
+  hoSPIRIT2DImageDomainOperator<T> spirit2(&this->dim);
+  spirit2.set_forward_kernel(this->kernel, false);
+  spirit2.set_acquired_points(this->kspace);
+  spirit2.mult_MH_M(&this->x, &y2);
+  this->expect_near(y, y2);
+
+  // a changed kernel is not taken from the cache
+  hoNDArray<T> kernel2(this->kernel);
+  kernel2(7) += T(1);
+  spirit2.set_forward_kernel(kernel2, false);
+  spirit2.mult_MH_M(&this->x, &y2);
+
+  hoSPIRIT2DOperator<T> ref(&this->dim);
+  ref.set_forward_kernel(kernel2, false);
+  ref.set_acquired_points(this->kspace);
+  hoNDArray<T> tmp(this->x.get_dimensions()), yRef(this->x.get_dimensions());
+  ref.mult_M(&this->x, &tmp);
+  ref.mult_MH(&tmp, &yRef);
+  this->expect_near(yRef, y2);
+
+  // operators keep their kernels after the cache is cleared
+  hoSPIRIT2DImageDomainOperator<T>::clear_kernel_cache();
+  spirit.mult_MH_M(&this->x, &y2);
+  this->expect_near(y, y2);
+}
+
+TYPED_TEST(hoSPIRITOperator_test, imageDomainKernelReleaseTest){
+  typedef std::complex<TypeParam> T;
+
+  hoSPIRIT2DImageDomainOperator<T>::clear_kernel_cache();
+
+  hoNDArray<T> kernel2(this->kernel);
+  kernel2(3) += T(1);
+
+  hoSPIRIT2DImageDomainOperator<T> spirit(&this->dim);
+  spirit.set_forward_kernel(this->kernel, false);
+
+  {
+    hoSPIRIT2DImageDomainOperator<T> spirit2(&this->dim);
+    spirit2.set_forward_kernel(kernel2, false);
+  }
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_kernels(), (size_t)2);
+
+  // only the kernel of the finished operator is released
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::release_unused_kernels(), (size_t)1);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_kernels(), (size_t)1);
+
+  // the kernel in use is still found
+  hoSPIRIT2DImageDomainOperator<T> spirit3(&this->dim);
+  spirit3.set_forward_kernel(this->kernel, false);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_kernels(), (size_t)1);
+}
+
+TYPED_TEST(hoSPIRITOperator_test, imageDomainKernelCacheThreadTest){
+  typedef std::complex<TypeParam> T;
+
+  hoSPIRIT2DImageDomainOperator<T>::clear_kernel_cache();
+
+  // a larger kernel, so the threads look it up while it is being computed
+  std::vector<size_t> dim(3);
+  dim[0] = 128;
+  dim[1] = 96;
+  dim[2] = 8;
+
+  hoNDArray<T> kernel(dim[0], dim[1], dim[2], dim[2]);
+  for (size_t n = 0; n < kernel.get_number_of_elements(); n++)
+  {
+      kernel(n) = T(std::sin(0.37*n), std::cos(0.11*n));
+  }
+
+  // operators set with the same kernel at the same time share one cache entry
+  size_t num_threads = 8;
+  std::vector< boost::shared_ptr< hoSPIRIT2DImageDomainOperator<T> > > ops(num_threads);
+  for (size_t t = 0; t < num_threads; t++)
+  {
+    ops[t] = boost::shared_ptr< hoSPIRIT2DImageDomainOperator<T> >(new hoSPIRIT2DImageDomainOperator<T>(&dim));
+  }
+
+  std::atomic<bool> start(false);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++)
+  {
+    threads.push_back(std::thread([&, t]() {
+      while (!start) std::this_thread::yield();
+      ops[t]->set_forward_kernel(kernel, false);
+    }));
+  }
+  start = true;
+  for (size_t t = 0; t < num_threads; t++) threads[t].join();
+
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_kernels(), (size_t)1);
+}
+
+TYPED_TEST(hoSPIRITOperator_test, calibKernelCacheTest){
+  typedef std::complex<TypeParam> T;
+
+  hoSPIRIT2DImageDomainOperator<T>::clear_kernel_cache();
+
+  size_t RO = this->RO, E1 = this->E1, CHA = this->CHA;
+  size_t kRO = 5, kE1 = 5;
+  double reg_lamda = 0.005;
+
+  hoNDArray<T> acs(12, 10, CHA);
+  for (size_t n = 0; n < acs.get_number_of_elements(); n++)
+  {
+      acs(n) = T(std::cos(0.41*n) + 0.2*std::sin(0.03*n*n), std::sin(0.17*n));
+  }
+
+  hoNDArray<T> convKerRef, kImRef;
+  spirit2d_calib_convolution_kernel(acs, acs, reg_lamda, kRO, kE1, 1, 1, convKerRef, true);
+  spirit2d_image_domain_kernel(convKerRef, RO, E1, kImRef);
+
+  // the second calibration with the same data is taken from the cache
+  for (int k = 0; k < 2; k++)
+  {
+    hoNDArray<T> convKer(convKerRef.get_dimensions()), kIm(kImRef.get_dimensions());
+    hoSPIRIT2DImageDomainOperator<T>::calib_image_domain_kernel(acs, acs, reg_lamda, kRO, kE1, RO, E1, convKer, kIm);
+    this->expect_near(convKerRef, convKer);
+    this->expect_near(kImRef, kIm);
+    EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_calibrations(), (size_t)1);
+  }
+
+  // changed calibration data or parameters are calibrated again
+  hoNDArray<T> acs2(acs);
+  acs2(5) += T(1);
+  hoNDArray<T> convKer, kIm;
+  hoSPIRIT2DImageDomainOperator<T>::calib_image_domain_kernel(acs2, acs2, reg_lamda, kRO, kE1, RO, E1, convKer, kIm);
+  hoSPIRIT2DImageDomainOperator<T>::calib_image_domain_kernel(acs, acs, 2*reg_lamda, kRO, kE1, RO, E1, convKer, kIm);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_calibrations(), (size_t)3);
+
+  spirit2d_calib_convolution_kernel(acs, acs, 2*reg_lamda, kRO, kE1, 1, 1, convKerRef, true);
+  this->expect_near(convKerRef, convKer);
+
+  // calibrations are not kept past the end of a job
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::release_unused_kernels(), (size_t)3);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_calibrations(), (size_t)0);
+}
+
+TYPED_TEST(hoSPIRITOperator_test, reserveKernelCacheSizeTest){
+  typedef std::complex<TypeParam> T;
+
+  size_t size = hoSPIRIT2DImageDomainOperator<T>::get_kernel_cache_size();
+
+  // a chain asking for less does not shrink the cache of another chain
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::reserve_kernel_cache_size(size/2), size);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_kernel_cache_size(), size);
+
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::reserve_kernel_cache_size(2*size), 2*size);
+  EXPECT_EQ(hoSPIRIT2DImageDomainOperator<T>::get_kernel_cache_size(), 2*size);
+
+  hoSPIRIT2DImageDomainOperator<T>::set_kernel_cache_size(size);
+}
+
+TYPED_TEST(hoSPIRITOperator_test, batchTest){
+  typedef std::complex<TypeParam> T;
+
+  this->template batch_test< hoSPIRIT2DOperator<T> >();
+  this->template batch_test< hoSPIRIT2DImageDomainOperator<T> >();
+}
+
+TYPED_TEST(hoSPIRITOperator_test, batchedCgUnwrappingTest){
+  typedef std::complex<TypeParam> T;
+
+  size_t RO = this->RO, E1 = this->E1, CHA = this->CHA;
+  size_t N = this->kspace.get_number_of_elements();
+
+  // three images sharing the kernel, each with its own sampling, as in GenericReconCartesianSpiritGadget
+  size_t K = 3;
+  hoNDArray<T> kspaceBatch(RO, E1, CHA, K);
+  for (size_t k = 0; k < K; k++)
+  {
+    for (size_t n = 0; n < N; n++)
+    {
+      size_t e1 = (n / RO) % E1;
+      size_t cha = n / (RO*E1);
+      kspaceBatch(n + k*N) = ((e1 + cha + k) % 3 != 0) ? T(1 + std::cos(0.5*n + k), std::sin(0.3*n - k)) : T(0);
+    }
+  }
+
+  // one image at a time with the lsqr solver
+  hoNDArray<T> resOne(RO, E1, CHA, K);
+  {
+    boost::shared_ptr< hoSPIRIT2DImageDomainOperator<T> > oper(new hoSPIRIT2DImageDomainOperator<T>(&this->dim));
+    oper->set_forward_kernel(this->kernel, false);
+
+    hoLsqrSolver<T> solver;
+    solver.set_tc_tolerance((TypeParam)1e-6);
+    solver.set_max_iterations(500);
+    solver.set_encoding_operator(oper);
+
+    hoNDArray<T> b(RO, E1, CHA), x(RO, E1, CHA);
+    for (size_t k = 0; k < K; k++)
+    {
+      boost::shared_ptr< hoNDArray<T> > acq(new hoNDArray<T>(RO, E1, CHA, kspaceBatch.begin() + k*N));
+      oper->set_acquired_points(*acq);
+      solver.set_x0(acq);
+
+      oper->compute_righ_hand_side(*acq, b);
+      solver.solve(&x, &b);
+      oper->restore_acquired_kspace(*acq, x);
+
+      memcpy(resOne.begin() + k*N, x.begin(), x.get_number_of_bytes());
+    }
+  }
+
+  // all images at once with the batched cg solver
+  std::vector<size_t> dimBatch(this->dim);
+  dimBatch.push_back(K);
+
+  boost::shared_ptr< hoNDArray<T> > acq(new hoNDArray<T>(kspaceBatch));
+  boost::shared_ptr< hoSPIRIT2DImageDomainOperator<T> > oper(new hoSPIRIT2DImageDomainOperator<T>(&dimBatch));
+  oper->set_forward_kernel(this->kernel, true);
+  oper->set_acquired_points(*acq);
+
+  hoBatchCgSolver<T> cg;
+  cg.set_tc_tolerance((TypeParam)1e-10);
+  cg.set_max_iterations(500);
+  cg.set_encoding_operator(oper);
+  cg.set_use_fused_kernels(true);
+  cg.set_x0(acq);
+
+  hoNDArray<T> b;
+  oper->compute_righ_hand_side(*acq, b);
+  boost::shared_ptr< hoNDArray<T> > res = cg.solve(&b);
+  ASSERT_TRUE(res.get() != NULL);
+  oper->restore_acquired_kspace(*acq, *res);
+
+  ASSERT_EQ(res->get_number_of_elements(), K*N);
+  ASSERT_EQ(cg.get_system_iterations().size(), K);
+  for (size_t k = 0; k < K; k++)
+  {
+    EXPECT_GT(cg.get_system_iterations()[k], 0u);
+
+    hoNDArray<T> one(this->dim, resOne.begin() + k*N), batched(this->dim, res->begin() + k*N);
+    hoNDArray<T> d(one);
+    d -= batched;
+    EXPECT_LE(nrm2(&d), nrm2(&one)*1e-3);
+  }
+}
@@ -0,0 +1,250 @@
+#include "hoNDArray_math.h"
+#include "hoCgSolver.h"
+#include "hoBatchCgSolver.h"
+#include "hoLsqrSolver.h"
+#include "linearOperator.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace Gadgetron;
+using testing::Types;
+
+// small dense operator A, out = A*in; a batch of vectors [N K] is multiplied one by one
+template <typename T> class hoDenseTestOperator : public linearOperator< hoNDArray<T> >
+{
+public:
+
+    hoDenseTestOperator(size_t N) : linearOperator< hoNDArray<T> >(), N_(N), A_(N*N)
+    {
+        for (size_t r = 0; r < N_; r++)
+        {
+            for (size_t c = 0; c < N_; c++)
+            {
+                // diagonally dominant, well conditioned
+                A_[r + c*N_] = (r == c) ? T(4 + r % 3) : T(1) / T(1 + r + 2 * c);
+            }
+        }
+
+        std::vector<size_t> dims(1, N_);
+        this->set_domain_dimensions(&dims);
+        this->set_codomain_dimensions(&dims);
+    }
+
+    virtual void mult_M(hoNDArray<T>* in, hoNDArray<T>* out, bool accumulate = false) { this->apply(in, out, accumulate, false); }
+    virtual void mult_MH(hoNDArray<T>* in, hoNDArray<T>* out, bool accumulate = false) { this->apply(in, out, accumulate, true); }
+
+protected:
+
+    void apply(hoNDArray<T>* in, hoNDArray<T>* out, bool accumulate, bool transpose)
+    {
+        if (!accumulate) out->create(in->get_dimensions());
+        for (size_t k = 0; k < in->get_number_of_elements() / N_; k++)
+        {
+            for (size_t r = 0; r < N_; r++)
+            {
+                T v = 0;
+                for (size_t c = 0; c < N_; c++) v += (transpose ? A_[c + r*N_] : A_[r + c*N_]) * (*in)(c + k*N_);
+                (*out)(r + k*N_) = accumulate ? (*out)(r + k*N_) + v : v;
+            }
+        }
+    }
+
+    size_t N_;
+    std::vector<T> A_;
+};
+
+template <typename T> class hoSolvers_Real : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    N = 23;
+    op = boost::shared_ptr< hoDenseTestOperator<T> >(new hoDenseTestOperator<T>(N));
+
+    x_true.create(N);
+    x_true2.create(N);
+    for (size_t n = 0; n < N; n++)
+    {
+        x_true(n) = T(1) + T(n % 5);
+        x_true2(n) = T(3) - T(n % 7);
+    }
+
+    op->mult_M(&x_true, &b);
+    op->mult_M(&x_true2, &b2);
+
+    // the cg tolerance is on the squared residual ratio rq/rq0; it is chosen per precision,
+    // so the iterations stop on the tolerance and not on the maximal number of iterations
+    cg_tol = (sizeof(T) == sizeof(float)) ? T(1e-9) : T(1e-12);
+  }
+
+  size_t N;
+  T cg_tol;
+  boost::shared_ptr< hoDenseTestOperator<T> > op;
+  hoNDArray<T> x_true, x_true2, b, b2;
+};
+
+typedef Types<float, double> realImplementations;
+
+TYPED_TEST_CASE(hoSolvers_Real, realImplementations);
+
+TYPED_TEST(hoSolvers_Real, cgKeepWorkspaceTest){
+  hoCgSolver<TypeParam> cg;
+  cg.set_encoding_operator(this->op);
+  cg.set_max_iterations(100);
+  cg.set_tc_tolerance(this->cg_tol);
+  cg.set_keep_workspace(true);
+
+  // the second solve runs on the helper memory of the first one
+  boost::shared_ptr< hoNDArray<TypeParam> > x = cg.solve(&this->b);
+  boost::shared_ptr< hoNDArray<TypeParam> > x2 = cg.solve(&this->b2);
+
+  hoCgSolver<TypeParam> cgFresh;
+  cgFresh.set_encoding_operator(this->op);
+  cgFresh.set_max_iterations(100);
+  cgFresh.set_tc_tolerance(this->cg_tol);
+  boost::shared_ptr< hoNDArray<TypeParam> > x2Fresh = cgFresh.solve(&this->b2);
+
+  for (size_t n = 0; n < this->N; n++)
+  {
+    EXPECT_NEAR(this->x_true(n), (*x)(n), 1e-3);
+    EXPECT_NEAR(this->x_true2(n), (*x2)(n), 1e-3);
+    EXPECT_FLOAT_EQ((*x2Fresh)(n), (*x2)(n));
+  }
+
+  // the right hand side is computed into the same array every time
+  hoNDArray<TypeParam>* rhs = cg.compute_rhs(&this->b).get();
+  EXPECT_EQ(rhs, cg.compute_rhs(&this->b2).get());
+
+  cg.release_workspace();
+  x = cg.solve(&this->b);
+  for (size_t n = 0; n < this->N; n++) EXPECT_NEAR(this->x_true(n), (*x)(n), 1e-3);
+}
+
+TYPED_TEST(hoSolvers_Real, lsqrKeepWorkspaceTest){
+  hoLsqrSolver<TypeParam> lsqr;
+  lsqr.set_encoding_operator(this->op);
+  lsqr.set_max_iterations(100);
+  lsqr.set_tc_tolerance((TypeParam)1e-7);
+  lsqr.set_keep_workspace(true);
+
+  hoNDArray<TypeParam> x, x2;
+  lsqr.solve(&x, &this->b);
+  lsqr.solve(&x2, &this->b2);
+
+  for (size_t n = 0; n < this->N; n++)
+  {
+    EXPECT_NEAR(this->x_true(n), x(n), 1e-3);
+    EXPECT_NEAR(this->x_true2(n), x2(n), 1e-3);
+  }
+}
+
+TYPED_TEST(hoSolvers_Real, operatorKeepBuffersTest){
+  hoNDArray<TypeParam> y, y2;
+  this->op->mult_MH_M(&this->x_true, &y);
+
+  this->op->set_keep_buffers(true);
+  this->op->mult_MH_M(&this->x_true, &y2);
+  this->op->mult_MH_M(&this->x_true, &y2);
+
+  for (size_t n = 0; n < this->N; n++) EXPECT_FLOAT_EQ(y(n), y2(n));
+}
+
+TYPED_TEST(hoSolvers_Real, fusedKernelsTest){
+  hoNDArray<TypeParam> x(this->x_true), r(this->b), y(this->b);
+  hoNDArray<TypeParam> xRef(this->x_true), rRef(this->b), yRef(this->b);
+  TypeParam a = TypeParam(0.37), c = TypeParam(-1.5);
+
+  TypeParam rr = solver_axpy2_nrm2sq(a, &this->x_true2, &x, &this->b2, &r);
+  axpy(a, &this->x_true2, &xRef);
+  axpy(-a, &this->b2, &rRef);
+  EXPECT_NEAR(dot(&rRef, &rRef), rr, 1e-3*rr);
+
+  TypeParam ny = solver_axpby_nrm2(a, &this->x_true, c, &y);
+  yRef *= c;
+  axpy(a, &this->x_true, &yRef);
+  EXPECT_NEAR(nrm2(&yRef), ny, 1e-4*ny);
+
+  solver_xpby(&this->x_true, c, &r);
+  rRef *= c;
+  axpy(TypeParam(1), &this->x_true, &rRef);
+
+  for (size_t n = 0; n < this->N; n++)
+  {
+    EXPECT_FLOAT_EQ(xRef(n), x(n));
+    EXPECT_FLOAT_EQ(rRef(n), r(n));
+    EXPECT_FLOAT_EQ(yRef(n), y(n));
+  }
+
+  yRef = y;
+  TypeParam d = solver_diff_nrm2_copy(&this->x_true, &y);
+  yRef -= this->x_true;
+  EXPECT_NEAR(nrm2(&yRef), d, 1e-4*d);
+  for (size_t n = 0; n < this->N; n++) EXPECT_EQ(this->x_true(n), y(n));
+}
+
+TYPED_TEST(hoSolvers_Real, fusedCgLsqrTest){
+  hoCgSolver<TypeParam> cg;
+  cg.set_encoding_operator(this->op);
+  cg.set_max_iterations(100);
+  cg.set_tc_tolerance(this->cg_tol);
+  cg.set_use_fused_kernels(true);
+
+  boost::shared_ptr< hoNDArray<TypeParam> > x = cg.solve(&this->b);
+
+  hoLsqrSolver<TypeParam> lsqr;
+  lsqr.set_encoding_operator(this->op);
+  lsqr.set_max_iterations(100);
+  lsqr.set_tc_tolerance((TypeParam)1e-7);
+  lsqr.set_use_fused_kernels(true);
+
+  hoNDArray<TypeParam> x2;
+  lsqr.solve(&x2, &this->b2);
+
+  for (size_t n = 0; n < this->N; n++)
+  {
+    EXPECT_NEAR(this->x_true(n), (*x)(n), 1e-3);
+    EXPECT_NEAR(this->x_true2(n), x2(n), 1e-3);
+  }
+}
+
+TYPED_TEST(hoSolvers_Real, batchCgTest){
+  // three systems: b, b2 and a zero right hand side
+  size_t K = 3;
+  std::vector<size_t> dims(2);
+  dims[0] = this->N;
+  dims[1] = K;
+
+  hoNDArray<TypeParam> b(dims);
+  Gadgetron::clear(b);
+  memcpy(b.begin(), this->b.begin(), this->b.get_number_of_bytes());
+  memcpy(b.begin() + this->N, this->b2.begin(), this->b2.get_number_of_bytes());
+
+  this->op->set_domain_dimensions(&dims);
+  this->op->set_codomain_dimensions(&dims);
+
+  hoBatchCgSolver<TypeParam> cg;
+  cg.set_encoding_operator(this->op);
+  cg.set_max_iterations(100);
+  cg.set_tc_tolerance(this->cg_tol);
+
+  boost::shared_ptr< hoNDArray<TypeParam> > x = cg.solve(&b);
+  ASSERT_EQ(x->get_number_of_elements(), this->N*K);
+
+  for (size_t n = 0; n < this->N; n++)
+  {
+    EXPECT_NEAR(this->x_true(n), (*x)(n), 1e-3);
+    EXPECT_NEAR(this->x_true2(n), (*x)(n + this->N), 1e-3);
+    EXPECT_EQ(TypeParam(0), (*x)(n + 2 * this->N));
+  }
+
+  // every system stops on its own
+  std::vector<unsigned int> iters = cg.get_system_iterations();
+  ASSERT_EQ(K, iters.size());
+  EXPECT_GT(iters[0], 0u);
+  EXPECT_GT(iters[1], 0u);
+  EXPECT_LT(iters[0], 100u);
+  EXPECT_LT(iters[1], 100u);
+  EXPECT_EQ(0u, iters[2]);
+
+  std::vector<TypeParam> res = cg.get_system_residuals();
+  EXPECT_LT(res[0], this->cg_tol);
+  EXPECT_LT(res[1], this->cg_tol);
+}
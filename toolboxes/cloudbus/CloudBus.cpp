@@ -1,8 +1,46 @@
 #include "CloudBus.h"
 #include "log.h"
 
+#include <fstream>
+#include <sstream>
+
 namespace Gadgetron
 {
+  namespace
+  {
+    //Busy and total CPU time of all cores since boot, in clock ticks
+    bool read_cpu_times(uint64_t& busy, uint64_t& total)
+    {
+      std::ifstream f("/proc/stat");
+      std::string cpu;
+      if (!(f >> cpu) || cpu != "cpu") return false;
+
+      //user nice system idle iowait irq softirq steal
+      uint64_t v, idle = 0;
+      total = 0;
+      for (int i = 0; i < 8 && (f >> v); i++) {
+        total += v;
+        if (i == 3 || i == 4) idle += v;
+      }
+      busy = total - idle;
+      return total > 0;
+    }
+
+    //Memory available for new allocations in bytes, 0 if unknown
+    uint64_t read_free_memory()
+    {
+      std::ifstream f("/proc/meminfo");
+      std::string line;
+      while (std::getline(f, line)) {
+        std::istringstream str(line);
+        std::string key;
+        uint64_t kb;
+        if ((str >> key >> kb) && key == "MemAvailable:") return kb*1024;
+      }
+      return 0;
+    }
+  }
+
   CloudBus* CloudBus::instance_ = 0;
   const char* CloudBus::relay_inet_addr_ = GADGETRON_DEFAULT_RELAY_ADDR;
   int CloudBus::relay_port_ = GADGETRON_DEFAULT_RELAY_PORT;
@@ -40,7 +78,7 @@ namespace Gadgetron
 	}
       
 	uint32_t msg_id = *((uint32_t*)buffer);
-	if (msg_id != GADGETRON_CLOUDBUS_NODE_LIST_REPLY) {
+	if (msg_id != GADGETRON_CLOUDBUS_NODE_LIST_REPLY_V2) {
 	  GERROR("Unexpected message id = %d\n", msg_id);
 	  return -1;
 	}
@@ -103,9 +141,34 @@ namespace Gadgetron
   
   void CloudBus::set_compute_capability(uint32_t c)
   {
+    std::lock_guard<std::mutex> lk(info_mtx_);
     node_info_.compute_capability = c;
   }
 
+  void CloudBus::set_pending_bytes_function(std::function<uint64_t()> f)
+  {
+    std::lock_guard<std::mutex> lk(info_mtx_);
+    pending_bytes_function_ = f;
+  }
+
+  void CloudBus::update_load()
+  {
+    uint64_t busy, total;
+    if (read_cpu_times(busy, total)) {
+      if (total > cpu_total_ && busy >= cpu_busy_) {
+        node_info_.cpu_load = static_cast<uint32_t>((100*(busy - cpu_busy_))/(total - cpu_total_));
+      }
+      cpu_busy_ = busy;
+      cpu_total_ = total;
+    }
+
+    node_info_.free_memory = read_free_memory();
+
+    if (pending_bytes_function_) {
+      node_info_.pending_bytes = pending_bytes_function_();
+    }
+  }
+
   unsigned int CloudBus::active_reconstructions()
   {
     return node_info_.active_reconstructions;
@@ -123,17 +186,23 @@ namespace Gadgetron
   
   void CloudBus::report_recon_start()
   {
-    node_info_.active_reconstructions++;
-    auto t = std::chrono::system_clock::now();
-    node_info_.last_recon = std::chrono::system_clock::to_time_t(t);
+    {
+      std::lock_guard<std::mutex> lk(info_mtx_);
+      node_info_.active_reconstructions++;
+      auto t = std::chrono::system_clock::now();
+      node_info_.last_recon = std::chrono::system_clock::to_time_t(t);
+    }
     send_node_info();
   }
   
   void CloudBus::report_recon_end()
   {
-    if (node_info_.active_reconstructions > 0) node_info_.active_reconstructions--;
-    auto t = std::chrono::system_clock::now();
-    node_info_.last_recon = std::chrono::system_clock::to_time_t(t);
+    {
+      std::lock_guard<std::mutex> lk(info_mtx_);
+      if (node_info_.active_reconstructions > 0) node_info_.active_reconstructions--;
+      auto t = std::chrono::system_clock::now();
+      node_info_.last_recon = std::chrono::system_clock::to_time_t(t);
+    }
     send_node_info();
   }
 
@@ -171,7 +240,10 @@ namespace Gadgetron
     
     while (true) {
       if (connected_) {
-	//
+	//Heartbeat with the current load
+	if (!query_mode_) {
+	  send_node_info();
+	}
       } else {
           if (relay_port_ > 0) {
               std::string connect_addr(relay_inet_addr_);
@@ -209,11 +281,14 @@ namespace Gadgetron
 
   void CloudBus::send_node_info()
   {
+    std::lock_guard<std::mutex> lk(info_mtx_);
+    update_load();
+
     size_t buf_len = calculate_node_info_length(node_info_);
     try {
       char* buffer = new char[4+4+buf_len];
       *((uint32_t*)buffer) = buf_len+4;
-      *((uint32_t*)(buffer + 4)) = GADGETRON_CLOUDBUS_NODE_INFO;
+      *((uint32_t*)(buffer + 4)) = GADGETRON_CLOUDBUS_NODE_INFO_V2;
       if (connected_) {
 	serialize(node_info_,buffer + 8,buf_len);
 	this->peer().send_n(buffer,buf_len+8);
@@ -230,7 +305,7 @@ namespace Gadgetron
     if (connected_) {
       uint32_t req[2];
       req[0] = 4;
-      req[1] = GADGETRON_CLOUDBUS_NODE_LIST_QUERY;
+      req[1] = GADGETRON_CLOUDBUS_NODE_LIST_QUERY_V2;
 
       this->peer().send_n((char*)(&req),8);
       {
@@ -262,6 +337,9 @@ namespace Gadgetron
         n.compute_capability = 1;
         n.active_reconstructions = 0;
         n.last_recon = 0;
+        n.cpu_load = 0;
+        n.free_memory = 0;
+        n.pending_bytes = 0;
         nodes.clear();
         nodes.push_back(n);
     } else {
@@ -289,6 +367,8 @@ namespace Gadgetron
     , connected_(false)
     , reader_task_(0)
     , use_lb_endpoint_(false)
+    , cpu_busy_(0)
+    , cpu_total_(0)
   {
     node_info_.port = gadgetron_port_;
     node_info_.rest_port = rest_port_;
@@ -301,6 +381,10 @@ namespace Gadgetron
     node_info_.active_reconstructions = 0;
     auto t = std::chrono::system_clock::now() - std::chrono::seconds(5*60);
     node_info_.last_recon = std::chrono::system_clock::to_time_t(t);
+    node_info_.cpu_load = 0;
+    node_info_.free_memory = 0;
+    node_info_.pending_bytes = 0;
+    update_load();
   }
 
 }
@@ -25,6 +25,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 
 #define GADGETRON_DEFAULT_RELAY_ADDR "localhost"
 #define GADGETRON_DEFAULT_RELAY_PORT 8002
@@ -85,6 +86,9 @@ namespace Gadgetron
     
     void set_compute_capability(uint32_t c);
 
+    ///Function returning the bytes queued in the running reconstructions, reported with the node load
+    void set_pending_bytes_function(std::function<uint64_t()> f);
+
     void send_node_info();    
     void update_node_info();
     void get_node_info(std::vector<GadgetronNodeInfo>& nodes);
@@ -114,7 +118,14 @@ namespace Gadgetron
     std::string lb_address_;
     uint32_t lb_port_;
 
+    ///Refresh the load metrics of node_info_, called with info_mtx_ held
+    void update_load();
+
     GadgetronNodeInfo node_info_;
+    std::mutex info_mtx_; //Guards node_info_ and the sending on the socket
+    std::function<uint64_t()> pending_bytes_function_;
+    uint64_t cpu_busy_;   //CPU time counters at the previous load update
+    uint64_t cpu_total_;
     std::vector<GadgetronNodeInfo> nodes_;
     
     std::mutex mtx_;
@@ -3,24 +3,33 @@
 
 namespace Gadgetron
 {
-  size_t calculate_node_info_length(GadgetronNodeInfo& n)
+  size_t calculate_node_info_length(GadgetronNodeInfo& n, uint32_t version)
   {
     size_t len = 0;
+    if (version > 1) len += 2*sizeof(uint32_t); //record length and version
     len += 4 + n.uuid.size();
     len += 4 + n.address.size();
     len += 4*sizeof(uint32_t);
     len += sizeof(std::time_t);
+    if (version > 1) len += sizeof(uint32_t) + 2*sizeof(uint64_t);
     return len;
   }
   
-  size_t serialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len)
+  size_t serialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len, uint32_t version)
   {
     size_t pos = 0;
+    size_t len = calculate_node_info_length(n, version);
     
-    if (buf_len < calculate_node_info_length(n)) {
+    if (buf_len < len) {
       throw std::runtime_error("Provided buffer is too short for serialization");
     }
     
+    if (version > 1) {
+      //The length counts the bytes following it
+      *((uint32_t*)(buffer + pos)) = len - 4; pos += 4;
+      *((uint32_t*)(buffer + pos)) = GADGETRON_NODE_INFO_VERSION; pos += 4;
+    }
+
     *((uint32_t*)(buffer + pos)) = n.uuid.size(); pos += 4;
     memcpy ((buffer+pos), n.uuid.c_str(), n.uuid.size() ); pos += n.uuid.size();
 
@@ -32,20 +41,38 @@ namespace Gadgetron
     *((uint32_t*)(buffer + pos)) = n.compute_capability; pos += 4;
     *((uint32_t*)(buffer + pos)) = n.active_reconstructions; pos += 4;
     *((std::time_t*)(buffer + pos)) = n.last_recon; pos += sizeof(std::time_t);
+
+    if (version > 1) {
+      *((uint32_t*)(buffer + pos)) = n.cpu_load; pos += 4;
+      *((uint64_t*)(buffer + pos)) = n.free_memory; pos += 8;
+      *((uint64_t*)(buffer + pos)) = n.pending_bytes; pos += 8;
+    }
     
     return pos;
   }
 
-  size_t deserialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len)
+  size_t deserialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len, uint32_t version)
   {
     size_t pos = 0;
-    
-    if (buf_len < 16) throw std::runtime_error("Provided buffer is too small to hold node info");
+    size_t record_len = buf_len;
+
+    if (version > 1) {
+      if (buf_len < 8) throw std::runtime_error("Provided buffer is too small to hold node info");
+
+      record_len = *((uint32_t*)(buffer+pos)) + 4; pos += 4;
+      version = *((uint32_t*)(buffer+pos)); pos += 4;
 
+      if (record_len > buf_len) throw std::runtime_error("Node info record is longer than the provided buffer");
+      if (version < 2) throw std::runtime_error("Unknown node info version");
+    }
+
+    if (pos + 4 > record_len) throw std::runtime_error("Node info record is truncated");
     size_t uuid_size = *((uint32_t*)(buffer+pos)); pos += 4;
+    if (pos + uuid_size + 4 > record_len) throw std::runtime_error("Node info record is truncated");
     n.uuid = std::string(buffer+pos,uuid_size); pos += uuid_size;
 
     size_t address_size = *((uint32_t*)(buffer+pos)); pos += 4;
+    if (pos + address_size + 4*sizeof(uint32_t) + sizeof(std::time_t) > record_len) throw std::runtime_error("Node info record is truncated");
     n.address = std::string(buffer+pos,address_size); pos += address_size;
 
     n.port = *((uint32_t*)(buffer+pos)); pos += 4;
@@ -53,24 +80,37 @@ namespace Gadgetron
     n.compute_capability = *((uint32_t*)(buffer+pos)); pos += 4;
     n.active_reconstructions = *((uint32_t*)(buffer+pos)); pos += 4;
     n.last_recon = *((std::time_t*)(buffer+pos)); pos += sizeof(std::time_t);
-    return pos;
+
+    //Load fields are unknown for nodes sending the legacy record
+    n.cpu_load = 0;
+    n.free_memory = 0;
+    n.pending_bytes = 0;
+    if (version < 2) return pos;
+
+    if (pos + 4 + 2*8 > record_len) throw std::runtime_error("Node info record is truncated");
+    n.cpu_load = *((uint32_t*)(buffer+pos)); pos += 4;
+    n.free_memory = *((uint64_t*)(buffer+pos)); pos += 8;
+    n.pending_bytes = *((uint64_t*)(buffer+pos)); pos += 8;
+
+    //Skip the fields of newer versions
+    return record_len;
   }
 
 
-  size_t calculate_node_info_list_length(std::vector<GadgetronNodeInfo>& nl)
+  size_t calculate_node_info_list_length(std::vector<GadgetronNodeInfo>& nl, uint32_t version)
   {
     size_t length = 0;
     for (std::vector<GadgetronNodeInfo>::iterator it = nl.begin();
 	 it != nl.end(); it++)
       {
-	length += calculate_node_info_length(*it);
+	length += calculate_node_info_length(*it, version);
       }
     return length;
   }
   
-  size_t serialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len)
+  size_t serialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len, uint32_t version)
   {
-    size_t serialized_length = calculate_node_info_list_length(nl);
+    size_t serialized_length = calculate_node_info_list_length(nl, version);
     if ((serialized_length+4) > buf_len) throw std::runtime_error("Buffer too short for serializing node info list");
 
     *((uint32_t*)buffer) = nl.size();
@@ -80,14 +120,14 @@ namespace Gadgetron
     for (std::vector<GadgetronNodeInfo>::iterator it = nl.begin();
 	 it != nl.end(); it++)
       {
-	pos += serialize(*it,buffer+pos,buf_len-pos);
+	pos += serialize(*it,buffer+pos,buf_len-pos,version);
       }
 
     return pos;
   }
 
 
-  size_t deserialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len)
+  size_t deserialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len, uint32_t version)
   {
     nl.clear();
     size_t pos = 0;
@@ -97,7 +137,7 @@ namespace Gadgetron
     
     for (unsigned int i = 0; i < num_nodes; i++) {
       GadgetronNodeInfo n;
-      pos += deserialize(n,buffer+pos,buf_len-pos);
+      pos += deserialize(n,buffer+pos,buf_len-pos,version);
       nl.push_back(n);
     }
     
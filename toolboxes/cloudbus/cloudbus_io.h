@@ -19,9 +19,23 @@ namespace Gadgetron
     GADGETRON_CLOUDBUS_NODE_INFO = 1,
     GADGETRON_CLOUDBUS_NODE_LIST_QUERY = 2,
     GADGETRON_CLOUDBUS_NODE_LIST_REPLY = 3,
+    GADGETRON_CLOUDBUS_NODE_INFO_V2 = 4,
+    GADGETRON_CLOUDBUS_NODE_LIST_QUERY_V2 = 5,
+    GADGETRON_CLOUDBUS_NODE_LIST_REPLY_V2 = 6,
     GADGETRON_CLOUDBUS_MESSAGE_MAX
   };
   
+  /**
+     Version of the node info record.
+
+     Version 1 is the record of the original messages, it has no prefix and ends with last_recon.
+     The _V2 messages carry records that start with their length and version. Version 2 adds the
+     load fields; later versions only append fields, and readers skip the fields they do not know.
+
+     The relay answers both kinds of messages, so nodes of either kind can share an upgraded relay.
+   */
+  const uint32_t GADGETRON_NODE_INFO_VERSION = 2;
+
   struct EXPORTCLOUDBUS GadgetronNodeInfo
   {
     std::string uuid;
@@ -31,17 +45,21 @@ namespace Gadgetron
     uint32_t compute_capability;
     uint32_t active_reconstructions;
     std::time_t last_recon;
+    uint32_t cpu_load;      //CPU utilisation in percent of all cores since the last heartbeat
+    uint64_t free_memory;   //Available memory in bytes, 0 if unknown
+    uint64_t pending_bytes; //Bytes queued in the running reconstructions
   };
 
-  EXPORTCLOUDBUS size_t calculate_node_info_length(GadgetronNodeInfo& n);
+  //With version 1 the record is read and written without prefix, otherwise the record carries its own version
+  EXPORTCLOUDBUS size_t calculate_node_info_length(GadgetronNodeInfo& n, uint32_t version = GADGETRON_NODE_INFO_VERSION);
 
-  EXPORTCLOUDBUS size_t serialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len);
-  EXPORTCLOUDBUS size_t deserialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len);
+  EXPORTCLOUDBUS size_t serialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len, uint32_t version = GADGETRON_NODE_INFO_VERSION);
+  EXPORTCLOUDBUS size_t deserialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len, uint32_t version = GADGETRON_NODE_INFO_VERSION);
 
-  EXPORTCLOUDBUS size_t calculate_node_info_list_length(std::vector<GadgetronNodeInfo>& nl);
+  EXPORTCLOUDBUS size_t calculate_node_info_list_length(std::vector<GadgetronNodeInfo>& nl, uint32_t version = GADGETRON_NODE_INFO_VERSION);
 
-  EXPORTCLOUDBUS size_t serialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len);
-  EXPORTCLOUDBUS size_t deserialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len);
+  EXPORTCLOUDBUS size_t serialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len, uint32_t version = GADGETRON_NODE_INFO_VERSION);
+  EXPORTCLOUDBUS size_t deserialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len, uint32_t version = GADGETRON_NODE_INFO_VERSION);
 }
 
 #endif
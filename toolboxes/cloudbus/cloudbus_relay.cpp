@@ -68,8 +68,9 @@ namespace Gadgetron{
       auto t = std::chrono::system_clock::from_time_t(n.last_recon);
       std::chrono::duration<double> time_since_last_recon =
 	std::chrono::system_clock::now() - t;
-      GDEBUG("Adding node: %s, %s, %d, (active reconstructions: %d, last recon %f s)\n",
-	     n.uuid.c_str(), n.address.c_str(), n.port, n.active_reconstructions, time_since_last_recon.count());
+      GDEBUG("Adding node: %s, %s, %d, (active reconstructions: %d, last recon %f s, cpu load %d%%, free memory %llu MB)\n",
+	     n.uuid.c_str(), n.address.c_str(), n.port, n.active_reconstructions, time_since_last_recon.count(),
+	     n.cpu_load, (unsigned long long)(n.free_memory >> 20));
       node_map_[c] = n;
       mtx_.release();
     }
@@ -164,8 +165,10 @@ namespace Gadgetron{
 
       switch (msg_id) {
       case (GADGETRON_CLOUDBUS_NODE_INFO):
+      case (GADGETRON_CLOUDBUS_NODE_INFO_V2):
 
-	deserialize(n,buffer+4,msg_size-4);
+	//Nodes sending the original message report no load
+	deserialize(n,buffer+4,msg_size-4,(msg_id == GADGETRON_CLOUDBUS_NODE_INFO) ? 1 : GADGETRON_NODE_INFO_VERSION);
 
 	//We will change the host name to the actually connected peer address since the relay host may not be able to resolve the host name
 	if (peer().get_remote_addr (peer_addr) == 0) {
@@ -175,15 +178,20 @@ namespace Gadgetron{
 	this->acceptor_->add_node(this,n);
 	break;
       case (GADGETRON_CLOUDBUS_NODE_LIST_QUERY):
+      case (GADGETRON_CLOUDBUS_NODE_LIST_QUERY_V2):
 	{
+	  //The reply has the format of the query
+	  bool v2 = (msg_id == GADGETRON_CLOUDBUS_NODE_LIST_QUERY_V2);
+	  uint32_t version = v2 ? GADGETRON_NODE_INFO_VERSION : 1;
+
 	  //Get list of all nodes except myself
 	  this->acceptor_->get_node_list(nl,this);
-	  size_t buf_len = calculate_node_info_list_length(nl) + 4;
+	  size_t buf_len = calculate_node_info_list_length(nl,version) + 4;
 	  char* buffer = new char[buf_len+8];
 	  *((uint32_t*)buffer) = buf_len+4;
-	  *((uint32_t*)(buffer+4)) = GADGETRON_CLOUDBUS_NODE_LIST_REPLY;
+	  *((uint32_t*)(buffer+4)) = v2 ? GADGETRON_CLOUDBUS_NODE_LIST_REPLY_V2 : GADGETRON_CLOUDBUS_NODE_LIST_REPLY;
 	  try {
-	    serialize(nl,buffer+8,buf_len);
+	    serialize(nl,buffer+8,buf_len,version);
 	    this->peer().send_n(buffer,buf_len+8);
 	  } catch (...) {
 	    GERROR("Error serializing and sending node list\n");
@@ -312,6 +320,9 @@ int main(int argc, char** argv)
 				     out["nodes"][idx]["rest_port"] = n.rest_port;
 				     out["nodes"][idx]["compute_capability"] = n.compute_capability;
 				     out["nodes"][idx]["active_reconstructions"] = n.active_reconstructions;
+				     out["nodes"][idx]["cpu_load"] = n.cpu_load;
+				     out["nodes"][idx]["free_memory"] = n.free_memory;
+				     out["nodes"][idx]["pending_bytes"] = n.pending_bytes;
 				     auto t = std::chrono::system_clock::from_time_t(n.last_recon);
 				     std::chrono::duration<double> time_since_last_recon =
 				       std::chrono::system_clock::now() - t;
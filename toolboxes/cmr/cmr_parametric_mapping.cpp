@@ -188,6 +188,9 @@ CmrParametricMapping<T>::CmrParametricMapping()
 
     max_map_value_ = -1;
 
+    use_batched_fitting_ = false;
+    batch_size_ = 64;
+
     verbose_ = false;
     perform_timing_ = false;
 
@@ -264,31 +267,129 @@ void CmrParametricMapping<T>::perform_parametric_mapping()
             {
                 T* pData = &data_(0, 0, 0, s, slc);
 
-                T* pMap = &map_(0, 0, s, slc);
-                T* pPara = &para_(0, 0, 0, s, slc);
-
-                T* pMapSD = NULL;
-                T* pParaSD = NULL;
-                if (this->compute_SD_maps_)
-                {
-                    pMapSD = &sd_map_(0, 0, s, slc);
-                    pParaSD = &sd_para_(0, 0, 0, s, slc);
-                }
-
                 T* pMaskCurr = NULL;
                 if (pMask != NULL)
                 {
                     pMaskCurr = pMask + s*RO*E1 + slc*S*RO*E1;
                 }
 
-#pragma omp parallel private(e1, ro, n) shared(RO, E1, pMask, pMaskCurr, pData, pMap, pMapSD, pPara, pParaSD, num_ti, NUM)
+                if (this->use_batched_fitting_)
+                {
+                    // pixels to be mapped, fitted in blocks of batch_size_ pixels
+                    std::vector<long long> pixels;
+                    pixels.reserve(RO*E1);
+
+                    for (e1 = 0; e1 < E1; e1++)
+                    {
+                        for (ro = 0; ro < RO; ro++)
+                        {
+                            long long offset = ro + e1*RO;
+                            if (pMask != NULL && pMaskCurr[offset] <= 0) continue;
+                            pixels.push_back(offset);
+                        }
+                    }
+
+                    long long num_pixels = (long long)pixels.size();
+                    long long L = (long long)((this->batch_size_ > 0) ? this->batch_size_ : 1);
+                    long long num_blocks = (num_pixels + L - 1) / L;
+
+                    long long b;
+
+#pragma omp parallel private(b, n) shared(s, slc, RO, E1, pixels, pData, num_ti, NUM, num_pixels, L, num_blocks)
+                    {
+                        std::vector<T> yi(num_ti, 0);
+                        std::vector<T> guess(NUM + 1, 0);
+                        std::vector<T> bi(NUM + 1, 0);
+                        std::vector<T> sd(NUM + 1, 0);
+
+                        std::vector<T> y_batch, guess_batch, b_batch, map_batch;
+
+                        T map_v(0);
+
+#pragma omp for schedule(dynamic)
+                        for (b = 0; b < num_blocks; b++)
+                        {
+                            size_t start = (size_t)(b*L);
+                            size_t num = (size_t)std::min(L, num_pixels - b*L);
+
+                            y_batch.resize(num*num_ti);
+                            guess_batch.resize(num*NUM);
+                            map_batch.resize(num);
+
+                            size_t l;
+                            for (l = 0; l < num; l++)
+                            {
+                                long long offset = pixels[start + l];
+
+                                for (n = 0; n < num_ti; n++)
+                                {
+                                    yi[n] = pData[offset + n*RO*E1];
+                                    y_batch[l + n*num] = yi[n];
+                                }
+
+                                this->get_initial_guess(ti_, yi, guess);
+
+                                for (n = 0; n < NUM; n++)
+                                {
+                                    guess_batch[l + n*num] = guess[n];
+                                }
+                            }
+
+                            // a block that fails to fit is mapped again pixel by pixel, from the same initial guesses
+                            b_batch = guess_batch;
+
+                            bool batched = false;
+                            try
+                            {
+                                batched = this->compute_map_batch(ti_, y_batch, num, b_batch, map_batch);
+                            }
+                            catch(...)
+                            {
+                                batched = false;
+                            }
+
+                            for (l = 0; l < num; l++)
+                            {
+                                for (n = 0; n < num_ti; n++)
+                                {
+                                    yi[n] = y_batch[l + n*num];
+                                }
+
+                                if (batched)
+                                {
+                                    bi.resize(NUM);
+                                    for (n = 0; n < NUM; n++)
+                                    {
+                                        bi[n] = b_batch[l + n*num];
+                                    }
+
+                                    map_v = map_batch[l];
+                                }
+                                else
+                                {
+                                    guess.resize(NUM);
+                                    for (n = 0; n < NUM; n++)
+                                    {
+                                        guess[n] = guess_batch[l + n*num];
+                                    }
+                                }
+
+                                this->map_pixel(yi, guess, !batched, bi, map_v, sd, (size_t)pixels[start + l], s, slc);
+                            }
+                        }
+                    } // openmp
+
+                    continue;
+                }
+
+#pragma omp parallel private(e1, ro, n) shared(s, slc, RO, E1, pMask, pMaskCurr, pData, num_ti, NUM)
                 {
                     std::vector<T> yi(num_ti, 0);
                     std::vector<T> guess(NUM + 1, 0);
                     std::vector<T> bi(NUM + 1, 0);
                     std::vector<T> sd(NUM + 1, 0);
 
-                    T map_v(0), map_sd(0);
+                    T map_v(0);
 
 #pragma omp for 
                     for (e1 = 0; e1 < E1; e1++)
@@ -313,37 +414,7 @@ void CmrParametricMapping<T>::perform_parametric_mapping()
                             this->get_initial_guess(ti_, yi, guess);
 
                             // perform mapping
-                            this->compute_map(ti_, yi, guess, bi, map_v);
-
-                            pMap[offset] = map_v;
-                            for (n = 0; n < NUM; n++)
-                            {
-                                pPara[offset + n*RO*E1] = bi[n];
-                            }
-
-                            // compute SD if needed
-                            if (this->compute_SD_maps_)
-                            {
-                                try
-                                {
-                                    this->compute_sd(ti_, yi, bi, sd, map_sd);
-                                }
-                                catch(...)
-                                {
-                                    for (n = 0; n < NUM; n++)
-                                    {
-                                        sd[n] = 0;
-                                    }
-
-                                    map_sd = 0;
-                                }
-
-                                pMapSD[offset] = map_sd;
-                                for (n = 0; n < NUM; n++)
-                                {
-                                    pParaSD[offset + n*RO*E1] = sd[n];
-                                }
-                            }
+                            this->map_pixel(yi, guess, true, bi, map_v, sd, (size_t)offset, s, slc);
                         }
                     }
                 } // openmp
@@ -408,6 +479,65 @@ void CmrParametricMapping<T>::compute_map(const std::vector<T>& ti, const std::v
     map_v = 0;
 }
 
+template <typename T>
+bool CmrParametricMapping<T>::compute_map_batch(const VectorType& ti, const VectorType& yi, size_t L, VectorType& bi, VectorType& map_v)
+{
+    return false;
+}
+
+template <typename T>
+void CmrParametricMapping<T>::map_pixel(const VectorType& yi, const VectorType& guess, bool fit, VectorType& bi, T& map_v, VectorType& sd, size_t offset, size_t s, size_t slc)
+{
+    size_t n;
+
+    size_t RO = map_.get_size(0);
+    size_t E1 = map_.get_size(1);
+    size_t NUM = this->get_num_of_paras();
+
+    if (fit)
+    {
+        this->compute_map(ti_, yi, guess, bi, map_v);
+    }
+
+    T* pMap = &map_(0, 0, s, slc);
+    T* pPara = &para_(0, 0, 0, s, slc);
+
+    pMap[offset] = map_v;
+    for (n = 0; n < NUM; n++)
+    {
+        pPara[offset + n*RO*E1] = bi[n];
+    }
+
+    // compute SD if needed
+    if (this->compute_SD_maps_)
+    {
+        T map_sd(0);
+
+        try
+        {
+            this->compute_sd(ti_, yi, bi, sd, map_sd);
+        }
+        catch(...)
+        {
+            for (n = 0; n < NUM; n++)
+            {
+                sd[n] = 0;
+            }
+
+            map_sd = 0;
+        }
+
+        T* pMapSD = &sd_map_(0, 0, s, slc);
+        T* pParaSD = &sd_para_(0, 0, 0, s, slc);
+
+        pMapSD[offset] = map_sd;
+        for (n = 0; n < NUM; n++)
+        {
+            pParaSD[offset + n*RO*E1] = sd[n];
+        }
+    }
+}
+
 template <typename T>
 void CmrParametricMapping<T>::compute_sd(const std::vector<T>& ti, const std::vector<T>& yi, const std::vector<T>& bi, std::vector<T>& sd, T& map_sd)
 {
@@ -105,6 +105,12 @@ namespace Gadgetron {
         /// maximal valid value of map
         T max_map_value_;
 
+        /// whether to fit blocks of pixels together with compute_map_batch
+        /// if the mapping does not support batched fitting, compute_map is called for every pixel
+        bool use_batched_fitting_;
+        /// number of pixels fitted together in batched fitting
+        size_t batch_size_;
+
         // ======================================================================================
         /// parameter for debugging
         // ======================================================================================
@@ -133,6 +139,16 @@ namespace Gadgetron {
         /// compute map values for every parameters in bi
         virtual void compute_map(const VectorType& ti, const VectorType& yi, const VectorType& guess, VectorType& bi, T& map_v);
 
+        /// compute map values for L pixels together
+        /// yi: [L num_ti], bi: [L NUM], the pixel index runs fastest
+        /// bi holds the initial guess on input and the fitted parameters on output; map_v has L values
+        /// return false if batched fitting is not supported by this mapping
+        virtual bool compute_map_batch(const VectorType& ti, const VectorType& yi, size_t L, VectorType& bi, VectorType& map_v);
+
+        /// store map_v and bi for pixel offset of [s slc] and compute its SD if needed
+        /// if fit is true, bi and map_v are fitted from guess first
+        void map_pixel(const VectorType& yi, const VectorType& guess, bool fit, VectorType& bi, T& map_v, VectorType& sd, size_t offset, size_t s, size_t slc);
+
         /// compute SD values for every parameters in bi
         virtual void compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd);
 
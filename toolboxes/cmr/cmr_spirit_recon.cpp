@@ -9,7 +9,7 @@
 #include "mri_core_spirit.h"
 #include "hoNDArray_reductions.h"
 #include "hoNDFFT.h"
-#include "hoSPIRIT2DOperator.h"
+#include "hoSPIRIT2DImageDomainOperator.h"
 #include "hoLsqrSolver.h"
 #include "hoSPIRIT2DTDataFidelityOperator.h"
 #include "hoWavelet2DTOperator.h"
@@ -76,8 +76,8 @@ namespace Gadgetron {
 
 #pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, CHA, dim, startE1, endE1, ref_N, ref_S, kspace, res, kspace_Shifted, ker_Shifted, kspace_initial_Shifted, hasInitial, iter_max, iter_thres, print_iter) num_threads(numThreads) if(num>1) 
             {
-                boost::shared_ptr< hoSPIRIT2DOperator< T > > oper(new hoSPIRIT2DOperator< T >(&dim));
-                hoSPIRIT2DOperator< T >& spirit = *oper;
+                boost::shared_ptr< hoSPIRIT2DImageDomainOperator< T > > oper(new hoSPIRIT2DImageDomainOperator< T >(&dim));
+                hoSPIRIT2DImageDomainOperator< T >& spirit = *oper;
                 spirit.use_non_centered_fft_ = true;
                 spirit.no_null_space_ = false;
 
@@ -93,6 +93,9 @@ namespace Gadgetron {
                 cgSolver.set_output_mode(print_iter ? hoLsqrSolver< T >::OUTPUT_VERBOSE : hoLsqrSolver< T >::OUTPUT_SILENT);
                 cgSolver.set_encoding_operator(oper);
 
+                cgSolver.set_keep_workspace(true);
+                cgSolver.set_use_fused_kernels(true);
+
                 hoNDArray< T > b(RO, E1, CHA);
                 hoNDArray< T > unwarppedKSpace(RO, E1, CHA);
 
@@ -164,6 +167,8 @@ namespace Gadgetron {
                 }
             }
 
+            hoSPIRIT2DImageDomainOperator< T >::release_unused_kernels();
+
             Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->fftshift2D(res, kspace_Shifted);
             res = kspace_Shifted;
         }
@@ -11,6 +11,7 @@
 #include "hoNDArray_math.h"
 
 #include "simplexLagariaSolver.h"
+#include "batchedLevenbergMarquardtSolver.h"
 #include "twoParaExpRecoveryOperator.h"
 #include "curveFittingCostFunction.h"
 
@@ -96,6 +97,46 @@ void CmrT1SRMapping<T>::compute_map(const VectorType& ti, const VectorType& yi,
     }
 }
 
+template <typename T>
+bool CmrT1SRMapping<T>::compute_map_batch(const VectorType& ti, const VectorType& yi, size_t L, VectorType& bi, VectorType& map_v)
+{
+    try
+    {
+        size_t num = ti.size();
+
+        GADGET_CHECK_THROW(yi.size() >= L*num);
+        GADGET_CHECK_THROW(bi.size() >= L*this->get_num_of_paras());
+
+        map_v.resize(L);
+        if (L == 0) return true;
+
+        // define solver, bi holds the guess
+        Gadgetron::batchedLevenbergMarquardtSolver< T, Gadgetron::twoParaExpRecoveryModel<T> > solver(thres_fun_, max_iter_);
+        solver.solve(&ti[0], num, &yi[0], L, &bi[0]);
+
+        size_t l;
+        for (l = 0; l < L; l++)
+        {
+            map_v[l] = 0;
+
+            T A = bi[l];
+            T T1 = bi[l + L];
+
+            if (A > 0 && T1 > 0)
+            {
+                map_v[l] = T1;
+                if (map_v[l] > max_map_value_) map_v[l] = hole_marking_value_;
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Exceptions happened in CmrT1SRMapping<T>::compute_map_batch(...) ... ");
+    }
+
+    return true;
+}
+
 template <typename T>
 void CmrT1SRMapping<T>::compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd)
 {
@@ -46,6 +46,9 @@ public:
     /// compute map values for every parameters in bi
     virtual void compute_map(const VectorType& ti, const VectorType& yi, const VectorType& guess, VectorType& bi, T& map_v);
 
+    /// compute map values for L pixels together, with the Levenberg-Marquardt solver
+    virtual bool compute_map_batch(const VectorType& ti, const VectorType& yi, size_t L, VectorType& bi, VectorType& map_v);
+
     /// compute SD values for every parameters in bi
     virtual void compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd);
 
@@ -71,6 +74,8 @@ public:
     using BaseClass::max_fun_eval_;
     using BaseClass::thres_fun_;
     using BaseClass::max_map_value_;
+    using BaseClass::use_batched_fitting_;
+    using BaseClass::batch_size_;
 
     using BaseClass::verbose_;
     using BaseClass::debug_folder_;
@@ -0,0 +1,434 @@
+#include "hoMemoryPool.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+namespace Gadgetron{
+
+    namespace
+    {
+        const size_t HEADER_BYTES = 64;
+        const size_t MIN_CLASS_SHIFT = 6;
+        const size_t MAX_CLASS_SHIFT = 30;
+        const size_t NUM_CLASSES = (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT) * 4 + 1;
+        const size_t HUGE_PAGE_BYTES = (size_t)1 << 21;
+        const size_t NO_CLASS = (size_t)-1;
+
+        // Placed in front of every pool block, and only pool blocks; callers tell deallocate() which blocks came from the pool
+        struct BlockHeader
+        {
+            size_t size_class;
+            size_t block_bytes;
+            size_t system_bytes;
+            size_t mapped;
+            char padding[HEADER_BYTES - 4*sizeof(size_t)];
+        };
+
+        static_assert(sizeof(BlockHeader) == HEADER_BYTES, "hoMemoryPool block header must be 64 bytes");
+
+        // Four size classes per power of two, from 64 bytes to 1GB
+        size_t class_index(size_t bytes)
+        {
+            if (bytes <= ((size_t)1 << MIN_CLASS_SHIFT)) return 0;
+
+            size_t n = bytes - 1;
+            size_t k = 0;
+            while ((n >> (k + 1)) != 0) k++;
+
+            if (k >= MAX_CLASS_SHIFT) return NO_CLASS;
+
+            size_t base = (size_t)1 << k;
+            size_t quarter = base >> 2;
+            size_t j = (bytes - base + quarter - 1) / quarter;
+
+            return (k - MIN_CLASS_SHIFT) * 4 + j;
+        }
+
+        size_t class_bytes(size_t c)
+        {
+            size_t k = MIN_CLASS_SHIFT + c / 4;
+            size_t j = c % 4;
+            return ((size_t)1 << k) + j * ((size_t)1 << (k - 2));
+        }
+
+        void* aligned_system_malloc(size_t bytes)
+        {
+#ifdef WIN32
+            return _aligned_malloc(bytes, HEADER_BYTES);
+#else
+            void* mem = NULL;
+            if (posix_memalign(&mem, HEADER_BYTES, bytes) != 0) return NULL;
+            return mem;
+#endif
+        }
+
+        void aligned_system_free(void* mem)
+        {
+#ifdef WIN32
+            _aligned_free(mem);
+#else
+            free(mem);
+#endif
+        }
+
+        BlockHeader* system_allocate(size_t block_bytes, bool use_huge_pages)
+        {
+            size_t system_bytes = block_bytes + HEADER_BYTES;
+            void* mem = NULL;
+            size_t mapped = 0;
+
+#if defined(__linux__)
+            if (use_huge_pages && system_bytes >= HUGE_PAGE_BYTES)
+            {
+                size_t mapped_bytes = (system_bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+                mem = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED)
+                {
+                    mem = NULL;
+                }
+                else
+                {
+#ifdef MADV_HUGEPAGE
+                    madvise(mem, mapped_bytes, MADV_HUGEPAGE);
+#endif
+                    system_bytes = mapped_bytes;
+                    mapped = 1;
+                }
+            }
+#endif
+
+            if (!mem)
+            {
+                mem = aligned_system_malloc(system_bytes);
+                if (!mem) return NULL;
+            }
+
+            BlockHeader* h = static_cast<BlockHeader*>(mem);
+            h->size_class = NO_CLASS;
+            h->block_bytes = block_bytes;
+            h->system_bytes = system_bytes;
+            h->mapped = mapped;
+            return h;
+        }
+
+        void system_release(BlockHeader* h)
+        {
+#if defined(__linux__)
+            if (h->mapped)
+            {
+                munmap(h, h->system_bytes);
+                return;
+            }
+#endif
+            aligned_system_free(h);
+        }
+
+        struct ClassList
+        {
+            std::mutex mutex;
+            std::vector<BlockHeader*> blocks;
+        };
+
+        struct ThreadCache;
+
+        struct PoolState
+        {
+            std::atomic<bool> enabled;
+            std::atomic<bool> use_huge_pages;
+            std::atomic<size_t> max_cached_bytes;
+            std::atomic<size_t> max_thread_cached_bytes;
+
+            std::atomic<size_t> bytes_in_use;
+            std::atomic<size_t> high_water_mark;
+            std::atomic<size_t> bytes_cached;
+            std::atomic<size_t> blocks_in_use;
+
+            ClassList lists[NUM_CLASSES];
+
+            // caches of all running threads, so trim() can empty them
+            std::mutex thread_caches_mutex;
+            std::set<ThreadCache*> thread_caches;
+
+            PoolState()
+            {
+                bool enable = false;
+                const char* env = std::getenv("GADGETRON_MEMORY_POOL");
+                if (env)
+                {
+                    std::string v(env);
+                    enable = (v == "1" || v == "true" || v == "TRUE" || v == "on" || v == "ON");
+                }
+
+                enabled = enable;
+                use_huge_pages = true;
+                max_cached_bytes = (size_t)1 << 30;
+                max_thread_cached_bytes = (size_t)1 << 26;
+
+                bytes_in_use = 0;
+                high_water_mark = 0;
+                bytes_cached = 0;
+                blocks_in_use = 0;
+            }
+        };
+
+        // Never destroyed, since thread caches flush into it when threads exit during process shutdown
+        PoolState& pool_state()
+        {
+            static PoolState* state = new PoolState();
+            return *state;
+        }
+
+        thread_local bool thread_cache_destroyed = false;
+
+        // Owned by one thread; the mutex is only contended while trim() empties the cache from another thread
+        struct ThreadCache
+        {
+            std::mutex mutex;
+            std::vector<BlockHeader*> lists[NUM_CLASSES];
+            size_t bytes;
+
+            ThreadCache() : bytes(0)
+            {
+                PoolState& s = pool_state();
+                std::lock_guard<std::mutex> guard(s.thread_caches_mutex);
+                s.thread_caches.insert(this);
+            }
+
+            ~ThreadCache()
+            {
+                {
+                    PoolState& s = pool_state();
+                    std::lock_guard<std::mutex> guard(s.thread_caches_mutex);
+                    s.thread_caches.erase(this);
+                }
+
+                std::lock_guard<std::mutex> guard(mutex);
+                this->release_all(false);
+                thread_cache_destroyed = true;
+            }
+
+            // hand all blocks to the process cache, or to the system if to_system is set or the process cache is full;
+            // called with mutex held
+            void release_all(bool to_system)
+            {
+                PoolState& s = pool_state();
+
+                for (size_t c = 0; c < NUM_CLASSES; c++)
+                {
+                    for (size_t n = 0; n < lists[c].size(); n++)
+                    {
+                        BlockHeader* h = lists[c][n];
+
+                        if (!to_system && s.bytes_cached.load() <= s.max_cached_bytes.load())
+                        {
+                            std::lock_guard<std::mutex> guard(s.lists[c].mutex);
+                            s.lists[c].blocks.push_back(h);
+                            continue;
+                        }
+
+                        s.bytes_cached -= h->block_bytes;
+                        system_release(h);
+                    }
+                    lists[c].clear();
+                }
+
+                bytes = 0;
+            }
+        };
+
+        ThreadCache* thread_cache()
+        {
+            if (thread_cache_destroyed) return NULL;
+            thread_local ThreadCache cache;
+            return &cache;
+        }
+    }
+
+    void* hoMemoryPool::allocate(size_t bytes, bool& pooled)
+    {
+        PoolState& s = pool_state();
+
+        pooled = false;
+        if (!s.enabled.load(std::memory_order_relaxed))
+        {
+            return malloc(bytes);
+        }
+
+        size_t c = class_index(bytes);
+        BlockHeader* h = NULL;
+
+        if (c != NO_CLASS)
+        {
+            ThreadCache* tc = thread_cache();
+            if (tc)
+            {
+                std::lock_guard<std::mutex> guard(tc->mutex);
+                if (!tc->lists[c].empty())
+                {
+                    h = tc->lists[c].back();
+                    tc->lists[c].pop_back();
+                    tc->bytes -= h->block_bytes;
+                }
+            }
+
+            if (!h)
+            {
+                std::lock_guard<std::mutex> guard(s.lists[c].mutex);
+                if (!s.lists[c].blocks.empty())
+                {
+                    h = s.lists[c].blocks.back();
+                    s.lists[c].blocks.pop_back();
+                }
+            }
+
+            if (h)
+            {
+                s.bytes_cached -= h->block_bytes;
+            }
+            else
+            {
+                h = system_allocate(class_bytes(c), s.use_huge_pages.load());
+                if (!h) return NULL;
+                h->size_class = c;
+            }
+        }
+        else
+        {
+            h = system_allocate(bytes, s.use_huge_pages.load());
+            if (!h) return NULL;
+        }
+
+        size_t in_use = (s.bytes_in_use += h->block_bytes);
+        s.blocks_in_use++;
+
+        size_t hwm = s.high_water_mark.load();
+        while (in_use > hwm && !s.high_water_mark.compare_exchange_weak(hwm, in_use)) {}
+
+        pooled = true;
+        return reinterpret_cast<char*>(h) + HEADER_BYTES;
+    }
+
+    void hoMemoryPool::deallocate(void* ptr, bool pooled)
+    {
+        if (!ptr) return;
+
+        if (!pooled)
+        {
+            free(ptr);
+            return;
+        }
+
+        PoolState& s = pool_state();
+
+        BlockHeader* h = reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - HEADER_BYTES);
+
+        s.bytes_in_use -= h->block_bytes;
+        s.blocks_in_use--;
+
+        if (h->size_class == NO_CLASS || !s.enabled.load(std::memory_order_relaxed))
+        {
+            system_release(h);
+            return;
+        }
+
+        ThreadCache* tc = thread_cache();
+        if (tc)
+        {
+            std::lock_guard<std::mutex> guard(tc->mutex);
+            if (tc->bytes + h->block_bytes <= s.max_thread_cached_bytes.load())
+            {
+                tc->lists[h->size_class].push_back(h);
+                tc->bytes += h->block_bytes;
+                s.bytes_cached += h->block_bytes;
+                return;
+            }
+        }
+
+        if (s.bytes_cached.load() + h->block_bytes <= s.max_cached_bytes.load())
+        {
+            std::lock_guard<std::mutex> guard(s.lists[h->size_class].mutex);
+            s.lists[h->size_class].blocks.push_back(h);
+            s.bytes_cached += h->block_bytes;
+            return;
+        }
+
+        system_release(h);
+    }
+
+    void hoMemoryPool::configure(bool enabled, size_t max_cached_bytes, size_t max_thread_cached_bytes, bool use_huge_pages)
+    {
+        PoolState& s = pool_state();
+
+        s.max_cached_bytes = max_cached_bytes;
+        s.max_thread_cached_bytes = max_thread_cached_bytes;
+        s.use_huge_pages = use_huge_pages;
+
+        s.enabled = enabled;
+
+        if (!enabled) trim();
+    }
+
+    bool hoMemoryPool::enabled()
+    {
+        return pool_state().enabled.load();
+    }
+
+    hoMemoryPool::Statistics hoMemoryPool::statistics()
+    {
+        PoolState& s = pool_state();
+
+        Statistics stats;
+        stats.bytes_in_use = s.bytes_in_use.load();
+        stats.high_water_mark = s.high_water_mark.load();
+        stats.bytes_cached = s.bytes_cached.load();
+        stats.blocks_in_use = s.blocks_in_use.load();
+        return stats;
+    }
+
+    void hoMemoryPool::reset_high_water_mark()
+    {
+        PoolState& s = pool_state();
+        s.high_water_mark = s.bytes_in_use.load();
+    }
+
+    void hoMemoryPool::trim()
+    {
+        PoolState& s = pool_state();
+
+        {
+            std::lock_guard<std::mutex> guard(s.thread_caches_mutex);
+            for (std::set<ThreadCache*>::iterator it = s.thread_caches.begin(); it != s.thread_caches.end(); ++it)
+            {
+                std::lock_guard<std::mutex> cache_guard((*it)->mutex);
+                (*it)->release_all(true);
+            }
+        }
+
+        for (size_t c = 0; c < NUM_CLASSES; c++)
+        {
+            std::vector<BlockHeader*> blocks;
+            {
+                std::lock_guard<std::mutex> guard(s.lists[c].mutex);
+                blocks.swap(s.lists[c].blocks);
+            }
+
+            for (size_t n = 0; n < blocks.size(); n++)
+            {
+                s.bytes_cached -= blocks[n]->block_bytes;
+                system_release(blocks[n]);
+            }
+        }
+    }
+}
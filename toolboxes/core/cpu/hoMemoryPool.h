@@ -0,0 +1,58 @@
+/** \file hoMemoryPool.h
+    \brief Optional size class memory pool with per-thread caches, backing the data of hoNDArray.
+
+    With the pool disabled (the default), allocate() and deallocate() are plain malloc and free.
+    With the pool enabled, requests are rounded up to one of a set of size classes (four per power of two),
+    freed blocks are kept in a per-thread cache and then in a process-wide cache, and blocks of 2MB and above
+    are mapped with transparent huge pages where the platform supports it. Counters for the bytes in use and
+    the high-water mark are kept while the pool is enabled.
+
+    The pool is enabled per process by setting the environment variable GADGETRON_MEMORY_POOL=1, or by calling
+    hoMemoryPool::configure(). It can be switched at any time. allocate() reports whether a block came from the pool,
+    and the caller passes this back to deallocate(), so blocks are always returned to whoever allocated them.
+*/
+
+#pragma once
+
+#include "cpucore_export.h"
+
+#include <cstddef>
+
+namespace Gadgetron{
+
+    class EXPORTCPUCORE hoMemoryPool
+    {
+    public:
+
+        struct Statistics
+        {
+            /// bytes held by blocks currently handed out by the pool
+            size_t bytes_in_use;
+            /// largest value of bytes_in_use since start or the last reset_high_water_mark()
+            size_t high_water_mark;
+            /// bytes held in the thread and process caches
+            size_t bytes_cached;
+            /// number of blocks currently handed out by the pool
+            size_t blocks_in_use;
+        };
+
+        /// allocate memory for bytes, 64 byte aligned if the pool is enabled; returns NULL on failure
+        /// pooled is set if the block came from the pool, otherwise it is plain malloc memory
+        static void* allocate(size_t bytes, bool& pooled);
+
+        /// release memory obtained from allocate(), with the pooled flag allocate() returned
+        static void deallocate(void* ptr, bool pooled);
+
+        /// enable or disable the pool and set its cache limits
+        static void configure(bool enabled, size_t max_cached_bytes = (size_t)1 << 30, size_t max_thread_cached_bytes = (size_t)1 << 26, bool use_huge_pages = true);
+
+        static bool enabled();
+
+        static Statistics statistics();
+
+        static void reset_high_water_mark();
+
+        /// return all cached blocks of every thread and of the process cache to the system
+        static void trim();
+    };
+}
@@ -7,6 +7,7 @@
 #include "NDArray.h"
 #include "complext.h"
 #include "vector_td.h"
+#include "hoMemoryPool.h"
 
 #include "cpucore_export.h"
 
@@ -164,14 +165,16 @@ namespace Gadgetron{
     virtual void deallocate_memory();
 
     // Generic allocator / deallocator
+    // pooled is set if the data came from hoMemoryPool, and passed back when it is released
     //
 
-    template<class X> void _allocate_memory( size_t size, X** data )
+    template<class X> void _allocate_memory( size_t size, X** data, bool& pooled )
     {
+      pooled = false;
       *data = new (std::nothrow) X[size];
     }
 
-    template<class X> void _deallocate_memory( X* data )
+    template<class X> void _deallocate_memory( X* data, bool pooled )
     {
       delete [] data;
     }
@@ -179,33 +182,38 @@ namespace Gadgetron{
     // Overload these instances to avoid invoking the element class constructor/destructor
     //
 
-    virtual void _allocate_memory( size_t size, float** data );
-    virtual void _deallocate_memory( float* data );
+    virtual void _allocate_memory( size_t size, float** data, bool& pooled );
+    virtual void _deallocate_memory( float* data, bool pooled );
 
-    virtual void _allocate_memory( size_t size, double** data );
-    virtual void _deallocate_memory( double* data );
+    virtual void _allocate_memory( size_t size, double** data, bool& pooled );
+    virtual void _deallocate_memory( double* data, bool pooled );
 
-    virtual void _allocate_memory( size_t size, std::complex<float>** data );
-    virtual void _deallocate_memory( std::complex<float>* data );
+    virtual void _allocate_memory( size_t size, std::complex<float>** data, bool& pooled );
+    virtual void _deallocate_memory( std::complex<float>* data, bool pooled );
 
-    virtual void _allocate_memory( size_t size, std::complex<double>** data );
-    virtual void _deallocate_memory( std::complex<double>* data );
+    virtual void _allocate_memory( size_t size, std::complex<double>** data, bool& pooled );
+    virtual void _deallocate_memory( std::complex<double>* data, bool pooled );
 
-    virtual void _allocate_memory( size_t size, float_complext** data );
-    virtual void _deallocate_memory( float_complext* data );
+    virtual void _allocate_memory( size_t size, float_complext** data, bool& pooled );
+    virtual void _deallocate_memory( float_complext* data, bool pooled );
 
-    virtual void _allocate_memory( size_t size, double_complext** data );
-    virtual void _deallocate_memory( double_complext* data );
+    virtual void _allocate_memory( size_t size, double_complext** data, bool& pooled );
+    virtual void _deallocate_memory( double_complext* data, bool pooled );
 
-    template<class TYPE, unsigned int D> void _allocate_memory( size_t size, vector_td<TYPE,D>** data )
+    template<class TYPE, unsigned int D> void _allocate_memory( size_t size, vector_td<TYPE,D>** data, bool& pooled )
     {
-      *data = (vector_td<TYPE,D>*) malloc( size*sizeof(vector_td<TYPE,D>) );
+      *data = (vector_td<TYPE,D>*) hoMemoryPool::allocate( size*sizeof(vector_td<TYPE,D>), pooled );
     }
 
-    template<class TYPE, unsigned int D>  void _deallocate_memory( vector_td<TYPE,D>* data )
+    template<class TYPE, unsigned int D>  void _deallocate_memory( vector_td<TYPE,D>* data, bool pooled )
     {
-      free( data );
+      hoMemoryPool::deallocate( data, pooled );
     }
+
+    // The data block allocated from hoMemoryPool, 0 if data_ was not. Data set from outside is never
+    // taken for a pool block, since it is only released to the pool while data_ still equals it;
+    // so the data of another hoNDArray is copied rather than adopted with delete_data_on_destruct.
+    T* pool_data_;
   };
 }
 
@@ -5,38 +5,38 @@
 namespace Gadgetron
 {
     template <typename T> 
-    hoNDArray<T>::hoNDArray() : NDArray<T>::NDArray() 
+    hoNDArray<T>::hoNDArray() : NDArray<T>::NDArray(), pool_data_(0) 
     {
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(std::vector<size_t> *dimensions) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(std::vector<size_t> *dimensions) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions);
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(std::vector<size_t> &dimensions) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(std::vector<size_t> &dimensions) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions);
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(boost::shared_ptr< std::vector<size_t> > dimensions) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(boost::shared_ptr< std::vector<size_t> > dimensions) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions);
     }
 
 #if __cplusplus > 199711L
-    template<class T> hoNDArray<T>::hoNDArray(std::initializer_list<size_t> dimensions){
+    template<class T> hoNDArray<T>::hoNDArray(std::initializer_list<size_t> dimensions) : pool_data_(0) {
     	this->create(dimensions);
     }
-    template<class T> hoNDArray<T>::hoNDArray(std::initializer_list<size_t> dimensions,T* data, bool delete_data_on_destruct ){
+    template<class T> hoNDArray<T>::hoNDArray(std::initializer_list<size_t> dimensions,T* data, bool delete_data_on_destruct ) : pool_data_(0) {
     	this->create(dimensions,data,delete_data_on_destruct);
     }
 #endif
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t len) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t len) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(1);
         dim[0] = len;
@@ -44,7 +44,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(2);
         dim[0] = sx;
@@ -53,7 +53,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(3);
         dim[0] = sx;
@@ -63,7 +63,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(4);
         dim[0] = sx;
@@ -74,7 +74,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(5);
         dim[0] = sx;
@@ -86,7 +86,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(6);
         dim[0] = sx;
@@ -99,7 +99,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(7);
         dim[0] = sx;
@@ -113,7 +113,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, size_t ss) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, size_t ss) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(8);
         dim[0] = sx;
@@ -128,25 +128,25 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(std::vector<size_t> *dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(std::vector<size_t> *dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions,data,delete_data_on_destruct);
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(std::vector<size_t> &dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(std::vector<size_t> &dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions,data,delete_data_on_destruct);
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(boost::shared_ptr< std::vector<size_t> > dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(boost::shared_ptr< std::vector<size_t> > dimensions, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         this->create(dimensions,data,delete_data_on_destruct);
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t len, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t len, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(1);
         dim[0] = len;
@@ -154,7 +154,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(2);
         dim[0] = sx;
@@ -163,7 +163,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(3);
         dim[0] = sx;
@@ -173,7 +173,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(4);
         dim[0] = sx;
@@ -184,7 +184,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(5);
         dim[0] = sx;
@@ -196,7 +196,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(6);
         dim[0] = sx;
@@ -209,7 +209,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(7);
         dim[0] = sx;
@@ -223,7 +223,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, size_t ss, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray()
+    hoNDArray<T>::hoNDArray(size_t sx, size_t sy, size_t sz, size_t st, size_t sp, size_t sq, size_t sr, size_t ss, T* data, bool delete_data_on_destruct) : NDArray<T>::NDArray(), pool_data_(0)
     {
         std::vector<size_t> dim(8);
         dim[0] = sx;
@@ -246,7 +246,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(const hoNDArray<T>  *a)
+    hoNDArray<T>::hoNDArray(const hoNDArray<T>  *a) : pool_data_(0)
     {
         if(!a) throw std::runtime_error("hoNDArray<T>::hoNDArray(): 0x0 pointer provided");
         this->data_ = 0;
@@ -271,7 +271,7 @@ namespace Gadgetron
     }
 
     template <typename T> 
-    hoNDArray<T>::hoNDArray(const hoNDArray<T> &a)
+    hoNDArray<T>::hoNDArray(const hoNDArray<T> &a) : pool_data_(0)
     {
         this->data_ = 0;
 
@@ -296,12 +296,14 @@ namespace Gadgetron
 
 #if __cplusplus > 199711L
     template <typename T>
-    hoNDArray<T>::hoNDArray(hoNDArray<T>&& a) : NDArray<T>::NDArray(){
+    hoNDArray<T>::hoNDArray(hoNDArray<T>&& a) : NDArray<T>::NDArray(), pool_data_(0){
     	data_ = a.data_;
+    	pool_data_ = a.pool_data_;
     	*this->dimensions_ = *a.dimensions_;
     	this->elements_ = a.elements_;
     	a.dimensions_.reset();
     	a.data_ = nullptr;
+    	a.pool_data_ = nullptr;
     	this->offsetFactors_ = a.offsetFactors_;
     	a.offsetFactors_.reset();
     }
@@ -344,7 +346,9 @@ namespace Gadgetron
         rhs.dimensions_.reset();
         rhs.offsetFactors_.reset();
         data_ = rhs.data_;
+        pool_data_ = rhs.pool_data_;
         rhs.data_ = nullptr;
+        rhs.pool_data_ = nullptr;
         return *this;
     }
 #endif
@@ -902,13 +906,16 @@ namespace Gadgetron
 
             if ( this->elements_ > 0 )
             {
-                this->_allocate_memory(this->elements_, &this->data_);
+                bool pooled = false;
+                this->_allocate_memory(this->elements_, &this->data_, pooled);
 
                 if( this->data_ == 0x0 )
                 {
                     BOOST_THROW_EXCEPTION( bad_alloc("hoNDArray<>::allocate memory failed"));
                 }
 
+                this->pool_data_ = pooled ? this->data_ : 0x0;
+
                 this->delete_data_on_destruct_ = true;
 
                 // memset(this->data_, 0, sizeof(T)*this->elements_);
@@ -928,81 +935,82 @@ namespace Gadgetron
         }
         
         if( this->data_ ){
-            this->_deallocate_memory( this->data_ );
+            this->_deallocate_memory( this->data_, this->data_ == this->pool_data_ );
             this->data_ = 0x0;
         }
+        this->pool_data_ = 0x0;
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, float** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, float** data , bool& pooled )
     {
-        *data = (float*) malloc( size*sizeof(float) );
+        *data = (float*) hoMemoryPool::allocate( size*sizeof(float), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( float* data )
+    inline void hoNDArray<T>::_deallocate_memory( float* data , bool pooled )
     {
-        free(data);
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, double** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, double** data , bool& pooled )
     {
-        *data = (double*) malloc( size*sizeof(double) );
+        *data = (double*) hoMemoryPool::allocate( size*sizeof(double), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( double* data )
+    inline void hoNDArray<T>::_deallocate_memory( double* data , bool pooled )
     {
-        free(data);
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<float>** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<float>** data , bool& pooled )
     {
-        *data = (std::complex<float>*) malloc( size*sizeof(std::complex<float>) );
+        *data = (std::complex<float>*) hoMemoryPool::allocate( size*sizeof(std::complex<float>), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( std::complex<float>* data )
+    inline void hoNDArray<T>::_deallocate_memory( std::complex<float>* data , bool pooled )
     {
-        free(data);
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<double>** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<double>** data , bool& pooled )
     {
-        *data = (std::complex<double>*) malloc( size*sizeof(std::complex<double>) );
+        *data = (std::complex<double>*) hoMemoryPool::allocate( size*sizeof(std::complex<double>), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( std::complex<double>* data )
+    inline void hoNDArray<T>::_deallocate_memory( std::complex<double>* data , bool pooled )
     {
-        free(data);
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, float_complext** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, float_complext** data , bool& pooled )
     {
-        *data = (float_complext*) malloc( size*sizeof(float_complext) );
+        *data = (float_complext*) hoMemoryPool::allocate( size*sizeof(float_complext), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( float_complext* data )
+    inline void hoNDArray<T>::_deallocate_memory( float_complext* data , bool pooled )
     {
-        free( data );
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_allocate_memory( size_t size, double_complext** data )
+    inline void hoNDArray<T>::_allocate_memory( size_t size, double_complext** data , bool& pooled )
     {
-        *data = (double_complext*) malloc( size*sizeof(double_complext) );
+        *data = (double_complext*) hoMemoryPool::allocate( size*sizeof(double_complext), pooled );
     }
 
     template <typename T> 
-    inline void hoNDArray<T>::_deallocate_memory( double_complext* data )
+    inline void hoNDArray<T>::_deallocate_memory( double_complext* data , bool pooled )
     {
-        free( data );
+        hoMemoryPool::deallocate( data, pooled );
     }
 
     template <typename T> 
@@ -714,8 +714,9 @@ bool BSplineFFD3D<T, CoordType, DOut>::refine()
 
         for ( d=0; d<DOut; d++ )
         {
-            this->ctrl_pt_[d].create(dim, spacing, origin, axis, new_ctrl_pt[d].begin(), true);
-            new_ctrl_pt[d].delete_data_on_destruct(false);
+            // copied rather than adopted, the new array releases its data to where it was allocated
+            this->ctrl_pt_[d].create(dim, spacing, origin, axis);
+            memcpy(this->ctrl_pt_[d].begin(), new_ctrl_pt[d].begin(), new_ctrl_pt[d].get_number_of_bytes());
         }
     }
     catch(...)
@@ -11,13 +11,341 @@
 namespace Gadgetron{
 
 template<typename T> hoNDFFT<T>* hoNDFFT<T>::instance()
-    																{
-	if (!instance_) instance_ = new hoNDFFT<T>();
+{
+	static std::once_flag created;
+	std::call_once(created, [](){ instance_ = new hoNDFFT<T>(); });
 	return instance_;
-    																}
+}
 
 template<class T> hoNDFFT<T>* hoNDFFT<T>::instance_ = NULL;
 
+template<class T> bool hoNDFFT<T>::PlanKey::operator<(const PlanKey& k) const
+{
+	if (rank != k.rank) return rank < k.rank;
+	for (int i = 0; i < 3; i++)
+		if (n[i] != k.n[i]) return n[i] < k.n[i];
+	if (howmany != k.howmany) return howmany < k.howmany;
+	if (istride != k.istride) return istride < k.istride;
+	if (idist != k.idist) return idist < k.idist;
+	if (ostride != k.ostride) return ostride < k.ostride;
+	if (odist != k.odist) return odist < k.odist;
+	if (sign != k.sign) return sign < k.sign;
+	if (flags != k.flags) return flags < k.flags;
+	if (in_place != k.in_place) return in_place < k.in_place;
+	if (ialign != k.ialign) return ialign < k.ialign;
+	return oalign < k.oalign;
+}
+
+template<class T> void hoNDFFT<T>::PlanDeleter::operator()(typename fftw_types<T>::plan * p)
+{
+	std::lock_guard<std::mutex> guard(fft->mutex_);
+	fft->fftw_destroy_plan_(p);
+}
+
+template<class T> void hoNDFFT<T>::evict_plans(size_t num_plans, const CachedPlan* keep, std::vector<PlanPtr>& evicted)
+{
+	// the plans are only moved out, they are destroyed by the caller after all locks are released
+	while (plans_.size() > num_plans)
+	{
+		typename std::map<PlanKey, CachedPlan>::iterator it, lru = plans_.end();
+		for (it = plans_.begin(); it != plans_.end(); it++)
+		{
+			if (&it->second == keep) continue;
+			if (lru == plans_.end() || it->second.last_use < lru->second.last_use) lru = it;
+		}
+
+		if (lru == plans_.end()) break;
+
+		evicted.push_back(lru->second.plan);
+		plans_.erase(lru);
+	}
+}
+
+template<class T> void hoNDFFT<T>::set_plan_cache_size(size_t num_plans)
+{
+	std::vector<PlanPtr> evicted;
+
+	boost::unique_lock<boost::shared_mutex> guard(plans_mutex_);
+	max_plans_ = num_plans;
+	evict_plans(max_plans_, NULL, evicted);
+}
+
+template<class T> size_t hoNDFFT<T>::get_plan_cache_size()
+{
+	boost::shared_lock<boost::shared_mutex> guard(plans_mutex_);
+	return max_plans_;
+}
+
+template<class T> size_t hoNDFFT<T>::get_number_of_cached_plans()
+{
+	boost::shared_lock<boost::shared_mutex> guard(plans_mutex_);
+	return plans_.size();
+}
+
+template<class T> typename hoNDFFT<T>::PlanPtr hoNDFFT<T>::get_plan(int rank, const int* n, int howmany,
+		ComplexType* in, int istride, int idist,
+		ComplexType* out, int ostride, int odist,
+		int sign, unsigned flags)
+{
+	if (rank < 1 || rank > 3) throw std::runtime_error("hoNDFFT::get_plan: only ranks 1 to 3 are cached");
+
+	PlanKey key;
+	key.rank = rank;
+	for (int i = 0; i < 3; i++) key.n[i] = (i < rank) ? n[i] : 0;
+	key.howmany = howmany;
+	key.istride = istride;
+	key.idist = idist;
+	key.ostride = ostride;
+	key.odist = odist;
+	key.sign = sign;
+	key.flags = flags;
+	key.in_place = (in == out);
+	key.ialign = (flags & FFTW_UNALIGNED) ? 0 : fftw_alignment_of_(in);
+	key.oalign = (flags & FFTW_UNALIGNED) ? 0 : fftw_alignment_of_(out);
+
+	{
+		boost::shared_lock<boost::shared_mutex> guard(plans_mutex_);
+		typename std::map<PlanKey, CachedPlan>::iterator it = plans_.find(key);
+		if (it != plans_.end())
+		{
+			it->second.last_use = ++use_clock_;
+			return it->second.plan;
+		}
+	}
+
+	// declared before the planner lock, so evicted plans are destroyed after it is released
+	std::vector<PlanPtr> evicted;
+
+	std::lock_guard<std::mutex> planner_guard(mutex_);
+
+	// another thread may have made the plan while we waited for the planner
+	{
+		boost::shared_lock<boost::shared_mutex> guard(plans_mutex_);
+		typename std::map<PlanKey, CachedPlan>::iterator it = plans_.find(key);
+		if (it != plans_.end())
+		{
+			it->second.last_use = ++use_clock_;
+			return it->second.plan;
+		}
+	}
+
+	typename fftw_types<T>::plan * p = NULL;
+
+	// wisdom-only planning does not measure, so the arrays are left untouched
+	if (use_wisdom_ && (flags & FFTW_ESTIMATE))
+	{
+		p = fftw_plan_many_dft_(rank, n, howmany,
+				in, NULL, istride, idist,
+				out, NULL, ostride, odist,
+				sign, (flags & ~FFTW_ESTIMATE) | FFTW_MEASURE | FFTW_WISDOM_ONLY);
+	}
+
+	if (p == NULL)
+	{
+		p = fftw_plan_many_dft_(rank, n, howmany,
+				in, NULL, istride, idist,
+				out, NULL, ostride, odist,
+				sign, flags);
+	}
+
+	if (p == NULL)
+	{
+		throw std::runtime_error("hoNDFFT: failed to create fft plan");
+	}
+
+	PlanPtr res(p, PlanDeleter(this));
+
+	{
+		boost::unique_lock<boost::shared_mutex> guard(plans_mutex_);
+		CachedPlan& cached = plans_[key];
+		cached.plan = res;
+		cached.last_use = ++use_clock_;
+		evict_plans(max_plans_, &cached, evicted);
+	}
+
+	return res;
+}
+
+template<class T> bool hoNDFFT<T>::import_wisdom(const std::string& filename)
+{
+	FILE* file = fopen(filename.c_str(), "r");
+	if (!file) return false;
+
+	int res;
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		res = fftw_import_wisdom_from_file_(file);
+	}
+	fclose(file);
+
+	if (res) use_wisdom_ = true;
+	return (res != 0);
+}
+
+template<class T> bool hoNDFFT<T>::export_wisdom(const std::string& filename)
+{
+	FILE* file = fopen(filename.c_str(), "w");
+	if (!file) return false;
+
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		fftw_export_wisdom_to_file_(file);
+	}
+
+	return (fclose(file) == 0);
+}
+
+template<class T> void hoNDFFT<T>::plan_ahead(const std::vector<size_t>& dims, size_t batch, unsigned rigor)
+{
+	if (dims.empty() || dims.size() > 3) throw std::runtime_error("hoNDFFT::plan_ahead: only 1 to 3 dimensions are supported");
+	if (batch == 0) batch = 1;
+
+	// the plans use the same layout as fft1/fft2/fft3: slowest varying dimension first, contiguous batches
+	int rank = (int)dims.size();
+	int n[3];
+	int len = 1;
+	for (int i = 0; i < rank; i++)
+	{
+		n[i] = (int)dims[rank-1-i];
+		len *= n[i];
+	}
+
+	// the batched plans fft_batched runs for batch arrays and for a single one, with the same chunks and flags
+	std::vector<int> howmany;
+	std::vector<unsigned> flags;
+	size_t nums[] = {batch, 1};
+	for (int b = 0; b < ((batch > 1) ? 2 : 1); b++)
+	{
+		int num = (int)nums[b];
+		int chunk, last;
+		unsigned f;
+		get_batch_layout(len, num, get_num_threads_fft(rank, n, num), chunk, last, f);
+
+		howmany.push_back(chunk);
+		flags.push_back(f);
+		if (last != chunk)
+		{
+			howmany.push_back(last);
+			flags.push_back(f);
+		}
+	}
+
+	ComplexType* in = (ComplexType*)fftw_malloc_(sizeof(ComplexType)*len*batch);
+	ComplexType* out = (ComplexType*)fftw_malloc_(sizeof(ComplexType)*len*batch);
+	if (!in || !out)
+	{
+		if (in) fftw_free_(in);
+		if (out) fftw_free_(out);
+		throw std::runtime_error("hoNDFFT::plan_ahead: failed to allocate planning buffers");
+	}
+
+	int signs[] = {FFTW_FORWARD, FFTW_BACKWARD};
+
+	try
+	{
+		// accumulate wisdom at the requested rigor
+		{
+			std::lock_guard<std::mutex> guard(mutex_);
+
+			for (int s = 0; s < 2; s++)
+			{
+				for (size_t h = 0; h < howmany.size(); h++)
+				{
+					unsigned f = (flags[h] & ~FFTW_ESTIMATE) | rigor;
+					typename fftw_types<T>::plan * p;
+
+					p = fftw_plan_many_dft_(rank, n, howmany[h], in, NULL, 1, len, in, NULL, 1, len, signs[s], f);
+					if (p) fftw_destroy_plan_(p);
+
+					p = fftw_plan_many_dft_(rank, n, howmany[h], in, NULL, 1, len, out, NULL, 1, len, signs[s], f);
+					if (p) fftw_destroy_plan_(p);
+				}
+			}
+		}
+
+		use_wisdom_ = true;
+
+		// and put the plans the transforms will look up into the cache, made from that wisdom
+		for (int s = 0; s < 2; s++)
+		{
+			for (size_t h = 0; h < howmany.size(); h++)
+			{
+				get_plan(rank, n, howmany[h], in, 1, len, in, 1, len, signs[s], flags[h]);
+				get_plan(rank, n, howmany[h], in, 1, len, out, 1, len, signs[s], flags[h]);
+			}
+		}
+	}
+	catch (...)
+	{
+		fftw_free_(in);
+		fftw_free_(out);
+		throw;
+	}
+
+	fftw_free_(in);
+	fftw_free_(out);
+}
+
+template<class T> unsigned hoNDFFT<T>::plan_flags_for_offset(size_t offset_elements, unsigned flags)
+{
+	// offsets that are a multiple of 64 bytes keep whatever SIMD alignment the first array has
+	if ((offset_elements*sizeof(ComplexType)) % 64 != 0) flags |= FFTW_UNALIGNED;
+	return flags;
+}
+
+template<class T> void hoNDFFT<T>::get_batch_layout(int len, int num, int num_thr, int& chunk, int& last, unsigned& flags)
+{
+	if ( num_thr <= 1 || num <= 1 )
+	{
+		chunk = num;
+		last = num;
+		flags = FFTW_ESTIMATE;
+		return;
+	}
+
+	if ( num_thr > num ) num_thr = num;
+
+	// contiguous chunks of transforms, one batched plan per chunk size
+	chunk = (num + num_thr - 1) / num_thr;
+	int num_chunks = (num + chunk - 1) / chunk;
+	last = num - (num_chunks-1)*chunk;
+
+	flags = plan_flags_for_offset((size_t)chunk*len, FFTW_ESTIMATE);
+}
+
+template<class T> void hoNDFFT<T>::fft_batched(int rank, const int* n, int num, ComplexType* in, ComplexType* out, int sign, int num_thr)
+{
+	int len = 1;
+	for (int i = 0; i < rank; i++) len *= n[i];
+
+	int chunk, last;
+	unsigned flags;
+	get_batch_layout(len, num, num_thr, chunk, last, flags);
+
+	if ( chunk == num )
+	{
+		PlanPtr p = get_plan(rank, n, num, in, 1, len, out, 1, len, sign, flags);
+		fftw_execute_dft_(p.get(), in, out);
+		return;
+	}
+
+	int num_chunks = (num + chunk - 1) / chunk;
+
+	PlanPtr plan = get_plan(rank, n, chunk, in, 1, len, out, 1, len, sign, flags);
+	PlanPtr plan_last = (last == chunk) ? plan : get_plan(rank, n, last, in, 1, len, out, 1, len, sign, flags);
+
+	typename fftw_types<T>::plan * p = plan.get();
+	typename fftw_types<T>::plan * p_last = plan_last.get();
+
+	int k;
+#pragma omp parallel for private(k) shared(num_chunks, chunk, len, p, p_last, in, out) num_threads(num_thr)
+	for ( k=0; k<num_chunks; k++ )
+	{
+		size_t offset = (size_t)k*chunk*len;
+		fftw_execute_dft_( (k == num_chunks-1) ? p_last : p, in+offset, out+offset);
+	}
+}
+
 
 template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* input, size_t dim_to_transform, int sign)
    {
@@ -34,7 +362,7 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
 
 
 
-       typename fftw_types<T>::plan * fft_plan        = 0;
+       PlanPtr         fft_plan;
        ComplexType*    fft_storage     = 0;
 
        ComplexType* fft_buffer = 0;
@@ -76,27 +404,24 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
        total_dist = trafos*dist;
 
 
-       //Allocate storage and make plan
+       //Allocate storage and look up plan
+       fft_storage = (ComplexType*)fftw_malloc_(sizeof(T)*length*2);
+       if (fft_storage == 0)
        {
-           std::lock_guard<std::mutex> guard(mutex_);
-           fft_storage = (ComplexType*)fftw_malloc_(sizeof(T)*length*2);
-           if (fft_storage == 0)
-           {
-               GDEBUG_STREAM("Failed to allocate buffer for FFT" << std::endl);
-               return;
-           }
-           fft_buffer = fft_storage;
-
-           unsigned planner_flags = FFTW_MEASURE | FFTW_DESTROY_INPUT;
-
-           fft_plan = fftw_plan_dft_1d_(length, fft_storage, fft_storage, sign, planner_flags);
+           GDEBUG_STREAM("Failed to allocate buffer for FFT" << std::endl);
+           return;
+       }
+       fft_buffer = fft_storage;
 
-           if (fft_plan == 0)
-           {
-               fftw_free_(fft_storage);
-               GDEBUG_STREAM("Failed to create plan for FFT" << std::endl);
-               return;
-           }
+       try
+       {
+           fft_plan = get_plan(1, &length, 1, fft_storage, 1, length, fft_storage, 1, length, sign, FFTW_MEASURE | FFTW_DESTROY_INPUT);
+       }
+       catch (...)
+       {
+           fftw_free_(fft_storage);
+           GDEBUG_STREAM("Failed to create plan for FFT" << std::endl);
+           return;
        }
 
        //Grab address of data
@@ -125,7 +450,7 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
                    }
                }
 
-               fftw_execute_(fft_plan);
+               fftw_execute_dft_(fft_plan.get(), fft_buffer, fft_buffer);
 
                {
                    int j, idx3 = idx2;
@@ -137,26 +462,14 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
                    for (j = 0; j < middle_point; idx3+=stride)
                    {
                        data_ptr[idx3  ] = fft_buffer[j++]*scale;
-                       data_ptr[idx3] = fft_buffer[j++]*scale;
                    }
                }
 
            } //Loop over transformations
        } //Loop over chunks
 
-       //clean up
-       {
-           std::lock_guard<std::mutex> guard(mutex_);
-           if (fft_plan != 0)
-           {
-               fftw_destroy_plan_(fft_plan);
-           }
-
-           if (fft_storage != 0)
-           {
-               fftw_free_(fft_storage);
-           }
-       }
+       //clean up, the plan stays in the cache
+       fftw_free_(fft_storage);
    }
 
 template<class T> void hoNDFFT<T>::fft_int(hoNDArray< ComplexType >* input, size_t dim_to_transform, int sign)	{
@@ -177,7 +490,7 @@ template<class T> void hoNDFFT<T>::fft_int(hoNDArray< ComplexType >* input, size
 	int total_dist = 1;
 
 
-	typename fftw_types<T>::plan * fft_plan        = 0;
+	PlanPtr fft_plan;
 
 
 	//Set sizes
@@ -219,37 +532,19 @@ template<class T> void hoNDFFT<T>::fft_int(hoNDArray< ComplexType >* input, size
 //Grab address of data
 	ComplexType* data_ptr = input->get_data_ptr();
 
-	//Allocate storage and make plan
-	{
-            std::lock_guard<std::mutex> guard(mutex_);
-            unsigned planner_flags = FFTW_ESTIMATE;
-            fft_plan = fftw_plan_many_dft_(1,&length,trafos,data_ptr,&length,stride,dist,data_ptr,&length,stride,dist,sign,planner_flags);
-            //fftw_print_plan_(fft_plan);
-            if (fft_plan == NULL)
-	    {
-                throw std::runtime_error("hoNDFFT: failed to create fft plan");
-            }
-	}
+	//Look up plan, it is run on every chunk
+	unsigned planner_flags = (chunks > 1) ? plan_flags_for_offset(chunk_size, FFTW_ESTIMATE) : FFTW_ESTIMATE;
+	fft_plan = get_plan(1,&length,trafos,data_ptr,stride,dist,data_ptr,stride,dist,sign,planner_flags);
 
 #pragma omp parallel for
 	for (int k = 0; k < chunks; k++)
-		fftw_execute_dft_(fft_plan,data_ptr+k*chunk_size,data_ptr+k*chunk_size);
+		fftw_execute_dft_(fft_plan.get(),data_ptr+k*chunk_size,data_ptr+k*chunk_size);
 
 //Flip frequencies to center DC freq
 	if (sign == FFTW_FORWARD)
 		timeswitch(input,dim_to_transform);
 
 
-	//clean up
-	{
-            std::lock_guard<std::mutex> guard(mutex_);
-            if (fft_plan != 0)
-	    {
-                fftw_destroy_plan_(fft_plan);
-            }
-	}
-
-
 	*input *= scale;
 }
 template<typename T>
@@ -988,99 +1283,36 @@ inline void hoNDFFT<T>::ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< Com
 template<typename T>
 void hoNDFFT<T>::fft1(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
-	fft1(res, a, forward);
+	fft1(a, a, forward);
 }
 
 template<typename T>
 void hoNDFFT<T>::fft2(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
-	fft2(res, a, forward);
+	fft2(a, a, forward);
 }
 
 template<typename T>
 void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
-	fft3(res, a, forward);
+	fft3(a, a, forward);
 }
 
 template<typename T>
 void hoNDFFT<T>::fft1(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward)
 {
-	r = a;
+	if ( !r.dimensions_equal(&a) )
+	{
+		r.create(a.get_dimensions());
+	}
 
 	int n0 = (int)a.get_size(0);
 	T fftRatio = T(1.0/std::sqrt( T(n0) ));
 
-
 	int num = (int)(a.get_number_of_elements()/n0);
 	int num_thr = get_num_threads_fft1(n0, num);
 
-	int n;
-
-
-	typename fftw_types<T>::plan * p;
-
-	if( num_thr > 1 )
-	{
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			if ( forward )
-			{
-				p = fftw_plan_dft_1d_(n0,a.get_data_ptr(),r.get_data_ptr(),FFTW_FORWARD,FFTW_ESTIMATE);
-			}
-			else
-			{
-				p = fftw_plan_dft_1d_(n0,a.get_data_ptr(),r.get_data_ptr(),FFTW_BACKWARD,FFTW_ESTIMATE);
-			}
-		}
-
-#pragma omp parallel for private(n) shared(num, p, a, n0, r) num_threads(num_thr)
-		for ( n=0; n<num; n++ )
-		{
-			fftw_execute_dft_(p, a.get_data_ptr()+n*n0,
-					r.get_data_ptr()+n*n0);
-		}
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
-	}
-	else
-	{
-		// multiple fft interface
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			if ( forward )
-			{
-				p = fftw_plan_many_dft_(1, &n0, num,
-						a.get_data_ptr(), NULL,
-						1, n0,
-						r.get_data_ptr(), NULL,
-						1, n0,
-						FFTW_FORWARD, FFTW_ESTIMATE);
-			}
-			else
-			{
-				p = fftw_plan_many_dft_(1, &n0, num,
-						a.get_data_ptr(),NULL,
-						1, n0,
-						r.get_data_ptr(), NULL,
-						1, n0,
-						FFTW_BACKWARD, FFTW_ESTIMATE);
-			}
-		}
-
-		fftw_execute_(p);
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
-	}
+	fft_batched(1, &n0, num, a.begin(), r.begin(), forward ? FFTW_FORWARD : FFTW_BACKWARD, num_thr);
 
 	r *= fftRatio;
 }
@@ -1088,7 +1320,10 @@ void hoNDFFT<T>::fft1(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 template<typename T>
 void hoNDFFT<T>::fft2(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward)
 {
-	r = a;
+	if ( !r.dimensions_equal(&a) )
+	{
+		r.create(a.get_dimensions());
+	}
 
 	int n0 = (int)a.get_size(1);
 	int n1 = (int)a.get_size(0);
@@ -1098,68 +1333,19 @@ void hoNDFFT<T>::fft2(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 	int num = (int)(a.get_number_of_elements()/(n0*n1));
 	int num_thr = get_num_threads_fft2(n0, n1, num);
 
-	int n;
-
-
-	typename fftw_types<T>::plan * p;
-
-	if ( num_thr > 1 )
-	{
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			p = fftw_plan_dft_2d_(n0, n1,
-					a.begin(),
-					r.begin(),
-					forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
-		}
-
-#pragma omp parallel for private(n) shared(num, p, a, n0, n1, r) num_threads(num_thr)
-		for ( n=0; n<num; n++ )
-		{
-			fftw_execute_dft_(p, a.begin()+n*n0*n1,
-					r.begin()+n*n0*n1);
-		}
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
-	}
-	else
-	{
-		// multiple fft interface
-
-		int n[] = {n0, n1};
-		int idist = n0*n1;
-		int odist = n0*n1;
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			p = fftw_plan_many_dft_(2, n, num,
-					a.begin(), NULL,
-					1, idist,
-					r.begin(), NULL,
-					1, odist,
-					forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
-
-		}
-
-		fftw_execute_(p);
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
-	}
+	int n[] = {n0, n1};
+	fft_batched(2, n, num, a.begin(), r.begin(), forward ? FFTW_FORWARD : FFTW_BACKWARD, num_thr);
 
 	r *= fftRatio;
-
 }
 
 template<typename T>
 void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward)
 {
-	r = a;
+	if ( !r.dimensions_equal(&a) )
+	{
+		r.create(a.get_dimensions());
+	}
 
 	int n2 = (int)a.get_size(0);
 	int n1 = (int)a.get_size(1);
@@ -1170,35 +1356,20 @@ void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 	int num = (int)(a.get_number_of_elements()/(n0*n1*n2));
 	int num_thr = get_num_threads_fft3(n0, n1, n2, num);
 
-	long long n;
-
-	typename fftw_types<T>::plan * p;
-
-	{
-                std::lock_guard<std::mutex> guard(mutex_);
-		p = fftw_plan_dft_3d_(n0, n1, n2,
-				a.get_data_ptr(),
-				r.get_data_ptr(),
-				forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
-
-	}
-
-#pragma omp parallel for private(n) shared(num, p, a, n0, n1, n2, r) if (num_thr > 1) num_threads(num_thr)
-	for ( n=0; n<num; n++ )
-	{
-		fftw_execute_dft_(p, a.begin()+n*n0*n1*n2,
-				r.begin()+n*n0*n1*n2);
-	}
-
-	{
-                std::lock_guard<std::mutex> guard(mutex_);
-		fftw_destroy_plan_(p);
-	}
+	int n[] = {n0, n1, n2};
+	fft_batched(3, n, num, a.begin(), r.begin(), forward ? FFTW_FORWARD : FFTW_BACKWARD, num_thr);
 
 	r *= fftRatio;
-
 }
 // TODO: implement more optimized threading strategy
+template<typename T>
+int hoNDFFT<T>::get_num_threads_fft(int rank, const int* n, size_t num)
+{
+	if ( rank == 1 ) return get_num_threads_fft1(n[0], num);
+	if ( rank == 2 ) return get_num_threads_fft2(n[0], n[1], num);
+	return get_num_threads_fft3(n[0], n[1], n[2], num);
+}
+
 template<typename T>
 inline int hoNDFFT<T>::get_num_threads_fft1(size_t n0, size_t num)
 {
@@ -1407,6 +1578,14 @@ template<> void hoNDFFT<double>::fftw_destroy_plan_( typename fftw_types<double>
 	fftw_destroy_plan(p);
 }
 
+template<> int hoNDFFT<float>::fftw_alignment_of_( ComplexType* p ){
+	return fftwf_alignment_of(reinterpret_cast<float*>(p));
+}
+
+template<> int hoNDFFT<double>::fftw_alignment_of_( ComplexType* p ){
+	return fftw_alignment_of(reinterpret_cast<double*>(p));
+}
+
 template<> void hoNDFFT<double>::fftw_print_plan_( typename fftw_types<double>::plan * p ){
 	fftw_print_plan(p);
 }
@@ -9,6 +9,12 @@
 #include "cpufft_export.h"
 
 #include <mutex>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
 #include <iostream>
 #include <fftw3.h>
 #include <complex>
@@ -34,7 +40,11 @@ template<> struct fftw_types<double>{
 
     /** 
     Generic class for Fast Fourier Transforms using FFTW on the hoNDArray class.
-    This class is a singleton because the planning and memory allocation routines of FFTW are NOT threadsafe.
+    This class is a singleton because the planning routines of FFTW are NOT threadsafe.
+    Plans are cached by shape, layout, direction and alignment; only the first transform of a given shape
+    takes the planner lock, later ones look up the plan under a shared lock and execute it on the new arrays.
+    The cache holds a bounded number of plans; the least recently used plan is dropped from it when a new
+    one is added, and destroyed once no running transform uses it any more.
     The class' template type is a REAL, ie. float or double.
 
 		Note that scaling is 1/sqrt(N) fir both FFT and IFFT, where N is the number of elements along the FFT dimensions
@@ -174,11 +184,33 @@ template<> struct fftw_types<double>{
         void fft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf);
         void ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf);
 
+        // FFTW wisdom
+        // once wisdom is imported or planned ahead, transforms first look for a plan in the wisdom (at FFTW_MEASURE or better)
+        // and only fall back to an estimated plan for shapes not covered by it
+
+        /// import wisdom from a file, returns false if the file cannot be read
+        bool import_wisdom(const std::string& filename);
+
+        /// export the wisdom accumulated so far to a file, returns false if the file cannot be written
+        bool export_wisdom(const std::string& filename);
+
+        /// plan forward and inverse, in-place and out-of-place transforms of dims (1 to 3 dimensions, fastest varying first),
+        /// batched over batch contiguous arrays and for a single array, with the planner rigor flags (FFTW_MEASURE, FFTW_PATIENT
+        /// or FFTW_EXHAUSTIVE); the plans are made with the chunks and flags fft1/fft2/fft3 use and are added to the plan cache
+        void plan_ahead(const std::vector<size_t>& dims, size_t batch, unsigned rigor);
+
+        /// maximal number of plans kept in the cache, default 256
+        void set_plan_cache_size(size_t num_plans);
+        size_t get_plan_cache_size();
+
+        /// number of plans currently in the cache
+        size_t get_number_of_cached_plans();
+
     protected:
 
         //We are making these protected since this class is a singleton
 
-        hoNDFFT() {
+        hoNDFFT() : use_wisdom_(false), use_clock_(0), max_plans_(256) {
 
 
 #ifdef USE_OMP
@@ -188,7 +220,62 @@ template<> struct fftw_types<double>{
 #endif // USE_OMP
         }
 
-        virtual ~hoNDFFT() { fftw_cleanup_(); }
+        virtual ~hoNDFFT()
+        {
+            plans_.clear();
+            fftw_cleanup_();
+        }
+
+        /// everything that decides whether a plan can be executed on a new pair of arrays
+        struct PlanKey
+        {
+            int rank;
+            int n[3];
+            int howmany;
+            int istride;
+            int idist;
+            int ostride;
+            int odist;
+            int sign;
+            unsigned flags;
+            bool in_place;
+            int ialign;
+            int oalign;
+
+            bool operator<(const PlanKey& k) const;
+        };
+
+        /// destroys a plan under the planner lock, once neither the cache nor a running transform holds it
+        struct PlanDeleter
+        {
+            hoNDFFT<T>* fft;
+            PlanDeleter(hoNDFFT<T>* f) : fft(f) {}
+            void operator()(typename fftw_types<T>::plan * p);
+        };
+
+        typedef boost::shared_ptr<typename fftw_types<T>::plan> PlanPtr;
+
+        struct CachedPlan
+        {
+            PlanPtr plan;
+            std::atomic<unsigned long long> last_use;
+        };
+
+        /// find or create the plan for howmany transforms of rank <= 3; hold the returned pointer while the plan is run with fftw_execute_dft_
+        PlanPtr get_plan(int rank, const int* n, int howmany,
+                                               ComplexType* in, int istride, int idist,
+                                               ComplexType* out, int ostride, int odist,
+                                               int sign, unsigned flags);
+
+        /// how fft_batched splits num transforms of len elements over num_thr threads: chunks of chunk transforms, the last one
+        /// of last transforms, all planned with flags; chunk == num if the transforms are run as one plan
+        void get_batch_layout(int len, int num, int num_thr, int& chunk, int& last, unsigned& flags);
+
+        /// num contiguous transforms of shape n, as one batched plan, or split into num_thr batched plans over contiguous chunks
+        void fft_batched(int rank, const int* n, int num, ComplexType* in, ComplexType* out, int sign, int num_thr);
+
+        /// FFTW_UNALIGNED is needed when a plan is run at offsets that may change the SIMD alignment
+        unsigned plan_flags_for_offset(size_t offset_elements, unsigned flags);
 
         void fft_int(hoNDArray< ComplexType >* input, size_t dim_to_transform, int sign);
 
@@ -202,6 +289,7 @@ template<> struct fftw_types<double>{
         void  fftw_execute_dft_(typename fftw_types<T>::plan * p, ComplexType*, ComplexType*);
         void  fftw_execute_(typename fftw_types<T>::plan * p);
         void fftw_print_plan_(typename fftw_types<T>::plan *p);
+        int fftw_alignment_of_(ComplexType* p);
 
         typename fftw_types<T>::plan * fftw_plan_dft_1d_(int rank, ComplexType*, ComplexType*, int, unsigned);
         typename fftw_types<T>::plan * fftw_plan_dft_2d_(int dim0,int dim1, ComplexType*, ComplexType*, int, unsigned);
@@ -220,8 +308,22 @@ template<> struct fftw_types<double>{
 
 
         static hoNDFFT<T>* instance_;
+
+        // serialises the FFTW planner
         std::mutex mutex_;
 
+        // guards the plan cache only, so lookups do not wait for planning; hits take it shared
+        boost::shared_mutex plans_mutex_;
+        std::map<PlanKey, CachedPlan> plans_;
+        std::atomic<unsigned long long> use_clock_;
+        size_t max_plans_;
+
+        /// drop the least recently used plans until at most num_plans are left, keep is never dropped
+        void evict_plans(size_t num_plans, const CachedPlan* keep, std::vector<PlanPtr>& evicted);
+
+        // set once wisdom is available, see import_wisdom and plan_ahead
+        std::atomic<bool> use_wisdom_;
+
         int num_of_max_threads_;
 
         // the fft and ifft shift pivot for a certain length
@@ -266,6 +368,7 @@ template<> struct fftw_types<double>{
         void fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward);
 
         // get the number of threads used for fft
+        int get_num_threads_fft(int rank, const int* n, size_t num);
         int get_num_threads_fft1(size_t n0, size_t num);
         int get_num_threads_fft2(size_t n0, size_t n1, size_t num);
         int get_num_threads_fft3(size_t n0, size_t n1, size_t n2, size_t num);
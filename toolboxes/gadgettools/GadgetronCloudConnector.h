@@ -232,6 +232,17 @@ public:
 		  cloud_connector_->setJobTobeCompletedAndNoticeController();
 		  return -1;
                 }
+
+                while ((mb = r->read_pending()))
+                {
+                    if (cloud_connector_->process(mid.id, mb) < 0)
+                    {
+		      GERROR("ReaderTask, Failed to process pending message\n");
+		      cloud_connector_->set_status(false);
+		      cloud_connector_->setJobTobeCompletedAndNoticeController();
+		      return -1;
+                    }
+                }
             }
         }
 
@@ -71,6 +71,20 @@ int GadgetronConnector::svc(void)
       return close();
     }
 
+    if (mid.id == GADGET_MESSAGE_JOB_END) {
+      GadgetMessageJob job;
+      if ((recv_count = peer().recv_n(&job, sizeof(GadgetMessageJob))) <= 0) {
+	GERROR("GadgetronConnector, failed to read job ID\n");
+	return -1;
+      }
+
+      if (job_done(job.job_id) < 0) {
+	GERROR("GadgetronConnector, Failed to process end of job %d\n", job.job_id);
+	return -1;
+      }
+      continue;
+    }
+
     GadgetMessageReader* r = readers_.find(mid.id);
     if (r == 0) {
       GERROR("GadgetronConnector, Unknown message id %d received\n", mid.id);
@@ -87,6 +101,13 @@ int GadgetronConnector::svc(void)
 	GERROR("GadgetronConnector, Failed to process message\n");
 	return -1;
       }
+
+      while ((mb = r->read_pending())) {
+        if (process(mid.id, mb) < 0) {
+          GERROR("GadgetronConnector, Failed to process pending message\n");
+          return -1;
+        }
+      }
     }
   }
   return 0;
@@ -10,6 +10,7 @@
 #include <ace/SOCK_Stream.h>
 #include <ace/Reactor_Notification_Strategy.h>
 #include <string>
+#include <vector>
 
 #define MAXHOSTNAMELENGTH 1024
 
@@ -70,46 +71,147 @@ namespace Gadgetron{
 
       //Send a package if we have one
       while (this->getq (mb) != -1) {
-	GadgetContainerMessage<GadgetMessageIdentifier>* mid =
-	  AsContainerMessage<GadgetMessageIdentifier>(mb);
 
+	//Coalesce the messages that are already queued into one gathered send
+	int res = 0;
+	do {
+	  res = this->write_message(mb);
+	} while (res == 0
+		 && batch_.size() < WRITER_TASK_MAX_BATCH_MESSAGES
+		 && send_buffer_.bytes() < WRITER_TASK_MAX_BATCH_BYTES
+		 && !this->msg_queue()->is_empty()
+		 && this->getq(mb, &nowait) != -1);
+
+	if (this->flush() < 0) {
+	  GERROR("Failed to write message batch to Gadgetron\n");
+	  return -1;
+	}
 
-	if (!mid) {
-	  GERROR("Invalid message on output queue\n");
-	  mb->release();
+	if (res < 0) {
 	  return -1;
 	}
 
-	//Is this a shutdown message?
-	if (mid->getObjectPtr()->id == GADGET_MESSAGE_CLOSE) {
-	  socket_->send_n(mid->getObjectPtr(),sizeof(GadgetMessageIdentifier));
+	if (res > 0) {
 	  return 0;
 	}
+      }
+
+      return 0;
+
+    }
+
+  protected:
+
+    enum {
+      WRITER_TASK_MAX_BATCH_MESSAGES = 256,
+      WRITER_TASK_MAX_BATCH_BYTES = 16*1024*1024
+    };
+
+    /**
+       Writes or gathers one message. Returns 1 for the close message, 0 on success and -1 on failure.
+     */
+    int write_message(ACE_Message_Block* mb)
+    {
+      GadgetContainerMessage<GadgetMessageIdentifier>* mid =
+	AsContainerMessage<GadgetMessageIdentifier>(mb);
+
+
+      if (!mid) {
+	GERROR("Invalid message on output queue\n");
+	mb->release();
+	return -1;
+      }
+
+      //Is this a shutdown message?
+      if (mid->getObjectPtr()->id == GADGET_MESSAGE_CLOSE) {
+	if (this->flush() < 0) {
+	  GERROR("Failed to write message batch to Gadgetron\n");
+	  mb->release();
+	  return -1;
+	}
+	socket_->send_n(mid->getObjectPtr(),sizeof(GadgetMessageIdentifier));
+	mb->release();
+	return 1;
+      }
 
-	GadgetMessageWriter* w = writers_.find(mid->getObjectPtr()->id);
+      //Job boundaries carry only the job ID
+      if (mid->getObjectPtr()->id == GADGET_MESSAGE_JOB_END) {
+	GadgetContainerMessage<GadgetMessageJob>* job =
+	  AsContainerMessage<GadgetMessageJob>(mb->cont());
 
-	if (!w) {
-	  GERROR("Unrecognized Message ID received: %d\n",mid->getObjectPtr()->id);
+	if (!job) {
+	  GERROR("Job end message without job ID\n");
 	  mb->release();
 	  return -1;
 	}
 
-	if (w->write(socket_,mb->cont()) < 0) {
-	  GERROR("Failed to write message to Gadgetron\n");
-	  mb->release ();
+	send_buffer_.add_copy(mid->getObjectPtr(), sizeof(GadgetMessageIdentifier));
+	send_buffer_.add_copy(job->getObjectPtr(), sizeof(GadgetMessageJob));
+	mb->release();
+	return 0;
+      }
+
+      GadgetMessageWriter* w = writers_.find(mid->getObjectPtr()->id);
+
+      if (!w) {
+	GERROR("Unrecognized Message ID received: %d\n",mid->getObjectPtr()->id);
+	mb->release();
+	return -1;
+      }
+
+      if (w->supports_gather()) {
+	GadgetMessageSendBuffer::Mark mark = send_buffer_.mark();
+	if (w->gather(send_buffer_, mb->cont()) < 0) {
+	  GERROR("Failed to gather message for Gadgetron\n");
+	  //The partial message references mb, it must neither be sent nor outlive it
+	  send_buffer_.rollback(mark);
+	  mb->release();
 	  return -1;
 	}
+	batch_.push_back(mb);
+	return 0;
+      }
 
+      //Keep the order of messages on the wire
+      if (this->flush() < 0) {
+	GERROR("Failed to write message batch to Gadgetron\n");
 	mb->release();
+	return -1;
+      }
+
+      if (w->write(socket_,mb->cont()) < 0) {
+	GERROR("Failed to write message to Gadgetron\n");
+	mb->release ();
+	return -1;
       }
 
+      mb->release();
       return 0;
+    }
+
+    /**
+       Sends the gathered messages and releases them.
+     */
+    int flush()
+    {
+      int res = 0;
+      if (!send_buffer_.empty()) {
+	res = send_buffer_.flush(socket_);
+      }
 
+      for (size_t i = 0; i < batch_.size(); i++) {
+	batch_[i]->release();
+      }
+      batch_.clear();
+
+      return res;
     }
 
   protected:
     ACE_SOCK_Stream* socket_;
     GadgetronSlotContainer<GadgetMessageWriter> writers_;
+    GadgetMessageSendBuffer send_buffer_;
+    std::vector<ACE_Message_Block*> batch_;
   };
 
   class EXPORTGADGETTOOLS GadgetronConnector: public ACE_Svc_Handler<ACE_SOCK_STREAM, ACE_MT_SYNCH> {
@@ -132,6 +234,13 @@ namespace Gadgetron{
       return 0;
     }
 
+    /**
+       Called when the node has returned all results of a job, see GadgetMessageJob
+     */
+    virtual int job_done(ACE_UINT32 job_id) {
+      return 0;
+    }
+
     virtual int register_reader(size_t slot, GadgetMessageReader* reader);
     virtual int register_writer(size_t slot, GadgetMessageWriter* writer) {
       return writer_task_.register_writer(slot,writer);
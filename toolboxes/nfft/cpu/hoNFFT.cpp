@@ -16,12 +16,35 @@
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <limits>
 #include <boost/make_shared.hpp>
 
 using namespace std;
 
 namespace Gadgetron{
 
+    namespace
+    {
+        // Gather batch arrays of n elements each into one array with the batch index running fastest,
+        // so that the convolutions can apply each kernel weight to all batch members in one contiguous loop
+        template<class T> const T* interleave(const T* in, size_t n, size_t batch, std::vector<T>& buffer)
+        {
+            if(batch == 1)
+                return in;
+
+            buffer.resize(n*batch);
+            T* out = &buffer[0];
+
+            long long i;
+#pragma omp parallel for
+            for(i = 0; i < (long long)n; i++)
+                for(size_t b = 0; b < batch; b++)
+                    out[i*batch+b] = in[b*n+i];
+
+            return out;
+        }
+    }
+
     template<class Real, unsigned int D>
     hoNFFT_plan<Real, D>::hoNFFT_plan()
     {
@@ -32,7 +55,8 @@ namespace Gadgetron{
     hoNFFT_plan<Real, D>::hoNFFT_plan(
         typename uint64d<D>::Type n,
         Real osf,
-        Real wg
+        Real wg,
+        NFFT_kernel kernel
     )
     {
         if(osf < Real(1.0))
@@ -53,6 +77,43 @@ namespace Gadgetron{
         this->n = n;
         this->osf = osf;
         this->wg = wg;
+        this->prep_mode = NFFT_PREP_NONE;
+        this->kernel = kernel;
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::select_parameters(
+        Real tolerance,
+        size_t n,
+        Real& osf,
+        Real& wg
+    )
+    {
+        if(tolerance <= Real(0) || tolerance >= Real(1))
+            throw std::runtime_error("Tolerance must be between 0 and 1");
+
+        if(n == 0)
+            throw std::runtime_error("Matrix size must be positive");
+
+        // Kernel widths from Barnett et al., "A parallel non-uniform fast
+        // Fourier transform library based on an exponential of semicircle kernel"
+        Real sigma = (tolerance >= Real(1e-9)) ? Real(1.25) : Real(2.0);
+        Real width;
+        if(sigma == Real(2.0))
+            width = std::ceil(-std::log10(tolerance/10));
+        else
+            width = std::ceil(-std::log(tolerance)/(M_PI*std::sqrt(1-1/sigma)));
+        width = std::max(width, Real(2));
+        width = std::min(width, Real(16));
+
+        size_t grid = (size_t)std::ceil(sigma*n/2)*2;
+        osf = Real(grid)/Real(n);
+
+        // the oversampled size is taken as osf*n rounded down throughout
+        while((size_t)(osf*n) < grid)
+            osf = std::nextafter(osf, Real(2)*osf);
+
+        wg = width;
     }
 
     template<class Real, unsigned int D>
@@ -63,7 +124,8 @@ namespace Gadgetron{
 
     template<class Real, unsigned int D>
     void hoNFFT_plan<Real, D>::preprocess(
-        const hoNDArray<typename reald<Real, D>::Type>& k
+        const hoNDArray<typename reald<Real, D>::Type>& k,
+        NFFT_prep_mode mode
     )
     {
         if(k.get_number_of_elements() == 0)
@@ -75,7 +137,18 @@ namespace Gadgetron{
                  throw std::runtime_error("Trajectory must be between [-0.5,0.5]");
 
         this->k = k;
+        this->prep_mode = mode;
         initialize();
+
+        if(mode == NFFT_PREP_SPARSE_MATRIX){
+            build_sparse_matrices();
+            tile_ptr.clear();
+            tile_samples.clear();
+        }else{
+            C2NC_matrix = SparseMatrix();
+            NC2C_matrix = SparseMatrix();
+            bin_samples();
+        }
     }
 
     template<class Real, unsigned int D>
@@ -113,7 +186,7 @@ namespace Gadgetron{
                 convolve(d, m, NFFT_CONV_C2NC);
                 
                 if(w.get_number_of_elements() != 0){
-                    if(m.get_number_of_elements() != w.get_number_of_elements())
+                    if(m.get_number_of_elements() % w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     m /= w;
@@ -122,7 +195,7 @@ namespace Gadgetron{
             }
             case NFFT_FORWARDS_NC2C:{
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != d.get_number_of_elements())
+                    if(d.get_number_of_elements() % w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompitalbe dimensions");
 
                     d *= w;
@@ -136,7 +209,7 @@ namespace Gadgetron{
             }
             case NFFT_BACKWARDS_NC2C:{
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != d.get_number_of_elements())
+                    if(d.get_number_of_elements() % w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     d *= w;
@@ -154,7 +227,7 @@ namespace Gadgetron{
                 convolve(d, m, NFFT_CONV_C2NC);
 
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != m.get_number_of_elements())
+                    if(m.get_number_of_elements() % w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     m *= w;
@@ -183,8 +256,11 @@ namespace Gadgetron{
     )
     {
         hoNDArray<Real> w((size_t)0);
-        hoNDArray<ComplexType> tmp;
-        tmp.create(n[0]*osf,n[1]*osf);
+        std::vector<size_t> dims;
+        for(size_t d = 0; d < D; d++)
+            dims.push_back(grid_size(d));
+        dims.push_back(in.get_number_of_elements()/k.get_number_of_elements());
+        hoNDArray<ComplexType> tmp(dims);
         compute(in, tmp, w, NFFT_BACKWARDS_NC2C);
         compute(tmp, out, w, NFFT_FORWARDS_C2NC);
     }
@@ -245,12 +321,12 @@ namespace Gadgetron{
     )
     {
         if(fourierDomain){
-            if(da.get_number_of_elements() != d.get_number_of_elements())
+            if(d.get_number_of_elements() % da.get_number_of_elements() != 0)
                 throw std::runtime_error("Incompatiblef deapodization dimensions");
             
             d *= da;
         }else{
-            if(da.get_number_of_elements() != d.get_number_of_elements())
+            if(d.get_number_of_elements() % da.get_number_of_elements() != 0)
                 throw std::runtime_error("Incompatible deapodization dimensions");
 
             d /= da;
@@ -263,26 +339,34 @@ namespace Gadgetron{
         kosf = std::floor(0.91/(osf*1e-3));
         kwidth = osf*kw/2;
 
-        Real tmp = kw*(osf-0.5);
-        beta = M_PI*std::sqrt(tmp*tmp-0.8);
-
-        p.create(kosf*kwidth+1);
-        for(size_t i = 0; i < kosf*kwidth+1; i++){
-            Real om = Real(i)/Real(kosf*kwidth);
-            p[i] = bessi0(beta*std::sqrt(1-om*om));
-        }
-        Real pConst = p[0];
-        for(auto it = p.begin(); it != p.end(); it++)
-            *it /= pConst;
-        p[kosf*kwidth] = 0;
-        
-        // Need to fix to allow for flexibility in dimensions
         hoNDArray<Real> dax(osf*n[0]);
-        for(int i = 0; i < osf*n[0]; i++){
-            Real x = (i-osf*n[0]/2)/n[0];
-            Real tmp = M_PI*M_PI*kw*kw*x*x-beta*beta;
-            auto sqa = std::sqrt(complex<Real>(tmp, 0));
-            dax[i] = (std::sin(sqa)/sqa).real();
+
+        if(kernel == NFFT_KERNEL_EXP_SEMICIRCLE){
+            es_beta = 0.97*M_PI*(1-1/(2*osf))*wg;
+
+            for(int i = 0; i < osf*n[0]; i++)
+                dax[i] = es_fourier((i-osf*n[0]/2)/(osf*n[0]));
+        }else{
+            Real tmp = kw*(osf-0.5);
+            beta = M_PI*std::sqrt(tmp*tmp-0.8);
+
+            p.create(kosf*kwidth+1);
+            for(size_t i = 0; i < p.get_number_of_elements(); i++){
+                Real om = Real(i)/Real(kosf*kwidth);
+                p[i] = bessi0(beta*std::sqrt(1-om*om));
+            }
+            Real pConst = p[0];
+            for(auto it = p.begin(); it != p.end(); it++)
+                *it /= pConst;
+            p[kosf*kwidth] = 0;
+
+            // Need to fix to allow for flexibility in dimensions
+            for(int i = 0; i < osf*n[0]; i++){
+                Real x = (i-osf*n[0]/2)/n[0];
+                Real tmp = M_PI*M_PI*kw*kw*x*x-beta*beta;
+                auto sqa = std::sqrt(complex<Real>(tmp, 0));
+                dax[i] = (std::sin(sqa)/sqa).real();
+            }
         }
         auto daxConst = dax[osf*n[0]/2-1];
         for(auto it = dax.begin(); it != dax.end(); it++)
@@ -314,8 +398,8 @@ namespace Gadgetron{
                 da.create(osf*n[0], osf*n[1], osf*n[2]);
                 for(size_t i = 0; i < osf*n[0]; i++)
                     for(size_t j = 0; j < osf*n[1]; j++)
-                        for(size_t k = 0; k < osf*n[3]; k++)
-                            da[i+n[1]*j*osf+n[2]*k*osf] = dax[i]*dax[j]*dax[k];
+                        for(size_t k = 0; k < osf*n[2]; k++)
+                            da[i+(j+k*n[1]*osf)*n[0]*osf] = dax[i]*dax[j]*dax[k];
                 nx.create(k.get_number_of_elements());
                 ny.create(k.get_number_of_elements());
                 nz.create(k.get_number_of_elements());
@@ -328,99 +412,366 @@ namespace Gadgetron{
                 
             }
         }
+
+        tap_offsets.clear();
+        for(int l = -kwidth; l < kwidth+1; l++)
+            tap_offsets.push_back(l);
     }
 
     template<class Real, unsigned int D>
-    void hoNFFT_plan<Real, D>::convolve_NFFT_C2NC(
-        hoNDArray<ComplexType> &m,
-        hoNDArray<ComplexType> &d
+    size_t hoNFFT_plan<Real, D>::taps_per_sample()
+    {
+        size_t taps = 1;
+        for(size_t d = 0; d < D; d++)
+            taps *= tap_offsets.size();
+        return taps;
+    }
+
+    template<class Real, unsigned int D>
+    size_t hoNFFT_plan<Real, D>::grid_size(size_t dim)
+    {
+        return (size_t)(osf*n[dim]);
+    }
+
+    template<class Real, unsigned int D>
+    size_t hoNFFT_plan<Real, D>::grid_elements()
+    {
+        size_t cells = 1;
+        for(size_t d = 0; d < D; d++)
+            cells *= grid_size(d);
+        return cells;
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::sample_weights(
+        size_t i,
+        long long* pos,
+        Real* w
     )
     {
-        switch(D){
-            case 1:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        Real nxt = std::round(nx[i]+lx);
-                        Real kkx = std::min(
-                            std::round(kosf*std::abs(nx[i]-nxt)),
-                            std::floor(kosf*kwidth)
-                        );
-                        Real kwx = p[kkx];
-                        nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                        d[i] += m[(size_t)nxt]*kwx;
-                    }
+        hoNDArray<Real>* coords[3] = {&nx, &ny, &nz};
+        const size_t L = tap_offsets.size();
+
+        if(kernel == NFFT_KERNEL_EXP_SEMICIRCLE){
+            for(size_t d = 0; d < D; d++){
+                Real x = (*coords[d])[i];
+                for(size_t l = 0; l < L; l++){
+                    Real xt = std::round(x+tap_offsets[l]);
+                    w[d*L+l] = (x-xt)/kwidth;
+                    pos[d*L+l] = (long long)xt;
                 }
-                break;                
             }
-            case 2:{
-                d.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            Real nxt = std::round(nx[i]+lx);
-                            Real nyt = std::round(ny[i]+ly);
-
-                            Real kkx = std::min(
-                                std::round(kosf*std::abs(nx[i]-nxt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kky = std::min(
-                                std::round(kosf*std::abs(ny[i]-nyt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kwx = p[kkx]; Real kwy = p[kky];
-
-                            nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                            nyt = std::max(nyt, Real(0)); nyt = std::min(nyt, osf*n[1]-1);
-
-                            d[i] += m[(size_t)(nxt+nyt*osf*n[1])]*kwx*kwy;
-                        }
-                    }
+
+            // branch free, so the compiler can vectorize the exponentials
+            for(size_t e = 0; e < D*L; e++){
+                Real t = std::max(1-w[e]*w[e], Real(0));
+                w[e] = std::exp(es_beta*(std::sqrt(t)-1))*Real(t > 0);
+            }
+            return;
+        }
+
+        const Real kmax = std::floor(kosf*kwidth);
+
+        for(size_t d = 0; d < D; d++){
+            Real x = (*coords[d])[i];
+            for(size_t l = 0; l < L; l++){
+                Real xt = std::round(x+tap_offsets[l]);
+                Real kk = std::min(std::round(kosf*std::abs(x-xt)), kmax);
+                w[d*L+l] = p[(size_t)kk];
+                pos[d*L+l] = (long long)xt;
+            }
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::bin_samples()
+    {
+        hoNDArray<Real>* coords[3] = {&nx, &ny, &nz};
+        const size_t samples = k.get_number_of_elements();
+
+        // Taps reach from about round(x)+tap_offsets.front() to round(x)+tap_offsets.back(),
+        // with a margin for rounding and for samples on the upper grid edge
+        tile_pad = (size_t)std::max(-tap_offsets.front(), tap_offsets.back())+2;
+        tile_size = std::max<size_t>(D == 1 ? 256 : (D == 2 ? 32 : 16), 2*tile_pad);
+
+        size_t numTiles = 1;
+        tiles_per_dim.resize(D);
+        for(size_t d = 0; d < D; d++){
+            tiles_per_dim[d] = (grid_size(d)+tile_size-1)/tile_size;
+            numTiles *= tiles_per_dim[d];
+        }
+
+        std::vector<size_t> tile_of(samples);
+        for(size_t i = 0; i < samples; i++){
+            size_t t = 0, stride = 1;
+            for(size_t d = 0; d < D; d++){
+                Real x = std::round((*coords[d])[i]);
+                x = std::max(x, Real(0)); x = std::min(x, Real(grid_size(d)-1));
+                t += ((size_t)x/tile_size)*stride;
+                stride *= tiles_per_dim[d];
+            }
+            tile_of[i] = t;
+        }
+
+        // counting sort, samples keep their order within a tile
+        tile_ptr.assign(numTiles+1, 0);
+        for(size_t i = 0; i < samples; i++)
+            tile_ptr[tile_of[i]+1]++;
+        for(size_t t = 0; t < numTiles; t++)
+            tile_ptr[t+1] += tile_ptr[t];
+
+        tile_samples.resize(samples);
+        std::vector<size_t> fill(tile_ptr.begin(), tile_ptr.end()-1);
+        for(size_t i = 0; i < samples; i++)
+            tile_samples[fill[tile_of[i]]++] = i;
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::sample_taps(
+        size_t i,
+        size_t* idx,
+        Real* w
+    )
+    {
+        const size_t L = tap_offsets.size();
+
+        std::vector<long long> pos(D*L);
+        std::vector<Real> gw(D*L);
+        sample_weights(i, &pos[0], &gw[0]);
+
+        std::vector<size_t> gi(D*L);
+        for(size_t d = 0; d < D; d++){
+            long long last = (long long)grid_size(d)-1;
+            for(size_t l = 0; l < L; l++)
+                gi[d*L+l] = (size_t)std::min(std::max(pos[d*L+l], 0LL), last);
+        }
+
+        // taps are enumerated with the last dimension running fastest
+        const size_t taps = taps_per_sample();
+        for(size_t t = 0; t < taps; t++){
+            size_t rem = t;
+            size_t index = 0;
+            size_t stride = 1;
+            Real weight = 1;
+            size_t digit[D];
+            for(size_t d = D; d-- > 0;){
+                digit[d] = rem % L;
+                rem /= L;
+            }
+            for(size_t d = 0; d < D; d++){
+                index += gi[d*L+digit[d]]*stride;
+                weight *= gw[d*L+digit[d]];
+                stride *= grid_size(d);
+            }
+            idx[t] = index;
+            w[t] = weight;
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::build_sparse_matrices()
+    {
+        const size_t samples = k.get_number_of_elements();
+        const size_t taps = taps_per_sample();
+
+        const size_t cells = grid_elements();
+
+        if(cells > std::numeric_limits<unsigned int>::max() || samples > std::numeric_limits<unsigned int>::max())
+            throw std::runtime_error("hoNFFT_plan: problem too large for the sparse matrix mode");
+
+        // sample to grid weights, one row per sample
+        SparseMatrix& A = C2NC_matrix;
+        A.rows = samples;
+        A.cols = cells;
+        A.row_ptr.resize(samples+1);
+        A.col.resize(samples*taps);
+        A.val.resize(samples*taps);
+
+        long long ii;
+#pragma omp parallel
+        {
+            std::vector<size_t> idx(taps);
+            std::vector<Real> w(taps);
+
+#pragma omp for
+            for(ii = 0; ii < (long long)samples; ii++){
+                size_t i = (size_t)ii;
+                sample_taps(i, &idx[0], &w[0]);
+                A.row_ptr[i] = i*taps;
+                for(size_t t = 0; t < taps; t++){
+                    A.col[i*taps+t] = (unsigned int)idx[t];
+                    A.val[i*taps+t] = w[t];
                 }
-                break;
             }
-            case 3:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            for(int lz = -kwidth; lz = kwidth+1; lz++){
-                                Real nxt = std::round(nx[i]+lx);
-                                Real nyt = std::round(ny[i]+ly);
-                                Real nzt = std::round(nz[i]+lz);
-
-                                Real kkx = std::min(
-                                    std::round(kosf*std::abs(nx[i]-nxt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kky = std::min(
-                                    std::round(kosf*std::abs(ny[i]-nyt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kkz = std::min(
-                                    std::round(kosf*std::abs(nz[i]-nzt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kwx = p[kkx];
-                                Real kwy = p[kky];
-                                Real kwz = p[kkz];
-
-                                nxt = std::max(nxt, Real(0));
-                                nxt = std::min(nxt, osf*n[0]-1);
-
-                                nyt = std::max(nxt, Real(0));
-                                nyt = std::min(nyt, osf*n[1]-1);
-
-                                nzt = std::max(nzt, Real(0));
-                                nzt = std::min(nzt, osf*n[2]-1);
-
-                                d[i] += m[(size_t)(nxt+nyt*osf*n[1]+nzt*osf*n[2])]*kwx*kwy*kwz;
+        }
+        A.row_ptr[samples] = samples*taps;
+
+        // transpose, one row per grid cell; entries stay in sample order
+        // so the accumulation order matches the on the fly convolution
+        SparseMatrix& AT = NC2C_matrix;
+        AT.rows = cells;
+        AT.cols = samples;
+        AT.row_ptr.assign(cells+1, 0);
+        AT.col.resize(A.col.size());
+        AT.val.resize(A.val.size());
+
+        for(size_t e = 0; e < A.col.size(); e++)
+            AT.row_ptr[A.col[e]+1]++;
+        for(size_t c = 0; c < cells; c++)
+            AT.row_ptr[c+1] += AT.row_ptr[c];
+
+        std::vector<size_t> fill(AT.row_ptr.begin(), AT.row_ptr.end()-1);
+        for(size_t i = 0; i < samples; i++){
+            for(size_t e = A.row_ptr[i]; e < A.row_ptr[i+1]; e++){
+                size_t pos = fill[A.col[e]]++;
+                AT.col[pos] = (unsigned int)i;
+                AT.val[pos] = A.val[e];
+            }
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::sparse_mult(
+        const SparseMatrix& M,
+        const ComplexType* in,
+        ComplexType* out,
+        size_t batch
+    )
+    {
+        long long r;
+#pragma omp parallel
+        {
+            std::vector<ComplexType> sum(batch);
+
+#pragma omp for schedule(dynamic, 256)
+            for(r = 0; r < (long long)M.rows; r++){
+                std::fill(sum.begin(), sum.end(), ComplexType(0));
+                for(size_t e = M.row_ptr[r]; e < M.row_ptr[r+1]; e++){
+                    const ComplexType* x = in+(size_t)M.col[e]*batch;
+                    const Real v = M.val[e];
+                    for(size_t b = 0; b < batch; b++)
+                        sum[b] += x[b]*v;
+                }
+                for(size_t b = 0; b < batch; b++)
+                    out[b*M.rows+r] = sum[b];
+            }
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::clear_grid_boundary(
+        hoNDArray<ComplexType> &m
+    )
+    {
+        const size_t G = grid_elements();
+
+        for(size_t b = 0; b < m.get_number_of_elements()/G; b++){
+            ComplexType* pm = m.get_data_ptr()+b*G;
+
+            if(D == 1){
+                pm[0] = 0;
+                pm[G-1] = 0;
+                continue;
+            }
+
+            for(size_t i = 0; i < n[0]*osf; i++){
+                pm[i] = 0;
+                pm[(size_t)(n[0]*osf+i)] = 0;
+                pm[(size_t)(n[0]*osf*(n[0]*osf-1)+i)] = 0;
+                pm[(size_t)(n[0]*osf*i+(n[0]*osf-1))] = 0;
+            }
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::convolve_NFFT_C2NC(
+        hoNDArray<ComplexType> &m,
+        hoNDArray<ComplexType> &d
+    )
+    {
+        const size_t G = grid_elements();
+        const size_t Ns = k.get_number_of_elements();
+        const size_t B = m.get_number_of_elements()/G;
+
+        if(B == 0 || m.get_number_of_elements() != G*B || d.get_number_of_elements() != Ns*B)
+            throw std::runtime_error("Incompatible convolution dimensions");
+
+        std::vector<ComplexType> buffer;
+        const ComplexType* mI = interleave(m.get_data_ptr(), G, B, buffer);
+        ComplexType* pd = d.get_data_ptr();
+
+        if(prep_mode == NFFT_PREP_SPARSE_MATRIX){
+            sparse_mult(C2NC_matrix, mI, pd, B);
+            return;
+        }
+
+        // Every sample only reads from the grid, so the tiles are
+        // processed in parallel; tiles keep the reads cache local
+        const size_t L = tap_offsets.size();
+        const size_t numTiles = tile_ptr.size()-1;
+
+        size_t stride[D];
+        stride[0] = B;
+        for(size_t dim = 1; dim < D; dim++)
+            stride[dim] = stride[dim-1]*grid_size(dim-1);
+
+        long long tt;
+#pragma omp parallel
+        {
+            std::vector<long long> pos(D*L);
+            std::vector<Real> w(D*L);
+            std::vector<size_t> idx(D*L);
+            std::vector<ComplexType> sum(B);
+
+#pragma omp for schedule(dynamic)
+            for(tt = 0; tt < (long long)numTiles; tt++){
+                for(size_t s = tile_ptr[tt]; s < tile_ptr[tt+1]; s++){
+                    size_t i = tile_samples[s];
+                    sample_weights(i, &pos[0], &w[0]);
+
+                    for(size_t dim = 0; dim < D; dim++){
+                        long long last = (long long)grid_size(dim)-1;
+                        for(size_t l = 0; l < L; l++)
+                            idx[dim*L+l] = (size_t)std::min(std::max(pos[dim*L+l], 0LL), last)*stride[dim];
+                    }
+
+                    std::fill(sum.begin(), sum.end(), ComplexType(0));
+                    switch(D){
+                        case 1:{
+                            for(size_t lx = 0; lx < L; lx++){
+                                const ComplexType* x = mI+idx[lx];
+                                const Real wt = w[lx];
+                                for(size_t b = 0; b < B; b++)
+                                    sum[b] += x[b]*wt;
                             }
+                            break;
+                        }
+                        case 2:{
+                            for(size_t lx = 0; lx < L; lx++)
+                                for(size_t ly = 0; ly < L; ly++){
+                                    const ComplexType* x = mI+idx[lx]+idx[L+ly];
+                                    const Real wt = w[lx]*w[L+ly];
+                                    for(size_t b = 0; b < B; b++)
+                                        sum[b] += x[b]*wt;
+                                }
+                            break;
+                        }
+                        case 3:{
+                            for(size_t lx = 0; lx < L; lx++)
+                                for(size_t ly = 0; ly < L; ly++)
+                                    for(size_t lz = 0; lz < L; lz++){
+                                        const ComplexType* x = mI+idx[lx]+idx[L+ly]+idx[2*L+lz];
+                                        const Real wt = w[lx]*w[L+ly]*w[2*L+lz];
+                                        for(size_t b = 0; b < B; b++)
+                                            sum[b] += x[b]*wt;
+                                    }
+                            break;
                         }
                     }
+
+                    for(size_t b = 0; b < B; b++)
+                        pd[b*Ns+i] = sum[b];
                 }
-                break;    
             }
         }
     }
@@ -431,115 +782,147 @@ namespace Gadgetron{
         hoNDArray<ComplexType> &m
     )
     {
-        switch(D){
-            case 1:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        Real nxt = std::round(nx[i]+lx);
-                        Real kkx = std::min(
-                            std::round(kosf*std::abs(nx[i]-nxt)),
-                            std::floor(kosf*kwidth)
-                        );
-                        Real kwx = p[kkx];
-                        nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                        m[(size_t)nxt] += dw*kwx;
-                    }
-                }
+        const size_t G = grid_elements();
+        const size_t Ns = k.get_number_of_elements();
+        const size_t B = d.get_number_of_elements()/Ns;
 
-                m[0] = 0;
-                m[m.get_number_of_elements()] = 0;
-                break;
-            }
-            case 2:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            Real nxt = std::round(nx[i]+lx);
-                            Real nyt = std::round(ny[i]+ly);
-
-                            Real kkx = std::min(
-                                std::round(kosf*std::abs(nx[i]-nxt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kky = std::min(
-                                std::round(kosf*std::abs(ny[i]-nyt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kwx = p[kkx]; Real kwy = p[kky];
-
-                            nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                            nyt = std::max(nyt, Real(0)); nyt = std::min(nyt, osf*n[1]-1);
-
-                            m[(size_t)(nxt+nyt*osf*n[1])] += dw*kwx*kwy;
-                        }
-                    }
+        if(B == 0 || d.get_number_of_elements() != Ns*B || m.get_number_of_elements() != G*B)
+            throw std::runtime_error("Incompatible convolution dimensions");
 
-                    for(size_t i = 0; i < n[0]*osf; i++){
-                        m[i] = 0;
-                        m[n[0]*osf+i] = 0;
-                        m[n[0]*osf*(n[0]*osf-1)+i] = 0;
-                        m[n[0]*osf*i+(n[0]*osf-1)] = 0;
+        std::vector<ComplexType> buffer;
+        const ComplexType* dI = interleave(d.get_data_ptr(), Ns, B, buffer);
+        ComplexType* pm = m.get_data_ptr();
+
+        if(prep_mode == NFFT_PREP_SPARSE_MATRIX){
+            sparse_mult(NC2C_matrix, dI, pm, B);
+            clear_grid_boundary(m);
+            return;
+        }
+
+        // Each tile is gridded into a thread private padded sub-grid, which is
+        // then added to the grid. Tiles are at least two paddings wide, so tiles
+        // of the same colour (parity of the tile coordinates) never overlap and
+        // are merged without synchronization, one colour at a time.
+        const size_t L = tap_offsets.size();
+        const size_t numTiles = tile_ptr.size()-1;
+        const size_t S = tile_size+2*tile_pad;
+
+        size_t stride[D], subStride[D];
+        stride[0] = 1;
+        subStride[0] = B;
+        for(size_t dim = 1; dim < D; dim++){
+            stride[dim] = stride[dim-1]*grid_size(dim-1);
+            subStride[dim] = subStride[dim-1]*S;
+        }
+        const size_t subCells = subStride[D-1]*S/B;
+
+        m.fill(0);
+
+        for(size_t colour = 0; colour < (size_t(1) << D); colour++){
+            long long tt;
+#pragma omp parallel
+            {
+                std::vector<ComplexType> sub(subCells*B);
+                std::vector<long long> pos(D*L);
+                std::vector<Real> w(D*L);
+                std::vector<size_t> idx(D*L);
+
+#pragma omp for schedule(dynamic)
+                for(tt = 0; tt < (long long)numTiles; tt++){
+                    if(tile_ptr[tt] == tile_ptr[tt+1])
+                        continue;
+
+                    long long origin[D];
+                    size_t t = (size_t)tt, tileColour = 0;
+                    for(size_t dim = 0; dim < D; dim++){
+                        size_t c = t % tiles_per_dim[dim];
+                        t /= tiles_per_dim[dim];
+                        tileColour |= (c & 1) << dim;
+                        origin[dim] = (long long)(c*tile_size)-(long long)tile_pad;
                     }
-                }
-                break;
-            }
-            case 3:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            for(int lz = -kwidth; lz = kwidth+1; lz++){
-                                Real nxt = std::round(nx[i]+lx);
-                                Real nyt = std::round(ny[i]+ly);
-                                Real nzt = std::round(nz[i]+lz);
-
-                                Real kkx = std::min(
-                                    std::round(kosf*std::abs(nx[i]-nxt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kky = std::min(
-                                    std::round(kosf*std::abs(ny[i]-nyt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kkz = std::min(
-                                    std::round(kosf*std::abs(nz[i]-nzt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kwx = p[kkx];
-                                Real kwy = p[kky];
-                                Real kwz = p[kkz];
-
-                                nxt = std::max(nxt, Real(0));
-                                nxt = std::min(nxt, osf*n[0]-1);
-
-                                nyt = std::max(nxt, Real(0));
-                                nyt = std::min(nyt, osf*n[1]-1);
-
-                                nzt = std::max(nzt, Real(0));
-                                nzt = std::min(nzt, osf*n[2]-1);
-
-                                m[(size_t)(nxt+nyt*osf*n[1]+nzt*osf*n[2])] +=
-                                    dw*kwx*kwy*kwz;
+                    if(tileColour != colour)
+                        continue;
+
+                    std::fill(sub.begin(), sub.end(), ComplexType(0));
+
+                    for(size_t s = tile_ptr[tt]; s < tile_ptr[tt+1]; s++){
+                        size_t i = tile_samples[s];
+                        sample_weights(i, &pos[0], &w[0]);
+
+                        for(size_t dim = 0; dim < D; dim++)
+                            for(size_t l = 0; l < L; l++)
+                                idx[dim*L+l] = (size_t)(pos[dim*L+l]-origin[dim])*subStride[dim];
+
+                        const ComplexType* dw = dI+i*B;
+                        switch(D){
+                            case 1:{
+                                for(size_t lx = 0; lx < L; lx++){
+                                    ComplexType* y = &sub[idx[lx]];
+                                    const Real wt = w[lx];
+                                    for(size_t b = 0; b < B; b++)
+                                        y[b] += dw[b]*wt;
+                                }
+                                break;
+                            }
+                            case 2:{
+                                for(size_t lx = 0; lx < L; lx++)
+                                    for(size_t ly = 0; ly < L; ly++){
+                                        ComplexType* y = &sub[idx[lx]+idx[L+ly]];
+                                        const Real wt = w[lx]*w[L+ly];
+                                        for(size_t b = 0; b < B; b++)
+                                            y[b] += dw[b]*wt;
+                                    }
+                                break;
+                            }
+                            case 3:{
+                                for(size_t lx = 0; lx < L; lx++)
+                                    for(size_t ly = 0; ly < L; ly++)
+                                        for(size_t lz = 0; lz < L; lz++){
+                                            ComplexType* y = &sub[idx[lx]+idx[L+ly]+idx[2*L+lz]];
+                                            const Real wt = w[lx]*w[L+ly]*w[2*L+lz];
+                                            for(size_t b = 0; b < B; b++)
+                                                y[b] += dw[b]*wt;
+                                        }
+                                break;
                             }
                         }
                     }
-                }
 
-                for(size_t i = 0; i < n[0]*osf; i++){
-                    m[i] = 0;
-                    m[n[0]*osf+i] = 0;
-                    m[n[0]*osf*(n[0]*osf-1)+i] = 0;
-                    m[n[0]*osf*i+(n[0]*osf-1)] = 0;
-                    // Need to add two more
+                    // Add the sub-grid to the grid, clamping at the grid edges
+                    // as the kernel taps are clamped
+                    for(size_t e = 0; e < subCells; e++){
+                        size_t rem = e, index = 0;
+                        for(size_t dim = 0; dim < D; dim++){
+                            long long g = origin[dim]+(long long)(rem % S);
+                            rem /= S;
+                            g = std::min(std::max(g, 0LL), (long long)grid_size(dim)-1);
+                            index += (size_t)g*stride[dim];
+                        }
+                        for(size_t b = 0; b < B; b++)
+                            pm[b*G+index] += sub[e*B+b];
+                    }
                 }
-                break;
             }
         }
+
+        clear_grid_boundary(m);
+    }
+
+    template<class Real, unsigned int D>
+    Real hoNFFT_plan<Real, D>::es_fourier(Real f)
+    {
+        // midpoint rule over the kernel support; the kernel is smooth
+        // and nearly zero at its edges, so this converges quickly
+        const size_t M = (size_t)std::ceil(2*kwidth*64);
+        const Real h = 2*kwidth/M;
+
+        Real sum = 0;
+        for(size_t j = 0; j < M; j++){
+            Real t = -kwidth+(j+Real(0.5))*h;
+            Real z = t/kwidth;
+            sum += std::exp(es_beta*(std::sqrt(1-z*z)-1))*std::cos(2*M_PI*f*t);
+        }
+        return sum*h;
     }
 
     template<class Real, unsigned int D>
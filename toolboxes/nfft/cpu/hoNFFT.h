@@ -5,7 +5,10 @@
     Stanford Medical Image Reconstruction course lecture notes and 
     the Cuda version of the NFFT (cuNFFT)
 
-    Uses the Kaiser Bessel for convolution
+    Uses the Kaiser Bessel for convolution by default, or the
+    "exponential of semicircle" kernel exp(beta*(sqrt(1-z^2)-1))
+    of FINUFFT, which reaches a given accuracy with a narrower
+    kernel and a lower oversampling factor
 */
 
 #pragma once 
@@ -14,6 +17,7 @@
 #include "vector_td.h"
 #include "complext.h"
 #include <complex>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -46,6 +50,15 @@ namespace Gadgetron{
 
             hoNFFT_plan();
 
+            /**
+                Enum defining the convolution kernel
+            */
+
+            enum NFFT_kernel{
+                NFFT_KERNEL_KAISER_BESSEL, /** Kaiser Bessel, looked up from a table */
+                NFFT_KERNEL_EXP_SEMICIRCLE /** exponential of semicircle, evaluated directly */
+            };
+
             /**
                 Constructor defining the required NFFT parameters
 
@@ -54,12 +67,34 @@ namespace Gadgetron{
                 /param n: the non-oversampled matrix size to use for NFFT
                 /param osf: the oversampling factor
                 /param wg: the width of the oversampled kernel
+                /param kernel: the convolution kernel
             */
 
             hoNFFT_plan(
                 typename uint64d<D>::Type n,
                 Real osf,
-                Real wg
+                Real wg,
+                NFFT_kernel kernel = NFFT_KERNEL_KAISER_BESSEL
+            );
+
+            /**
+                Select the oversampling factor and kernel width of the exponential
+                of semicircle kernel for a target relative accuracy
+
+                An oversampling factor of 1.25 is used down to a tolerance of 1e-9,
+                2 below that; it is rounded up so the oversampled matrix size is even.
+
+                /param tolerance: the target relative accuracy
+                /param n: the non-oversampled matrix size
+                /param osf: output oversampling factor
+                /param wg: output width of the oversampled kernel
+            */
+
+            static void select_parameters(
+                Real tolerance,
+                size_t n,
+                Real& osf,
+                Real& wg
             );
 
             /** 
@@ -68,15 +103,29 @@ namespace Gadgetron{
 
             ~hoNFFT_plan();
 
+            /**
+                Enum defining the preprocessing mode
+            */
+
+            enum NFFT_prep_mode{
+                NFFT_PREP_NONE, /** kernel weights are computed in every convolution */
+                NFFT_PREP_SPARSE_MATRIX /** kernel weights are stored once in a sparse matrix and its transpose */
+            };
+
             /** 
                 Perform NFFT preprocessing for a given trajectory
 
+                With NFFT_PREP_SPARSE_MATRIX, both convolutions become parallel sparse
+                matrix-vector products, which pays off when many transforms are run on
+                the same trajectory, e.g. in iterative reconstructions.
+
                 \param k: the NFFT non cartesian trajectory
                 \param mode: enum specifying the preprocessing mode
             */
 
             void preprocess(
-                const hoNDArray<typename reald<Real, D>::Type>& k
+                const hoNDArray<typename reald<Real, D>::Type>& k,
+                NFFT_prep_mode mode = NFFT_PREP_NONE
             );
 
             /**
@@ -93,6 +142,10 @@ namespace Gadgetron{
             /**
                 Execute the NFFT
 
+                Arrays may hold a batch of coils or frames in their trailing dimensions,
+                e.g. [samples, coils] and [grid, coils]. All batch members are transformed
+                in one pass, with every kernel weight computed once and applied to all of them.
+
                 \param d: the input data array
                 \param m: the output matrix
                 \param w: optional density compensation if not iterative 
@@ -148,7 +201,7 @@ namespace Gadgetron{
             };
 
             /** 
-                Perform standalone convolution
+                Perform standalone convolution, batched over trailing dimensions as compute()
 
                 \param d: input array
                 \param m: output array
@@ -224,6 +277,82 @@ namespace Gadgetron{
                 hoNDArray<ComplexType> &m
             );
 
+            /**
+                Sparse matrix in compressed row storage, 
+                used for the precomputed convolutions
+            */
+
+            struct SparseMatrix{
+                size_t rows, cols;
+                std::vector<size_t> row_ptr;
+                std::vector<unsigned int> col;
+                std::vector<Real> val;
+            };
+
+            /**
+                Unclamped grid positions and kernel weights of one sample
+                along each dimension, tap_offsets.size() entries per dimension
+
+                \param i: sample index
+                \param pos: output grid positions
+                \param w: output kernel weights
+            */
+
+            void sample_weights(size_t i, long long* pos, Real* w);
+
+            /**
+                Sort the samples into grid tiles for the on the fly convolutions
+            */
+
+            void bin_samples();
+
+            /**
+                Grid indices and kernel weights of all taps of one sample,
+                in the order the convolutions visit them
+
+                \param i: sample index
+                \param idx: output grid indices, taps_per_sample() entries
+                \param w: output kernel weights, taps_per_sample() entries
+            */
+
+            void sample_taps(size_t i, size_t* idx, Real* w);
+
+            size_t taps_per_sample();
+
+            size_t grid_size(size_t dim);
+
+            size_t grid_elements();
+
+            /**
+                Build the sample to grid matrix and its transpose
+            */
+
+            void build_sparse_matrices();
+
+            /**
+                out = M*in for a batch of vectors, parallel over the rows of M
+
+                \param in: input vectors, interleaved with the batch index running fastest
+                \param out: output vectors, one after the other
+                \param batch: number of vectors
+            */
+
+            void sparse_mult(const SparseMatrix& M, const ComplexType* in, ComplexType* out, size_t batch);
+
+            /**
+                Clear the grid boundary after a non to cartesian convolution
+            */
+
+            void clear_grid_boundary(hoNDArray<ComplexType> &m);
+
+            /**
+                Fourier transform of the exponential of semicircle kernel
+
+                \param f: frequency in cycles per oversampled grid cell
+            */
+
+            Real es_fourier(Real f);
+
             /**
                 Bessel function
             */
@@ -246,6 +375,22 @@ namespace Gadgetron{
 
             hoNDArray<typename reald<Real, D>::Type> k;
 
+            NFFT_prep_mode prep_mode;
+
+            NFFT_kernel kernel;
+
+            Real es_beta;
+
+            // tap offsets along each dimension relative to the sample position
+            std::vector<int> tap_offsets;
+
+            // samples sorted by grid tile; tile t holds tile_samples[tile_ptr[t]] to tile_samples[tile_ptr[t+1]-1]
+            size_t tile_size, tile_pad;
+            std::vector<size_t> tiles_per_dim, tile_ptr, tile_samples;
+
+            // sample to grid (C2NC) and grid to sample (NC2C) convolution matrices
+            SparseMatrix C2NC_matrix, NC2C_matrix;
+
     };
 
 }
@@ -0,0 +1,596 @@
+#include "hoSPIRIT2DImageDomainOperator.h"
+#include "mri_core_spirit.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Gadgetron
+{
+
+template <typename T> std::mutex hoSPIRIT2DImageDomainOperator<T>::cache_mutex_;
+template <typename T> std::list< typename hoSPIRIT2DImageDomainOperator<T>::PixelKernelPtr > hoSPIRIT2DImageDomainOperator<T>::cache_;
+template <typename T> std::list< typename hoSPIRIT2DImageDomainOperator<T>::CalibKernelPtr > hoSPIRIT2DImageDomainOperator<T>::calib_cache_;
+template <typename T> size_t hoSPIRIT2DImageDomainOperator<T>::cache_size_ = (size_t)256 << 20;
+
+// FNV-1a hash over the 64 bit words of the kernel values
+template <typename T>
+static unsigned long long spirit_kernel_hash(const T* pKer, size_t N, unsigned long long h = 14695981039346656037ULL)
+{
+    const unsigned long long* pW = reinterpret_cast<const unsigned long long*>(pKer);
+    size_t W = N*sizeof(T) / sizeof(unsigned long long);
+
+    for (size_t n = 0; n < W; n++)
+    {
+        h ^= pW[n];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+// hash of the calibration data and parameters
+template <typename T>
+static unsigned long long spirit_calib_hash(const hoNDArray<T>& acsSrc, const hoNDArray<T>& acsDst, double reg_lamda, size_t kRO, size_t kE1, size_t RO, size_t E1)
+{
+    unsigned long long para[8];
+    para[0] = acsSrc.get_size(0);
+    para[1] = acsSrc.get_size(1);
+    para[2] = acsSrc.get_number_of_elements();
+    para[3] = acsDst.get_number_of_elements();
+    para[4] = kRO;
+    para[5] = kE1;
+    para[6] = RO + (E1 << 32);
+    std::memcpy(&para[7], &reg_lamda, sizeof(double));
+
+    unsigned long long h = spirit_kernel_hash(para, 8);
+    h = spirit_kernel_hash(acsSrc.begin(), acsSrc.get_number_of_elements(), h);
+    return spirit_kernel_hash(acsDst.begin(), acsDst.get_number_of_elements(), h);
+}
+
+template <typename T>
+bool hoSPIRIT2DImageDomainOperator<T>::CalibKernel::matches(const ARRAY_TYPE& src, const ARRAY_TYPE& dst, double lamda, size_t kro, size_t ke1, size_t ro, size_t e1, unsigned long long h) const
+{
+    if (hash != h || reg_lamda != lamda || kRO != kro || kE1 != ke1 || RO != ro || E1 != e1) return false;
+    if (!acsSrc.dimensions_equal(&src) || !acsDst.dimensions_equal(&dst)) return false;
+
+    return std::equal(src.begin(), src.end(), acsSrc.begin()) && std::equal(dst.begin(), dst.end(), acsDst.begin());
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::CalibKernel::number_of_bytes() const
+{
+    return acsSrc.get_number_of_bytes() + acsDst.get_number_of_bytes() + convKer.get_number_of_bytes() + kIm.get_number_of_bytes();
+}
+
+template <typename T>
+hoSPIRIT2DImageDomainOperator<T>::hoSPIRIT2DImageDomainOperator(std::vector<size_t> *dims) : BaseClass(dims)
+{
+}
+
+template <typename T>
+hoSPIRIT2DImageDomainOperator<T>::~hoSPIRIT2DImageDomainOperator()
+{
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::set_kernel_cache_size(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_size_ = bytes;
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::get_kernel_cache_size()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return cache_size_;
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::reserve_kernel_cache_size(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (bytes > cache_size_) cache_size_ = bytes;
+    return cache_size_;
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::clear_kernel_cache()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.clear();
+    calib_cache_.clear();
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::release_unused_kernels()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+
+    // a kernel only referenced by the cache is not used by any operator, nor being looked up
+    size_t num = 0;
+    typename std::list<PixelKernelPtr>::iterator it = cache_.begin();
+    while (it != cache_.end())
+    {
+        if (it->use_count() == 1)
+        {
+            it = cache_.erase(it);
+            num++;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // calibrated kernels are copied out, no operator holds them
+    num += calib_cache_.size();
+    calib_cache_.clear();
+
+    return num;
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_kernels()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return cache_.size();
+}
+
+template <typename T>
+size_t hoSPIRIT2DImageDomainOperator<T>::get_number_of_cached_calibrations()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return calib_cache_.size();
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::calib_image_domain_kernel(const ARRAY_TYPE& acsSrc, const ARRAY_TYPE& acsDst, double reg_lamda,
+                                                                 size_t kRO, size_t kE1, size_t RO, size_t E1, ARRAY_TYPE& convKer, ARRAY_TYPE& kIm)
+{
+    try
+    {
+        unsigned long long hash = spirit_calib_hash(acsSrc, acsDst, reg_lamda, kRO, kE1, RO, E1);
+
+        CalibKernelPtr ker;
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+
+            typename std::list<CalibKernelPtr>::iterator it;
+            for (it = calib_cache_.begin(); it != calib_cache_.end(); ++it)
+            {
+                if ((*it)->matches(acsSrc, acsDst, reg_lamda, kRO, kE1, RO, E1, hash))
+                {
+                    ker = *it;
+                    calib_cache_.splice(calib_cache_.begin(), calib_cache_, it);
+                    break;
+                }
+            }
+        }
+
+        if (!ker)
+        {
+            // computed outside the lock, entries are not changed once they are in the cache
+            ker = CalibKernelPtr(new CalibKernel());
+            ker->kRO = kRO;
+            ker->kE1 = kE1;
+            ker->RO = RO;
+            ker->E1 = E1;
+            ker->reg_lamda = reg_lamda;
+            ker->hash = hash;
+            ker->acsSrc = acsSrc;
+            ker->acsDst = acsDst;
+
+            Gadgetron::spirit2d_calib_convolution_kernel(acsSrc, acsDst, reg_lamda, kRO, kE1, 1, 1, ker->convKer, true);
+            Gadgetron::spirit2d_image_domain_kernel(ker->convKer, RO, E1, ker->kIm);
+
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+
+            // another thread may have added the same calibration meanwhile
+            typename std::list<CalibKernelPtr>::iterator it;
+            for (it = calib_cache_.begin(); it != calib_cache_.end(); ++it)
+            {
+                if ((*it)->matches(acsSrc, acsDst, reg_lamda, kRO, kE1, RO, E1, hash)) break;
+            }
+
+            if (it == calib_cache_.end())
+            {
+                calib_cache_.push_front(ker);
+                evict_calibrations();
+            }
+        }
+
+        if (!convKer.dimensions_equal(&ker->convKer)) convKer.create(ker->convKer.get_dimensions());
+        memcpy(convKer.begin(), ker->convKer.begin(), ker->convKer.get_number_of_bytes());
+
+        if (!kIm.dimensions_equal(&ker->kIm)) kIm.create(ker->kIm.get_dimensions());
+        memcpy(kIm.begin(), ker->kIm.begin(), ker->kIm.get_number_of_bytes());
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRIT2DImageDomainOperator<T>::calib_image_domain_kernel(...) ... ");
+    }
+}
+
+template <typename T>
+typename hoSPIRIT2DImageDomainOperator<T>::PixelKernelPtr hoSPIRIT2DImageDomainOperator<T>::find_or_create_pixel_kernel(const ARRAY_TYPE& forward_kernel)
+{
+    size_t RO = forward_kernel.get_size(0);
+    size_t E1 = forward_kernel.get_size(1);
+    size_t srcCHA = forward_kernel.get_size(2);
+    size_t dstCHA = forward_kernel.get_size(3);
+
+    size_t P = RO*E1;
+    size_t C = srcCHA*dstCHA;
+
+    const T* pKer = forward_kernel.begin();
+    unsigned long long hash = spirit_kernel_hash(pKer, forward_kernel.get_number_of_elements());
+
+    PixelKernelPtr res(new PixelKernel());
+    res->RO = RO;
+    res->E1 = E1;
+    res->srcCHA = srcCHA;
+    res->dstCHA = dstCHA;
+    res->hash = hash;
+
+    std::promise<void> forward_promise;
+    res->forward_ready = forward_promise.get_future().share();
+
+    // kernels of the same size and hash, the first caller adds its kernel before computing it
+    std::vector<PixelKernelPtr> candidates;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+
+        typename std::list<PixelKernelPtr>::iterator it;
+        for (it = cache_.begin(); it != cache_.end(); ++it)
+        {
+            const PixelKernel& ker = **it;
+            if (ker.hash == hash && ker.RO == RO && ker.E1 == E1 && ker.srcCHA == srcCHA && ker.dstCHA == dstCHA)
+            {
+                candidates.push_back(*it);
+            }
+        }
+
+        if (candidates.empty())
+        {
+            cache_.push_front(res);
+            evict_kernels();
+        }
+    }
+
+    // the values are compared as well, outside the lock, so a hash collision is never taken for a hit
+    for (size_t c = 0; c < candidates.size(); c++)
+    {
+        const PixelKernel& ker = *candidates[c];
+        ker.forward_ready.get();
+
+        bool equal = true;
+        for (size_t p = 0; p < P && equal; p++)
+        {
+            const T* pM = &ker.forward[p*C];
+            for (size_t d = 0; d < dstCHA && equal; d++)
+            {
+                for (size_t s = 0; s < srcCHA; s++)
+                {
+                    if (pM[d*srcCHA + s] != pKer[p + s*P + d*P*srcCHA])
+                    {
+                        equal = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (equal)
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            typename std::list<PixelKernelPtr>::iterator it = std::find(cache_.begin(), cache_.end(), candidates[c]);
+            if (it != cache_.end()) cache_.splice(cache_.begin(), cache_, it);
+            return candidates[c];
+        }
+    }
+
+    // a hash collision, the kernel is added next to the other one
+    if (!candidates.empty())
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        cache_.push_front(res);
+        evict_kernels();
+    }
+
+    // reorder the kernel to one matrix per pixel
+    try
+    {
+        res->forward.resize(P*C);
+        T* pM = &res->forward[0];
+
+        long long p;
+#pragma omp parallel for default(shared) private(p) if (P*C > 64*1024)
+        for (p = 0; p < (long long)P; p++)
+        {
+            for (size_t d = 0; d < dstCHA; d++)
+            {
+                for (size_t s = 0; s < srcCHA; s++)
+                {
+                    pM[p*C + d*srcCHA + s] = pKer[p + s*P + d*P*srcCHA];
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            cache_.remove(res);
+        }
+        forward_promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    forward_promise.set_value();
+    return res;
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::evict_kernels()
+{
+    // evict the least recently used kernels, the newest one is always kept
+    typename std::list<PixelKernelPtr>::iterator it = cache_.begin();
+    if (it == cache_.end()) return;
+
+    size_t bytes = (*it)->number_of_bytes();
+    for (++it; it != cache_.end(); ++it)
+    {
+        bytes += (*it)->number_of_bytes();
+        if (bytes > cache_size_) break;
+    }
+    cache_.erase(it, cache_.end());
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::evict_calibrations()
+{
+    typename std::list<CalibKernelPtr>::iterator it = calib_cache_.begin();
+    if (it == calib_cache_.end()) return;
+
+    size_t bytes = (*it)->number_of_bytes();
+    for (++it; it != calib_cache_.end(); ++it)
+    {
+        bytes += (*it)->number_of_bytes();
+        if (bytes > cache_size_) break;
+    }
+    calib_cache_.erase(it, calib_cache_.end());
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::compute_adjoint_forward(PixelKernel& ker)
+{
+    std::call_once(ker.adjoint_forward_flag, [&ker]()
+    {
+        size_t P = ker.num_pixels();
+        size_t srcCHA = ker.srcCHA;
+        size_t dstCHA = ker.dstCHA;
+        size_t C = srcCHA*dstCHA;
+        size_t CC = srcCHA*srcCHA;
+
+        ker.adjoint_forward.resize(P*CC);
+
+        const T* pM = &ker.forward[0];
+        T* pAF = &ker.adjoint_forward[0];
+
+        // (G-I)'(G-I) at every pixel, AF(s1, s2) = sum_d conj(M(d, s1)) * M(d, s2)
+        long long p;
+#pragma omp parallel for default(shared) private(p) if (P*CC > 64*1024)
+        for (p = 0; p < (long long)P; p++)
+        {
+            const T* pMp = pM + p*C;
+            T* pAFp = pAF + p*CC;
+
+            for (size_t s1 = 0; s1 < srcCHA; s1++)
+            {
+                for (size_t s2 = 0; s2 < srcCHA; s2++)
+                {
+                    T v(0);
+                    for (size_t d = 0; d < dstCHA; d++)
+                    {
+                        v += std::conj(pMp[d*srcCHA + s1]) * pMp[d*srcCHA + s2];
+                    }
+                    pAFp[s1*srcCHA + s2] = v;
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel)
+{
+    try
+    {
+        GADGET_CHECK_THROW(forward_kernel.get_number_of_dimensions() == 4);
+
+        std::vector<size_t> dim;
+        forward_kernel.get_dimensions(dim);
+        forward_kernel_.create(dim, forward_kernel.begin());
+
+        pixel_kernel_ = find_or_create_pixel_kernel(forward_kernel);
+
+        if (compute_adjoint_forward_kernel)
+        {
+            compute_adjoint_forward(*pixel_kernel_);
+        }
+
+        // allocate the helper memory, no buffer for the product of kernel and image is needed
+        std::vector<size_t> dimDst(3);
+        dimDst[0] = dim[0];
+        dimDst[1] = dim[1];
+        dimDst[2] = dim[3];
+
+        res_after_apply_kernel_sum_over_.create(dimDst);
+        kspace_dst_.create(dimDst);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRIT2DImageDomainOperator<T>::set_forward_kernel(...) ... ");
+    }
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::apply_pixel_matrices(const T* M, size_t rows, size_t cols, bool conj_transpose, const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    try
+    {
+        GADGET_CHECK_THROW(im.get_number_of_dimensions() >= 3);
+
+        size_t P = pixel_kernel_->num_pixels();
+        size_t C = rows*cols;
+
+        size_t numIn = conj_transpose ? rows : cols;
+        size_t numOut = conj_transpose ? cols : rows;
+
+        // im can hold a batch of systems sharing the kernel, [RO E1 CHA N]
+        size_t num = im.get_number_of_elements() / (P*numIn);
+        GADGET_CHECK_THROW(num*P*numIn == im.get_number_of_elements());
+
+        std::vector<size_t> dimR;
+        im.get_dimensions(dimR);
+        dimR[2] = numOut;
+
+        if (!r.dimensions_equal(&dimR))
+        {
+            r.create(dimR);
+        }
+
+        const T* pIm = im.begin();
+        T* pR = r.begin();
+
+        // pixels are processed in tiles, so the strided channel accesses of neighbouring pixels share cache lines
+        const size_t tile = 64;
+        size_t numTiles = (P + tile - 1) / tile;
+        long long numTasks = (long long)(numTiles*num);
+
+        long long t;
+#pragma omp parallel for default(shared) private(t) if (P*C*num > 64*1024)
+        for (t = 0; t < numTasks; t++)
+        {
+            size_t n = t / numTiles;
+            size_t p0 = (t - n*numTiles)*tile;
+            size_t p1 = std::min(p0 + tile, P);
+
+            const T* pImN = pIm + n*P*numIn;
+            T* pRN = pR + n*P*numOut;
+
+            for (size_t p = p0; p < p1; p++)
+            {
+                const T* pM = M + p*C;
+
+                if (conj_transpose)
+                {
+                    // (M')(o, i) = conj(M(i, o))
+                    for (size_t o = 0; o < numOut; o++)
+                    {
+                        T v(0);
+                        for (size_t i = 0; i < numIn; i++)
+                        {
+                            v += std::conj(pM[i*cols + o]) * pImN[i*P + p];
+                        }
+                        pRN[o*P + p] = v;
+                    }
+                }
+                else
+                {
+                    for (size_t o = 0; o < numOut; o++)
+                    {
+                        const T* pMo = pM + o*cols;
+
+                        T v(0);
+                        for (size_t i = 0; i < numIn; i++)
+                        {
+                            v += pMo[i] * pImN[i*P + p];
+                        }
+                        pRN[o*P + p] = v;
+                    }
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRIT2DImageDomainOperator<T>::apply_pixel_matrices(...) ... ");
+    }
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::apply_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    GADGET_CHECK_THROW(pixel_kernel_);
+    this->apply_pixel_matrices(&pixel_kernel_->forward[0], pixel_kernel_->dstCHA, pixel_kernel_->srcCHA, false, im, r);
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::apply_adjoint_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    GADGET_CHECK_THROW(pixel_kernel_);
+    this->apply_pixel_matrices(&pixel_kernel_->forward[0], pixel_kernel_->dstCHA, pixel_kernel_->srcCHA, true, im, r);
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::apply_adjoint_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    GADGET_CHECK_THROW(pixel_kernel_);
+    compute_adjoint_forward(*pixel_kernel_);
+    this->apply_pixel_matrices(&pixel_kernel_->adjoint_forward[0], pixel_kernel_->srcCHA, pixel_kernel_->srcCHA, false, im, r);
+}
+
+template <typename T>
+void hoSPIRIT2DImageDomainOperator<T>::mult_MH_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+{
+    try
+    {
+        if (accumulate)
+        {
+            kspace_dst_ = *y;
+        }
+
+        if (no_null_space_)
+        {
+            // (G-I)'(G-I)x
+            this->convert_to_image(*x, complexIm_);
+        }
+        else
+        {
+            // Dc(G-I)'(G-I)Dc'x
+            Gadgetron::multiply(unacquired_points_indicator_, *x, *y);
+            this->convert_to_image(*y, complexIm_);
+        }
+
+        // apply (G-I)'(G-I) in the image domain, no transform between (G-I) and (G-I)'
+        this->apply_adjoint_forward_kernel(complexIm_, res_after_apply_kernel_sum_over_);
+
+        // go back to kspace
+        this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
+
+        if (!no_null_space_)
+        {
+            // apply Dc
+            Gadgetron::multiply(unacquired_points_indicator_, *y, *y);
+        }
+
+        if (accumulate)
+        {
+            Gadgetron::add(kspace_dst_, *y, *y);
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRIT2DImageDomainOperator<T>::mult_MH_M(...) ... ");
+    }
+}
+
+// ------------------------------------------------------------
+// Instantiation
+// ------------------------------------------------------------
+
+template class EXPORTCPUOPERATOR hoSPIRIT2DImageDomainOperator< std::complex<float> >;
+template class EXPORTCPUOPERATOR hoSPIRIT2DImageDomainOperator< std::complex<double> >;
+
+}
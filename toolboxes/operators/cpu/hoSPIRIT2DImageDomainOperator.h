@@ -0,0 +1,160 @@
+/** \file       hoSPIRIT2DImageDomainOperator.h
+    \brief      Implement SPIRIT 2D operator with the kernels stored as per pixel channel mixing matrices
+
+                The image-domain kernel (G-I) is a CHA x CHA matrix at every pixel. Here these matrices are
+                stored pixel-major, i.e. the matrix of one pixel is contiguous, and applied as one small
+                matrix-vector product per pixel, instead of a full element-wise multiplication followed by
+                a sum over the source channels. (G-I)' is applied from the same matrices.
+
+                mult_MH_M applies Dc F (G-I)'(G-I) F' Dc', which needs one fft pair instead of the two of
+                mult_M followed by mult_MH; it is used by the cg solver.
+
+                The per pixel matrices of a kernel, including (G-I)'(G-I), are kept in a process wide cache
+                with least recently used eviction, keyed by the kernel size and a hash of the kernel values.
+                Operators set with the same kernel, e.g. one per thread or per slice, share the matrices
+                and only the first one computes them.
+
+                calib_image_domain_kernel keeps the kernels computed from calibration data in a second cache,
+                keyed by a hash of the calibration data and the calibration parameters. A repeated calibration
+                skips the kernel estimation and the transform to the image domain.
+*/
+
+#pragma once
+
+#include "hoSPIRIT2DOperator.h"
+#include <future>
+#include <list>
+#include <mutex>
+
+namespace Gadgetron {
+
+template <typename T>
+class EXPORTCPUOPERATOR hoSPIRIT2DImageDomainOperator : public hoSPIRIT2DOperator<T>
+{
+public:
+
+    typedef hoSPIRIT2DOperator<T> BaseClass;
+    typedef typename BaseClass::ARRAY_TYPE ARRAY_TYPE;
+    typedef typename BaseClass::REAL REAL;
+    typedef typename BaseClass::ELEMENT_TYPE ELEMENT_TYPE;
+
+    hoSPIRIT2DImageDomainOperator(std::vector<size_t> *dims);
+    virtual ~hoSPIRIT2DImageDomainOperator();
+
+    /// set forward kernel, find or compute its per pixel matrices
+    /// forward_kernel : [RO E1 srcCHA dstCHA]
+    /// if compute_adjoint_forward_kernel==false, (G-I)'(G-I) is computed when first needed
+    virtual void set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel=false);
+
+    /// apply Dc(G-I)'(G-I)Dc', with one fft pair
+    /// if no_null_space_==true, apply (G-I)'(G-I)
+    virtual void mult_MH_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+
+    /// compute the spirit convolution kernel and the image domain kernel from calibration data,
+    /// or take them from the cache if the same calibration was done before
+    /// acsSrc : [ref_RO ref_E1 srcCHA], acsDst : [ref_RO ref_E1 dstCHA]
+    /// reg_lamda, kRO, kE1 : as for spirit2d_calib_convolution_kernel, with minusI==true
+    /// convKer : [convKRO convKE1 srcCHA dstCHA], kIm : [RO E1 srcCHA dstCHA]
+    static void calib_image_domain_kernel(const ARRAY_TYPE& acsSrc, const ARRAY_TYPE& acsDst, double reg_lamda,
+                                          size_t kRO, size_t kE1, size_t RO, size_t E1, ARRAY_TYPE& convKer, ARRAY_TYPE& kIm);
+
+    /// maximal size in bytes of the kernels kept in the cache, default 256MB
+    /// the per pixel kernels and the calibrated kernels are limited separately
+    /// kernels in use by an operator are kept alive by the operator
+    static void set_kernel_cache_size(size_t bytes);
+    static size_t get_kernel_cache_size();
+
+    /// raise the maximal size to at least bytes, a smaller request leaves the cache as it is
+    /// return the maximal size in use afterwards
+    static size_t reserve_kernel_cache_size(size_t bytes);
+
+    /// remove all kernels from the cache
+    static void clear_kernel_cache();
+
+    /// remove the kernels no operator holds any more and the calibrated kernels, e.g. at the end of a job
+    /// return the number of removed kernels
+    static size_t release_unused_kernels();
+
+    /// number of kernels in the cache, including those still being computed
+    static size_t get_number_of_cached_kernels();
+
+    /// number of calibrated kernels in the cache
+    static size_t get_number_of_cached_calibrations();
+
+    using BaseClass::use_non_centered_fft_;
+    using BaseClass::no_null_space_;
+
+protected:
+
+    /// per pixel matrices of one kernel
+    struct PixelKernel
+    {
+        size_t RO, E1, srcCHA, dstCHA;
+        unsigned long long hash;
+
+        // (G-I), [srcCHA dstCHA num_pixels], the matrix of a pixel has srcCHA running fastest
+        std::vector<T> forward;
+        // ready once forward is filled in by the caller that added the kernel to the cache
+        std::shared_future<void> forward_ready;
+        // (G-I)'(G-I), [srcCHA srcCHA num_pixels], computed once on first use
+        std::vector<T> adjoint_forward;
+        std::once_flag adjoint_forward_flag;
+
+        size_t num_pixels() const { return RO*E1; }
+        size_t number_of_bytes() const { return (srcCHA*dstCHA + srcCHA*srcCHA)*RO*E1*sizeof(T); }
+    };
+
+    typedef boost::shared_ptr<PixelKernel> PixelKernelPtr;
+
+    /// kernels computed from one calibration
+    struct CalibKernel
+    {
+        size_t kRO, kE1, RO, E1;
+        double reg_lamda;
+        unsigned long long hash;
+
+        // kept to confirm a hit, the calibration data is much smaller than the kernels
+        ARRAY_TYPE acsSrc, acsDst;
+        ARRAY_TYPE convKer, kIm;
+
+        bool matches(const ARRAY_TYPE& src, const ARRAY_TYPE& dst, double lamda, size_t kro, size_t ke1, size_t ro, size_t e1, unsigned long long h) const;
+        size_t number_of_bytes() const;
+    };
+
+    typedef boost::shared_ptr<CalibKernel> CalibKernelPtr;
+
+    virtual void apply_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+    virtual void apply_adjoint_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+    virtual void apply_adjoint_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+
+    /// r = M*im at every pixel, or M'*im if conj_transpose==true
+    /// M : [cols rows num_pixels], im : [RO E1 CHA ...]
+    void apply_pixel_matrices(const T* M, size_t rows, size_t cols, bool conj_transpose, const ARRAY_TYPE& im, ARRAY_TYPE& r);
+
+    /// compute (G-I)'(G-I) of a kernel, if not done yet
+    static void compute_adjoint_forward(PixelKernel& ker);
+
+    /// find the kernel in the cache, or compute its per pixel matrices and add it
+    /// a kernel is added before it is computed, so concurrent callers with the same kernel wait for one computation
+    static PixelKernelPtr find_or_create_pixel_kernel(const ARRAY_TYPE& forward_kernel);
+
+    /// drop the least recently used kernels over the cache size, called with cache_mutex_ held
+    static void evict_kernels();
+    static void evict_calibrations();
+
+    PixelKernelPtr pixel_kernel_;
+
+    using BaseClass::forward_kernel_;
+    using BaseClass::unacquired_points_indicator_;
+
+    using BaseClass::complexIm_;
+    using BaseClass::kspace_dst_;
+    using BaseClass::res_after_apply_kernel_sum_over_;
+
+    static std::mutex cache_mutex_;
+    static std::list<PixelKernelPtr> cache_;
+    static std::list<CalibKernelPtr> calib_cache_;
+    static size_t cache_size_;
+};
+
+}
@@ -57,7 +57,7 @@ void hoSPIRIT2DTDataFidelityOperator<T>::forward(const ARRAY_TYPE& x, ARRAY_TYPE
         this->convert_to_image(x, this->complexIm_);
 
         // G-I
-        this->apply_forward_kernel(this->complexIm_);
+        this->apply_forward_kernel_per_kspace(this->complexIm_);
 
         this->convert_to_kspace(this->res_after_apply_kernel_sum_over_, y);
 
@@ -83,7 +83,7 @@ void hoSPIRIT2DTDataFidelityOperator<T>::adjoint(const ARRAY_TYPE& x, ARRAY_TYPE
         this->convert_to_image(x, this->complexIm_dst_);
 
         // (G-I)'
-        this->apply_adjoint_kernel(this->complexIm_dst_);
+        this->apply_adjoint_kernel_per_kspace(this->complexIm_dst_);
 
         this->convert_to_kspace(this->res_after_apply_kernel_sum_over_dst_, y);
 
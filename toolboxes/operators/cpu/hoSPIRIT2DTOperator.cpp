@@ -79,7 +79,7 @@ void hoSPIRIT2DTOperator<T>::set_forward_kernel(ARRAY_TYPE& forward_kernel, bool
 }
 
 template <typename T>
-void hoSPIRIT2DTOperator<T>::apply_forward_kernel(ARRAY_TYPE& x)
+void hoSPIRIT2DTOperator<T>::apply_forward_kernel_per_kspace(ARRAY_TYPE& x)
 {
     try
     {
@@ -117,7 +117,7 @@ void hoSPIRIT2DTOperator<T>::apply_forward_kernel(ARRAY_TYPE& x)
     }
     catch(...)
     {
-        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_forward_kernel(x) ... ");
+        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_forward_kernel_per_kspace(x) ... ");
     }
 }
 
@@ -145,7 +145,7 @@ void hoSPIRIT2DTOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulat
         }
 
         // apply kernel and sum
-        this->apply_forward_kernel(complexIm_);
+        this->apply_forward_kernel_per_kspace(complexIm_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
@@ -162,7 +162,7 @@ void hoSPIRIT2DTOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulat
 }
 
 template <typename T>
-void hoSPIRIT2DTOperator<T>::apply_adjoint_kernel(ARRAY_TYPE& x)
+void hoSPIRIT2DTOperator<T>::apply_adjoint_kernel_per_kspace(ARRAY_TYPE& x)
 {
     try
     {
@@ -200,7 +200,7 @@ void hoSPIRIT2DTOperator<T>::apply_adjoint_kernel(ARRAY_TYPE& x)
     }
     catch (...)
     {
-        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_adjoint_kernel(x) ... ");
+        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_adjoint_kernel_per_kspace(x) ... ");
     }
 }
 
@@ -220,7 +220,7 @@ void hoSPIRIT2DTOperator<T>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumula
         this->convert_to_image(*x, complexIm_dst_);
 
         // apply adjoint kernel and sum
-        this->apply_adjoint_kernel(complexIm_dst_);
+        this->apply_adjoint_kernel_per_kspace(complexIm_dst_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_dst_, *y);
@@ -262,7 +262,7 @@ void hoSPIRIT2DTOperator<T>::compute_righ_hand_side(const ARRAY_TYPE& x, ARRAY_T
             this->convert_to_image(x, complexIm_);
 
             // apply kernel and sum
-            this->apply_forward_kernel(complexIm_);
+            this->apply_forward_kernel_per_kspace(complexIm_);
 
             // go back to kspace 
             this->convert_to_kspace(res_after_apply_kernel_sum_over_, b);
@@ -278,7 +278,7 @@ void hoSPIRIT2DTOperator<T>::compute_righ_hand_side(const ARRAY_TYPE& x, ARRAY_T
 }
 
 template <typename T>
-void hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel(ARRAY_TYPE& x)
+void hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel_per_kspace(ARRAY_TYPE& x)
 {
     try
     {
@@ -314,7 +314,7 @@ void hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel(ARRAY_TYPE& x)
     }
     catch (...)
     {
-        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel(x) ... ");
+        GADGET_THROW("Errors in hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel_per_kspace(x) ... ");
     }
 }
 
@@ -346,7 +346,7 @@ void hoSPIRIT2DTOperator<T>::gradient(ARRAY_TYPE* x, ARRAY_TYPE* g, bool accumul
         }
 
         // apply kernel and sum
-        this->apply_adjoint_forward_kernel(complexIm_);
+        this->apply_adjoint_forward_kernel_per_kspace(complexIm_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_dst_, *g);
@@ -391,7 +391,7 @@ typename hoSPIRIT2DTOperator<T>::REAL hoSPIRIT2DTOperator<T>::magnitude(ARRAY_TY
         }
 
         // apply kernel and sum
-        this->apply_forward_kernel(complexIm_);
+        this->apply_forward_kernel_per_kspace(complexIm_);
 
         // L2 norm
         T obj(0);
@@ -25,7 +25,7 @@ public:
     /// set forward kernel, compute the adjoint and adjoint_forward kernel
     /// forward_kernel : [RO E1 srcCHA dstCHA Nor1]
     /// the number of kernels can be 1 or equal to the number of 2D kspaces
-    void set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel=false);
+    virtual void set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel=false);
 
     /// apply(G-I)Dc'
     /// x: [RO E1 srcCHA N]
@@ -83,9 +83,11 @@ protected:
     //using BaseClass::gt_timer3_;
     //using BaseClass::gt_exporter_;
 
-    void apply_forward_kernel(ARRAY_TYPE& x);
-    void apply_adjoint_kernel(ARRAY_TYPE& x);
-    void apply_adjoint_forward_kernel(ARRAY_TYPE& x);
+    /// apply the kernel of every 2D kspace, x : [RO E1 CHA N]
+    /// the forward kernel result is in res_after_apply_kernel_sum_over_, the others in res_after_apply_kernel_sum_over_dst_
+    void apply_forward_kernel_per_kspace(ARRAY_TYPE& x);
+    void apply_adjoint_kernel_per_kspace(ARRAY_TYPE& x);
+    void apply_adjoint_forward_kernel_per_kspace(ARRAY_TYPE& x);
 };
 
 }
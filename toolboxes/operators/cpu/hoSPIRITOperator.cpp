@@ -181,6 +181,81 @@ void hoSPIRITOperator<T>::sum_over_src_channel(const ARRAY_TYPE& x, ARRAY_TYPE&
     }
 }
 
+template<typename T>
+void hoSPIRITOperator<T>::apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    try
+    {
+        size_t NDim = kernel.get_number_of_dimensions();
+        GADGET_CHECK_THROW(NDim >= 2);
+
+        size_t srcCHA = kernel.get_size(NDim - 2);
+        size_t dstCHA = kernel.get_size(NDim - 1);
+
+        size_t imSize = kernel.get_number_of_elements() / dstCHA;
+        size_t rSize = imSize / srcCHA * dstCHA;
+
+        size_t num = im.get_number_of_elements() / imSize;
+        GADGET_CHECK_THROW(num*imSize == im.get_number_of_elements());
+
+        if (num == 1)
+        {
+            Gadgetron::multiply(kernel, im, res_after_apply_kernel_);
+            this->sum_over_src_channel(res_after_apply_kernel_, r);
+            return;
+        }
+
+        // a batch of systems after the channel dimension, [... srcCHA N], sharing the kernel
+        std::vector<size_t> dimR;
+        im.get_dimensions(dimR);
+        dimR[NDim - 2] = dstCHA;
+
+        if (!r.dimensions_equal(&dimR))
+        {
+            r.create(dimR);
+        }
+
+        std::vector<size_t> dimIm(NDim - 1), dimROne(NDim - 1);
+        for (size_t d = 0; d < NDim - 1; d++)
+        {
+            dimIm[d] = kernel.get_size(d);
+            dimROne[d] = kernel.get_size(d);
+        }
+        dimROne[NDim - 2] = dstCHA;
+
+        for (size_t n = 0; n < num; n++)
+        {
+            ARRAY_TYPE imN(dimIm, const_cast<T*>(im.begin()) + n*imSize);
+            ARRAY_TYPE rN(dimROne, r.begin() + n*rSize);
+
+            Gadgetron::multiply(kernel, imN, res_after_apply_kernel_);
+            this->sum_over_src_channel(res_after_apply_kernel_, rN);
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRITOperator<T>::apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& im, ARRAY_TYPE& r) ... ");
+    }
+}
+
+template<typename T>
+void hoSPIRITOperator<T>::apply_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    this->apply_kernel(forward_kernel_, im, r);
+}
+
+template<typename T>
+void hoSPIRITOperator<T>::apply_adjoint_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    this->apply_kernel(adjoint_kernel_, im, r);
+}
+
+template<typename T>
+void hoSPIRITOperator<T>::apply_adjoint_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    this->apply_kernel(adjoint_forward_kernel_, im, r);
+}
+
 template <typename T>
 void hoSPIRITOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
 {
@@ -206,9 +281,7 @@ void hoSPIRITOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_);
-
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_forward_kernel(complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
@@ -240,8 +313,7 @@ void hoSPIRITOperator<T>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
         this->convert_to_image(*x, complexIm_);
 
         // apply kernel and sum
-        Gadgetron::multiply(adjoint_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_adjoint_kernel(complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
@@ -283,9 +355,7 @@ void hoSPIRITOperator<T>::compute_righ_hand_side(const ARRAY_TYPE& x, ARRAY_TYPE
             this->convert_to_image(x, complexIm_);
 
             // apply kernel and sum
-            GADGET_CATCH_THROW(Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_));
-
-            GADGET_CATCH_THROW(this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_));
+            GADGET_CATCH_THROW(this->apply_forward_kernel(complexIm_, res_after_apply_kernel_sum_over_));
 
             // go back to kspace 
             this->convert_to_kspace(res_after_apply_kernel_sum_over_, b);
@@ -326,8 +396,7 @@ void hoSPIRITOperator<T>::gradient(ARRAY_TYPE* x, ARRAY_TYPE* g, bool accumulate
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(adjoint_forward_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_adjoint_forward_kernel(complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *g);
@@ -371,8 +440,7 @@ typename hoSPIRITOperator<T>::REAL hoSPIRITOperator<T>::magnitude(ARRAY_TYPE* x)
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_forward_kernel(complexIm_, res_after_apply_kernel_sum_over_);
 
         // L2 norm
         T obj(0);
@@ -31,12 +31,14 @@ public:
 
     /// set forward kernel, compute the adjoint and adjoint_forward kernel
     /// forward_kernel : [... srcCHA dstCHA]
-    void set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel=false);
+    virtual void set_forward_kernel(ARRAY_TYPE& forward_kernel, bool compute_adjoint_forward_kernel=false);
 
     /// apply(G-I)Dc'
     /// x: [ ... srcCHA]
     /// y: [ ... dstCHA]
     /// if no_null_space_==true, apply (G-I)
+    /// x and y can hold a batch of systems sharing the kernel, [... CHA N], e.g. for hoBatchCgSolver;
+    /// the acquired points are then set for the whole batch
     virtual void mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
     /// apply Dc(G-I)'
     /// if no_null_space_==true, (G-I)'
@@ -106,6 +108,16 @@ protected:
     // utility functions
     void sum_over_src_channel(const ARRAY_TYPE& x, ARRAY_TYPE& r);
 
+    /// apply kernel [... srcCHA dstCHA] to im [... srcCHA] and sum over srcCHA, r: [... dstCHA]
+    /// im can hold a batch of systems sharing the kernel, [... srcCHA N], then r is [... dstCHA N]
+    void apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& im, ARRAY_TYPE& r);
+
+    /// apply (G-I), (G-I)' or (G-I)'(G-I) in the image domain, as apply_kernel with the respective kernel
+    /// derived operators can store the kernels in another layout
+    virtual void apply_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+    virtual void apply_adjoint_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+    virtual void apply_adjoint_forward_kernel(const ARRAY_TYPE& im, ARRAY_TYPE& r);
+
     // helper memory
     ARRAY_TYPE kspace_;
     ARRAY_TYPE complexIm_;
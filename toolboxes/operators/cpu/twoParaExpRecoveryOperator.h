@@ -75,4 +75,20 @@ namespace Gadgetron {
             y[ii] = b[0] - b[0] * exp( -1 * x[ii] * rb);
         }
     }
+
+    // the same model for batchedLevenbergMarquardtSolver, value and gradient in one call
+    template <typename T> struct twoParaExpRecoveryModel
+    {
+        enum { NUM_PARAS = 2 };
+
+        static inline void evaluate(T x, const T* b, T& y, T* grad)
+        {
+            T rb = T(1) / ((std::abs(b[1])<FLT_EPSILON) ? ((b[1]<0) ? -FLT_EPSILON : FLT_EPSILON) : b[1]);
+
+            T val = std::exp(-x * rb);
+            y = b[0] - b[0] * val;
+            grad[0] = 1 - val;
+            grad[1] = -b[0] * val * x * rb * rb;
+        }
+    };
 }
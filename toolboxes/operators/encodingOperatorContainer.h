@@ -178,7 +178,9 @@ namespace Gadgetron{
 
     virtual void mult_MH( ARRAY_TYPE* in, ARRAY_TYPE* out, bool accumulate = false )
     {
-      ARRAY_TYPE tmp_image(get_domain_dimensions());
+      boost::shared_ptr< std::vector<size_t> > dims = get_domain_dimensions();
+      ARRAY_TYPE local_image;
+      ARRAY_TYPE &tmp_image = this->intermediate_buffer( this->domain_buffer_, local_image, dims.get() );
         
       for (size_t i=0; i<operators_.size(); i++){
       
@@ -202,8 +204,9 @@ namespace Gadgetron{
   
     virtual void mult_MH_M( ARRAY_TYPE* in, ARRAY_TYPE* out, bool accumulate = false )
     {
-
-      ARRAY_TYPE tmp_image(get_domain_dimensions());
+      boost::shared_ptr< std::vector<size_t> > dims = get_domain_dimensions();
+      ARRAY_TYPE local_image;
+      ARRAY_TYPE &tmp_image = this->intermediate_buffer( this->domain_buffer_, local_image, dims.get() );
     
       for (size_t i=0; i<operators_.size(); i++){
       
@@ -16,14 +16,14 @@ namespace Gadgetron{
   public:
     typedef typename ARRAY_TYPE::element_type ELEMENT_TYPE;
     typedef typename realType<ELEMENT_TYPE>::Type REAL;
-  linearOperator() : generalOperator<ARRAY_TYPE>() {}
+  linearOperator() : generalOperator<ARRAY_TYPE>(), keep_buffers_(false) {}
 
-  linearOperator(std::vector<size_t> *dims) : generalOperator<ARRAY_TYPE>(dims) {
+  linearOperator(std::vector<size_t> *dims) : generalOperator<ARRAY_TYPE>(dims), keep_buffers_(false) {
       set_codomain_dimensions(dims);
     }
 
   linearOperator(std::vector<size_t> *dims, std::vector<size_t> *codims)
-    : generalOperator<ARRAY_TYPE>(dims) {
+    : generalOperator<ARRAY_TYPE>(dims), keep_buffers_(false) {
       set_codomain_dimensions(codims);
     }
 
@@ -72,6 +72,20 @@ namespace Gadgetron{
 	return boost::shared_ptr< std::vector<size_t> >(dims);
       }
 
+    /**
+     * Keep the intermediate arrays of mult_MH_M (and of mult_MH in operator containers) between calls,
+     * instead of allocating them for every call. Only for operators which are not applied by several threads at once.
+     */
+    virtual void set_keep_buffers(bool keep) { keep_buffers_ = keep; }
+    virtual bool get_keep_buffers() { return keep_buffers_; }
+
+    // Release the intermediate arrays kept between calls
+    virtual void release_buffers()
+    {
+      if( codomain_buffer_.get_number_of_elements() > 0 ) codomain_buffer_.clear();
+      if( domain_buffer_.get_number_of_elements() > 0 ) domain_buffer_.clear();
+    }
+
     virtual void mult_M( ARRAY_TYPE* in, ARRAY_TYPE* out, bool accumulate = false) = 0;
     virtual void mult_MH( ARRAY_TYPE* in, ARRAY_TYPE* out, bool accumulate = false) = 0;
 
@@ -81,13 +95,28 @@ namespace Gadgetron{
 	throw std::runtime_error("Error: linearOperator::mult_MH_M : codomain dimensions not set");
       }
 
-      ARRAY_TYPE tmp;
-      tmp.create(&codomain_dims_);
+      ARRAY_TYPE local_tmp;
+      ARRAY_TYPE &tmp = intermediate_buffer( codomain_buffer_, local_tmp, &codomain_dims_ );
       mult_M( in, &tmp, false );
       mult_MH( &tmp, out, accumulate );
     }
 
   protected:
+
+    // Array for an intermediate result of the given dimensions:
+    // the kept buffer if keep_buffers_ is set, which is only reallocated when the dimensions change, otherwise the local array
+    ARRAY_TYPE& intermediate_buffer( ARRAY_TYPE &kept, ARRAY_TYPE &local, std::vector<size_t> *dims )
+    {
+      ARRAY_TYPE &buf = keep_buffers_ ? kept : local;
+      if( buf.get_number_of_elements() == 0 || !buf.dimensions_equal(dims) )
+	buf.create(dims);
+      return buf;
+    }
+
     std::vector<size_t> codomain_dims_;
+
+    bool keep_buffers_;
+    // intermediate arrays kept between calls if keep_buffers_ is set
+    ARRAY_TYPE codomain_buffer_, domain_buffer_;
   };
 }
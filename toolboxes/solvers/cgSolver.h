@@ -98,6 +98,20 @@ namespace Gadgetron{
     virtual void solver_dump( ARRAY_TYPE* ) {}
 
 
+    // Release the helper arrays kept between solves
+    //
+
+    virtual void release_workspace()
+    {
+      p_.reset();
+      r_.reset();
+      if( q_.get_number_of_elements() > 0 ) q_.clear();
+      if( mhm_q_.get_number_of_elements() > 0 ) mhm_q_.clear();
+      rhs_.reset();
+      if( rhs_tmp_.get_number_of_elements() > 0 ) rhs_tmp_.clear();
+    }
+
+
     //
     // Main solver interface
     //
@@ -182,16 +196,27 @@ namespace Gadgetron{
       	throw std::runtime_error( "Error: cgSolver::compute_rhs : encoding operator has not set domain dimension" );
       }
 
-      // Create result array and clear
+      // Create result array and clear.
+      // If the workspace is kept, the array is reused by the next call and overwritten.
       //
 
-      boost::shared_ptr<ARRAY_TYPE> result = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(image_dims.get()));
+      boost::shared_ptr<ARRAY_TYPE> result;
+      if( this->keep_workspace_ ){
+        if( rhs_.get() ) this->prepare_workspace( *rhs_, image_dims.get() );
+        else rhs_ = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(image_dims.get()));
+        result = rhs_;
+      }
+      else{
+        result = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(image_dims.get()));
+      }
       clear(result.get());
     
       // Create temporary array
       //
 
-      ARRAY_TYPE tmp(image_dims.get() );
+      ARRAY_TYPE local_tmp;
+      ARRAY_TYPE &tmp = this->keep_workspace_ ? rhs_tmp_ : local_tmp;
+      this->prepare_workspace( tmp, image_dims.get() );
 
       // Compute operator adjoint
       //
@@ -234,8 +259,12 @@ namespace Gadgetron{
       // Initialize r,p,x
       //
 
-      r_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*rhs) );
-      p_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*r_) );
+      // r and p are reused from the previous solve if the workspace is kept
+      if( r_.get() ) *r_ = *rhs;
+      else r_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*rhs) );
+
+      if( p_.get() ) *p_ = *r_;
+      else p_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*r_) );
     
       if( !this->get_x0().get() ){ // no starting image provided      
 	clear(x_.get());
@@ -259,15 +288,16 @@ namespace Gadgetron{
 	
         *x_ = *(this->get_x0());
         
-        ARRAY_TYPE mhmX( rhs->get_dimensions());
+        boost::shared_ptr< std::vector<size_t> > dims = rhs->get_dimensions();
+        this->prepare_workspace( q_, dims.get() );
 
         if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE ) {
           GDEBUG_STREAM("Preparing guess..." << std::endl);
         }
         
-        mult_MH_M( this->get_x0().get(), &mhmX );
+        mult_MH_M( this->get_x0().get(), &q_ );
         
-        *r_ -= mhmX;
+        *r_ -= q_;
         *p_ = *r_;
         
         // Apply preconditioning, twice (should change preconditioners to do this)
@@ -292,9 +322,11 @@ namespace Gadgetron{
 
     virtual void deinitialize()
     {
-      p_.reset();
-      r_.reset();
       x_.reset();
+
+      if( !this->keep_workspace_ ){
+        release_workspace();
+      }
     }
 
     // Perform full cg iteration
@@ -302,7 +334,9 @@ namespace Gadgetron{
 
     virtual void iterate( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
     {
-      ARRAY_TYPE q = ARRAY_TYPE(x_->get_dimensions());
+      boost::shared_ptr< std::vector<size_t> > dims = x_->get_dimensions();
+      this->prepare_workspace( q_, dims.get() );
+      ARRAY_TYPE &q = q_;
 
       // Perform one iteration of the solver
       //
@@ -313,34 +347,40 @@ namespace Gadgetron{
       //
 
       alpha_ = rq_/dot( p_.get(), &q );
-      axpy( alpha_, p_.get(), x_.get());
 
-      // Update residual
-      //
+      if( this->use_fused_kernels_ ){
+        iterate_fused( &q );
+      }
+      else{
+        axpy( alpha_, p_.get(), x_.get());
 
-      axpy( -alpha_, &q, r_.get());
+        // Update residual
+        //
 
-      // Apply preconditioning
-      //
+        axpy( -alpha_, &q, r_.get());
 
-      if( precond_.get() ){
+        // Apply preconditioning
+        //
 
-        precond_->apply( r_.get(), &q );
-        precond_->apply( &q, &q );
+        if( precond_.get() ){
+
+          precond_->apply( r_.get(), &q );
+          precond_->apply( &q, &q );
         
-        REAL tmp_rq = real(dot( r_.get(), &q ));      
-        *p_ *= ELEMENT_TYPE((tmp_rq/rq_));
-        axpy( ELEMENT_TYPE(1), &q, p_.get() );
-        rq_ = tmp_rq;
-      } 
-      else{
+          REAL tmp_rq = real(dot( r_.get(), &q ));      
+          *p_ *= ELEMENT_TYPE((tmp_rq/rq_));
+          axpy( ELEMENT_TYPE(1), &q, p_.get() );
+          rq_ = tmp_rq;
+        } 
+        else{
         
-        REAL tmp_rq = real(dot( r_.get(), r_.get()) );
-        *p_ *= ELEMENT_TYPE((tmp_rq/rq_));           
-        axpy( ELEMENT_TYPE(1), r_.get(), p_.get() );
-        rq_ = tmp_rq;      
+          REAL tmp_rq = real(dot( r_.get(), r_.get()) );
+          *p_ *= ELEMENT_TYPE((tmp_rq/rq_));           
+          axpy( ELEMENT_TYPE(1), r_.get(), p_.get() );
+          rq_ = tmp_rq;      
+        }
       }
-      
+
       // Invoke termination callback iteration
       //
 
@@ -349,6 +389,29 @@ namespace Gadgetron{
       }    
     }
     
+    // Update x, r and p with the fused kernels of solverUtils.h, alpha_ is already computed
+    //
+
+    virtual void iterate_fused( ARRAY_TYPE *q )
+    {
+      // x += alpha*p, r -= alpha*q and |r|^2 in one pass
+      REAL rr = solver_axpy2_nrm2sq( alpha_, p_.get(), x_.get(), q, r_.get() );
+
+      if( precond_.get() ){
+
+        precond_->apply( r_.get(), q );
+        precond_->apply( q, q );
+
+        REAL tmp_rq = real(dot( r_.get(), q ));
+        solver_xpby( q, ELEMENT_TYPE((tmp_rq/rq_)), p_.get() );
+        rq_ = tmp_rq;
+      }
+      else{
+        solver_xpby( r_.get(), ELEMENT_TYPE((rr/rq_)), p_.get() );
+        rq_ = rr;
+      }
+    }
+
     // Perform mult_MH_M of the encoding and regularization matrices
     //
 
@@ -368,7 +431,9 @@ namespace Gadgetron{
       // Intermediate storage
       //
 
-      ARRAY_TYPE q = ARRAY_TYPE(in->get_dimensions());
+      boost::shared_ptr< std::vector<size_t> > dims = in->get_dimensions();
+      this->prepare_workspace( mhm_q_, dims.get() );
+      ARRAY_TYPE &q = mhm_q_;
 
       // Start by clearing the output
       //
@@ -408,5 +473,11 @@ namespace Gadgetron{
     REAL rq0_;
     ELEMENT_TYPE alpha_;
     boost::shared_ptr<ARRAY_TYPE> x_, p_, r_;
+
+    // Right hand side, kept with the workspace
+    boost::shared_ptr<ARRAY_TYPE> rhs_;
+
+    // Helper memory, allocated once per problem size
+    ARRAY_TYPE q_, mhm_q_, rhs_tmp_;
   };
 }
@@ -0,0 +1,247 @@
+/** \file       batchedLevenbergMarquardtSolver.h
+    \brief      Implement the Levenberg-Marquardt least square curve fitting for a batch of curves
+
+                All curves share the sample positions x and are fitted with the same signal model at once.
+                The data is stored as structure of arrays, with the curve index running fastest, so the
+                inner loops run over the curves and are vectorized, one curve per SIMD lane.
+
+                The model is a class with the number of parameters NUM_PARAS and a static function
+                evaluate(x, b, y, grad), which computes the model value y and its gradient grad with
+                respect to the parameters b at one sample position, e.g. twoParaExpRecoveryModel.
+
+                ref: Donald W. Marquardt, "An Algorithm for Least-Squares Estimation of Nonlinear Parameters", SIAM Journal on Applied Mathematics, 11(2), 431-441, 1963.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+namespace Gadgetron {
+
+template <typename T, typename Model>
+class batchedLevenbergMarquardtSolver
+{
+public:
+
+    typedef batchedLevenbergMarquardtSolver<T, Model> Self;
+
+    enum { NUM_PARAS = Model::NUM_PARAS };
+
+    batchedLevenbergMarquardtSolver(double thres_fun=1e-6, size_t maxIter=100);
+    virtual ~batchedLevenbergMarquardtSolver();
+
+    /// fit L curves with K samples each
+    /// x: [K] sample positions
+    /// y: [L K] measured samples, sample k of curve l is y[l + k*L]
+    /// b: [L NUM_PARAS] initial parameters on input, fitted parameters on output, parameter p of curve l is b[l + p*L]
+    void solve(const T* x, size_t K, const T* y, size_t L, T* b);
+
+    /// threshold for minimal relative changes of the sum of squared residuals
+    double thres_fun_;
+    /// number of maximal iteration
+    size_t max_iter_;
+    /// initial damping, relative to the diagonal of the normal matrix
+    double lambda_init_;
+
+    /// [L] sum of squared residuals of every curve at the fitted parameters
+    std::vector<T> cost_;
+    /// [L] number of iterations of every curve
+    std::vector<size_t> iter_;
+
+protected:
+
+    /// compute the sum of squared residuals at b for the active curves
+    void eval_cost(const T* x, size_t K, const T* y, size_t L, const T* b, T* cost);
+
+    // buffers are kept between calls, a solver object can be reused for many batches
+    std::vector<T> jtj_;    // [L NUM_PARAS*(NUM_PARAS+1)/2] lower triangle of J'J
+    std::vector<T> jtr_;    // [L NUM_PARAS] J'r
+    std::vector<T> b_try_;  // [L NUM_PARAS]
+    std::vector<T> cost_try_;
+    std::vector<T> lambda_;
+    std::vector<unsigned char> active_;
+};
+
+template <typename T, typename Model>
+batchedLevenbergMarquardtSolver<T, Model>::
+batchedLevenbergMarquardtSolver(double thres_fun, size_t maxIter) : thres_fun_(thres_fun), max_iter_(maxIter), lambda_init_(1e-3)
+{
+}
+
+template <typename T, typename Model>
+batchedLevenbergMarquardtSolver<T, Model>::
+~batchedLevenbergMarquardtSolver()
+{
+}
+
+template <typename T, typename Model>
+void batchedLevenbergMarquardtSolver<T, Model>::
+eval_cost(const T* x, size_t K, const T* y, size_t L, const T* b, T* cost)
+{
+    const size_t P = NUM_PARAS;
+
+    size_t l, k, p;
+    for (l = 0; l < L; l++) cost[l] = 0;
+
+    for (k = 0; k < K; k++)
+    {
+        const T* yk = y + k*L;
+        const T xk = x[k];
+
+        for (l = 0; l < L; l++)
+        {
+            T bl[NUM_PARAS], g[NUM_PARAS], v;
+            for (p = 0; p < P; p++) bl[p] = b[l + p*L];
+
+            Model::evaluate(xk, bl, v, g);
+
+            T r = v - yk[l];
+            cost[l] += r*r;
+        }
+    }
+}
+
+template <typename T, typename Model>
+void batchedLevenbergMarquardtSolver<T, Model>::
+solve(const T* x, size_t K, const T* y, size_t L, T* b)
+{
+    const size_t P = NUM_PARAS;
+    const size_t PP = P*(P + 1) / 2;
+
+    cost_.resize(L);
+    iter_.assign(L, 0);
+    jtj_.resize(L*PP);
+    jtr_.resize(L*P);
+    b_try_.resize(L*P);
+    cost_try_.resize(L);
+    lambda_.assign(L, (T)lambda_init_);
+    active_.assign(L, 1);
+
+    T* cost = &cost_[0];
+    T* jtj = &jtj_[0];
+    T* jtr = &jtr_[0];
+    T* b_try = &b_try_[0];
+    T* cost_try = &cost_try_[0];
+    T* lambda = &lambda_[0];
+
+    size_t l, k, p, q, i;
+
+    this->eval_cost(x, K, y, L, b, cost);
+
+    size_t num_active = L;
+    size_t iter;
+    for (iter = 0; iter < max_iter_ && num_active > 0; iter++)
+    {
+        // normal equations at the current parameters
+        std::fill(jtj_.begin(), jtj_.end(), T(0));
+        std::fill(jtr_.begin(), jtr_.end(), T(0));
+
+        for (k = 0; k < K; k++)
+        {
+            const T* yk = y + k*L;
+            const T xk = x[k];
+
+            for (l = 0; l < L; l++)
+            {
+                T bl[NUM_PARAS], g[NUM_PARAS], v;
+                for (p = 0; p < P; p++) bl[p] = b[l + p*L];
+
+                Model::evaluate(xk, bl, v, g);
+
+                T r = v - yk[l];
+
+                i = 0;
+                for (p = 0; p < P; p++)
+                {
+                    jtr[l + p*L] += g[p] * r;
+                    for (q = 0; q <= p; q++, i++)
+                    {
+                        jtj[l + i*L] += g[p] * g[q];
+                    }
+                }
+            }
+        }
+
+        // solve (J'J + lambda*diag(J'J)) delta = -J'r by Cholesky decomposition, one small system per curve
+        for (l = 0; l < L; l++)
+        {
+            T a[NUM_PARAS][NUM_PARAS], d[NUM_PARAS];
+
+            i = 0;
+            for (p = 0; p < P; p++)
+            {
+                for (q = 0; q <= p; q++, i++)
+                {
+                    a[p][q] = jtj[l + i*L];
+                }
+                a[p][p] *= (1 + lambda[l]);
+                a[p][p] += std::numeric_limits<T>::min();
+                d[p] = -jtr[l + p*L];
+            }
+
+            for (q = 0; q < P; q++)
+            {
+                T s = a[q][q];
+                for (i = 0; i < q; i++) s -= a[q][i] * a[q][i];
+                a[q][q] = std::sqrt(std::max(s, std::numeric_limits<T>::min()));
+
+                for (p = q + 1; p < P; p++)
+                {
+                    T t = a[p][q];
+                    for (i = 0; i < q; i++) t -= a[p][i] * a[q][i];
+                    a[p][q] = t / a[q][q];
+                }
+            }
+
+            for (p = 0; p < P; p++)
+            {
+                for (i = 0; i < p; i++) d[p] -= a[p][i] * d[i];
+                d[p] /= a[p][p];
+            }
+
+            for (p = P; p-- > 0; )
+            {
+                for (i = p + 1; i < P; i++) d[p] -= a[i][p] * d[i];
+                d[p] /= a[p][p];
+            }
+
+            for (p = 0; p < P; p++)
+            {
+                b_try[l + p*L] = b[l + p*L] + (active_[l] ? d[p] : T(0));
+            }
+        }
+
+        this->eval_cost(x, K, y, L, b_try, cost_try);
+
+        // accept the steps that reduce the cost and adapt the damping
+        num_active = 0;
+        for (l = 0; l < L; l++)
+        {
+            if (!active_[l]) continue;
+
+            iter_[l]++;
+
+            if (cost_try[l] < cost[l] && std::isfinite(cost_try[l]))
+            {
+                T reduction = cost[l] - cost_try[l];
+
+                for (p = 0; p < P; p++) b[l + p*L] = b_try[l + p*L];
+                cost[l] = cost_try[l];
+                lambda[l] = std::max(lambda[l] / 10, (T)1e-12);
+
+                if (reduction <= thres_fun_*cost[l]) active_[l] = 0;
+            }
+            else
+            {
+                lambda[l] *= 10;
+                if (lambda[l] > (T)1e12) active_[l] = 0;
+            }
+
+            if (active_[l]) num_active++;
+        }
+    }
+}
+}
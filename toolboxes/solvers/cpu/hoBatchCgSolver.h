@@ -0,0 +1,224 @@
+/** \file   hoBatchCgSolver.h
+    \brief  Conjugate gradient solver for a batch of independent systems on the cpu.
+
+    The K systems are stacked along the last dimension of the arrays, e.g. [RO E1 CHA K] for K slices,
+    and are advanced in lockstep: the encoding and regularization operators are applied to all of them
+    at once, e.g. with one batched fft, and must not mix the systems. Every system has its own alpha and
+    beta. A system stops being updated once its relative residual rq/rq0 is below the tolerance, and
+    the solver returns when all systems have converged or the maximal number of iterations is reached.
+*/
+
+#pragma once
+
+#include "hoCgSolver.h"
+#include <vector>
+
+namespace Gadgetron{
+
+  template <class T> class hoBatchCgSolver : public hoCgSolver<T>
+  {
+  public:
+
+    typedef hoCgSolver<T> BaseClass;
+    typedef hoNDArray<T> ARRAY_TYPE;
+    typedef typename realType<T>::Type REAL;
+
+    hoBatchCgSolver() : BaseClass(), num_systems_(0), system_size_(0) {}
+    virtual ~hoBatchCgSolver() {}
+
+    // Number of iterations every system ran in the last solve
+    virtual const std::vector<unsigned int>& get_system_iterations() const { return iter_k_; }
+
+    // Relative residual rq/rq0 of every system at the end of the last solve
+    virtual std::vector<REAL> get_system_residuals() const
+    {
+      std::vector<REAL> res(num_systems_, REAL(0));
+      for( size_t k=0; k<num_systems_; k++ ){
+        if( rq0_k_[k] > REAL(0) ) res[k] = rq_k_[k]/rq0_k_[k];
+      }
+      return res;
+    }
+
+  protected:
+
+    // Initialize solver, as cgSolver::initialize with rq and rq0 per system
+    //
+
+    virtual void initialize( ARRAY_TYPE *rhs )
+    {
+      if( !rhs || rhs->get_number_of_elements() == 0 ){
+        throw std::runtime_error( "Error: hoBatchCgSolver::initialize : empty or NULL rhs provided" );
+      }
+
+      num_systems_ = rhs->get_size( rhs->get_number_of_dimensions()-1 );
+      system_size_ = rhs->get_number_of_elements()/num_systems_;
+
+      this->x_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(rhs->get_dimensions()) );
+
+      if( this->r_.get() ) *this->r_ = *rhs;
+      else this->r_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*rhs) );
+
+      if( this->p_.get() ) *this->p_ = *this->r_;
+      else this->p_ = boost::shared_ptr<ARRAY_TYPE>( new ARRAY_TYPE(*this->r_) );
+
+      if( this->precond_.get() ){
+        this->precond_->apply( this->p_.get(), this->p_.get() );
+        this->precond_->apply( this->p_.get(), this->p_.get() );
+      }
+
+      this->system_dot( this->r_.get(), this->p_.get(), rq0_k_ );
+
+      if( this->get_x0().get() ){
+
+        if( !this->get_x0()->dimensions_equal( rhs ) ){
+          throw std::runtime_error( "Error: hoBatchCgSolver::initialize : RHS and initial guess must have same dimensions" );
+        }
+
+        *this->x_ = *(this->get_x0());
+
+        boost::shared_ptr< std::vector<size_t> > dims = rhs->get_dimensions();
+        this->prepare_workspace( this->q_, dims.get() );
+        this->mult_MH_M( this->get_x0().get(), &this->q_ );
+
+        *this->r_ -= this->q_;
+        *this->p_ = *this->r_;
+
+        if( this->precond_.get() ){
+          this->precond_->apply( this->p_.get(), this->p_.get() );
+          this->precond_->apply( this->p_.get(), this->p_.get() );
+        }
+      }
+      else{
+        clear( this->x_.get() );
+      }
+
+      this->system_dot( this->r_.get(), this->p_.get(), rq_k_ );
+
+      // systems with a zero right hand side or an initial guess within the tolerance are not iterated
+      active_.assign( num_systems_, 1 );
+      iter_k_.assign( num_systems_, 0 );
+      for( size_t k=0; k<num_systems_; k++ ){
+        if( !(rq0_k_[k] > REAL(0)) || rq_k_[k]/rq0_k_[k] < this->tc_tolerance_ ){
+          this->deactivate( k );
+        }
+      }
+    }
+
+    // Perform one cg iteration for all active systems
+    //
+
+    virtual void iterate( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
+    {
+      boost::shared_ptr< std::vector<size_t> > dims = this->x_->get_dimensions();
+      this->prepare_workspace( this->q_, dims.get() );
+      ARRAY_TYPE &q = this->q_;
+
+      // one operator application for the whole batch
+      this->mult_MH_M( this->p_.get(), &q );
+
+      size_t k;
+      for( k=0; k<num_systems_; k++ ){
+
+        if( !active_[k] ) continue;
+
+        ARRAY_TYPE pk, qk, xk, rk;
+        this->system( *this->p_, k, pk );
+        this->system( q, k, qk );
+        this->system( *this->x_, k, xk );
+        this->system( *this->r_, k, rk );
+
+        T alpha = T( rq_k_[k]/real(dot( &pk, &qk )) );
+
+        // x += alpha*p, r -= alpha*q and |r|^2 in one pass
+        REAL rr = solver_axpy2_nrm2sq( alpha, &pk, &xk, &qk, &rk );
+
+        if( !this->precond_.get() ){
+          solver_xpby( &rk, T(rr/rq_k_[k]), &pk );
+          rq_k_[k] = rr;
+        }
+      }
+
+      if( this->precond_.get() ){
+
+        this->precond_->apply( this->r_.get(), &q );
+        this->precond_->apply( &q, &q );
+
+        for( k=0; k<num_systems_; k++ ){
+
+          if( !active_[k] ) continue;
+
+          ARRAY_TYPE pk, qk, rk;
+          this->system( *this->p_, k, pk );
+          this->system( q, k, qk );
+          this->system( *this->r_, k, rk );
+
+          REAL tmp_rq = real(dot( &rk, &qk ));
+          solver_xpby( &qk, T(tmp_rq/rq_k_[k]), &pk );
+          rq_k_[k] = tmp_rq;
+        }
+      }
+
+      // convergence mask
+      //
+
+      size_t num_active = 0;
+      REAL max_metric = 0;
+      for( k=0; k<num_systems_; k++ ){
+
+        if( !active_[k] ) continue;
+
+        iter_k_[k]++;
+
+        REAL metric = rq_k_[k]/rq0_k_[k];
+        if( metric > max_metric ) max_metric = metric;
+
+        if( metric < this->tc_tolerance_ ) this->deactivate( k );
+        else num_active++;
+      }
+
+      if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE ){
+        GDEBUG_STREAM("Iteration " << iteration << ". max rq/rq_0 = " << max_metric << ", " << num_active << " of " << num_systems_ << " systems active" << std::endl);
+      }
+
+      *tc_metric = max_metric;
+      *tc_terminate = ( num_active == 0 );
+    }
+
+    // Stop updating system k; its search direction is cleared, so the operator
+    // applications of the following iterations leave it at zero
+    void deactivate( size_t k )
+    {
+      active_[k] = 0;
+
+      ARRAY_TYPE pk;
+      this->system( *this->p_, k, pk );
+      clear( &pk );
+    }
+
+    // Array of system k, sharing the memory of a
+    void system( ARRAY_TYPE& a, size_t k, ARRAY_TYPE& ak )
+    {
+      ak.create( system_size_, a.begin() + k*system_size_ );
+    }
+
+    // Real part of the dot product of every system
+    void system_dot( ARRAY_TYPE* a, ARRAY_TYPE* b, std::vector<REAL>& res )
+    {
+      res.resize( num_systems_ );
+      for( size_t k=0; k<num_systems_; k++ ){
+        ARRAY_TYPE ak, bk;
+        this->system( *a, k, ak );
+        this->system( *b, k, bk );
+        res[k] = real(dot( &ak, &bk ));
+      }
+    }
+
+    size_t num_systems_;
+    size_t system_size_;
+
+    std::vector<REAL> rq_k_;
+    std::vector<REAL> rq0_k_;
+    std::vector<unsigned char> active_;
+    std::vector<unsigned int> iter_k_;
+  };
+}
@@ -10,6 +10,7 @@
 
 #include "cgSolver.h"
 #include "hoNDArray_math.h"
+#include "hoSolverUtils.h"
 
 namespace Gadgetron{
 
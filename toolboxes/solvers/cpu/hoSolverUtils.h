@@ -3,6 +3,8 @@
 #include "hoNDArray.h"
 #include "hoNDArray_math.h"
 #include "complext.h"
+#include "solverUtils.h"
+#include <cmath>
 
 #ifdef USE_OMP
 #include <omp.h>
@@ -23,4 +25,93 @@ template<class T> void solver_non_negativity_filter(hoNDArray<T> *xdata, hoNDArr
 		if( (real(x[i]) <= REAL(0)) && (real(g[i]) > 0) )
 			g[i]=T(0);
 }
+
+// Single pass versions of the solver vector updates of solverUtils.h;
+// every element is read and written once, instead of once per blas call
+
+/// x += a*p, r -= a*q; returns the squared l2 norm of the updated r
+template<class T> typename realType<T>::Type solver_axpy2_nrm2sq(T a, hoNDArray<T> *pdata, hoNDArray<T> *xdata, hoNDArray<T> *qdata, hoNDArray<T> *rdata)
+{
+	typedef typename realType<T>::Type REAL;
+
+	const T* p = pdata->get_data_ptr();
+	T* x = xdata->get_data_ptr();
+	const T* q = qdata->get_data_ptr();
+	T* r = rdata->get_data_ptr();
+
+	long long N = (long long)xdata->get_number_of_elements();
+	double nrm = 0; // accumulated in double, the partial sums of large arrays lose precision in float
+
+#ifdef USE_OMP
+#pragma omp parallel for reduction(+:nrm) if(N>64*1024)
+#endif
+	for( long long i=0; i < N; i++ ){
+		x[i] += a*p[i];
+		T v = r[i] - a*q[i];
+		r[i] = v;
+		nrm += (double)norm(v);
+	}
+
+	return (REAL)nrm;
+}
+
+/// y = x + b*y
+template<class T> void solver_xpby(hoNDArray<T> *xdata, T b, hoNDArray<T> *ydata)
+{
+	const T* x = xdata->get_data_ptr();
+	T* y = ydata->get_data_ptr();
+
+	long long N = (long long)ydata->get_number_of_elements();
+
+#ifdef USE_OMP
+#pragma omp parallel for if(N>64*1024)
+#endif
+	for( long long i=0; i < N; i++ )
+		y[i] = x[i] + b*y[i];
+}
+
+/// y = a*x + b*y; returns the l2 norm of the updated y
+template<class T> typename realType<T>::Type solver_axpby_nrm2(T a, hoNDArray<T> *xdata, T b, hoNDArray<T> *ydata)
+{
+	typedef typename realType<T>::Type REAL;
+
+	const T* x = xdata->get_data_ptr();
+	T* y = ydata->get_data_ptr();
+
+	long long N = (long long)ydata->get_number_of_elements();
+	double nrm = 0;
+
+#ifdef USE_OMP
+#pragma omp parallel for reduction(+:nrm) if(N>64*1024)
+#endif
+	for( long long i=0; i < N; i++ ){
+		T v = a*x[i] + b*y[i];
+		y[i] = v;
+		nrm += (double)norm(v);
+	}
+
+	return (REAL)std::sqrt(nrm);
+}
+
+/// returns the l2 norm of x-y and copies x to y
+template<class T> typename realType<T>::Type solver_diff_nrm2_copy(hoNDArray<T> *xdata, hoNDArray<T> *ydata)
+{
+	typedef typename realType<T>::Type REAL;
+
+	const T* x = xdata->get_data_ptr();
+	T* y = ydata->get_data_ptr();
+
+	long long N = (long long)ydata->get_number_of_elements();
+	double nrm = 0;
+
+#ifdef USE_OMP
+#pragma omp parallel for reduction(+:nrm) if(N>64*1024)
+#endif
+	for( long long i=0; i < N; i++ ){
+		nrm += (double)norm(T(x[i] - y[i]));
+		y[i] = x[i];
+	}
+
+	return (REAL)std::sqrt(nrm);
+}
 }
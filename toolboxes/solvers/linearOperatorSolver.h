@@ -6,6 +6,7 @@
 
 #include "solver.h"
 #include "linearOperator.h"
+#include "solverUtils.h"
 
 #include <vector>
 #include <iostream>
@@ -19,7 +20,7 @@ namespace Gadgetron{
   public:
 
     // Constructor
-    linearOperatorSolver() : solver<ARRAY_TYPE,ARRAY_TYPE>() {}
+    linearOperatorSolver() : solver<ARRAY_TYPE,ARRAY_TYPE>(), keep_workspace_(false), use_fused_kernels_(false) {}
   
     // Destructor
     virtual ~linearOperatorSolver() {}
@@ -61,8 +62,35 @@ namespace Gadgetron{
     {
       return regularization_operators_.size();
     }
+
+    // Keep the helper arrays of the iterations between solves (default false).
+    // When the same problem size is solved again, e.g. for every slice or frame, nothing is reallocated.
+    virtual void set_keep_workspace( bool keep ) { keep_workspace_ = keep; }
+    virtual bool get_keep_workspace() { return keep_workspace_; }
+
+    // Release the helper arrays kept between solves
+    virtual void release_workspace() {}
+
+    // Update the vectors of the iterations with the fused kernels of solverUtils.h (default false),
+    // which combine the separate axpy/dot/nrm2 calls of an update into a single pass over the arrays
+    virtual void set_use_fused_kernels( bool use ) { use_fused_kernels_ = use; }
+    virtual bool get_use_fused_kernels() { return use_fused_kernels_; }
     
   protected:
+
+    // Make sure a helper array has the given dimensions; it is only reallocated when they change
+    static void prepare_workspace( ARRAY_TYPE &a, std::vector<size_t> *dims )
+    {
+      if( a.get_number_of_elements() == 0 || !a.dimensions_equal(dims) ){
+        a.create(dims);
+      }
+    }
+
+    // Whether the helper arrays are kept between solves
+    bool keep_workspace_;
+
+    // Whether the fused vector updates are used
+    bool use_fused_kernels_;
   
     // Single encoding operator
     boost::shared_ptr< linearOperator<ARRAY_TYPE> > encoding_operator_;
@@ -61,7 +61,34 @@ public:
             int flag = 1;
 
             REAL tolb = tc_tolerance_ * n2b;
-            ARRAY_TYPE u(*b);
+
+            // helper memory is only allocated when the problem size changes
+            ARRAY_TYPE& u = u_;
+            ARRAY_TYPE& v = v_;
+            ARRAY_TYPE& d = d_;
+            ARRAY_TYPE& z = z_;
+            ARRAY_TYPE& dtmp = dtmp_;
+            ARRAY_TYPE& ztmp = ztmp_;
+            ARRAY_TYPE& vt = vt_;
+            ARRAY_TYPE& utmp = utmp_;
+
+            // the fused kernels of solverUtils.h update and measure a vector in one pass, without z, dtmp and ztmp
+            bool fused = this->use_fused_kernels_;
+
+            boost::shared_ptr< std::vector<size_t> > dims = x->get_dimensions();
+            this->prepare_workspace(v, dims.get());
+            this->prepare_workspace(d, dims.get());
+            if (!fused)
+            {
+                this->prepare_workspace(z, dims.get());
+                this->prepare_workspace(dtmp, dims.get());
+                this->prepare_workspace(ztmp, dims.get());
+            }
+            this->prepare_workspace(vt, dims.get());
+
+            u = *b;
+            dims = b->get_dimensions();
+            this->prepare_workspace(utmp, dims.get());
 
             this->encoding_operator_->mult_M(x, &u);
             Gadgetron::subtract(*b, u, u);
@@ -78,7 +105,6 @@ public:
             REAL s = 0;
             REAL phibar = beta;
 
-            ARRAY_TYPE v(x);
             this->encoding_operator_->mult_MH(&u, &v);
 
             REAL alpha = Gadgetron::nrm2(&v);
@@ -87,7 +113,6 @@ public:
                 Gadgetron::scal(REAL(1.0) / alpha, v);
             }
 
-            ARRAY_TYPE d(x);
             Gadgetron::clear(d);
 
             REAL normar;
@@ -97,6 +122,7 @@ public:
             if (std::abs(normar) < DBL_EPSILON)
             {
                 Gadgetron::clear(x);
+                if (!this->keep_workspace_) this->release_workspace();
                 return;
             }
 
@@ -106,21 +132,31 @@ public:
             size_t iter = iterations_;
             size_t  maxstagsteps = 3;
 
-            ARRAY_TYPE z(v), dtmp(d), ztmp(v), vt(v), utmp(u);
             ARRAY_TYPE normaVec(3);
 
             REAL thet, rhot, rho, phi, tmp, tmp2;
 
+            // with the fused kernels, the norm of x is computed along with its update
+            REAL normx = fused ? Gadgetron::nrm2(x) : REAL(0);
+
             size_t ii;
             for (ii = 0; ii<iterations_; ii++)
             {
-                z = v;
+                if (!fused) z = v;
+                ARRAY_TYPE& zv = fused ? v : z;
 
-                this->encoding_operator_->mult_M(&z, &utmp);
-                Gadgetron::scal(alpha, u);
-                Gadgetron::subtract(utmp, u, u);
+                this->encoding_operator_->mult_M(&zv, &utmp);
+                if (fused)
+                {
+                    beta = solver_axpby_nrm2(ELEMENT_TYPE(1), &utmp, ELEMENT_TYPE(-alpha), &u);
+                }
+                else
+                {
+                    Gadgetron::scal(alpha, u);
+                    Gadgetron::subtract(utmp, u, u);
+                    beta = Gadgetron::nrm2(&u);
+                }
 
-                beta = Gadgetron::nrm2(&u);
                 Gadgetron::scal(REAL(1.0) / beta, u);
 
                 normaVec(0) = norma;
@@ -141,17 +177,24 @@ public:
 
                 phibar = s * phibar;
 
-                dtmp = d;
-                Gadgetron::scal(thet, dtmp);
-                Gadgetron::subtract(z, dtmp, ztmp);
-                Gadgetron::scal(REAL(1.0) / rho, ztmp);
+                if (fused)
+                {
+                    tmp = solver_axpby_nrm2(ELEMENT_TYPE(REAL(1.0) / rho), &zv, ELEMENT_TYPE(-thet / rho), &d);
+                }
+                else
+                {
+                    dtmp = d;
+                    Gadgetron::scal(thet, dtmp);
+                    Gadgetron::subtract(z, dtmp, ztmp);
+                    Gadgetron::scal(REAL(1.0) / rho, ztmp);
 
-                d = ztmp;
-                tmp = Gadgetron::nrm2(&d);
+                    d = ztmp;
+                    tmp = Gadgetron::nrm2(&d);
+                }
                 sumnormd2 += (tmp*tmp);
 
                 // Check for stagnation of the method
-                tmp2 = Gadgetron::nrm2(x);
+                tmp2 = fused ? normx : Gadgetron::nrm2(x);
 
                 if (std::abs(phi)*std::abs(tmp) < DBL_EPSILON*std::abs(tmp2))
                 {
@@ -182,20 +225,34 @@ public:
                     break;
                 }
 
-                // memcpy(dtmp.begin(), d.begin(), d.get_number_of_bytes());
-                dtmp = d;
+                if (fused)
+                {
+                    normx = solver_axpby_nrm2(ELEMENT_TYPE(phi), &d, ELEMENT_TYPE(1), x);
+                }
+                else
+                {
+                    // memcpy(dtmp.begin(), d.begin(), d.get_number_of_bytes());
+                    dtmp = d;
 
-                Gadgetron::scal(phi, dtmp);
-                Gadgetron::add(*x, dtmp, *x);
+                    Gadgetron::scal(phi, dtmp);
+                    Gadgetron::add(*x, dtmp, *x);
+                }
 
                 normr = (REAL)(std::abs((double)s) * normr);
 
                 this->encoding_operator_->mult_MH(&u, &vt);
 
-                Gadgetron::scal(beta, v);
-                Gadgetron::subtract(vt, v, v);
+                if (fused)
+                {
+                    alpha = solver_axpby_nrm2(ELEMENT_TYPE(1), &vt, ELEMENT_TYPE(-beta), &v);
+                }
+                else
+                {
+                    Gadgetron::scal(beta, v);
+                    Gadgetron::subtract(vt, v, v);
 
-                alpha = Gadgetron::nrm2(&v);
+                    alpha = Gadgetron::nrm2(&v);
+                }
 
                 Gadgetron::scal(REAL(1.0) / alpha, v);
 
@@ -219,6 +276,8 @@ public:
                     flag = 0;
                 }
             }
+
+            if (!this->keep_workspace_) this->release_workspace();
         }
         catch (...)
         {
@@ -233,10 +292,22 @@ public:
         return x;
     }
 
+    virtual void release_workspace()
+    {
+        ARRAY_TYPE* buf[] = { &u_, &v_, &d_, &z_, &dtmp_, &ztmp_, &vt_, &utmp_ };
+        for (size_t n = 0; n < sizeof(buf) / sizeof(buf[0]); n++)
+        {
+            if (buf[n]->get_number_of_elements() > 0) buf[n]->clear();
+        }
+    }
+
 protected:
 
     unsigned int iterations_;
     REAL tc_tolerance_;
+
+    // helper memory of the iterations
+    ARRAY_TYPE u_, v_, d_, z_, dtmp_, ztmp_, vt_, utmp_;
 };
 
 }
@@ -63,6 +63,7 @@ protected:
 			d_k.reset();
 			b_k.reset();
 			p_M.reset();
+			if (tmp_k.get_number_of_elements() > 0) tmp_k.clear();
 		}
 
 		REAL get_weight(){ return reg_op->get_weight(); }
@@ -82,6 +83,8 @@ protected:
 		boost::shared_ptr<ARRAY_TYPE_ELEMENT> b_k;
 		boost::shared_ptr<ARRAY_TYPE_ELEMENT> p_M;
 		boost::shared_ptr<ARRAY_TYPE_ELEMENT> prior;
+		// helper memory for update_dk, allocated once per solve
+		ARRAY_TYPE_ELEMENT tmp_k;
 	};
 
 	class sbL1RegularizationOperator : public sbRegularizationOperator
@@ -91,7 +94,8 @@ protected:
 
 		virtual void update_dk(ARRAY_TYPE_ELEMENT* u_k)
 		{
-			ARRAY_TYPE_ELEMENT tmp(*this->b_k);
+			ARRAY_TYPE_ELEMENT& tmp = this->tmp_k;
+			tmp = *this->b_k;
 			this->reg_op->mult_M(u_k,&tmp,true);
 			if (this->prior.get())
 				tmp -= *(this->p_M);
@@ -116,7 +120,8 @@ protected:
 
 		virtual void update_dk(ARRAY_TYPE_ELEMENT* u_k)
 		{
-			ARRAY_TYPE_ELEMENT tmp(*this->b_k);
+			ARRAY_TYPE_ELEMENT& tmp = this->tmp_k;
+			tmp = *this->b_k;
 			this->reg_op->mult_M(u_k,&tmp,true);
 			if (this->prior.get())
 				tmp -= *(this->p_M);
@@ -671,6 +676,13 @@ protected:
 		inner_solver_->set_encoding_operator( enc_op_container_ );
 		enc_op_container_->add_operator( this->encoding_operator_ );
 
+		// The inner problem has the same size in every inner iteration
+		enc_op_container_->set_keep_buffers(true);
+		inner_solver_->set_keep_workspace(true);
+
+		// The fused kernel mode is passed on to the inner solver, which runs most of the vector updates
+		inner_solver_->set_use_fused_kernels(this->use_fused_kernels_);
+
 		// Invoke initialization on all regularization operators
 		//
 
@@ -685,11 +697,24 @@ protected:
 
 	virtual void deinitialize()
 	{
+		// Stop keeping the buffers of the inner problem, and release them unless the workspace is kept
+		enc_op_container_->set_keep_buffers(false);
+		if (!this->keep_workspace_){
+			enc_op_container_->release_buffers();
+		}
+
 		enc_op_container_ = boost::shared_ptr<encodingOperatorContainer<ARRAY_TYPE_ELEMENT> >( new encodingOperatorContainer<ARRAY_TYPE_ELEMENT>);
 		inner_solver_->set_encoding_operator( enc_op_container_ );
 		for (int i=0; i < regularization_operators_.size(); i++){
 			regularization_operators_[i]->deinitialize();
 		}
+
+		// The inner solver keeps its helper memory only if this solver does
+		inner_solver_->set_keep_workspace(this->keep_workspace_);
+		if (!this->keep_workspace_){
+			inner_solver_->release_workspace();
+			if (encoding_space_.get_number_of_elements() > 0) encoding_space_.clear();
+		}
 		if (non_negativity_filter_weight_ > REAL(0)){
 			regularization_operators_.pop_back();
 		}
@@ -732,12 +757,14 @@ protected:
 				if( this->output_mode_ >= solver<ARRAY_TYPE_ELEMENT, ARRAY_TYPE_ELEMENT>::OUTPUT_VERBOSE )
 					GDEBUG_STREAM(std::endl << "SB inner loop iteration " << inner_iteration << std::endl << std::endl);
 
-				{ // Brackets used to free 'data' below as soon as it goes out of scope
-
+				{
 					// Setup input vector to the encoding operator container (argument to the inner solver's solve)
+					// It is allocated once and reused in every inner iteration
 					//
 
-					ARRAY_TYPE_ELEMENT data(enc_op_container_->get_codomain_dimensions());
+					boost::shared_ptr< std::vector<size_t> > codom_dims = enc_op_container_->get_codomain_dimensions();
+					this->prepare_workspace(encoding_space_, codom_dims.get());
+					ARRAY_TYPE_ELEMENT& data = encoding_space_;
 					ARRAY_TYPE_ELEMENT tmp(f->get_dimensions().get(), data.get_data_ptr() );
 
 					tmp = *f;
@@ -790,9 +817,16 @@ protected:
 
 			// Output change in u_k
 			if( tolerance > REAL(0) || this->output_mode_ >= solver<ARRAY_TYPE_ELEMENT, ARRAY_TYPE_ELEMENT>::OUTPUT_VERBOSE ){
-				u_k_prev *= ELEMENT_TYPE(-1);
-				u_k_prev += *u_k;
-				REAL delta = nrm2(&u_k_prev);
+				REAL delta;
+				if( this->use_fused_kernels_ ){
+					// |u_k - u_k_prev| and u_k_prev = u_k in one pass
+					delta = solver_diff_nrm2_copy(u_k.get(), &u_k_prev);
+				}
+				else{
+					u_k_prev *= ELEMENT_TYPE(-1);
+					u_k_prev += *u_k;
+					delta = nrm2(&u_k_prev);
+				}
 
 				if( this->output_mode_ >= solver<ARRAY_TYPE_ELEMENT, ARRAY_TYPE_ELEMENT>::OUTPUT_VERBOSE )
 					GDEBUG_STREAM("u_k delta l2-norm (outer loop): " << delta << std::endl << std::endl);
@@ -800,7 +834,8 @@ protected:
 				if( delta < tolerance )
 					break;
 
-				u_k_prev = *u_k;
+				if( !this->use_fused_kernels_ )
+					u_k_prev = *u_k;
 			}
 		} // end of outer loop
 	}
@@ -838,5 +873,8 @@ protected:
 	std::vector<unsigned int> weights_backup_;
 	REAL non_negativity_filter_weight_;
 	bool use_x0_;
+
+	// helper memory, the input of the inner solver
+	ARRAY_TYPE_ELEMENT encoding_space_;
 };
 }
@@ -0,0 +1,50 @@
+/** \file   solverUtils.h
+    \brief  Vector updates of the solver iterations which combine several blas level 1 calls.
+
+    The generic versions below compose the separate axpy/dot/nrm2 calls and work for any array type.
+    Array types with a faster, single pass implementation overload them, e.g. hoSolverUtils.h for hoNDArray.
+    Solvers use them when the fused kernel mode is switched on (linearOperatorSolver::set_use_fused_kernels).
+*/
+
+#pragma once
+
+#include "complext.h"
+
+namespace Gadgetron {
+
+/// x += a*p, r -= a*q; returns the squared l2 norm of the updated r
+template<class ARRAY_TYPE> typename realType<typename ARRAY_TYPE::element_type>::Type
+solver_axpy2_nrm2sq(typename ARRAY_TYPE::element_type a, ARRAY_TYPE* p, ARRAY_TYPE* x, ARRAY_TYPE* q, ARRAY_TYPE* r)
+{
+    axpy(a, p, x);
+    axpy(-a, q, r);
+    return real(dot(r, r));
+}
+
+/// y = x + b*y
+template<class ARRAY_TYPE>
+void solver_xpby(ARRAY_TYPE* x, typename ARRAY_TYPE::element_type b, ARRAY_TYPE* y)
+{
+    *y *= b;
+    axpy(typename ARRAY_TYPE::element_type(1), x, y);
+}
+
+/// y = a*x + b*y; returns the l2 norm of the updated y
+template<class ARRAY_TYPE> typename realType<typename ARRAY_TYPE::element_type>::Type
+solver_axpby_nrm2(typename ARRAY_TYPE::element_type a, ARRAY_TYPE* x, typename ARRAY_TYPE::element_type b, ARRAY_TYPE* y)
+{
+    *y *= b;
+    axpy(a, x, y);
+    return nrm2(y);
+}
+
+/// returns the l2 norm of x-y and copies x to y
+template<class ARRAY_TYPE> typename realType<typename ARRAY_TYPE::element_type>::Type
+solver_diff_nrm2_copy(ARRAY_TYPE* x, ARRAY_TYPE* y)
+{
+    *y -= *x;
+    typename realType<typename ARRAY_TYPE::element_type>::Type v = nrm2(y);
+    *y = *x;
+    return v;
+}
+}